@@ -0,0 +1,158 @@
+#include "BackgroundSave.h"
+#include "DialogueBake.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+SaveWorker::SaveWorker() : thread(&SaveWorker::Run, this) {
+}
+
+SaveWorker::~SaveWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    //a queued save still gets written so closing straight after Ctrl+S loses nothing
+    thread.join();
+}
+
+void SaveWorker::Start(std::vector<Character> snapshot, const std::string& path, const WriteOptions& options) {
+    Job job;
+    job.characters = std::move(snapshot);
+    job.path = path;
+    job.options = options;
+    Queue(std::move(job));
+}
+
+void SaveWorker::StartSharded(ShardedSaveJob shards, const std::string& directory, const WriteOptions& options) {
+    Job job;
+    job.kind = JobKind::Sharded;
+    job.shards = std::move(shards);
+    job.path = directory;
+    job.options = options;
+    Queue(std::move(job));
+}
+
+void SaveWorker::StartBake(std::vector<Character> snapshot, const std::string& path) {
+    Job job;
+    job.kind = JobKind::Baked;
+    job.characters = std::move(snapshot);
+    job.path = path;
+    Queue(std::move(job));
+}
+
+void SaveWorker::Queue(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto queued = std::find_if(pending.begin(), pending.end(), [&](const Job& older) { return older.kind == job.kind && older.path == job.path; });
+        if (queued == pending.end()) {
+            pending.push_back(std::move(job));
+        }
+        else {
+            if (job.kind == JobKind::Sharded) {
+                //the dirty flags were cleared when the older job was prepared, so keep its shards
+                //unless the newer job carries a fresher copy of the same character
+                for (auto& older : queued->shards.changed) {
+                    bool replaced = false;
+                    for (auto& newer : job.shards.changed) {
+                        if (newer.shard == older.shard) {
+                            replaced = true;
+                            break;
+                        }
+                    }
+                    if (!replaced) {
+                        job.shards.changed.push_back(std::move(older));
+                    }
+                }
+            }
+            *queued = std::move(job);
+        }
+    }
+    wake.notify_one();
+}
+
+SaveStatus SaveWorker::Status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    SaveStatus current = status;
+    if (current.state == SaveState::Saving) {
+        current.messagesWritten = progress.load(std::memory_order_relaxed);
+    }
+    current.finished = finished;
+    current.failed = failed;
+    current.failedSaves = failedSaves;
+    current.lastFailure = lastFailure;
+    return current;
+}
+
+void SaveWorker::SetOnFinished(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onFinished = std::move(callback);
+}
+
+bool SaveWorker::Busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !pending.empty() || status.state == SaveState::Saving;
+}
+
+void SaveWorker::Run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return !pending.empty() || stopping; });
+            if (pending.empty()) {
+                return;
+            }
+            job = std::move(pending.front());
+            pending.pop_front();
+
+            status = SaveStatus();
+            status.state = SaveState::Saving;
+            for (auto& character : job.kind == JobKind::Sharded ? job.shards.changed : job.characters) {
+                status.totalMessages += character.messages.size();
+            }
+            progress = 0;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ProfileSpan span("save");
+        SaveResult result;
+        switch (job.kind) {
+        case JobKind::Json:
+            result = SaveCharactersToFile(job.path, job.characters, job.options, &progress);
+            break;
+        case JobKind::Sharded:
+            result = SaveShardedProject(job.path, job.shards, job.options, &progress);
+            break;
+        case JobKind::Baked:
+            result = SaveBakedFile(job.path, job.characters);
+            progress = status.totalMessages;
+            break;
+        }
+        span.AddBytes(result.bytesWritten);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            status.state = result.ok ? SaveState::Done : SaveState::Failed;
+            status.messagesWritten = progress.load();
+            status.bytesWritten = result.bytesWritten;
+            status.seconds = seconds;
+            status.error = result.error;
+            finished++;
+            if (!result.ok) {
+                failed++;
+                failedSaves += job.kind == JobKind::Baked ? 0 : 1;
+                lastFailure = result.error;
+            }
+            callback = onFinished;
+        }
+        if (callback) {
+            callback();
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueWriter.h"
+#include "ProjectFiles.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class SaveState {
+    Idle,
+    Saving,
+    Done,
+    Failed
+};
+
+struct SaveStatus {
+    SaveState state = SaveState::Idle;
+    std::size_t messagesWritten = 0;
+    std::size_t totalMessages = 0;
+    std::size_t bytesWritten = 0;
+    double seconds = 0.0;
+    std::string error = "";
+    // Jobs finished and failed since the worker started, with the last failure's error. Unlike
+    // state these outlast the next queued job starting, so a caller comparing them with what it
+    // saw before never misses a failure.
+    std::size_t finished = 0;
+    std::size_t failed = 0;
+    // of the failures, those saving the document rather than baking it
+    std::size_t failedSaves = 0;
+    std::string lastFailure = "";
+};
+
+// Serializes snapshots of the document on its own thread so Save never blocks the frame.
+// Asking for a save while one is running queues it. Queued jobs run in order; a newer job for the
+// same kind of save to the same place takes over the queued one, a sharded save absorbing the
+// changed shards of the one it replaces, and any other job waits its turn, since the document's
+// dirty flags were cleared for it when it was queued.
+class SaveWorker {
+public:
+    SaveWorker();
+    ~SaveWorker();
+
+    SaveWorker(const SaveWorker&) = delete;
+    SaveWorker& operator=(const SaveWorker&) = delete;
+
+    void Start(std::vector<Character> snapshot, const std::string& path, const WriteOptions& options);
+    // Sharded project save; job comes from PrepareShardedSave.
+    void StartSharded(ShardedSaveJob job, const std::string& directory, const WriteOptions& options);
+    // Baked binary export for the game runtime, see BakedDialogue.h. It queues behind any saves
+    // and never takes their place.
+    void StartBake(std::vector<Character> snapshot, const std::string& path);
+    SaveStatus Status() const;
+    bool Busy() const;
+    // Called on the save thread whenever a job ends, e.g. to wake an idle UI so it shows the result.
+    void SetOnFinished(std::function<void()> callback);
+
+private:
+    enum class JobKind {
+        Json,
+        Sharded,
+        Baked
+    };
+
+    struct Job {
+        JobKind kind = JobKind::Json;
+        std::vector<Character> characters;
+        ShardedSaveJob shards;
+        std::string path;
+        WriteOptions options;
+    };
+
+    void Queue(Job job);
+
+    void Run();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::deque<Job> pending;
+    SaveStatus status;
+    std::size_t finished = 0;
+    std::size_t failed = 0;
+    std::size_t failedSaves = 0;
+    std::string lastFailure;
+    std::function<void()> onFinished;
+    std::atomic<std::size_t> progress{ 0 };
+    std::thread thread;
+};
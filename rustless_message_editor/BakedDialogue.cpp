@@ -0,0 +1,117 @@
+#include "BakedDialogue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+bool IsLittleEndian() {
+    uint16_t one = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+bool SectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, std::size_t fileSize) {
+    if (offset % 8 != 0 || offset > fileSize) {
+        return false;
+    }
+    return count <= (fileSize - offset) / elementSize;
+}
+
+}
+
+bool BakedDialogue::Open(const std::string& path, std::string& error) {
+    Close();
+    if (!file.Open(path, error)) {
+        return false;
+    }
+    if (!Attach(file.Data(), file.Size(), error)) {
+        file.Close();
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool BakedDialogue::Attach(const void* data, std::size_t size, std::string& error) {
+    header = nullptr;
+    if (!IsLittleEndian()) {
+        error = "baked dialogue needs a little-endian machine";
+        return false;
+    }
+    if (data == nullptr || size < sizeof(BakedHeader)) {
+        error = "file is too small to be baked dialogue";
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(data);
+    const BakedHeader* candidate = reinterpret_cast<const BakedHeader*>(base);
+    if (std::memcmp(candidate->magic, kBakedMagic, sizeof(kBakedMagic)) != 0) {
+        error = "not a baked dialogue file";
+        return false;
+    }
+    if (candidate->version != kBakedVersion) {
+        error = "unsupported baked dialogue version " + std::to_string(candidate->version);
+        return false;
+    }
+    if (!SectionFits(candidate->characterOffset, candidate->characterCount, sizeof(BakedCharacter), size)
+        || !SectionFits(candidate->messageOffset, candidate->messageCount, sizeof(BakedMessage), size)
+        || !SectionFits(candidate->idOffset, candidate->messageCount, sizeof(BakedIdEntry), size)
+        || !SectionFits(candidate->stringOffset, candidate->stringCount, sizeof(BakedString), size)
+        || !SectionFits(candidate->stringDataOffset, candidate->stringDataSize, 1, size)
+        || candidate->stringCount == 0) {
+        error = "baked dialogue is truncated or corrupt";
+        return false;
+    }
+
+    //character ranges are few and cheap to check; messages and strings are checked on access
+    const BakedCharacter* characterTable = reinterpret_cast<const BakedCharacter*>(base + candidate->characterOffset);
+    for (uint32_t i = 0; i < candidate->characterCount; i++) {
+        uint64_t end = static_cast<uint64_t>(characterTable[i].firstMessage) + characterTable[i].messageCount;
+        if (end > candidate->messageCount) {
+            error = "baked dialogue has a character outside the message table";
+            return false;
+        }
+    }
+
+    header = candidate;
+    characters = characterTable;
+    messages = reinterpret_cast<const BakedMessage*>(base + header->messageOffset);
+    ids = reinterpret_cast<const BakedIdEntry*>(base + header->idOffset);
+    strings = reinterpret_cast<const BakedString*>(base + header->stringOffset);
+    stringData = base + header->stringDataOffset;
+    return true;
+}
+
+void BakedDialogue::Close() {
+    file.Close();
+    header = nullptr;
+    characters = nullptr;
+    messages = nullptr;
+    ids = nullptr;
+    strings = nullptr;
+    stringData = nullptr;
+}
+
+std::string_view BakedDialogue::String(uint32_t index) const {
+    if (index >= header->stringCount) {
+        return std::string_view();
+    }
+    const BakedString& entry = strings[index];
+    if (static_cast<uint64_t>(entry.offset) + entry.length > header->stringDataSize) {
+        return std::string_view();
+    }
+    return std::string_view(stringData + entry.offset, entry.length);
+}
+
+int64_t BakedDialogue::FindMessage(int32_t id) const {
+    const BakedIdEntry* end = ids + header->messageCount;
+    const BakedIdEntry* found = std::lower_bound(ids, end, id, [](const BakedIdEntry& entry, int32_t value) {
+        return entry.id < value;
+    });
+    if (found == end || found->id != id || found->message >= header->messageCount) {
+        return -1;
+    }
+    return found->message;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+// Read-only access to baked dialogue (.bin) files, usable by the game without the editor model.
+//
+// Layout, all integers little-endian, every section 8-byte aligned:
+//
+//   BakedHeader
+//   BakedCharacter[characterCount]
+//   BakedMessage[messageCount]        grouped by character, in editor order
+//   BakedIdEntry[messageCount]        sorted by id, then message index
+//   BakedString[stringCount]          offset/length into the string data; string 0 is ""
+//   string data                       UTF-8, every string followed by a NUL
+//
+// Strings are deduplicated, so repeated speaker names and replies are stored once.
+// Nothing is parsed on open: the reader checks the header and section bounds and then
+// hands out pointers straight into the mapping.
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+constexpr char kBakedMagic[4] = { 'R', 'M', 'E', 'D' };
+constexpr uint32_t kBakedVersion = 1;
+
+struct BakedHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t characterCount;
+    uint32_t messageCount;
+    uint32_t stringCount;
+    uint32_t reserved;
+    uint64_t characterOffset;
+    uint64_t messageOffset;
+    uint64_t idOffset;
+    uint64_t stringOffset;
+    uint64_t stringDataOffset;
+    uint64_t stringDataSize;
+};
+
+struct BakedCharacter {
+    uint32_t name;
+    uint32_t firstMessage;
+    uint32_t messageCount;
+    uint32_t reserved;
+};
+
+struct BakedResponse {
+    uint32_t reply;
+    uint32_t content;
+    int32_t health;
+};
+
+struct BakedMessage {
+    int32_t id;
+    uint32_t character;
+    uint32_t content;
+    int32_t timeToRespond;
+    int32_t relationship;
+    BakedResponse responses[2];
+    uint32_t reserved;
+};
+
+struct BakedIdEntry {
+    int32_t id;
+    uint32_t message;
+};
+
+struct BakedString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(BakedHeader) == 72, "baked header layout changed");
+static_assert(sizeof(BakedCharacter) == 16, "baked character layout changed");
+static_assert(sizeof(BakedMessage) == 48, "baked message layout changed");
+static_assert(sizeof(BakedIdEntry) == 8, "baked id layout changed");
+static_assert(sizeof(BakedString) == 8, "baked string layout changed");
+
+class BakedDialogue {
+public:
+    // Maps the file and validates it; the view stays valid until Close or destruction.
+    bool Open(const std::string& path, std::string& error);
+    // Uses caller-owned memory instead of a file; it must outlive this object and be 8-byte aligned.
+    bool Attach(const void* data, std::size_t size, std::string& error);
+    void Close();
+
+    uint32_t CharacterCount() const { return header->characterCount; }
+    uint32_t MessageCount() const { return header->messageCount; }
+
+    const BakedCharacter& CharacterAt(uint32_t index) const { return characters[index]; }
+    const BakedMessage& MessageAt(uint32_t index) const { return messages[index]; }
+    std::string_view String(uint32_t index) const;
+    std::string_view CharacterName(uint32_t index) const { return String(characters[index].name); }
+
+    // Index of the first message with this ID, or -1. Binary search over the sorted ID table.
+    int64_t FindMessage(int32_t id) const;
+
+private:
+    MappedFile file;
+    const BakedHeader* header = nullptr;
+    const BakedCharacter* characters = nullptr;
+    const BakedMessage* messages = nullptr;
+    const BakedIdEntry* ids = nullptr;
+    const BakedString* strings = nullptr;
+    const char* stringData = nullptr;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Text.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Response {
+    Text reply;
+    Text content;
+    int health = 0;
+};
+
+enum Relationship {
+    POSITIVE,
+    NEUTERAL,
+    NEGATIVE
+};
+
+struct Message {
+    Text content;
+    int timeToRespond = 20;
+    Response responce[2];
+    Relationship relationship = NEUTERAL;
+    int32_t ID = 0;
+    //edited since the last save
+    bool dirty = false;
+    //"Responses" expanded in the editor's message list
+    bool responsesOpen = false;
+};
+
+struct Character {
+    std::string name = "";
+    std::vector<Message> messages;
+    //std::vector<std::string> dummyMessages = {};
+    //name, message list or any message changed since the last save
+    bool dirty = false;
+    //file name of this character's shard in a sharded project, empty until first saved there
+    std::string shard = "";
+    //how many of this character's messages have responsesOpen, so the list layout can skip looking
+    int openResponses = 0;
+    //messages not parsed yet, see LazyLoader; -1 once they have been
+    int lazySlot = -1;
+    //why the file holding this character's messages couldn't be read; until it can, the character
+    //has none of them and must not be saved over that file
+    std::string loadError = "";
+};
@@ -0,0 +1,258 @@
+#include "DialogueBake.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Writes integers byte by byte so the file is little-endian whatever the host is.
+class BlobWriter {
+public:
+    explicit BlobWriter(std::string& blob) : blob(blob) {}
+
+    void U32(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            blob += static_cast<char>((value >> (i * 8)) & 0xff);
+        }
+    }
+
+    void I32(int32_t value) {
+        U32(static_cast<uint32_t>(value));
+    }
+
+    void U64(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            blob += static_cast<char>((value >> (i * 8)) & 0xff);
+        }
+    }
+
+    void Align() {
+        while (blob.size() % 8 != 0) {
+            blob += '\0';
+        }
+    }
+
+    uint64_t Offset() const {
+        return blob.size();
+    }
+
+private:
+    std::string& blob;
+};
+
+class StringTable {
+public:
+    StringTable() {
+        Add(std::string_view());
+    }
+
+    uint32_t Add(std::string_view text) {
+        auto found = lookup.find(text);
+        if (found != lookup.end()) {
+            return found->second;
+        }
+        uint32_t index = static_cast<uint32_t>(entries.size());
+        entries.push_back(BakedString{ static_cast<uint32_t>(data.size()), static_cast<uint32_t>(text.size()) });
+        data.append(text.data(), text.size());
+        data += '\0';
+        lookup.emplace(text, index);
+        return index;
+    }
+
+    std::vector<BakedString> entries;
+    std::string data;
+
+private:
+    //views point into the characters being baked, which outlive the table
+    std::unordered_map<std::string_view, uint32_t> lookup;
+};
+
+}
+
+bool BakeCharacters(const std::vector<Character>& characters, std::string& blob, std::string& error) {
+    std::size_t messageTotal = 0;
+    for (auto& character : characters) {
+        messageTotal += character.messages.size();
+    }
+    if (characters.size() > std::numeric_limits<uint32_t>::max() || messageTotal > std::numeric_limits<uint32_t>::max()) {
+        error = "too many messages to bake";
+        return false;
+    }
+
+    StringTable strings;
+    std::vector<BakedCharacter> bakedCharacters;
+    std::vector<BakedMessage> bakedMessages;
+    std::vector<BakedIdEntry> idTable;
+    bakedCharacters.reserve(characters.size());
+    bakedMessages.reserve(messageTotal);
+    idTable.reserve(messageTotal);
+
+    for (uint32_t c = 0; c < characters.size(); c++) {
+        const Character& character = characters[c];
+        BakedCharacter baked = {};
+        baked.name = strings.Add(character.name);
+        baked.firstMessage = static_cast<uint32_t>(bakedMessages.size());
+        baked.messageCount = static_cast<uint32_t>(character.messages.size());
+        bakedCharacters.push_back(baked);
+
+        for (auto& message : character.messages) {
+            BakedMessage record = {};
+            record.id = message.ID;
+            record.character = c;
+            record.content = strings.Add(message.content);
+            record.timeToRespond = message.timeToRespond;
+            record.relationship = message.relationship;
+            for (int r = 0; r < 2; r++) {
+                record.responses[r].reply = strings.Add(message.responce[r].reply);
+                record.responses[r].content = strings.Add(message.responce[r].content);
+                record.responses[r].health = message.responce[r].health;
+            }
+            idTable.push_back(BakedIdEntry{ message.ID, static_cast<uint32_t>(bakedMessages.size()) });
+            bakedMessages.push_back(record);
+        }
+    }
+    if (strings.data.size() > std::numeric_limits<uint32_t>::max()) {
+        error = "too much text to bake";
+        return false;
+    }
+
+    std::sort(idTable.begin(), idTable.end(), [](const BakedIdEntry& a, const BakedIdEntry& b) {
+        return a.id != b.id ? a.id < b.id : a.message < b.message;
+    });
+
+    //section offsets are known up front because every record has a fixed size
+    auto align = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+    BakedHeader header = {};
+    header.characterCount = static_cast<uint32_t>(bakedCharacters.size());
+    header.messageCount = static_cast<uint32_t>(bakedMessages.size());
+    header.stringCount = static_cast<uint32_t>(strings.entries.size());
+    header.characterOffset = align(sizeof(BakedHeader));
+    header.messageOffset = align(header.characterOffset + bakedCharacters.size() * sizeof(BakedCharacter));
+    header.idOffset = align(header.messageOffset + bakedMessages.size() * sizeof(BakedMessage));
+    header.stringOffset = align(header.idOffset + idTable.size() * sizeof(BakedIdEntry));
+    header.stringDataOffset = align(header.stringOffset + strings.entries.size() * sizeof(BakedString));
+    header.stringDataSize = strings.data.size();
+
+    blob.clear();
+    blob.reserve(static_cast<std::size_t>(header.stringDataOffset + header.stringDataSize));
+    BlobWriter out(blob);
+
+    blob.append(kBakedMagic, sizeof(kBakedMagic));
+    out.U32(kBakedVersion);
+    out.U32(header.characterCount);
+    out.U32(header.messageCount);
+    out.U32(header.stringCount);
+    out.U32(0);
+    out.U64(header.characterOffset);
+    out.U64(header.messageOffset);
+    out.U64(header.idOffset);
+    out.U64(header.stringOffset);
+    out.U64(header.stringDataOffset);
+    out.U64(header.stringDataSize);
+
+    out.Align();
+    for (auto& character : bakedCharacters) {
+        out.U32(character.name);
+        out.U32(character.firstMessage);
+        out.U32(character.messageCount);
+        out.U32(0);
+    }
+
+    out.Align();
+    for (auto& message : bakedMessages) {
+        out.I32(message.id);
+        out.U32(message.character);
+        out.U32(message.content);
+        out.I32(message.timeToRespond);
+        out.I32(message.relationship);
+        for (auto& response : message.responses) {
+            out.U32(response.reply);
+            out.U32(response.content);
+            out.I32(response.health);
+        }
+        out.U32(0);
+    }
+
+    out.Align();
+    for (auto& entry : idTable) {
+        out.I32(entry.id);
+        out.U32(entry.message);
+    }
+
+    out.Align();
+    for (auto& entry : strings.entries) {
+        out.U32(entry.offset);
+        out.U32(entry.length);
+    }
+
+    out.Align();
+    blob += strings.data;
+    return true;
+}
+
+SaveResult SaveBakedFile(const std::string& path, const std::vector<Character>& characters) {
+    SaveResult result;
+    std::string blob;
+    if (!BakeCharacters(characters, blob, result.error)) {
+        result.ok = false;
+        return result;
+    }
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            result.ok = false;
+            result.error = "Failed to open file for writing: check directory " + std::filesystem::path(path).parent_path().string() + " exists";
+            return result;
+        }
+        file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        if (!file.good()) {
+            result.ok = false;
+            result.error = "Failed writing " + tempPath;
+        }
+    }
+
+    std::error_code ec;
+    if (result.ok) {
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            result.ok = false;
+            result.error = "Failed to replace " + path + ": " + ec.message();
+        }
+    }
+    if (!result.ok) {
+        std::filesystem::remove(tempPath, ec);
+        return result;
+    }
+    result.bytesWritten = blob.size();
+    return result;
+}
+
+void UnbakeCharacters(const BakedDialogue& baked, std::vector<Character>& characters) {
+    for (uint32_t c = 0; c < baked.CharacterCount(); c++) {
+        const BakedCharacter& bakedCharacter = baked.CharacterAt(c);
+        Character character;
+        character.name = std::string(baked.CharacterName(c));
+        character.messages.reserve(bakedCharacter.messageCount);
+        for (uint32_t m = 0; m < bakedCharacter.messageCount; m++) {
+            const BakedMessage& record = baked.MessageAt(bakedCharacter.firstMessage + m);
+            Message message;
+            message.ID = record.id;
+            message.content = std::string(baked.String(record.content));
+            message.timeToRespond = record.timeToRespond;
+            message.relationship = static_cast<Relationship>(record.relationship);
+            for (int r = 0; r < 2; r++) {
+                message.responce[r].reply = std::string(baked.String(record.responses[r].reply));
+                message.responce[r].content = std::string(baked.String(record.responses[r].content));
+                message.responce[r].health = record.responses[r].health;
+            }
+            character.messages.push_back(std::move(message));
+        }
+        characters.push_back(std::move(character));
+    }
+}
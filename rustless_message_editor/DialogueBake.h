@@ -0,0 +1,17 @@
+#pragma once
+
+#include "BakedDialogue.h"
+#include "Dialogue.h"
+#include "DialogueWriter.h"
+
+#include <string>
+#include <vector>
+
+// Bakes characters into the binary format described in BakedDialogue.h.
+bool BakeCharacters(const std::vector<Character>& characters, std::string& blob, std::string& error);
+
+// Bakes and writes through "<path>.tmp" + rename, like SaveCharactersToFile.
+SaveResult SaveBakedFile(const std::string& path, const std::vector<Character>& characters);
+
+// Turns a baked file back into editor characters (appending), e.g. to check a bake round trips.
+void UnbakeCharacters(const BakedDialogue& baked, std::vector<Character>& characters);
@@ -0,0 +1,427 @@
+#include "DialogueBatch.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iterator>
+#include <regex>
+#include <utility>
+
+namespace {
+
+const int kFields = static_cast<int>(MessageField::Health2) + 1;
+
+// messages planned as one item; small enough to balance, big enough that claiming one is free
+const std::size_t kBlockMessages = 4096;
+
+const char* const kRelationshipLabels[3] = { "positive", "neutral", "negative" };
+
+bool IsTextOp(BatchOp op) {
+    return op == BatchOp::Replace || op == BatchOp::RegexReplace;
+}
+
+int FieldNumber(const Message& message, MessageField field) {
+    switch (field) {
+    case MessageField::TimeToRespond: return message.timeToRespond;
+    case MessageField::Relationship: return static_cast<int>(message.relationship);
+    case MessageField::ID: return message.ID;
+    case MessageField::Health1: return message.responce[0].health;
+    case MessageField::Health2: return message.responce[1].health;
+    default: return 0;
+    }
+}
+
+std::string_view FieldText(const Message& message, MessageField field) {
+    switch (field) {
+    case MessageField::Content: return message.content.View();
+    case MessageField::Content1: return message.responce[0].content.View();
+    case MessageField::Reply1: return message.responce[0].reply.View();
+    case MessageField::Content2: return message.responce[1].content.View();
+    case MessageField::Reply2: return message.responce[1].reply.View();
+    default: return std::string_view();
+    }
+}
+
+// Longest run of plain characters every match of a regex has to contain, so the texts without it
+// are skipped before std::regex (slow) ever looks at them. Anything unsure ends the run: groups,
+// classes, escapes other than escaped punctuation, and a character made optional by what follows
+// it. A pattern with an alternative anywhere has none.
+std::string RequiredLiteral(const std::string& pattern) {
+    if (pattern.find('|') != std::string::npos) {
+        return std::string();
+    }
+    std::string best;
+    std::string run;
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+    for (std::size_t k = 0; k < pattern.size(); k++) {
+        char c = pattern[k];
+        char literal = 0;
+        std::size_t next = k + 1;
+        if (c == '\\' && k + 1 < pattern.size() && std::ispunct(static_cast<unsigned char>(pattern[k + 1]))) {
+            literal = pattern[k + 1];
+            next = k + 2;
+        }
+        else if (c == '\\') {
+            //\b, \d, a backreference...
+            endRun();
+            k++;
+            continue;
+        }
+        else if (c == '(' || c == '[') {
+            //skip the group or class; a quantifier after it only ever applies to it
+            endRun();
+            int depth = 0;
+            for (; k < pattern.size(); k++) {
+                if (pattern[k] == '\\') {
+                    k++;
+                    continue;
+                }
+                depth += (pattern[k] == c) ? 1 : (pattern[k] == (c == '(' ? ')' : ']')) ? -1 : 0;
+                if (depth == 0) {
+                    break;
+                }
+            }
+            continue;
+        }
+        else if (std::string_view("\\.^$*+?{}()[]").find(c) == std::string_view::npos) {
+            literal = c;
+        }
+        if (literal == 0) {
+            endRun();
+            continue;
+        }
+        if (next < pattern.size() && (pattern[next] == '?' || pattern[next] == '*' || pattern[next] == '{')) {
+            endRun();
+            k = next - 1;
+            continue;
+        }
+        run.push_back(literal);
+        k = next - 1;
+    }
+    endRun();
+    return best;
+}
+
+// A regex and what its matches must contain.
+struct Pattern {
+    std::regex regex;
+    std::string literal;
+
+    bool Search(std::string_view text) const {
+        if (!literal.empty() && text.find(literal) == std::string_view::npos) {
+            return false;
+        }
+        return std::regex_search(text.begin(), text.end(), regex);
+    }
+};
+
+bool Compile(const std::string& source, Pattern& pattern, std::string& error) {
+    try {
+        pattern.regex = std::regex(source, std::regex::ECMAScript | std::regex::optimize);
+    }
+    catch (const std::regex_error& e) {
+        error = "bad regex \"" + source + "\": " + e.what();
+        return false;
+    }
+    pattern.literal = RequiredLiteral(source);
+    return true;
+}
+
+struct Batch {
+    const BatchFilter& filter;
+    const std::vector<BatchTransform>& transforms;
+    bool regexFilter = false;
+    Pattern filterPattern;
+    // per transform, for RegexReplace
+    std::vector<Pattern> patterns;
+
+    Batch(const BatchFilter& filter, const std::vector<BatchTransform>& transforms) : filter(filter), transforms(transforms) {
+    }
+
+    bool Picks(const Message& message) const {
+        if ((filter.relationship >= 0 && static_cast<int>(message.relationship) != filter.relationship) || message.ID < filter.minID
+            || message.ID > filter.maxID) {
+            return false;
+        }
+        if (filter.text.empty()) {
+            return true;
+        }
+        std::string_view texts[5] = { message.content.View(), message.responce[0].reply.View(), message.responce[0].content.View(),
+            message.responce[1].reply.View(), message.responce[1].content.View() };
+        for (std::string_view text : texts) {
+            if (regexFilter ? filterPattern.Search(text) : text.find(filter.text) != std::string_view::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Sets result to current rewritten; false when it stays as it was.
+    bool TransformText(std::size_t t, std::string_view current, std::string& result) const {
+        const BatchTransform& transform = transforms[t];
+        switch (transform.op) {
+        case BatchOp::Set:
+            if (current == transform.text) {
+                return false;
+            }
+            result = transform.text;
+            return true;
+        case BatchOp::Replace: {
+            if (transform.pattern.empty()) {
+                return false;
+            }
+            std::size_t at = current.find(transform.pattern);
+            if (at == std::string_view::npos) {
+                return false;
+            }
+            std::size_t from = 0;
+            for (; at != std::string_view::npos; at = current.find(transform.pattern, from)) {
+                result.append(current.data() + from, at - from);
+                result += transform.text;
+                from = at + transform.pattern.size();
+            }
+            result.append(current.data() + from, current.size() - from);
+            return true;
+        }
+        case BatchOp::RegexReplace: {
+            //replacing finds the matches itself, so only the literal is checked first
+            const Pattern& pattern = patterns[t];
+            if (!pattern.literal.empty() && current.find(pattern.literal) == std::string_view::npos) {
+                return false;
+            }
+            std::regex_replace(std::back_inserter(result), current.begin(), current.end(), pattern.regex, transform.text);
+            return current != result;
+        }
+        default:
+            return false;
+        }
+    }
+
+    static int TransformNumber(const BatchTransform& transform, MessageField field, int number) {
+        double value = number;
+        switch (transform.op) {
+        case BatchOp::Set: value = transform.value; break;
+        case BatchOp::Add: value += transform.value; break;
+        case BatchOp::Scale: value *= transform.value; break;
+        case BatchOp::Clamp: value = std::min<double>(std::max<double>(value, transform.low), transform.high); break;
+        default: break;
+        }
+        value = std::round(value);
+        if (field == MessageField::Relationship) {
+            return static_cast<int>(std::min(std::max(value, 0.0), 2.0));
+        }
+        return static_cast<int>(std::min<double>(std::max<double>(value, INT32_MIN), INT32_MAX));
+    }
+
+    // Runs every transform over one message and adds a change for each field that ends up different.
+    bool Plan(const Message& message, int character, int index, std::vector<FieldChange>& changes) const {
+        int numbers[kFields];
+        std::string texts[kFields];
+        uint32_t touched = 0;
+        for (std::size_t t = 0; t < transforms.size(); t++) {
+            const BatchTransform& transform = transforms[t];
+            for (int f = 0; f < kFields; f++) {
+                MessageField field = static_cast<MessageField>(f);
+                if ((transform.fields & BatchFieldBit(field)) == 0) {
+                    continue;
+                }
+                if (!IsTextField(field)) {
+                    if (!IsTextOp(transform.op)) {
+                        int current = (touched & BatchFieldBit(field)) != 0 ? numbers[f] : FieldNumber(message, field);
+                        numbers[f] = TransformNumber(transform, field, current);
+                        touched |= BatchFieldBit(field);
+                    }
+                    continue;
+                }
+                if (transform.op != BatchOp::Set && !IsTextOp(transform.op)) {
+                    continue;
+                }
+                //text is only copied out of the message once something changes it
+                std::string_view current = (touched & BatchFieldBit(field)) != 0 ? std::string_view(texts[f]) : FieldText(message, field);
+                std::string changed;
+                if (TransformText(t, current, changed)) {
+                    texts[f] = std::move(changed);
+                    touched |= BatchFieldBit(field);
+                }
+            }
+        }
+
+        bool any = false;
+        for (int f = 0; touched != 0 && f < kFields; f++) {
+            MessageField field = static_cast<MessageField>(f);
+            if ((touched & BatchFieldBit(field)) == 0) {
+                continue;
+            }
+            bool text = IsTextField(field);
+            if (text ? FieldText(message, field) == texts[f] : FieldNumber(message, field) == numbers[f]) {
+                continue;
+            }
+            changes.emplace_back();
+            FieldChange& change = changes.back();
+            change.character = character;
+            change.message = index;
+            change.field = field;
+            if (text) {
+                change.before.text = FieldText(message, field);
+                change.after.text = std::move(texts[f]);
+            }
+            else {
+                change.before.number = FieldNumber(message, field);
+                change.after.number = numbers[f];
+            }
+            any = true;
+        }
+        return any;
+    }
+};
+
+struct Block {
+    int character = 0;
+    std::size_t first = 0;
+    std::size_t count = 0;
+    std::vector<FieldChange> changes;
+    std::size_t matched = 0;
+    std::size_t changedMessages = 0;
+};
+
+std::string CutText(std::string_view text, std::size_t limit) {
+    if (text.size() <= limit) {
+        return std::string(text);
+    }
+    //back up to the start of a UTF-8 sequence
+    while (limit > 0 && (static_cast<unsigned char>(text[limit]) & 0xC0) == 0x80) {
+        limit--;
+    }
+    return std::string(text.substr(0, limit)) + "...";
+}
+
+}
+
+const BatchFieldName kBatchFieldNames[] = {
+    { "content", BatchFieldBit(MessageField::Content) },
+    { "time", BatchFieldBit(MessageField::TimeToRespond) },
+    { "relationship", BatchFieldBit(MessageField::Relationship) },
+    { "id", BatchFieldBit(MessageField::ID) },
+    { "content1", BatchFieldBit(MessageField::Content1) },
+    { "reply1", BatchFieldBit(MessageField::Reply1) },
+    { "health1", BatchFieldBit(MessageField::Health1) },
+    { "content2", BatchFieldBit(MessageField::Content2) },
+    { "reply2", BatchFieldBit(MessageField::Reply2) },
+    { "health2", BatchFieldBit(MessageField::Health2) },
+    { "health", BatchFieldBit(MessageField::Health1) | BatchFieldBit(MessageField::Health2) },
+    { "reply", BatchFieldBit(MessageField::Reply1) | BatchFieldBit(MessageField::Reply2) },
+    { "response", BatchFieldBit(MessageField::Content1) | BatchFieldBit(MessageField::Content2) },
+    { "text", BatchFieldBit(MessageField::Content) | BatchFieldBit(MessageField::Content1) | BatchFieldBit(MessageField::Reply1)
+        | BatchFieldBit(MessageField::Content2) | BatchFieldBit(MessageField::Reply2) },
+};
+
+const int kBatchFieldNameCount = static_cast<int>(sizeof(kBatchFieldNames) / sizeof(kBatchFieldNames[0]));
+
+bool ParseBatchFields(std::string_view name, uint32_t& fields) {
+    for (auto& candidate : kBatchFieldNames) {
+        if (name == candidate.name) {
+            fields = candidate.fields;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* BatchFieldLabel(MessageField field) {
+    return kBatchFieldNames[static_cast<int>(field)].name;
+}
+
+BatchPlan PlanBatch(const std::vector<Character>& characters, const BatchFilter& filter, const std::vector<BatchTransform>& transforms, unsigned threads) {
+    ProfileSpan span("batch/plan");
+    BatchPlan plan;
+    Batch batch(filter, transforms);
+    batch.regexFilter = filter.textRegex && !filter.text.empty();
+    if (batch.regexFilter && !Compile(filter.text, batch.filterPattern, plan.error)) {
+        plan.ok = false;
+        return plan;
+    }
+    batch.patterns.resize(transforms.size());
+    for (std::size_t t = 0; t < transforms.size(); t++) {
+        if (transforms[t].op == BatchOp::RegexReplace && !Compile(transforms[t].pattern, batch.patterns[t], plan.error)) {
+            plan.ok = false;
+            return plan;
+        }
+    }
+
+    std::vector<Block> blocks;
+    for (std::size_t c = 0; c < characters.size(); c++) {
+        if (!filter.character.empty() && characters[c].name != filter.character) {
+            continue;
+        }
+        std::size_t count = characters[c].messages.size();
+        for (std::size_t first = 0; first < count; first += kBlockMessages) {
+            Block block;
+            block.character = static_cast<int>(c);
+            block.first = first;
+            block.count = std::min(kBlockMessages, count - first);
+            blocks.push_back(std::move(block));
+        }
+    }
+
+    ParallelFor(blocks.size(), threads, [&](std::size_t b) {
+        Block& block = blocks[b];
+        const std::vector<Message>& messages = characters[block.character].messages;
+        for (std::size_t j = block.first; j < block.first + block.count; j++) {
+            if (!batch.Picks(messages[j])) {
+                continue;
+            }
+            block.matched++;
+            if (batch.Plan(messages[j], block.character, static_cast<int>(j), block.changes)) {
+                block.changedMessages++;
+            }
+        }
+    });
+
+    std::size_t total = 0;
+    for (auto& block : blocks) {
+        total += block.changes.size();
+    }
+    plan.changes.reserve(total);
+    for (auto& block : blocks) {
+        plan.matched += block.matched;
+        plan.changedMessages += block.changedMessages;
+        std::move(block.changes.begin(), block.changes.end(), std::back_inserter(plan.changes));
+    }
+    return plan;
+}
+
+void ApplyBatch(std::vector<Character>& characters, const std::vector<FieldChange>& changes, bool undo) {
+    ProfileSpan span("batch/apply");
+    for (std::size_t k = 0; k < changes.size(); k++) {
+        //undone back to front, should one field ever be in a batch twice
+        const FieldChange& change = changes[undo ? changes.size() - 1 - k : k];
+        Character& character = characters[change.character];
+        Message& message = character.messages[change.message];
+        SetField(message, change.field, undo ? change.before : change.after);
+        message.dirty = true;
+        character.dirty = true;
+    }
+}
+
+std::string DescribeValue(MessageField field, const FieldValue& value) {
+    if (IsTextField(field)) {
+        return "\"" + CutText(value.text, 60) + "\"";
+    }
+    if (field == MessageField::Relationship && value.number >= 0 && value.number < 3) {
+        return kRelationshipLabels[value.number];
+    }
+    return std::to_string(value.number);
+}
+
+std::string DescribeChange(const std::vector<Character>& characters, const FieldChange& change) {
+    const Character& character = characters[change.character];
+    return character.name + " #" + std::to_string(character.messages[change.message].ID) + " " + BatchFieldLabel(change.field) + ": "
+        + DescribeValue(change.field, change.before) + " -> " + DescribeValue(change.field, change.after);
+}
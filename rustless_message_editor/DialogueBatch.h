@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "UndoHistory.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bulk edits over the whole dialogue, e.g. scaling one character's health or fixing a term in
+// every reply. A filter picks messages, transforms rewrite fields of each picked message, and
+// PlanBatch turns that into the FieldChanges it would make without touching the document, so
+// they can be previewed and then applied as one undo step (EditKind::Batch).
+
+enum class BatchOp {
+    // numbers to value, text to text
+    Set,
+    // numbers only
+    Add,
+    Scale,
+    Clamp,
+    // text only: every occurrence of pattern becomes text
+    Replace,
+    // text only: pattern is an ECMAScript regex, text may use $1, $& and so on
+    RegexReplace
+};
+
+constexpr uint32_t BatchFieldBit(MessageField field) {
+    return 1u << static_cast<int>(field);
+}
+
+struct BatchTransform {
+    BatchOp op = BatchOp::Set;
+    // BatchFieldBit of every field it rewrites; fields the op doesn't fit are left alone
+    uint32_t fields = 0;
+    double value = 0.0;
+    int low = 0;
+    int high = 0;
+    std::string pattern = "";
+    std::string text = "";
+};
+
+struct BatchFilter {
+    // exact character name, empty for every character
+    std::string character = "";
+    // a Relationship, or -1 for any
+    int relationship = -1;
+    int32_t minID = INT32_MIN;
+    int32_t maxID = INT32_MAX;
+    // only messages whose content, a reply or a response holds this; empty for all
+    std::string text = "";
+    bool textRegex = false;
+};
+
+struct BatchPlan {
+    bool ok = true;
+    // a pattern that isn't a regex
+    std::string error = "";
+    // messages the filter picked, and how many of them would change
+    std::size_t matched = 0;
+    std::size_t changedMessages = 0;
+    // in document order, with before set from the document
+    std::vector<FieldChange> changes;
+};
+
+// A field name and the fields it stands for: every single field, then the groups
+// "health", "reply", "response" (both responses' content) and "text" (all five texts).
+struct BatchFieldName {
+    const char* name;
+    uint32_t fields;
+};
+
+extern const BatchFieldName kBatchFieldNames[];
+extern const int kBatchFieldNameCount;
+
+bool ParseBatchFields(std::string_view name, uint32_t& fields);
+const char* BatchFieldLabel(MessageField field);
+
+// Runs the filter and transforms over every loaded message, split into blocks planned on threads
+// threads (0 = one per core). Numbers are rounded to the nearest int and relationships kept to
+// the three there are. Characters a LazyLoader hasn't parsed yet have no messages to pick.
+BatchPlan PlanBatch(const std::vector<Character>& characters, const BatchFilter& filter, const std::vector<BatchTransform>& transforms,
+    unsigned threads = 0);
+
+// Sets every change's after (before when undo) and marks the messages dirty. Keeping indexes in
+// step is the caller's job.
+void ApplyBatch(std::vector<Character>& characters, const std::vector<FieldChange>& changes, bool undo);
+
+// "Name #ID field: before -> after", long text cut short.
+std::string DescribeChange(const std::vector<Character>& characters, const FieldChange& change);
+// One side of a change the way DescribeChange prints it.
+std::string DescribeValue(MessageField field, const FieldValue& value);
@@ -0,0 +1,172 @@
+#include "DialogueIndex.h"
+
+namespace {
+
+void MoveID(std::unordered_multimap<int32_t, MessageLocation>& ids, int32_t id, int character, int from, int to) {
+    auto range = ids.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.character == character && it->second.message == from) {
+            it->second.message = to;
+            return;
+        }
+    }
+}
+
+}
+
+void DialogueIndex::Rebuild(const std::vector<Character>& characters) {
+    names.clear();
+    ids.clear();
+
+    std::size_t total = 0;
+    for (auto& character : characters) {
+        total += character.messages.size();
+    }
+    names.reserve(characters.size());
+    ids.reserve(total);
+
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        //emplace keeps the first slot when two characters share a name
+        names.emplace(characters[i].name, i);
+        for (int j = 0; j < static_cast<int>(characters[i].messages.size()); j++) {
+            ids.emplace(characters[i].messages[j].ID, MessageLocation{ i, j });
+        }
+    }
+}
+
+int DialogueIndex::FindCharacter(const std::string& name) const {
+    auto it = names.find(name);
+    return it != names.end() ? it->second : -1;
+}
+
+MessageLocation DialogueIndex::FindMessage(int32_t id) const {
+    MessageLocation first;
+    auto range = ids.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        const MessageLocation& loc = it->second;
+        if (first.character == -1 || loc.character < first.character || (loc.character == first.character && loc.message < first.message)) {
+            first = loc;
+        }
+    }
+    return first;
+}
+
+std::size_t DialogueIndex::CountMessages(int32_t id) const {
+    return ids.count(id);
+}
+
+std::vector<MessageLocation> DialogueIndex::FindMessages(int32_t id) const {
+    std::vector<MessageLocation> found;
+    auto range = ids.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        found.push_back(it->second);
+    }
+    return found;
+}
+
+void DialogueIndex::OnCharacterAdded(const std::vector<Character>& characters, int character) {
+    if (character != static_cast<int>(characters.size()) - 1) {
+        //inserted in the middle, so every later slot moves up by one
+        for (auto& entry : names) {
+            if (entry.second >= character) {
+                entry.second++;
+            }
+        }
+        for (auto& entry : ids) {
+            if (entry.second.character >= character) {
+                entry.second.character++;
+            }
+        }
+    }
+
+    AddName(characters, characters[character].name);
+    const auto& messages = characters[character].messages;
+    for (int j = 0; j < static_cast<int>(messages.size()); j++) {
+        ids.emplace(messages[j].ID, MessageLocation{ character, j });
+    }
+}
+
+void DialogueIndex::OnCharacterRenamed(const std::vector<Character>& characters, int character) {
+    //the old name, if this was the first character using it, is whatever still points at the slot
+    std::vector<std::string> stale;
+    for (auto& entry : names) {
+        if (entry.second == character && entry.first != characters[character].name) {
+            stale.push_back(entry.first);
+        }
+    }
+    for (auto& name : stale) {
+        AddName(characters, name);
+    }
+    AddName(characters, characters[character].name);
+}
+
+void DialogueIndex::OnCharacterDeleted(const std::vector<Character>& characters, int character) {
+    std::vector<std::string> orphaned;
+    for (auto& entry : names) {
+        if (entry.second == character) {
+            orphaned.push_back(entry.first);
+        }
+        else if (entry.second > character) {
+            entry.second--;
+        }
+    }
+    for (auto& name : orphaned) {
+        AddName(characters, name);
+    }
+
+    for (auto it = ids.begin(); it != ids.end();) {
+        if (it->second.character == character) {
+            it = ids.erase(it);
+            continue;
+        }
+        if (it->second.character > character) {
+            it->second.character--;
+        }
+        ++it;
+    }
+}
+
+void DialogueIndex::OnMessageAdded(const std::vector<Character>& characters, int character, int message) {
+    const auto& messages = characters[character].messages;
+    for (int k = static_cast<int>(messages.size()) - 1; k > message; k--) {
+        MoveID(ids, messages[k].ID, character, k - 1, k);
+    }
+    ids.emplace(messages[message].ID, MessageLocation{ character, message });
+}
+
+void DialogueIndex::OnMessageIDChanged(int character, int message, int32_t oldID, int32_t newID) {
+    if (oldID == newID) {
+        return;
+    }
+    RemoveID(oldID, character, message);
+    ids.emplace(newID, MessageLocation{ character, message });
+}
+
+void DialogueIndex::OnMessageDeleted(const std::vector<Character>& characters, int character, int message, int32_t deletedID) {
+    RemoveID(deletedID, character, message);
+    const auto& messages = characters[character].messages;
+    for (int k = message; k < static_cast<int>(messages.size()); k++) {
+        MoveID(ids, messages[k].ID, character, k + 1, k);
+    }
+}
+
+void DialogueIndex::AddName(const std::vector<Character>& characters, const std::string& name) {
+    //the slot for a name is the first character using it, which may have just changed
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        if (characters[i].name == name) {
+            names[name] = i;
+            return;
+        }
+    }
+    names.erase(name);
+}
+
+void DialogueIndex::RemoveID(int32_t id, int character, int message) {
+    auto range = ids.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.character == character && it->second.message == message) {
+            ids.erase(it);
+            return;
+        }
+    }
+}
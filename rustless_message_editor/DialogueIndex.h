@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MessageLocation {
+    int character = -1;
+    int message = -1;
+};
+
+// Hashed lookups over the character list: name -> character slot and Message::ID -> message.
+// The editor keeps it in step with the vector through the On* calls after each change.
+// Names and IDs are not unique, so a lookup returns the first match in document order.
+class DialogueIndex {
+public:
+    void Rebuild(const std::vector<Character>& characters);
+
+    int FindCharacter(const std::string& name) const;
+    MessageLocation FindMessage(int32_t id) const;
+    // Number of messages currently using this ID.
+    std::size_t CountMessages(int32_t id) const;
+    // Every message using this ID, in no particular order.
+    std::vector<MessageLocation> FindMessages(int32_t id) const;
+
+    void OnCharacterAdded(const std::vector<Character>& characters, int character);
+    // Call after the name changed; the old name is not needed, so the editor can rename in place.
+    void OnCharacterRenamed(const std::vector<Character>& characters, int character);
+    // Call after the character has been erased from the vector.
+    void OnCharacterDeleted(const std::vector<Character>& characters, int character);
+
+    void OnMessageAdded(const std::vector<Character>& characters, int character, int message);
+    void OnMessageIDChanged(int character, int message, int32_t oldID, int32_t newID);
+    // Call after the message has been erased; deletedID is the ID it had.
+    void OnMessageDeleted(const std::vector<Character>& characters, int character, int message, int32_t deletedID);
+
+private:
+    void AddName(const std::vector<Character>& characters, const std::string& name);
+    void RemoveID(int32_t id, int character, int message);
+
+    std::unordered_map<std::string, int> names;
+    std::unordered_multimap<int32_t, MessageLocation> ids;
+};
@@ -0,0 +1,995 @@
+#include "DialogueLoader.h"
+#include "Profiler.h"
+
+#include <json.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Input iterator over the load buffer that remembers how far the lexer has read,
+// so errors found inside SAX callbacks can still be reported with a line and column.
+class TrackingIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = const char&;
+
+    TrackingIterator(const char* current, const char** furthest) : current(current), furthest(furthest) {}
+
+    reference operator*() const { return *current; }
+    TrackingIterator& operator++() {
+        *furthest = ++current;
+        return *this;
+    }
+    TrackingIterator operator++(int) {
+        TrackingIterator old = *this;
+        ++(*this);
+        return old;
+    }
+    bool operator==(const TrackingIterator& other) const { return current == other.current; }
+    bool operator!=(const TrackingIterator& other) const { return current != other.current; }
+
+private:
+    const char* current;
+    const char** furthest;
+};
+
+enum class Scope {
+    Root,
+    Document,
+    Messages,
+    Message,
+    Responses,
+    Response
+};
+
+enum class Field {
+    None,
+    Unknown,
+    Messages,
+    From,
+    Content,
+    TimeToRespond,
+    Relationship,
+    ID,
+    Responses,
+    Reply,
+    Health
+};
+
+// Where parsed messages go: the editor's vector, grouped into characters by "from".
+class CharacterSink {
+public:
+    explicit CharacterSink(std::vector<Character>& characters) : characters(characters) {}
+
+    void Add(const std::string& from, Message& message) {
+        //messages from one speaker are normally consecutive, so try the last one first
+        if (lastCharacter < 0 || characters[lastCharacter].name != from) {
+            lookups++;
+            auto found = slots.find(from);
+            if (found != slots.end()) {
+                lastCharacter = found->second;
+            }
+            else {
+                Character newCharacter;
+                newCharacter.name = from;
+                characters.push_back(std::move(newCharacter));
+                lastCharacter = static_cast<int>(characters.size()) - 1;
+                slots.emplace(from, lastCharacter);
+            }
+        }
+        characters[lastCharacter].messages.push_back(std::move(message));
+    }
+
+    //speakers that weren't the previous message's, so went to the hash map
+    int64_t lookups = 0;
+
+private:
+    std::vector<Character>& characters;
+    int lastCharacter = -1;
+    std::unordered_map<std::string, int> slots;
+};
+
+// Just the messages, for a character whose name is already known (see LoadMessageRuns).
+class MessageSink {
+public:
+    explicit MessageSink(std::vector<Message>& messages) : messages(messages) {}
+
+    void Add(const std::string&, Message& message) {
+        messages.push_back(std::move(message));
+    }
+
+private:
+    std::vector<Message>& messages;
+};
+
+class StoreSink {
+public:
+    explicit StoreSink(DialogueStore& store) : store(store) {}
+
+    void Add(const std::string& from, Message& message) {
+        store.AddMessage(from, message);
+    }
+
+private:
+    DialogueStore& store;
+};
+
+// SAX handler that builds each Message straight from the token stream and hands it to a sink.
+// Follows the same rules as the old DOM walk: null or missing fields keep their defaults,
+// unknown keys are ignored and each message needs a "from".
+template <typename Sink>
+class DialogueSax {
+public:
+    DialogueSax(Sink& sink, const char* begin, const char** position, bool borrow = false)
+        : sink(sink), begin(begin), position(position), borrow(borrow) {
+        scopes.reserve(8);
+        scopes.push_back(Scope::Root);
+    }
+
+    // For parsing message objects one at a time, as if already inside the "messages" array.
+    // parseOffset is where the current parse started, which the parser's own errors count from.
+    void StartInMessages() {
+        scopes.push_back(Scope::Document);
+        scopes.push_back(Scope::Messages);
+    }
+    std::size_t parseOffset = 0;
+
+    bool null() {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Responses:
+            //the old loader indexed a null response like an empty object
+            NextResponse();
+            return true;
+        case Scope::Messages:
+            return Fail("expected a message object");
+        case Scope::Root:
+            return Fail("expected an object at the top level");
+        default:
+            //null keeps whatever default the field already has
+            if (field == Field::From) {
+                hasFrom = false;
+            }
+            return true;
+        }
+    }
+
+    bool boolean(bool) {
+        return Scalar("a boolean");
+    }
+
+    bool number_integer(json::number_integer_t value) {
+        return Number(static_cast<long long>(value));
+    }
+
+    bool number_unsigned(json::number_unsigned_t value) {
+        return Number(static_cast<long long>(value));
+    }
+
+    bool number_float(json::number_float_t value, const json::string_t&) {
+        return Number(static_cast<long long>(value));
+    }
+
+    bool string(json::string_t& value) {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Message:
+            switch (field) {
+            case Field::From:
+                from.assign(value);
+                hasFrom = true;
+                return true;
+            case Field::Content:
+                SetText(message.content, value);
+                return true;
+            case Field::Unknown:
+                return true;
+            default:
+                return Scalar("a string");
+            }
+        case Scope::Response:
+            if (responseTrack >= 2) {
+                return true;
+            }
+            switch (field) {
+            case Field::Reply:
+                SetText(message.responce[responseTrack].reply, value);
+                return true;
+            case Field::Content:
+                SetText(message.responce[responseTrack].content, value);
+                return true;
+            case Field::Unknown:
+                return true;
+            default:
+                return Scalar("a string");
+            }
+        default:
+            return Scalar("a string");
+        }
+    }
+
+    bool binary(json::binary_t&) {
+        return Scalar("binary data");
+    }
+
+    bool start_object(std::size_t) {
+        if (skipDepth > 0) {
+            skipDepth++;
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Root:
+            scopes.push_back(Scope::Document);
+            field = Field::None;
+            return true;
+        case Scope::Messages:
+            ResetMessage();
+            from.clear();
+            hasFrom = false;
+            responseTrack = 0;
+            scopes.push_back(Scope::Message);
+            field = Field::None;
+            return true;
+        case Scope::Responses:
+            scopes.push_back(Scope::Response);
+            field = Field::None;
+            return true;
+        default:
+            if (field == Field::Unknown) {
+                skipDepth = 1;
+                return true;
+            }
+            return Fail(FieldName() + " cannot be an object");
+        }
+    }
+
+    bool end_object() {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+        Scope closing = scopes.back();
+        scopes.pop_back();
+        if (closing == Scope::Message) {
+            if (!hasFrom) {
+                return Fail("message is missing \"from\"");
+            }
+            sink.Add(from, message);
+        }
+        else if (closing == Scope::Response) {
+            NextResponse();
+        }
+        field = Field::None;
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (skipDepth > 0) {
+            skipDepth++;
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Document:
+            if (field == Field::Messages) {
+                scopes.push_back(Scope::Messages);
+                return true;
+            }
+            skipDepth = 1;
+            return true;
+        case Scope::Message:
+            if (field == Field::Responses) {
+                scopes.push_back(Scope::Responses);
+                return true;
+            }
+            if (field == Field::Unknown) {
+                skipDepth = 1;
+                return true;
+            }
+            return Fail(FieldName() + " cannot be an array");
+        case Scope::Response:
+            if (field == Field::Unknown) {
+                skipDepth = 1;
+                return true;
+            }
+            return Fail(FieldName() + " cannot be an array");
+        case Scope::Root:
+            return Fail("expected an object at the top level");
+        default:
+            return Fail("expected an object, found an array");
+        }
+    }
+
+    bool end_array() {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+        scopes.pop_back();
+        field = Field::None;
+        return true;
+    }
+
+    bool key(json::string_t& name) {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Document:
+            field = name == "messages" ? Field::Messages : Field::Unknown;
+            break;
+        case Scope::Message:
+            if (name == "from") field = Field::From;
+            else if (name == "content") field = Field::Content;
+            else if (name == "timeToRespond") field = Field::TimeToRespond;
+            else if (name == "relationship") field = Field::Relationship;
+            else if (name == "ID") field = Field::ID;
+            else if (name == "responses") field = Field::Responses;
+            else field = Field::Unknown;
+            break;
+        case Scope::Response:
+            if (name == "reply") field = Field::Reply;
+            else if (name == "content") field = Field::Content;
+            else if (name == "health") field = Field::Health;
+            else field = Field::Unknown;
+            break;
+        default:
+            field = Field::Unknown;
+            break;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t bytePosition, const std::string&, const nlohmann::detail::exception& ex) {
+        errorOffset = parseOffset + (bytePosition > 0 ? bytePosition - 1 : 0);
+        error = ex.what();
+        return false;
+    }
+
+    std::string error = "";
+    std::size_t errorOffset = 0;
+
+private:
+    bool Number(long long value) {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Message:
+            switch (field) {
+            case Field::TimeToRespond:
+                message.timeToRespond = static_cast<int>(value);
+                return true;
+            case Field::Relationship:
+                message.relationship = static_cast<Relationship>(value);
+                return true;
+            case Field::ID:
+                message.ID = static_cast<int32_t>(value);
+                return true;
+            case Field::Unknown:
+                return true;
+            default:
+                return Scalar("a number");
+            }
+        case Scope::Response:
+            if (responseTrack >= 2) {
+                return true;
+            }
+            switch (field) {
+            case Field::Health:
+                message.responce[responseTrack].health = static_cast<int>(value);
+                return true;
+            case Field::Unknown:
+                return true;
+            default:
+                return Scalar("a number");
+            }
+        default:
+            return Scalar("a number");
+        }
+    }
+
+    // When borrowing, a string without escape sequences is taken straight from the input: its raw
+    // bytes are then exactly value, so the quote that opens it is value.size() bytes before the one
+    // the lexer just read. A quote there that is itself escaped means the string had escapes, and
+    // those strings are copied, already unescaped by the parser.
+    void SetText(Text& text, const json::string_t& value) {
+        if (borrow) {
+            const char* close = *position - 1;
+            const char* open = close - value.size() - 1;
+            if (open > begin && *close == '"' && *open == '"' && open[-1] != '\\') {
+                text = Text::Borrow(std::string_view(open + 1, value.size()));
+                return;
+            }
+        }
+        text = value;
+    }
+
+    bool Scalar(const char* what) {
+        if (skipDepth > 0) {
+            return true;
+        }
+        switch (scopes.back()) {
+        case Scope::Root:
+            return Fail("expected an object at the top level");
+        case Scope::Document:
+            if (field == Field::Messages) {
+                return Fail("\"messages\" must be an array");
+            }
+            return true;
+        case Scope::Messages:
+        case Scope::Responses:
+            return Fail(std::string("expected an object, found ") + what);
+        default:
+            if (field == Field::Unknown) {
+                return true;
+            }
+            return Fail(FieldName() + " cannot be " + what);
+        }
+    }
+
+    void NextResponse() {
+        if (responseTrack < 2) {
+            responseTrack++;
+        }
+    }
+
+    void ResetMessage() {
+        //cleared rather than reassigned, so with a sink that copies out the capacity is reused
+        static const Message defaults;
+        message.content.clear();
+        message.timeToRespond = defaults.timeToRespond;
+        message.relationship = defaults.relationship;
+        message.ID = defaults.ID;
+        for (auto& response : message.responce) {
+            response.reply.clear();
+            response.content.clear();
+            response.health = 0;
+        }
+    }
+
+    bool Fail(const std::string& what) {
+        error = what;
+        errorOffset = static_cast<std::size_t>(*position - begin);
+        return false;
+    }
+
+    std::string FieldName() const {
+        switch (field) {
+        case Field::Messages: return "\"messages\"";
+        case Field::From: return "\"from\"";
+        case Field::Content: return "\"content\"";
+        case Field::TimeToRespond: return "\"timeToRespond\"";
+        case Field::Relationship: return "\"relationship\"";
+        case Field::ID: return "\"ID\"";
+        case Field::Responses: return "\"responses\"";
+        case Field::Reply: return "\"reply\"";
+        case Field::Health: return "\"health\"";
+        default: return "value";
+        }
+    }
+
+    Sink& sink;
+    const char* begin;
+    const char** position;
+    bool borrow;
+
+    std::vector<Scope> scopes;
+    Field field = Field::None;
+    int skipDepth = 0;
+
+    Message message;
+    std::string from = "";
+    bool hasFrom = false;
+    int responseTrack = 0;
+};
+
+bool ReadWholeFile(const std::string& path, std::string& buffer, LoadResult& result) {
+    //directories open fine with libstdc++ and then report a nonsense size
+    std::error_code ec;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open() || !std::filesystem::is_regular_file(path, ec)) {
+        result.ok = false;
+        result.error = "could not open " + path;
+        return false;
+    }
+
+    ProfileSpan span("load/read file");
+    buffer.assign(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+    span.AddBytes(buffer.size());
+    return true;
+}
+
+void SetErrorPosition(LoadResult& result, const char* begin, std::size_t offset) {
+    result.line = 1;
+    result.column = 1;
+    for (std::size_t i = 0; i < offset; i++) {
+        if (begin[i] == '\n') {
+            result.line++;
+            result.column = 1;
+        }
+        else {
+            result.column++;
+        }
+    }
+}
+
+// The structural pass behind OutlineCharacters. Strings are skipped with memchr and values it
+// doesn't need are only bracket-counted, so it runs at close to memory speed.
+class Outliner {
+public:
+    Outliner(const char* begin, const char* end, std::vector<CharacterOutline>& outline) : begin(begin), at(begin), end(end), outline(outline) {
+        for (int i = 0; i < static_cast<int>(outline.size()); i++) {
+            slots.emplace(outline[i].name, i);
+        }
+    }
+
+    bool Document() {
+        SkipSpace();
+        if (!Expect('{', "expected an object at the top level")) {
+            return false;
+        }
+        SkipSpace();
+        if (at < end && *at == '}') {
+            at++;
+        }
+        else {
+            while (true) {
+                std::string key;
+                if (!Key(key)) {
+                    return false;
+                }
+                if (key != "messages") {
+                    if (!SkipValue()) {
+                        return false;
+                    }
+                }
+                else if (at < end && *at == '[') {
+                    if (!Messages()) {
+                        return false;
+                    }
+                }
+                else if (at < end && *at == '{') {
+                    return Fail("\"messages\" cannot be an object");
+                }
+                else if (end - at >= 4 && std::memcmp(at, "null", 4) == 0) {
+                    at += 4;
+                }
+                else {
+                    return Fail("\"messages\" must be an array");
+                }
+                if (!Next('}')) {
+                    return false;
+                }
+                if (at[-1] == '}') {
+                    break;
+                }
+            }
+        }
+        SkipSpace();
+        if (at != end) {
+            return Fail("unexpected data after the document");
+        }
+        return true;
+    }
+
+    std::string error = "";
+    std::size_t errorOffset = 0;
+
+private:
+    bool Messages() {
+        at++;
+        //a second "messages" array doesn't continue the last run of the first
+        lastCharacter = -1;
+        SkipSpace();
+        if (at < end && *at == ']') {
+            at++;
+            return true;
+        }
+        while (true) {
+            SkipSpace();
+            const char* start = at;
+            if (!Expect('{', "expected a message object")) {
+                return false;
+            }
+            std::string from;
+            bool hasFrom = false;
+            SkipSpace();
+            if (at < end && *at == '}') {
+                at++;
+            }
+            else {
+                while (true) {
+                    std::string key;
+                    if (!Key(key)) {
+                        return false;
+                    }
+                    if (key != "from") {
+                        if (!SkipValue()) {
+                            return false;
+                        }
+                    }
+                    else if (at < end && *at == '"') {
+                        if (!String(&from)) {
+                            return false;
+                        }
+                        hasFrom = true;
+                    }
+                    else if (end - at >= 4 && std::memcmp(at, "null", 4) == 0) {
+                        at += 4;
+                        hasFrom = false;
+                    }
+                    else {
+                        return Fail("\"from\" must be a string");
+                    }
+                    if (!Next('}')) {
+                        return false;
+                    }
+                    if (at[-1] == '}') {
+                        break;
+                    }
+                }
+            }
+            if (!hasFrom) {
+                at = start;
+                return Fail("message is missing \"from\"");
+            }
+            Add(from, static_cast<std::size_t>(start - begin), static_cast<std::size_t>(at - begin));
+            if (!Next(']')) {
+                return false;
+            }
+            if (at[-1] == ']') {
+                return true;
+            }
+        }
+    }
+
+    void Add(const std::string& from, std::size_t messageBegin, std::size_t messageEnd) {
+        //consecutive messages from one speaker become one run
+        if (lastCharacter >= 0 && outline[lastCharacter].name == from) {
+            outline[lastCharacter].runs.back().end = messageEnd;
+            outline[lastCharacter].messages++;
+            return;
+        }
+        auto found = slots.find(from);
+        if (found == slots.end()) {
+            found = slots.emplace(from, static_cast<int>(outline.size())).first;
+            outline.emplace_back();
+            outline.back().name = from;
+        }
+        lastCharacter = found->second;
+        outline[lastCharacter].runs.push_back(MessageRun{ messageBegin, messageEnd });
+        outline[lastCharacter].messages++;
+    }
+
+    // A key and its colon, leaving at on the value.
+    bool Key(std::string& key) {
+        SkipSpace();
+        if (at >= end || *at != '"') {
+            return Fail("expected a key");
+        }
+        if (!String(&key)) {
+            return false;
+        }
+        SkipSpace();
+        if (!Expect(':', "expected ':'")) {
+            return false;
+        }
+        SkipSpace();
+        return true;
+    }
+
+    // After a value: a comma, or close, which is left consumed so the caller can tell them apart.
+    bool Next(char close) {
+        SkipSpace();
+        if (at < end && (*at == ',' || *at == close)) {
+            at++;
+            return true;
+        }
+        return Fail(close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
+
+    // at is on the opening quote. Escaped text is decoded by the json parser, it's rare in names.
+    bool String(std::string* text) {
+        const char* open = at;
+        const char* search = at + 1;
+        while (true) {
+            auto* quote = static_cast<const char*>(std::memchr(search, '"', static_cast<std::size_t>(end - search)));
+            if (quote == nullptr) {
+                at = open;
+                return Fail("unterminated string");
+            }
+            const char* escapes = quote;
+            while (escapes > open + 1 && escapes[-1] == '\\') {
+                escapes--;
+            }
+            search = quote + 1;
+            if (((quote - escapes) & 1) == 0) {
+                break;
+            }
+        }
+        at = search;
+        if (text == nullptr) {
+            return true;
+        }
+        std::string_view raw(open + 1, static_cast<std::size_t>(at - open - 2));
+        if (raw.find('\\') == std::string_view::npos) {
+            text->assign(raw);
+            return true;
+        }
+        try {
+            *text = json::parse(open, at).get<std::string>();
+        }
+        catch (const json::exception&) {
+            at = open;
+            return Fail("invalid string");
+        }
+        return true;
+    }
+
+    bool SkipValue() {
+        if (at >= end) {
+            return Fail("unexpected end of input");
+        }
+        if (*at == '"') {
+            return String(nullptr);
+        }
+        if (*at != '{' && *at != '[') {
+            const char* start = at;
+            while (at < end && *at != ',' && *at != '}' && *at != ']' && !IsSpace(*at)) {
+                at++;
+            }
+            return at != start || Fail("expected a value");
+        }
+        int depth = 0;
+        while (at < end) {
+            char c = *at;
+            if (c == '"') {
+                if (!String(nullptr)) {
+                    return false;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            }
+            else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    at++;
+                    return true;
+                }
+            }
+            at++;
+        }
+        return Fail("unexpected end of input");
+    }
+
+    bool Expect(char c, const char* what) {
+        if (at < end && *at == c) {
+            at++;
+            return true;
+        }
+        return Fail(what);
+    }
+
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void SkipSpace() {
+        while (at < end && IsSpace(*at)) {
+            at++;
+        }
+    }
+
+    bool Fail(const char* what) {
+        error = what;
+        errorOffset = static_cast<std::size_t>(at - begin);
+        return false;
+    }
+
+    const char* begin;
+    const char* at;
+    const char* end;
+    std::vector<CharacterOutline>& outline;
+    std::unordered_map<std::string, int> slots;
+    int lastCharacter = -1;
+};
+
+LoadResult LoadInto(const char* begin, const char* end, std::vector<Character>& characters, bool borrow) {
+    LoadResult result;
+    result.bytesRead = static_cast<std::size_t>(end - begin);
+
+    //load into a scratch list so a bad file never leaves half a document behind
+    std::vector<Character> loaded;
+    const char* position = begin;
+    CharacterSink sink(loaded);
+    DialogueSax<CharacterSink> sax(sink, begin, &position, borrow);
+    bool parsed;
+    {
+        //parsing and building the messages are one pass
+        ProfileSpan span("load/parse");
+        span.AddBytes(result.bytesRead);
+        parsed = json::sax_parse(TrackingIterator(begin, &position), TrackingIterator(end, &position), &sax);
+    }
+    ProfileCount("load/character lookups", sink.lookups);
+
+    if (!parsed) {
+        result.ok = false;
+        result.error = sax.error;
+        SetErrorPosition(result, begin, sax.errorOffset);
+        return result;
+    }
+
+    if (characters.empty()) {
+        characters = std::move(loaded);
+        return result;
+    }
+
+    ProfileSpan span("load/merge");
+    std::unordered_map<std::string, int> slots;
+    slots.reserve(characters.size());
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        slots.emplace(characters[i].name, i);
+    }
+    for (auto& character : loaded) {
+        auto found = slots.find(character.name);
+        if (found != slots.end()) {
+            auto& messages = characters[found->second].messages;
+            messages.insert(messages.end(), std::make_move_iterator(character.messages.begin()), std::make_move_iterator(character.messages.end()));
+        }
+        else {
+            slots.emplace(character.name, static_cast<int>(characters.size()));
+            characters.push_back(std::move(character));
+        }
+    }
+    return result;
+}
+
+}
+
+LoadResult LoadCharacters(const char* begin, const char* end, std::vector<Character>& characters) {
+    return LoadInto(begin, end, characters, false);
+}
+
+LoadResult LoadCharactersBorrowed(const char* begin, const char* end, std::vector<Character>& characters) {
+    return LoadInto(begin, end, characters, true);
+}
+
+LoadResult LoadCharactersMapped(const std::string& path, MappedFile& source, std::vector<Character>& characters) {
+    LoadResult result;
+    {
+        ProfileSpan span("load/map file");
+        if (!source.Open(path, result.error)) {
+            result.ok = false;
+            return result;
+        }
+    }
+    result = LoadCharactersBorrowed(source.Data(), source.Data() + source.Size(), characters);
+    if (!result.ok) {
+        //a failed load leaves characters as they were, so nothing borrows from it
+        source.Close();
+    }
+    return result;
+}
+
+LoadResult LoadCharactersFromFile(const std::string& path, std::vector<Character>& characters) {
+    std::string buffer;
+    LoadResult result;
+    if (!ReadWholeFile(path, buffer, result)) {
+        return result;
+    }
+    return LoadCharacters(buffer.data(), buffer.data() + buffer.size(), characters);
+}
+
+LoadResult OutlineCharacters(const char* begin, const char* end, std::vector<CharacterOutline>& outline) {
+    LoadResult result;
+    result.bytesRead = static_cast<std::size_t>(end - begin);
+    ProfileSpan span("load/outline");
+    span.AddBytes(result.bytesRead);
+
+    std::vector<CharacterOutline> scanned;
+    Outliner outliner(begin, end, scanned);
+    if (!outliner.Document()) {
+        result.ok = false;
+        result.error = outliner.error;
+        SetErrorPosition(result, begin, outliner.errorOffset);
+        return result;
+    }
+    outline = std::move(scanned);
+    return result;
+}
+
+LoadResult LoadMessageRuns(const char* begin, const char* end, const std::vector<MessageRun>& runs, std::vector<Message>& messages) {
+    LoadResult result;
+    ProfileSpan span("load/messages");
+
+    std::vector<Message> loaded;
+    const char* position = begin;
+    MessageSink sink(loaded);
+    DialogueSax<MessageSink> sax(sink, begin, &position, true);
+    sax.StartInMessages();
+    for (const MessageRun& run : runs) {
+        //an outline of a longer version of the file
+        if (run.begin > run.end || run.end > static_cast<std::size_t>(end - begin)) {
+            result.ok = false;
+            result.error = "the messages aren't where the outline says, the file changed";
+            return result;
+        }
+        const char* at = begin + run.begin;
+        const char* runEnd = begin + run.end;
+        span.AddBytes(run.end - run.begin);
+        while (at < runEnd) {
+            //one object per parse: without strict the parser stops right after its closing brace
+            sax.parseOffset = static_cast<std::size_t>(at - begin);
+            if (!json::sax_parse(TrackingIterator(at, &position), TrackingIterator(runEnd, &position), &sax, json::input_format_t::json, false)) {
+                result.ok = false;
+                result.error = sax.error;
+                SetErrorPosition(result, begin, sax.errorOffset);
+                return result;
+            }
+            //then the comma and whitespace up to the next message of the run
+            at = position;
+            while (at < runEnd && *at != '{') {
+                at++;
+            }
+        }
+        result.bytesRead += run.end - run.begin;
+    }
+    if (messages.empty()) {
+        messages = std::move(loaded);
+    }
+    else {
+        messages.insert(messages.end(), std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.end()));
+    }
+    return result;
+}
+
+LoadResult LoadDialogueStore(const char* begin, const char* end, DialogueStore& store) {
+    LoadResult result;
+    result.bytesRead = static_cast<std::size_t>(end - begin);
+
+    store.Clear();
+    const char* position = begin;
+    StoreSink sink(store);
+    DialogueSax<StoreSink> sax(sink, begin, &position);
+    ProfileSpan span("load/parse store");
+    span.AddBytes(result.bytesRead);
+    bool parsed = json::sax_parse(TrackingIterator(begin, &position), TrackingIterator(end, &position), &sax);
+
+    if (!parsed) {
+        //unlike the vector the store has no cheap scratch copy, so a bad file leaves it empty
+        store.Clear();
+        result.ok = false;
+        result.error = sax.error;
+        SetErrorPosition(result, begin, sax.errorOffset);
+        return result;
+    }
+    store.Finish();
+    return result;
+}
+
+LoadResult LoadDialogueStoreFromFile(const std::string& path, DialogueStore& store) {
+    std::string buffer;
+    LoadResult result;
+    if (!ReadWholeFile(path, buffer, result)) {
+        return result;
+    }
+    return LoadDialogueStore(buffer.data(), buffer.data() + buffer.size(), store);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueStore.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Result of a load. line/column are 1-based and only meaningful when ok is false.
+struct LoadResult {
+    bool ok = true;
+    std::string error = "";
+    std::size_t line = 0;
+    std::size_t column = 0;
+    std::size_t bytesRead = 0;
+};
+
+// Streams a messages json straight into characters (appending, merged by "from")
+// without building a json DOM first. Missing or null fields get the same
+// defaults as Message/Response.
+LoadResult LoadCharacters(const char* begin, const char* end, std::vector<Character>& characters);
+LoadResult LoadCharactersFromFile(const std::string& path, std::vector<Character>& characters);
+
+// Same, except that text without escape sequences is borrowed from [begin, end) rather than copied
+// (see Text), so the input has to stay valid for as long as the characters use it.
+LoadResult LoadCharactersBorrowed(const char* begin, const char* end, std::vector<Character>& characters);
+// Maps path into source (which nothing may be borrowing from yet) and loads from the mapping,
+// borrowing. The characters' text points into source until it is edited, so source has to outlive
+// them. Saving keeps working while it is mapped, since writers only read the text; replacing the
+// mapped file itself works on POSIX, where the mapping keeps the old file alive, but not on Windows.
+LoadResult LoadCharactersMapped(const std::string& path, MappedFile& source, std::vector<Character>& characters);
+
+// A stretch of consecutive messages from one speaker, as byte offsets into the source: from the
+// first message's '{' to just past the last one's '}'.
+struct MessageRun {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+struct CharacterOutline {
+    std::string name = "";
+    std::size_t messages = 0;
+    std::vector<MessageRun> runs;
+};
+
+// Finds each character's messages without parsing them: one quick pass over the structure, in the
+// order LoadCharacters would create the characters. Only the structure and the "from" of each
+// message are checked, so a message whose fields are wrong is only reported by LoadMessageRuns.
+// outline is left alone on failure.
+LoadResult OutlineCharacters(const char* begin, const char* end, std::vector<CharacterOutline>& outline);
+// Parses the messages in runs (from OutlineCharacters over the same [begin, end)) and appends
+// them to messages, borrowing their text from the source as LoadCharactersBorrowed does.
+// messages is left alone on failure.
+LoadResult LoadMessageRuns(const char* begin, const char* end, const std::vector<MessageRun>& runs, std::vector<Message>& messages);
+
+// Same parser and rules, but into the compact DialogueStore (finished and ready to read).
+LoadResult LoadDialogueStore(const char* begin, const char* end, DialogueStore& store);
+LoadResult LoadDialogueStoreFromFile(const std::string& path, DialogueStore& store);
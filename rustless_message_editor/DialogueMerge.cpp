@@ -0,0 +1,668 @@
+#include "DialogueMerge.h"
+#include "DialogueBatch.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+const int kFields = static_cast<int>(MessageField::Health2) + 1;
+
+const std::vector<Message> kNoMessages;
+
+#ifdef _WIN32
+bool ReadFile(const std::string& path, std::string& buffer) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    buffer.assign(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    return static_cast<bool>(file.read(&buffer[0], static_cast<std::streamsize>(buffer.size())));
+}
+#endif
+
+uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+uint64_t HashText(uint64_t hash, std::string_view text) {
+    return Mix(hash, std::hash<std::string_view>()(text));
+}
+
+// The ID is left out: it's part of the key, so matched messages always share it.
+struct Hashes {
+    uint64_t message = 0;
+    uint64_t response[2] = { 0, 0 };
+};
+
+Hashes HashMessage(const Message& message) {
+    Hashes hashes;
+    hashes.message = HashText(0, message.content);
+    hashes.message = Mix(hashes.message, static_cast<uint64_t>(message.timeToRespond));
+    hashes.message = Mix(hashes.message, static_cast<uint64_t>(message.relationship));
+    for (int r = 0; r < 2; r++) {
+        const Response& response = message.responce[r];
+        hashes.response[r] = Mix(HashText(HashText(0, response.reply), response.content), static_cast<uint64_t>(response.health));
+        hashes.message = Mix(hashes.message, hashes.response[r]);
+    }
+    return hashes;
+}
+
+// the response a field belongs to, -1 for the message's own fields
+int ResponseOf(MessageField field) {
+    switch (field) {
+    case MessageField::Content1:
+    case MessageField::Reply1:
+    case MessageField::Health1:
+        return 0;
+    case MessageField::Content2:
+    case MessageField::Reply2:
+    case MessageField::Health2:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+Text* FieldText(Message& message, MessageField field) {
+    switch (field) {
+    case MessageField::Content: return &message.content;
+    case MessageField::Content1: return &message.responce[0].content;
+    case MessageField::Reply1: return &message.responce[0].reply;
+    case MessageField::Content2: return &message.responce[1].content;
+    case MessageField::Reply2: return &message.responce[1].reply;
+    default: return nullptr;
+    }
+}
+
+const Text* FieldText(const Message& message, MessageField field) {
+    return FieldText(const_cast<Message&>(message), field);
+}
+
+bool SameField(const Message& a, const Message& b, MessageField field) {
+    if (IsTextField(field)) {
+        return FieldText(a, field)->View() == FieldText(b, field)->View();
+    }
+    return GetField(a, field).number == GetField(b, field).number;
+}
+
+// Copies the Text itself rather than going through FieldValue, so borrowed text stays borrowed.
+void CopyField(Message& to, const Message& from, MessageField field) {
+    if (IsTextField(field)) {
+        *FieldText(to, field) = *FieldText(from, field);
+    }
+    else {
+        SetField(to, field, GetField(from, field));
+    }
+}
+
+// (ID, occurrence) packed in one number. IDs almost always go up through a character, which
+// makes every occurrence 0 without counting.
+void MessageKeys(const std::vector<Message>& messages, std::vector<uint64_t>& keys) {
+    keys.resize(messages.size());
+    bool increasing = true;
+    for (std::size_t k = 0; k < messages.size(); k++) {
+        keys[k] = uint64_t(static_cast<uint32_t>(messages[k].ID)) << 32;
+        increasing &= k == 0 || messages[k].ID > messages[k - 1].ID;
+    }
+    if (!increasing) {
+        std::unordered_map<int32_t, uint32_t> seen;
+        for (std::size_t k = 0; k < messages.size(); k++) {
+            keys[k] |= seen[messages[k].ID]++;
+        }
+    }
+}
+
+MessageKey KeyOf(const std::string& from, uint64_t key) {
+    return MessageKey{ from, static_cast<int32_t>(static_cast<uint32_t>(key >> 32)), static_cast<int>(key & 0xFFFFFFFFu) };
+}
+
+// One version's messages of one character, and what matching them needs.
+struct Side {
+    int character = -1;
+    const std::vector<Message>* messages = &kNoMessages;
+    std::vector<Message> scratch;
+    std::vector<uint64_t> keys;
+    std::vector<Hashes> hashes;
+
+    const Message& operator[](std::size_t k) const { return (*messages)[k]; }
+    std::size_t size() const { return messages->size(); }
+};
+
+bool LoadSide(const DialogueVersion& version, int character, Side& side, LoadResult& result) {
+    side.character = character;
+    side.messages = &kNoMessages;
+    if (character >= 0) {
+        LoadResult loaded = version.Messages(static_cast<std::size_t>(character), side.scratch, side.messages);
+        if (!loaded.ok) {
+            loaded.error = version.Name(static_cast<std::size_t>(character)) + ": " + loaded.error;
+            result = loaded;
+            return false;
+        }
+        result.bytesRead += loaded.bytesRead;
+    }
+    MessageKeys(*side.messages, side.keys);
+    side.hashes.resize(side.size());
+    for (std::size_t k = 0; k < side.size(); k++) {
+        side.hashes[k] = HashMessage(side[k]);
+    }
+    return true;
+}
+
+// Matches the messages of two versions by key (unique on either side): bToA[j] is the a with
+// b[j]'s key, -1 for none, and aToB the other way. Runs that line up at the start and the end are
+// matched in place; only what's left between them is looked up.
+void Align(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, std::vector<int>& bToA, std::vector<int>& aToB) {
+    bToA.assign(b.size(), -1);
+    aToB.assign(a.size(), -1);
+    std::size_t limit = std::min(a.size(), b.size());
+    std::size_t prefix = 0;
+    while (prefix < limit && a[prefix] == b[prefix]) {
+        bToA[prefix] = static_cast<int>(prefix);
+        aToB[prefix] = static_cast<int>(prefix);
+        prefix++;
+    }
+    std::size_t suffix = 0;
+    while (suffix < limit - prefix && a[a.size() - 1 - suffix] == b[b.size() - 1 - suffix]) {
+        bToA[b.size() - 1 - suffix] = static_cast<int>(a.size() - 1 - suffix);
+        aToB[a.size() - 1 - suffix] = static_cast<int>(b.size() - 1 - suffix);
+        suffix++;
+    }
+    if (prefix + suffix == a.size() || prefix + suffix == b.size()) {
+        return;
+    }
+    std::unordered_map<uint64_t, int> middle;
+    middle.reserve(a.size() - prefix - suffix);
+    for (std::size_t i = prefix; i < a.size() - suffix; i++) {
+        middle.emplace(a[i], static_cast<int>(i));
+    }
+    for (std::size_t j = prefix; j < b.size() - suffix; j++) {
+        auto found = middle.find(b[j]);
+        if (found != middle.end()) {
+            bToA[j] = found->second;
+            aToB[found->second] = static_cast<int>(j);
+        }
+    }
+}
+
+std::unordered_map<std::string, int> NameIndex(const DialogueVersion& version) {
+    std::unordered_map<std::string, int> names;
+    for (std::size_t c = 0; c < version.Characters(); c++) {
+        names.emplace(version.Name(c), static_cast<int>(c));
+    }
+    return names;
+}
+
+int Find(const std::unordered_map<std::string, int>& names, const std::string& name) {
+    auto found = names.find(name);
+    return found == names.end() ? -1 : found->second;
+}
+
+void AllFields(const Message& message, bool after, std::vector<FieldDiff>& fields) {
+    for (int f = 0; f < kFields; f++) {
+        FieldDiff field;
+        field.field = static_cast<MessageField>(f);
+        (after ? field.after : field.before) = GetField(message, field.field);
+        fields.push_back(std::move(field));
+    }
+}
+
+void ChangedFields(const Message& a, const Hashes& aHashes, const Message& b, const Hashes& bHashes, std::vector<FieldDiff>& fields) {
+    for (int f = 0; f < kFields; f++) {
+        MessageField field = static_cast<MessageField>(f);
+        int response = ResponseOf(field);
+        if ((response >= 0 && aHashes.response[response] == bHashes.response[response]) || SameField(a, b, field)) {
+            continue;
+        }
+        fields.push_back(FieldDiff{ field, GetField(a, field), GetField(b, field) });
+    }
+}
+
+// One character's three versions merged into merged, which ends up with every message to keep.
+class CharacterMerge {
+public:
+    CharacterMerge(const Side& base, const Side& ours, const Side& theirs, int character, std::vector<MergeConflict>& conflicts, MergeStats& stats)
+        : base(base), ours(ours), theirs(theirs), character(character), conflicts(conflicts), stats(stats) {
+    }
+
+    void Run(Character& merged) {
+        Align(base.keys, ours.keys, oursToBase, baseToOurs);
+        Align(base.keys, theirs.keys, theirsToBase, baseToTheirs);
+        Align(ours.keys, theirs.keys, theirsToOurs, oursToTheirs);
+        for (std::size_t b = 0; b < base.size(); b++) {
+            stats.removed += baseToOurs[b] < 0 && baseToTheirs[b] < 0 ? 1 : 0;
+        }
+
+        //what only theirs has goes after the last message before it that ours has too
+        std::vector<std::pair<int, int>> pending;
+        int anchor = 0;
+        for (std::size_t t = 0; t < theirs.size(); t++) {
+            if (theirsToOurs[t] >= 0) {
+                anchor = theirsToOurs[t] + 1;
+            }
+            else {
+                pending.emplace_back(anchor, static_cast<int>(t));
+            }
+        }
+        std::stable_sort(pending.begin(), pending.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+
+        std::vector<Message>& messages = merged.messages;
+        std::size_t next = 0;
+        for (std::size_t o = 0; o <= ours.size(); o++) {
+            while (next < pending.size() && pending[next].first <= static_cast<int>(o)) {
+                MergeTheirs(static_cast<std::size_t>(pending[next++].second), merged.name, messages);
+            }
+            if (o < ours.size()) {
+                MergeOurs(o, merged.name, messages);
+            }
+        }
+    }
+
+private:
+    void MergeOurs(std::size_t o, const std::string& from, std::vector<Message>& messages) {
+        int b = oursToBase[o];
+        int t = oursToTheirs[o];
+        uint64_t oursHash = ours.hashes[o].message;
+        if (b >= 0 && t >= 0) {
+            uint64_t baseHash = base.hashes[b].message;
+            uint64_t theirsHash = theirs.hashes[t].message;
+            if (oursHash == baseHash) {
+                messages.push_back(theirs[t]);
+                (theirsHash == baseHash ? stats.unchanged : stats.fromTheirs)++;
+            }
+            else if (theirsHash == baseHash || theirsHash == oursHash) {
+                messages.push_back(ours[o]);
+                stats.fromOurs++;
+            }
+            else {
+                Combine(&base[b], o, static_cast<std::size_t>(t), from, messages);
+            }
+        }
+        else if (b >= 0) {
+            if (oursHash == base.hashes[b].message) {
+                stats.removed++;
+                return;
+            }
+            Deleted(ours[o], ours.keys[o], MergeSide::Theirs, from, messages);
+        }
+        else if (t >= 0) {
+            if (oursHash == theirs.hashes[t].message) {
+                messages.push_back(ours[o]);
+                stats.added++;
+            }
+            else {
+                Combine(nullptr, o, static_cast<std::size_t>(t), from, messages);
+            }
+        }
+        else {
+            messages.push_back(ours[o]);
+            stats.added++;
+        }
+    }
+
+    void MergeTheirs(std::size_t t, const std::string& from, std::vector<Message>& messages) {
+        int b = theirsToBase[t];
+        if (b < 0) {
+            messages.push_back(theirs[t]);
+            stats.added++;
+        }
+        else if (theirs.hashes[t].message == base.hashes[b].message) {
+            stats.removed++;
+        }
+        else {
+            Deleted(theirs[t], theirs.keys[t], MergeSide::Ours, from, messages);
+        }
+    }
+
+    // One side deleted what the other changed: the changed message stays until it's settled.
+    void Deleted(const Message& kept, uint64_t key, MergeSide deletedBy, const std::string& from, std::vector<Message>& messages) {
+        MergeConflict conflict;
+        conflict.key = KeyOf(from, key);
+        conflict.kind = ConflictKind::DeleteChanged;
+        conflict.deletedBy = deletedBy;
+        conflict.character = character;
+        conflict.message = static_cast<int>(messages.size());
+        conflicts.push_back(std::move(conflict));
+        messages.push_back(kept);
+        stats.conflicts++;
+    }
+
+    // Both sides changed the message (or added it, when there's no base): field by field, the
+    // side that differs from base wins, and where both do, ours stays and it's a conflict.
+    void Combine(const Message* baseMessage, std::size_t o, std::size_t t, const std::string& from, std::vector<Message>& messages) {
+        Message merged = ours[o];
+        const Message& theirsMessage = theirs[t];
+        for (int f = 0; f < kFields; f++) {
+            MessageField field = static_cast<MessageField>(f);
+            int response = ResponseOf(field);
+            if ((response >= 0 && ours.hashes[o].response[response] == theirs.hashes[t].response[response]) || SameField(merged, theirsMessage, field)) {
+                continue;
+            }
+            if (baseMessage != nullptr && SameField(*baseMessage, merged, field)) {
+                CopyField(merged, theirsMessage, field);
+                continue;
+            }
+            if (baseMessage != nullptr && SameField(*baseMessage, theirsMessage, field)) {
+                continue;
+            }
+            MergeConflict conflict;
+            conflict.key = KeyOf(from, ours.keys[o]);
+            conflict.kind = baseMessage != nullptr ? ConflictKind::Field : ConflictKind::BothAdded;
+            conflict.field = field;
+            if (baseMessage != nullptr) {
+                conflict.base = GetField(*baseMessage, field);
+            }
+            conflict.ours = GetField(merged, field);
+            conflict.theirs = GetField(theirsMessage, field);
+            conflict.character = character;
+            conflict.message = static_cast<int>(messages.size());
+            conflicts.push_back(std::move(conflict));
+            stats.conflicts++;
+        }
+        messages.push_back(std::move(merged));
+        (baseMessage != nullptr ? stats.combined : stats.added)++;
+    }
+
+    const Side& base;
+    const Side& ours;
+    const Side& theirs;
+    int character;
+    std::vector<MergeConflict>& conflicts;
+    MergeStats& stats;
+    std::vector<int> oursToBase;
+    std::vector<int> baseToOurs;
+    std::vector<int> theirsToBase;
+    std::vector<int> baseToTheirs;
+    std::vector<int> theirsToOurs;
+    std::vector<int> oursToTheirs;
+};
+
+}
+
+LoadResult DialogueVersion::Open(const std::string& path) {
+    LoadResult result;
+#ifdef _WIN32
+    //read, not mapped, so a merge can save over one of its own inputs
+    if (!ReadFile(path, buffer)) {
+        result.ok = false;
+        result.error = "could not open " + path;
+        return result;
+    }
+    data = buffer.data();
+    size = buffer.size();
+#else
+    if (!mapped.Open(path, result.error)) {
+        result.ok = false;
+        return result;
+    }
+    data = mapped.Data();
+    size = mapped.Size();
+#endif
+    characters = nullptr;
+    return OutlineCharacters(data, data + size, outline);
+}
+
+void DialogueVersion::Use(const std::vector<Character>& loaded) {
+    characters = &loaded;
+    outline.clear();
+}
+
+std::size_t DialogueVersion::Characters() const {
+    return characters != nullptr ? characters->size() : outline.size();
+}
+
+const std::string& DialogueVersion::Name(std::size_t character) const {
+    return characters != nullptr ? (*characters)[character].name : outline[character].name;
+}
+
+std::size_t DialogueVersion::MessageCount(std::size_t character) const {
+    return characters != nullptr ? (*characters)[character].messages.size() : outline[character].messages;
+}
+
+bool DialogueVersion::SameBytes(std::size_t character, const DialogueVersion& other, std::size_t otherCharacter) const {
+    if (characters != nullptr || other.characters != nullptr) {
+        return false;
+    }
+    const std::vector<MessageRun>& runs = outline[character].runs;
+    const std::vector<MessageRun>& otherRuns = other.outline[otherCharacter].runs;
+    if (runs.size() != otherRuns.size()) {
+        return false;
+    }
+    for (std::size_t r = 0; r < runs.size(); r++) {
+        std::string_view run(data + runs[r].begin, runs[r].end - runs[r].begin);
+        if (run != std::string_view(other.data + otherRuns[r].begin, otherRuns[r].end - otherRuns[r].begin)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+LoadResult DialogueVersion::Messages(std::size_t character, std::vector<Message>& scratch, const std::vector<Message>*& messages) const {
+    if (characters != nullptr) {
+        messages = &(*characters)[character].messages;
+        return LoadResult();
+    }
+    scratch.clear();
+    LoadResult result = LoadMessageRuns(data, data + size, outline[character].runs, scratch);
+    messages = &scratch;
+    return result;
+}
+
+LoadResult DiffDialogue(const DialogueVersion& before, const DialogueVersion& after, const std::function<void(const MessageDiff&)>& visit,
+    DiffStats& stats) {
+    ProfileSpan span("merge/diff");
+    LoadResult result;
+    std::unordered_map<std::string, int> beforeNames = NameIndex(before);
+    std::vector<bool> compared(before.Characters(), false);
+    Side a;
+    Side b;
+    std::vector<int> bToA;
+    std::vector<int> aToB;
+    MessageDiff diff;
+
+    auto compare = [&](int beforeCharacter, int afterCharacter) {
+        if (beforeCharacter >= 0 && afterCharacter >= 0 && before.SameBytes(beforeCharacter, after, afterCharacter)) {
+            stats.characters++;
+            stats.unchanged += after.MessageCount(afterCharacter);
+            return true;
+        }
+        if (!LoadSide(before, beforeCharacter, a, result) || !LoadSide(after, afterCharacter, b, result)) {
+            return false;
+        }
+        stats.characters++;
+        const std::string& name = afterCharacter >= 0 ? after.Name(afterCharacter) : before.Name(beforeCharacter);
+        Align(a.keys, b.keys, bToA, aToB);
+        for (std::size_t j = 0; j < b.size(); j++) {
+            int i = bToA[j];
+            if (i >= 0 && a.hashes[i].message == b.hashes[j].message) {
+                stats.unchanged++;
+                continue;
+            }
+            diff.key = KeyOf(name, b.keys[j]);
+            diff.beforeCharacter = i >= 0 ? beforeCharacter : -1;
+            diff.beforeMessage = i;
+            diff.afterCharacter = afterCharacter;
+            diff.afterMessage = static_cast<int>(j);
+            diff.fields.clear();
+            if (i < 0) {
+                diff.kind = DiffKind::Added;
+                AllFields(b[j], true, diff.fields);
+                stats.added++;
+            }
+            else {
+                diff.kind = DiffKind::Changed;
+                ChangedFields(a[i], a.hashes[i], b[j], b.hashes[j], diff.fields);
+                stats.changed++;
+            }
+            visit(diff);
+        }
+        for (std::size_t i = 0; i < a.size(); i++) {
+            if (aToB[i] >= 0) {
+                continue;
+            }
+            diff.key = KeyOf(name, a.keys[i]);
+            diff.kind = DiffKind::Removed;
+            diff.beforeCharacter = beforeCharacter;
+            diff.beforeMessage = static_cast<int>(i);
+            diff.afterCharacter = -1;
+            diff.afterMessage = -1;
+            diff.fields.clear();
+            AllFields(a[i], false, diff.fields);
+            stats.removed++;
+            visit(diff);
+        }
+        return true;
+    };
+
+    for (std::size_t c = 0; c < after.Characters(); c++) {
+        int i = Find(beforeNames, after.Name(c));
+        if (i >= 0) {
+            compared[i] = true;
+        }
+        if (!compare(i, static_cast<int>(c))) {
+            return result;
+        }
+    }
+    for (std::size_t c = 0; c < before.Characters(); c++) {
+        if (!compared[c] && !compare(static_cast<int>(c), -1)) {
+            return result;
+        }
+    }
+    stats.bytesRead += result.bytesRead;
+    return result;
+}
+
+LoadResult MergeDialogue(const DialogueVersion& base, const DialogueVersion& ours, const DialogueVersion& theirs,
+    const std::function<void(Character&)>& emit, std::vector<MergeConflict>& conflicts, MergeStats& stats) {
+    ProfileSpan span("merge/merge");
+    LoadResult result;
+    std::unordered_map<std::string, int> baseNames = NameIndex(base);
+    std::unordered_map<std::string, int> oursNames = NameIndex(ours);
+    std::unordered_map<std::string, int> theirsNames = NameIndex(theirs);
+    std::vector<std::string> names;
+    for (std::size_t c = 0; c < ours.Characters(); c++) {
+        names.push_back(ours.Name(c));
+    }
+    for (std::size_t c = 0; c < theirs.Characters(); c++) {
+        if (Find(oursNames, theirs.Name(c)) < 0) {
+            names.push_back(theirs.Name(c));
+        }
+    }
+
+    Side baseSide;
+    Side oursSide;
+    Side theirsSide;
+    Character merged;
+    int emitted = 0;
+    for (auto& name : names) {
+        int b = Find(baseNames, name);
+        int o = Find(oursNames, name);
+        int t = Find(theirsNames, name);
+        //nobody touched it: ours as it is
+        if (b >= 0 && o >= 0 && t >= 0 && base.SameBytes(b, ours, o) && base.SameBytes(b, theirs, t)) {
+            if (!LoadSide(ours, o, oursSide, result)) {
+                return result;
+            }
+            merged = Character();
+            merged.name = name;
+            merged.messages = *oursSide.messages;
+            stats.unchanged += merged.messages.size();
+        }
+        else {
+            if (!LoadSide(base, b, baseSide, result) || !LoadSide(ours, o, oursSide, result) || !LoadSide(theirs, t, theirsSide, result)) {
+                return result;
+            }
+            merged = Character();
+            merged.name = name;
+            CharacterMerge(baseSide, oursSide, theirsSide, emitted, conflicts, stats).Run(merged);
+        }
+        if (merged.messages.empty()) {
+            continue;
+        }
+        stats.characters++;
+        stats.messages += merged.messages.size();
+        emit(merged);
+        emitted++;
+    }
+    stats.bytesRead += result.bytesRead;
+    return result;
+}
+
+void ResolveConflicts(std::vector<Character>& merged, const std::vector<MergeConflict>& conflicts, const std::vector<MergeSide>& choices) {
+    std::vector<std::pair<int, int>> dropped;
+    for (std::size_t k = 0; k < conflicts.size(); k++) {
+        const MergeConflict& conflict = conflicts[k];
+        MergeSide side = k < choices.size() ? choices[k] : MergeSide::Ours;
+        if (conflict.kind == ConflictKind::DeleteChanged) {
+            if (side == conflict.deletedBy || side == MergeSide::Base) {
+                dropped.emplace_back(conflict.character, conflict.message);
+            }
+            continue;
+        }
+        //messages both sides added have no base to go back to
+        if (side == MergeSide::Base && conflict.kind == ConflictKind::BothAdded) {
+            side = MergeSide::Ours;
+        }
+        const FieldValue& value = side == MergeSide::Ours ? conflict.ours : side == MergeSide::Theirs ? conflict.theirs : conflict.base;
+        SetField(merged[conflict.character].messages[conflict.message], conflict.field, value);
+    }
+    //last first, so the ones still to go keep their places
+    std::sort(dropped.begin(), dropped.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a > b; });
+    dropped.erase(std::unique(dropped.begin(), dropped.end()), dropped.end());
+    for (auto& drop : dropped) {
+        auto& messages = merged[drop.first].messages;
+        messages.erase(messages.begin() + drop.second);
+    }
+}
+
+const char* MergeSideName(MergeSide side) {
+    switch (side) {
+    case MergeSide::Ours: return "ours";
+    case MergeSide::Theirs: return "theirs";
+    default: return "base";
+    }
+}
+
+std::string DescribeKey(const MessageKey& key) {
+    std::string text = key.from + " #" + std::to_string(key.id);
+    if (key.occurrence != 0) {
+        text += " (" + std::to_string(key.occurrence + 1) + " of that ID)";
+    }
+    return text;
+}
+
+std::string DescribeDiff(const MessageDiff& diff) {
+    std::string text = DescribeKey(diff.key);
+    if (diff.kind != DiffKind::Changed) {
+        text += diff.kind == DiffKind::Added ? " added: " : " removed: ";
+        const FieldDiff& content = diff.fields[static_cast<int>(MessageField::Content)];
+        return text + DescribeValue(MessageField::Content, diff.kind == DiffKind::Added ? content.after : content.before);
+    }
+    for (std::size_t k = 0; k < diff.fields.size(); k++) {
+        const FieldDiff& field = diff.fields[k];
+        text += (k == 0 ? " " : ", ") + std::string(BatchFieldLabel(field.field)) + ": " + DescribeValue(field.field, field.before) + " -> "
+            + DescribeValue(field.field, field.after);
+    }
+    return text;
+}
+
+std::string DescribeConflict(const MergeConflict& conflict) {
+    std::string text = DescribeKey(conflict.key);
+    if (conflict.kind == ConflictKind::DeleteChanged) {
+        MergeSide changedBy = conflict.deletedBy == MergeSide::Ours ? MergeSide::Theirs : MergeSide::Ours;
+        return text + " deleted by " + MergeSideName(conflict.deletedBy) + ", changed by " + MergeSideName(changedBy);
+    }
+    text += conflict.kind == ConflictKind::BothAdded ? " added by both, " : " ";
+    text += std::string(BatchFieldLabel(conflict.field)) + ": ours " + DescribeValue(conflict.field, conflict.ours) + ", theirs "
+        + DescribeValue(conflict.field, conflict.theirs);
+    if (conflict.kind == ConflictKind::Field) {
+        text += ", base " + DescribeValue(conflict.field, conflict.base);
+    }
+    return text;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueLoader.h"
+#include "MappedFile.h"
+#include "UndoHistory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Structural diff and three-way merge of messages files, for writers editing copies of the same
+// dialogue: a text merge of the pretty json conflicts on every neighbouring edit and can leave it
+// broken, this can't.
+//
+// Messages are matched across versions by speaker and ID, with occurrence telling apart the
+// messages one speaker has under the same ID, in file order (as LiveReload does). Every message
+// and response is hashed, so the unchanged ones (nearly all of them) are passed over without
+// looking at their fields, and matching keys are only put in a hash map past the point where two
+// versions stop lining up one to one.
+//
+// Files are mapped and outlined (see OutlineCharacters) but only one character of each version is
+// parsed at a time, with its text borrowed from the mapping, so memory follows the biggest
+// character rather than the file.
+
+struct MessageKey {
+    std::string from = "";
+    int32_t id = 0;
+    int occurrence = 0;
+};
+
+// One version of the dialogue to compare: a messages json on disk, or characters in memory (the
+// editor's document), which then have to outlive it.
+class DialogueVersion {
+public:
+    DialogueVersion() = default;
+
+    DialogueVersion(const DialogueVersion&) = delete;
+    DialogueVersion& operator=(const DialogueVersion&) = delete;
+
+    LoadResult Open(const std::string& path);
+    void Use(const std::vector<Character>& characters);
+
+    std::size_t Characters() const;
+    const std::string& Name(std::size_t character) const;
+    // size of the file, 0 for characters in memory
+    std::size_t Bytes() const { return size; }
+    std::size_t MessageCount(std::size_t character) const;
+    // True when both are files holding the character's messages byte for byte the same, which
+    // passes over a character nobody touched without parsing it.
+    bool SameBytes(std::size_t character, const DialogueVersion& other, std::size_t otherCharacter) const;
+    // The character's messages: parsed into scratch from the file, or the character's own.
+    LoadResult Messages(std::size_t character, std::vector<Message>& scratch, const std::vector<Message>*& messages) const;
+
+private:
+    MappedFile mapped;
+    std::string buffer;
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::vector<CharacterOutline> outline;
+    const std::vector<Character>* characters = nullptr;
+};
+
+enum class DiffKind {
+    Added,
+    Removed,
+    Changed
+};
+
+struct FieldDiff {
+    MessageField field = MessageField::Content;
+    FieldValue before;
+    FieldValue after;
+};
+
+struct MessageDiff {
+    MessageKey key;
+    DiffKind kind = DiffKind::Changed;
+    // where the message is in each version, -1 in the one that hasn't got it
+    int beforeCharacter = -1;
+    int beforeMessage = -1;
+    int afterCharacter = -1;
+    int afterMessage = -1;
+    // the fields that differ; every field of an added or removed message
+    std::vector<FieldDiff> fields;
+};
+
+struct DiffStats {
+    std::size_t characters = 0;
+    std::size_t unchanged = 0;
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    std::size_t changed = 0;
+    std::size_t bytesRead = 0;
+};
+
+// Calls visit with every message that differs, character by character in after's order (then
+// the characters only before has), each character's additions and changes in after's order
+// followed by its removals.
+LoadResult DiffDialogue(const DialogueVersion& before, const DialogueVersion& after, const std::function<void(const MessageDiff&)>& visit,
+    DiffStats& stats);
+
+enum class ConflictKind {
+    // both sides changed a field, to different values
+    Field,
+    // both sides added a message under the same key, with this field different
+    BothAdded,
+    // one side deleted the message, the other changed it
+    DeleteChanged
+};
+
+enum class MergeSide {
+    Ours,
+    Theirs,
+    Base
+};
+
+struct MergeConflict {
+    MessageKey key;
+    ConflictKind kind = ConflictKind::Field;
+    // Field and BothAdded only
+    MessageField field = MessageField::Content;
+    FieldValue base;
+    FieldValue ours;
+    FieldValue theirs;
+    // DeleteChanged only: the side that deleted it
+    MergeSide deletedBy = MergeSide::Ours;
+    // where it is in the merged output; until resolved it holds ours, or for DeleteChanged
+    // whichever side still has the message
+    int character = -1;
+    int message = -1;
+};
+
+struct MergeStats {
+    std::size_t characters = 0;
+    std::size_t messages = 0;
+    std::size_t unchanged = 0;
+    // messages only one side changed, or both the same way
+    std::size_t fromOurs = 0;
+    std::size_t fromTheirs = 0;
+    // messages both sides changed, merged field by field (their conflicts included)
+    std::size_t combined = 0;
+    // by either side, or by both the same way
+    std::size_t added = 0;
+    std::size_t removed = 0;
+    std::size_t conflicts = 0;
+    std::size_t bytesRead = 0;
+};
+
+// Three-way merge: every change ours or theirs made to base, as long as they don't touch the same
+// field. A clash is kept as ours (or as the changed message, when the other side deleted it) and
+// recorded in conflicts for the caller to settle. emit gets each merged character in turn: ours'
+// order, then the ones only theirs has; messages only theirs added come right after the message
+// they follow in theirs. Characters left with no messages are not emitted.
+LoadResult MergeDialogue(const DialogueVersion& base, const DialogueVersion& ours, const DialogueVersion& theirs,
+    const std::function<void(Character&)>& emit, std::vector<MergeConflict>& conflicts, MergeStats& stats);
+
+// Settles conflicts in merged (what MergeDialogue emitted) with the side chosen for each; a
+// DeleteChanged settled for the side that deleted it, or for base, takes the message out.
+void ResolveConflicts(std::vector<Character>& merged, const std::vector<MergeConflict>& conflicts, const std::vector<MergeSide>& choices);
+
+const char* MergeSideName(MergeSide side);
+// "Name #ID" (with the occurrence when it isn't the first)
+std::string DescribeKey(const MessageKey& key);
+// "Name #ID: field before -> after" per field, or "added"/"removed"
+std::string DescribeDiff(const MessageDiff& diff);
+std::string DescribeConflict(const MergeConflict& conflict);
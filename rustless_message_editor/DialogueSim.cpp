@@ -0,0 +1,344 @@
+#include "DialogueSim.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+//playthroughs per batch: each batch is one unit of work with its own random sequence
+constexpr uint64_t kBatch = 4096;
+
+// SplitMix64: a few cycles a number and plenty random enough to pick replies with.
+struct SimRandom {
+    uint64_t state;
+
+    uint64_t Next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, bound), bound < 2^32
+    uint32_t Below(uint32_t bound) {
+        return static_cast<uint32_t>(((Next() >> 32) * bound) >> 32);
+    }
+};
+
+int Choose(const SimMessage& message, SimPolicy policy, SimRandom& random) {
+    if (message.choices != 3) {
+        return message.choices == 2 ? 1 : 0;
+    }
+    switch (policy) {
+    case SimPolicy::Kindest:
+        return message.health[1] > message.health[0] ? 1 : 0;
+    case SimPolicy::Cruelest:
+        return message.health[1] < message.health[0] ? 1 : 0;
+    default:
+        return static_cast<int>(random.Next() >> 63);
+    }
+}
+
+void RunBatch(const SimModel& model, const SimOptions& options, uint64_t batch, SimResult& result) {
+    SimRandom random{ options.seed ^ (batch * 0xD1B54A32D192ED03ull) };
+    //replies take [0, 2 * thinkMs] milliseconds
+    uint32_t thinkRange = static_cast<uint32_t>(std::max(0, options.thinkMs)) * 2 + 1;
+    uint64_t first = batch * kBatch;
+    uint64_t last = std::min(options.playthroughs, first + kBatch);
+    const SimMessage* messages = model.messages.data();
+    SimMessageStats* messageStats = result.messages.data();
+
+    for (uint64_t run = first; run < last; run++) {
+        std::size_t c = static_cast<std::size_t>(run % model.characters.size());
+        const SimCharacter& character = model.characters[c];
+        int64_t health = options.startHealth;
+        int64_t timeMs = 0;
+        bool died = false;
+        uint32_t end = character.firstMessage + character.messageCount;
+        for (uint32_t m = character.firstMessage; m < end; m++) {
+            const SimMessage& message = messages[m];
+            SimMessageStats& stats = messageStats[m];
+            SimRelationshipStats& relationship = result.relationships[message.relationship];
+            stats.reached++;
+            relationship.reached++;
+            if (message.choices != 0) {
+                uint32_t reply = random.Below(thinkRange);
+                if (static_cast<int64_t>(reply) > message.timeToRespondMs) {
+                    stats.missed++;
+                    relationship.missed++;
+                    timeMs += std::max(0, message.timeToRespondMs);
+                }
+                else {
+                    timeMs += reply;
+                    int pick = Choose(message, options.policy, random);
+                    int delta = message.health[pick];
+                    stats.picks[pick]++;
+                    health += delta;
+                    relationship.healthSum += delta;
+                    relationship.hurt += delta < 0;
+                    relationship.unchanged += delta == 0;
+                    relationship.helped += delta > 0;
+                }
+            }
+            stats.healthSum += health;
+            if (health <= 0) {
+                stats.deaths++;
+                died = true;
+                break;
+            }
+        }
+
+        SimCharacterStats& characterStats = result.characters[c];
+        if (characterStats.playthroughs == 0) {
+            characterStats.finalHealthMin = health;
+            characterStats.finalHealthMax = health;
+        }
+        characterStats.playthroughs++;
+        characterStats.deaths += died;
+        characterStats.finalHealthSum += health;
+        characterStats.finalHealthMin = std::min(characterStats.finalHealthMin, health);
+        characterStats.finalHealthMax = std::max(characterStats.finalHealthMax, health);
+        characterStats.timeMsSum += timeMs;
+        characterStats.timeMsMax = std::max(characterStats.timeMsMax, timeMs);
+        result.deaths += died;
+        int bucket = health <= 0 ? 0 : static_cast<int>(std::min<int64_t>(kSimHealthBuckets - 1, health / result.bucketWidth));
+        result.finalHealth[bucket]++;
+    }
+    result.playthroughs += last - first;
+}
+
+SimResult EmptyResult(const SimModel& model, const SimOptions& options) {
+    SimResult result;
+    result.options = options;
+    //32 buckets cover up to about three times the starting health
+    result.bucketWidth = std::max(1, options.startHealth / 10);
+    result.characters.resize(model.characters.size());
+    result.messages.resize(model.messages.size());
+    return result;
+}
+
+}
+
+SimModel BuildSimModel(const std::vector<Character>& characters) {
+    SimModel model;
+    for (std::size_t i = 0; i < characters.size(); i++) {
+        const Character& character = characters[i];
+        if (character.messages.empty()) {
+            continue;
+        }
+        SimCharacter entry;
+        entry.firstMessage = static_cast<uint32_t>(model.messages.size());
+        entry.messageCount = static_cast<uint32_t>(character.messages.size());
+        entry.source = static_cast<int>(i);
+        entry.budgetMs = 0;
+        for (auto& message : character.messages) {
+            SimMessage sim;
+            sim.health[0] = message.responce[0].health;
+            sim.health[1] = message.responce[1].health;
+            //timeToRespond is in seconds; clamped so the milliseconds fit
+            sim.timeToRespondMs = std::clamp(message.timeToRespond, -2000000, 2000000) * 1000;
+            int relationship = static_cast<int>(message.relationship);
+            sim.relationship = static_cast<uint8_t>(relationship >= POSITIVE && relationship <= NEGATIVE ? relationship : NEUTERAL);
+            sim.choices = static_cast<uint8_t>((message.responce[0].content.empty() ? 0 : 1) | (message.responce[1].content.empty() ? 0 : 2));
+            sim.reserved = 0;
+            if (sim.choices != 0) {
+                entry.budgetMs += std::max(0, sim.timeToRespondMs);
+            }
+            model.messages.push_back(sim);
+            model.ids.push_back(message.ID);
+        }
+        model.characters.push_back(entry);
+        model.names.push_back(character.name);
+    }
+    return model;
+}
+
+void SimResult::Add(const SimResult& other) {
+    playthroughs += other.playthroughs;
+    deaths += other.deaths;
+    for (int k = 0; k < kSimHealthBuckets; k++) {
+        finalHealth[k] += other.finalHealth[k];
+    }
+    for (int r = 0; r < 3; r++) {
+        SimRelationshipStats& to = relationships[r];
+        const SimRelationshipStats& from = other.relationships[r];
+        to.reached += from.reached;
+        to.missed += from.missed;
+        to.hurt += from.hurt;
+        to.unchanged += from.unchanged;
+        to.helped += from.helped;
+        to.healthSum += from.healthSum;
+    }
+    for (std::size_t c = 0; c < characters.size() && c < other.characters.size(); c++) {
+        SimCharacterStats& to = characters[c];
+        const SimCharacterStats& from = other.characters[c];
+        if (from.playthroughs == 0) {
+            continue;
+        }
+        to.finalHealthMin = to.playthroughs == 0 ? from.finalHealthMin : std::min(to.finalHealthMin, from.finalHealthMin);
+        to.finalHealthMax = to.playthroughs == 0 ? from.finalHealthMax : std::max(to.finalHealthMax, from.finalHealthMax);
+        to.playthroughs += from.playthroughs;
+        to.deaths += from.deaths;
+        to.finalHealthSum += from.finalHealthSum;
+        to.timeMsSum += from.timeMsSum;
+        to.timeMsMax = std::max(to.timeMsMax, from.timeMsMax);
+    }
+    for (std::size_t m = 0; m < messages.size() && m < other.messages.size(); m++) {
+        SimMessageStats& to = messages[m];
+        const SimMessageStats& from = other.messages[m];
+        to.reached += from.reached;
+        to.missed += from.missed;
+        to.picks[0] += from.picks[0];
+        to.picks[1] += from.picks[1];
+        to.deaths += from.deaths;
+        to.healthSum += from.healthSum;
+    }
+}
+
+SimResult RunSimulation(const SimModel& model, const SimOptions& options, std::atomic<uint64_t>* progress, const std::atomic<bool>* cancel) {
+    ProfileSpan span("simulate");
+    auto start = std::chrono::steady_clock::now();
+    SimResult total = EmptyResult(model, options);
+    if (model.characters.empty()) {
+        return total;
+    }
+
+    uint64_t batches = (options.playthroughs + kBatch - 1) / kBatch;
+    //each thread adds into its own totals; they are only summed once all have finished
+    std::vector<SimResult> perThread(ParallelThreads(static_cast<std::size_t>(batches), options.threads), EmptyResult(model, options));
+    ParallelForWorkers(static_cast<std::size_t>(batches), options.threads, [&](std::size_t batch, unsigned worker) {
+        if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+            return;
+        }
+        uint64_t before = perThread[worker].playthroughs;
+        RunBatch(model, options, batch, perThread[worker]);
+        if (progress != nullptr) {
+            progress->fetch_add(perThread[worker].playthroughs - before, std::memory_order_relaxed);
+        }
+    });
+    for (auto& part : perThread) {
+        total.Add(part);
+    }
+    total.cancelled = total.playthroughs < options.playthroughs;
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ProfileCount("simulated playthroughs", static_cast<int64_t>(total.playthroughs));
+    return total;
+}
+
+std::vector<uint32_t> DeadliestMessages(const SimResult& result, std::size_t count) {
+    std::vector<uint32_t> deadly;
+    for (uint32_t m = 0; m < result.messages.size(); m++) {
+        if (result.messages[m].deaths != 0) {
+            deadly.push_back(m);
+        }
+    }
+    auto deadlier = [&](uint32_t a, uint32_t b) {
+        return result.messages[a].deaths != result.messages[b].deaths ? result.messages[a].deaths > result.messages[b].deaths : a < b;
+    };
+    if (deadly.size() > count) {
+        std::partial_sort(deadly.begin(), deadly.begin() + count, deadly.end(), deadlier);
+        deadly.resize(count);
+    }
+    else {
+        std::sort(deadly.begin(), deadly.end(), deadlier);
+    }
+    return deadly;
+}
+
+SimWorker::SimWorker() : thread(&SimWorker::Run, this) {
+}
+
+SimWorker::~SimWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void SimWorker::Start(SimModel model, const SimOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingModel = std::move(model);
+        pendingOptions = options;
+        hasPending = true;
+        //the running one is about to be thrown away anyway
+        cancel = true;
+    }
+    wake.notify_one();
+}
+
+void SimWorker::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    hasPending = false;
+    cancel = true;
+}
+
+SimStatus SimWorker::Status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    SimStatus status;
+    status.running = running || hasPending;
+    status.done = running ? progress.load(std::memory_order_relaxed) : 0;
+    status.total = hasPending ? pendingOptions.playthroughs : total;
+    return status;
+}
+
+bool SimWorker::Take(SimModel& model, SimResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hasFinished) {
+        return false;
+    }
+    model = std::move(finishedModel);
+    result = std::move(finished);
+    hasFinished = false;
+    return true;
+}
+
+void SimWorker::SetOnFinished(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onFinished = std::move(callback);
+}
+
+void SimWorker::Run() {
+    while (true) {
+        SimModel model;
+        SimOptions options;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            running = false;
+            wake.wait(lock, [this] { return hasPending || stopping; });
+            if (stopping) {
+                return;
+            }
+            model = std::move(pendingModel);
+            options = pendingOptions;
+            hasPending = false;
+            running = true;
+            total = options.playthroughs;
+            progress = 0;
+            cancel = false;
+        }
+
+        SimResult result = RunSimulation(model, options, &progress, &cancel);
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            //a cancelled run is only worth showing when nothing replaced it
+            if (!result.cancelled || !hasPending) {
+                finishedModel = std::move(model);
+                finished = std::move(result);
+                hasFinished = true;
+            }
+            callback = onFinished;
+        }
+        if (callback) {
+            callback();
+        }
+    }
+}
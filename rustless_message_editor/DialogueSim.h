@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Playthrough simulator for balancing health and timing.
+//
+// A playthrough is one conversation with one character: their messages in order, the player
+// answering each with one of the responses that has content. The player's reply takes a random
+// time, and one slower than the message's timeToRespond misses it: no response, no health change.
+// Health starts at SimOptions::startHealth, moves by the chosen response's health, and the
+// conversation ends early once it reaches 0. Playthroughs go round the characters in turn.
+
+// Just what the simulation reads of a message, 16 bytes, one character's messages after another.
+struct SimMessage {
+    int32_t health[2];
+    int32_t timeToRespondMs;
+    // POSITIVE, NEUTERAL or NEGATIVE; anything else is counted as NEUTERAL
+    uint8_t relationship;
+    // bit r set when responce[r] has content and can be picked
+    uint8_t choices;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(SimMessage) == 16, "sim message layout changed");
+
+struct SimCharacter {
+    uint32_t firstMessage;
+    uint32_t messageCount;
+    // index in the characters the model was built from
+    int source;
+    // time a player answering every message at the last moment spends
+    int64_t budgetMs;
+};
+
+struct SimModel {
+    std::vector<SimCharacter> characters;
+    std::vector<SimMessage> messages;
+    // kept apart from the messages so the simulation doesn't drag them through the cache
+    std::vector<std::string> names;
+    std::vector<int32_t> ids;
+};
+
+// Characters without messages (including ones a LazyLoader hasn't parsed yet) are left out.
+SimModel BuildSimModel(const std::vector<Character>& characters);
+
+enum class SimPolicy {
+    // either response, evenly
+    Random,
+    // the one with more health
+    Kindest,
+    // the one with less health
+    Cruelest
+};
+
+struct SimOptions {
+    uint64_t playthroughs = 1000000;
+    SimPolicy policy = SimPolicy::Random;
+    int startHealth = 100;
+    // replies take anywhere from 0 to twice this long
+    int thinkMs = 8000;
+    uint64_t seed = 1;
+    // 0 = one per core
+    unsigned threads = 0;
+};
+
+constexpr int kSimHealthBuckets = 32;
+
+struct SimMessageStats {
+    uint64_t reached = 0;
+    uint64_t missed = 0;
+    uint64_t picks[2] = { 0, 0 };
+    // playthroughs whose health ran out here
+    uint64_t deaths = 0;
+    // health just after this message, over every playthrough that reached it
+    int64_t healthSum = 0;
+};
+
+struct SimCharacterStats {
+    uint64_t playthroughs = 0;
+    uint64_t deaths = 0;
+    int64_t finalHealthSum = 0;
+    int64_t finalHealthMin = 0;
+    int64_t finalHealthMax = 0;
+    int64_t timeMsSum = 0;
+    int64_t timeMsMax = 0;
+};
+
+struct SimRelationshipStats {
+    uint64_t reached = 0;
+    uint64_t missed = 0;
+    // answered messages by what the answer did to health
+    uint64_t hurt = 0;
+    uint64_t unchanged = 0;
+    uint64_t helped = 0;
+    int64_t healthSum = 0;
+};
+
+// Totals of a simulation. Everything is summed in integers and every batch of playthroughs has its
+// own random sequence, so a seed gives the same result on any number of threads.
+struct SimResult {
+    SimOptions options;
+    uint64_t playthroughs = 0;
+    uint64_t deaths = 0;
+    bool cancelled = false;
+    double seconds = 0.0;
+    // final health of every playthrough, bucketWidth wide from 0; the last bucket holds the rest
+    uint64_t finalHealth[kSimHealthBuckets] = {};
+    int bucketWidth = 1;
+    SimRelationshipStats relationships[3];
+    // parallel to the model's characters and messages
+    std::vector<SimCharacterStats> characters;
+    std::vector<SimMessageStats> messages;
+
+    void Add(const SimResult& other);
+};
+
+// Runs options.playthroughs playthroughs of model. progress, when given, counts finished
+// playthroughs as they go; setting cancel stops early with what was done so far.
+SimResult RunSimulation(const SimModel& model, const SimOptions& options, std::atomic<uint64_t>* progress = nullptr,
+    const std::atomic<bool>* cancel = nullptr);
+
+// Messages where the most playthroughs ran out of health, most first.
+std::vector<uint32_t> DeadliestMessages(const SimResult& result, std::size_t count);
+
+struct SimStatus {
+    bool running = false;
+    uint64_t done = 0;
+    uint64_t total = 0;
+};
+
+// Runs simulations on their own thread so the editor stays responsive. Starting one while another
+// runs cancels the older one.
+class SimWorker {
+public:
+    SimWorker();
+    ~SimWorker();
+
+    SimWorker(const SimWorker&) = delete;
+    SimWorker& operator=(const SimWorker&) = delete;
+
+    void Start(SimModel model, const SimOptions& options);
+    void Cancel();
+    SimStatus Status() const;
+    // The newest finished simulation and the model it ran on, once each.
+    bool Take(SimModel& model, SimResult& result);
+    // Called on the simulation thread when one finishes.
+    void SetOnFinished(std::function<void()> callback);
+
+private:
+    void Run();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool hasPending = false;
+    SimModel pendingModel;
+    SimOptions pendingOptions;
+    bool running = false;
+    uint64_t total = 0;
+    bool hasFinished = false;
+    SimModel finishedModel;
+    SimResult finished;
+    std::function<void()> onFinished;
+    std::atomic<uint64_t> progress{ 0 };
+    std::atomic<bool> cancel{ false };
+    std::thread thread;
+};
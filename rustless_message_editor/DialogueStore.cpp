@@ -0,0 +1,218 @@
+#include "DialogueStore.h"
+
+#include <functional>
+
+namespace {
+
+template <typename T>
+std::size_t VectorBytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+// Reorders a column so entry k comes from order[k].
+template <typename T>
+void Permute(std::vector<T>& column, const std::vector<uint32_t>& order) {
+    std::vector<T> permuted;
+    permuted.reserve(order.size());
+    for (uint32_t from : order) {
+        permuted.push_back(column[from]);
+    }
+    column.swap(permuted);
+}
+
+}
+
+StringPool::StringPool() {
+    table.assign(1024, 0);
+    Intern("");
+}
+
+uint32_t StringPool::Intern(std::string_view text) {
+    if (table.empty()) {
+        std::size_t size = 1024;
+        while (size < spans.size() * 2) {
+            size *= 2;
+        }
+        Rehash(size);
+    }
+    std::size_t mask = table.size() - 1;
+    std::size_t slot = std::hash<std::string_view>()(text) & mask;
+    while (table[slot] != 0) {
+        const Span& span = spans[table[slot] - 1];
+        if (span.length == text.size() && std::string_view(chars.data() + span.offset, span.length) == text) {
+            return table[slot] - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t index = static_cast<uint32_t>(spans.size());
+    spans.push_back(Span{ static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(text.size()) });
+    chars.append(text.data(), text.size());
+    table[slot] = index + 1;
+    //keep the table at most half full
+    if (spans.size() * 2 > table.size()) {
+        Rehash(table.size() * 2);
+    }
+    return index;
+}
+
+std::size_t StringPool::MemoryBytes() const {
+    return chars.capacity() + VectorBytes(spans) + VectorBytes(table);
+}
+
+void StringPool::Compact() {
+    chars.shrink_to_fit();
+    spans.shrink_to_fit();
+    std::vector<uint32_t>().swap(table);
+}
+
+void StringPool::Rehash(std::size_t size) {
+    std::vector<uint32_t> grown(size, 0);
+    std::size_t mask = grown.size() - 1;
+    for (uint32_t index = 0; index < spans.size(); index++) {
+        std::size_t slot = std::hash<std::string_view>()(Get(index)) & mask;
+        while (grown[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        grown[slot] = index + 1;
+    }
+    table.swap(grown);
+}
+
+void DialogueStore::Clear() {
+    *this = DialogueStore();
+}
+
+uint32_t DialogueStore::AddMessage(std::string_view from, std::string_view content, int32_t id, int timeToRespond, Relationship relationship) {
+    uint32_t name = strings.Intern(from);
+    //messages from one speaker are normally consecutive, so try the last one first
+    if (lastCharacter == UINT32_MAX || characterNames[lastCharacter] != name) {
+        auto found = characterOfName.find(name);
+        if (found != characterOfName.end()) {
+            lastCharacter = found->second;
+        }
+        else {
+            lastCharacter = static_cast<uint32_t>(characterNames.size());
+            characterNames.push_back(name);
+            characterOfName.emplace(name, lastCharacter);
+        }
+    }
+
+    speakers.push_back(lastCharacter);
+    ids.push_back(id);
+    contents.push_back(strings.Intern(content));
+    timesToRespond.push_back(timeToRespond);
+    relationships.push_back(static_cast<int32_t>(relationship));
+    responseFirst.push_back(responseFirst.back());
+    return static_cast<uint32_t>(ids.size()) - 1;
+}
+
+void DialogueStore::AddResponse(std::string_view reply, std::string_view content, int health) {
+    replies.push_back(strings.Intern(reply));
+    responseContents.push_back(strings.Intern(content));
+    healths.push_back(health);
+    responseFirst.back()++;
+}
+
+void DialogueStore::AddMessage(std::string_view from, const Message& message) {
+    AddMessage(from, message.content, message.ID, message.timeToRespond, message.relationship);
+    for (auto& response : message.responce) {
+        AddResponse(response.reply, response.content, response.health);
+    }
+}
+
+void DialogueStore::Finish() {
+    uint32_t characters = CharacterCount();
+    characterFirst.assign(characters + 1, 0);
+    bool grouped = true;
+    for (std::size_t m = 0; m < speakers.size(); m++) {
+        characterFirst[speakers[m] + 1]++;
+        grouped = grouped && (m == 0 || speakers[m - 1] <= speakers[m]);
+    }
+    for (uint32_t c = 0; c < characters; c++) {
+        characterFirst[c + 1] += characterFirst[c];
+    }
+
+    if (!grouped) {
+        //counting sort: stable, so each character keeps its messages in file order
+        std::vector<uint32_t> next(characterFirst.begin(), characterFirst.end() - 1);
+        std::vector<uint32_t> order(speakers.size());
+        for (uint32_t m = 0; m < speakers.size(); m++) {
+            order[next[speakers[m]]++] = m;
+        }
+
+        std::vector<uint32_t> responseOrder;
+        responseOrder.reserve(replies.size());
+        std::vector<uint32_t> first;
+        first.reserve(responseFirst.size());
+        first.push_back(0);
+        for (uint32_t from : order) {
+            for (uint32_t r = responseFirst[from]; r < responseFirst[from + 1]; r++) {
+                responseOrder.push_back(r);
+            }
+            first.push_back(static_cast<uint32_t>(responseOrder.size()));
+        }
+
+        Permute(ids, order);
+        Permute(contents, order);
+        Permute(timesToRespond, order);
+        Permute(relationships, order);
+        Permute(replies, responseOrder);
+        Permute(responseContents, responseOrder);
+        Permute(healths, responseOrder);
+        responseFirst.swap(first);
+    }
+
+    std::vector<uint32_t>().swap(speakers);
+    std::unordered_map<uint32_t, uint32_t>().swap(characterOfName);
+    lastCharacter = UINT32_MAX;
+
+    //read-mostly from here on, so the growth slack of every column and the intern table go
+    strings.Compact();
+    for (auto* column : { &characterNames, &characterFirst, &contents, &responseFirst, &replies, &responseContents }) {
+        column->shrink_to_fit();
+    }
+    for (auto* column : { &ids, &timesToRespond, &relationships, &healths }) {
+        column->shrink_to_fit();
+    }
+}
+
+void DialogueStore::FromCharacters(const std::vector<Character>& characters) {
+    Clear();
+    for (auto& character : characters) {
+        for (auto& message : character.messages) {
+            AddMessage(character.name, message);
+        }
+    }
+    Finish();
+}
+
+void DialogueStore::ToCharacters(std::vector<Character>& characters) const {
+    characters.clear();
+    characters.resize(CharacterCount());
+    for (uint32_t c = 0; c < CharacterCount(); c++) {
+        Character& character = characters[c];
+        character.name = std::string(CharacterName(c));
+        character.messages.resize(MessagesOf(c));
+        for (uint32_t k = 0; k < MessagesOf(c); k++) {
+            uint32_t m = FirstMessage(c) + k;
+            Message& message = character.messages[k];
+            message.content = std::string(Content(m));
+            message.ID = ID(m);
+            message.timeToRespond = TimeToRespond(m);
+            message.relationship = RelationshipOf(m);
+            //the editor model has room for two
+            for (uint32_t r = 0; r < ResponsesOf(m) && r < 2; r++) {
+                message.responce[r].reply = std::string(Reply(FirstResponse(m) + r));
+                message.responce[r].content = std::string(ResponseContent(FirstResponse(m) + r));
+                message.responce[r].health = Health(FirstResponse(m) + r);
+            }
+        }
+    }
+}
+
+std::size_t DialogueStore::MemoryBytes() const {
+    return strings.MemoryBytes() + VectorBytes(characterNames) + VectorBytes(characterFirst) + VectorBytes(speakers) +
+        VectorBytes(ids) + VectorBytes(contents) + VectorBytes(timesToRespond) + VectorBytes(relationships) + VectorBytes(responseFirst) +
+        VectorBytes(replies) + VectorBytes(responseContents) + VectorBytes(healths);
+}
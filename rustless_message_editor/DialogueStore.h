@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Append-only pool of interned strings. All text lives back to back in one buffer, so adding a
+// string is a bump of the buffer end instead of a heap allocation, and a string seen before
+// (a speaker name, a stock reply, "") is stored once and handed back by index.
+class StringPool {
+public:
+    StringPool();
+
+    uint32_t Intern(std::string_view text);
+    std::string_view Get(uint32_t index) const {
+        return std::string_view(chars.data() + spans[index].offset, spans[index].length);
+    }
+
+    uint32_t Count() const { return static_cast<uint32_t>(spans.size()); }
+    // Text plus table overhead, in bytes.
+    std::size_t MemoryBytes() const;
+    // Drops the lookup table and spare capacity once the strings are all in. Intern still works
+    // afterwards, it builds the table again first.
+    void Compact();
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    void Rehash(std::size_t size);
+
+    std::string chars;
+    std::vector<Span> spans;
+    // open addressing over span indices + 1, 0 = empty; the size is a power of two
+    std::vector<uint32_t> table;
+};
+
+// Compact alternative to std::vector<Character> for large read-mostly dialogue: text in a
+// StringPool, every numeric field in its own column, messages grouped by character like
+// BakedDialogue. Responses are columns too, with a per-message first-response index, so a
+// message can have any number of them without an allocation of its own.
+//
+// Finish trims every column and drops the intern table, so a loaded store costs its distinct text
+// once plus about 44 bytes a message; the structs pay a Text and often a heap block per string.
+//
+// Build with AddMessage/AddResponse in any speaker order, then call Finish once before reading.
+class DialogueStore {
+public:
+    void Clear();
+
+    // Appends a message for this speaker and returns its build-order index.
+    uint32_t AddMessage(std::string_view from, std::string_view content, int32_t id, int timeToRespond, Relationship relationship);
+    // Adds a response to the message added last.
+    void AddResponse(std::string_view reply, std::string_view content, int health);
+    // Both of the editor's responses.
+    void AddMessage(std::string_view from, const Message& message);
+    // Groups the messages by character, in first-appearance order of the speakers.
+    void Finish();
+
+    void FromCharacters(const std::vector<Character>& characters);
+    void ToCharacters(std::vector<Character>& characters) const;
+
+    uint32_t CharacterCount() const { return static_cast<uint32_t>(characterNames.size()); }
+    uint32_t MessageCount() const { return static_cast<uint32_t>(ids.size()); }
+    std::string_view CharacterName(uint32_t character) const { return strings.Get(characterNames[character]); }
+    uint32_t FirstMessage(uint32_t character) const { return characterFirst[character]; }
+    uint32_t MessagesOf(uint32_t character) const { return characterFirst[character + 1] - characterFirst[character]; }
+
+    int32_t ID(uint32_t message) const { return ids[message]; }
+    std::string_view Content(uint32_t message) const { return strings.Get(contents[message]); }
+    int TimeToRespond(uint32_t message) const { return timesToRespond[message]; }
+    Relationship RelationshipOf(uint32_t message) const { return static_cast<Relationship>(relationships[message]); }
+    uint32_t FirstResponse(uint32_t message) const { return responseFirst[message]; }
+    uint32_t ResponsesOf(uint32_t message) const { return responseFirst[message + 1] - responseFirst[message]; }
+
+    std::string_view Reply(uint32_t response) const { return strings.Get(replies[response]); }
+    std::string_view ResponseContent(uint32_t response) const { return strings.Get(responseContents[response]); }
+    int Health(uint32_t response) const { return healths[response]; }
+
+    const StringPool& Strings() const { return strings; }
+    std::size_t MemoryBytes() const;
+
+private:
+    StringPool strings;
+
+    std::vector<uint32_t> characterNames;
+    // CharacterCount + 1 entries once finished
+    std::vector<uint32_t> characterFirst;
+    // interned name -> character, for the speaker lookup while building
+    std::unordered_map<uint32_t, uint32_t> characterOfName;
+    uint32_t lastCharacter = UINT32_MAX;
+
+    // message columns; speakers is only needed until Finish has grouped them
+    std::vector<uint32_t> speakers;
+    std::vector<int32_t> ids;
+    std::vector<uint32_t> contents;
+    std::vector<int32_t> timesToRespond;
+    //int32 rather than a byte: the loader keeps whatever integer the file had
+    std::vector<int32_t> relationships;
+    // MessageCount + 1 entries; message m owns responses [responseFirst[m], responseFirst[m + 1])
+    std::vector<uint32_t> responseFirst = std::vector<uint32_t>(1, 0);
+
+    // response columns
+    std::vector<uint32_t> replies;
+    std::vector<uint32_t> responseContents;
+    std::vector<int32_t> healths;
+};
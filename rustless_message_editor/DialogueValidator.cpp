@@ -0,0 +1,254 @@
+#include "DialogueValidator.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+
+namespace {
+
+const char* const kProblemNames[kProblemKinds] = {
+    "duplicate ID",
+    "ID out of range",
+    "unknown relationship",
+    "no response has content",
+    "reply without content",
+    "health out of range",
+    "negative time to respond",
+    "no name",
+};
+
+// Work unit of the parallel pass: part of one character's messages, so a single huge
+// character is shared out as well as many small ones.
+struct Chunk {
+    int character;
+    int begin;
+    int end;
+};
+
+const int kChunkMessages = 16384;
+
+int KindOf(ProblemFlag kind) {
+    int bit = 0;
+    while ((1u << bit) != static_cast<unsigned>(kind)) {
+        bit++;
+    }
+    return bit;
+}
+
+}
+
+void DialogueValidator::ValidateAll(const std::vector<Character>& characters, const DialogueIndex& index, unsigned threads) {
+    flags.assign(characters.size(), {});
+    characterFlags.assign(characters.size(), 0);
+    problemsIn.assign(characters.size(), 0);
+    problemCount = 0;
+    std::fill(std::begin(kindCounts), std::end(kindCounts), 0);
+
+    std::vector<Chunk> chunks;
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        int count = static_cast<int>(characters[i].messages.size());
+        flags[i].resize(count);
+        for (int begin = 0; begin < count; begin += kChunkMessages) {
+            chunks.push_back(Chunk{ i, begin, std::min(count, begin + kChunkMessages) });
+        }
+    }
+
+    //workers only write their own chunk's slots and read the index, so nothing needs a lock
+    ParallelFor(chunks.size(), threads, [&](std::size_t k) {
+        const Chunk& chunk = chunks[k];
+        const auto& messages = characters[chunk.character].messages;
+        auto& out = flags[chunk.character];
+        for (int j = chunk.begin; j < chunk.end; j++) {
+            out[j] = CheckMessage(messages[j], index);
+        }
+    });
+
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        for (uint16_t value : flags[i]) {
+            if (value != 0) {
+                Count(value, 1);
+                problemsIn[i]++;
+            }
+        }
+        SetCharacterFlags(i, characters[i].name.empty() ? ProblemNoName : 0);
+    }
+    version++;
+}
+
+std::size_t DialogueValidator::KindCount(ProblemFlag kind) const {
+    return kindCounts[KindOf(kind)];
+}
+
+std::vector<Problem> DialogueValidator::Collect(std::size_t maxProblems) const {
+    std::vector<Problem> problems;
+    for (int i = 0; i < static_cast<int>(flags.size()) && problems.size() < maxProblems; i++) {
+        if (problemsIn[i] == 0) {
+            continue;
+        }
+        if (characterFlags[i] != 0) {
+            problems.push_back(Problem{ i, -1, characterFlags[i] });
+        }
+        for (int j = 0; j < static_cast<int>(flags[i].size()) && problems.size() < maxProblems; j++) {
+            if (flags[i][j] != 0) {
+                problems.push_back(Problem{ i, j, flags[i][j] });
+            }
+        }
+    }
+    return problems;
+}
+
+void DialogueValidator::OnMessageChanged(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message) {
+    SetMessageFlags(character, message, CheckMessage(characters[character].messages[message], index));
+    version++;
+}
+
+void DialogueValidator::OnMessageIDChanged(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message, int32_t oldID) {
+    //the messages left on the old ID may have stopped being duplicates, the ones on the new ID started
+    RecheckID(characters, index, oldID);
+    RecheckID(characters, index, characters[character].messages[message].ID);
+    version++;
+}
+
+void DialogueValidator::OnMessageAdded(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message) {
+    flags[character].insert(flags[character].begin() + message, 0);
+    RecheckID(characters, index, characters[character].messages[message].ID);
+    version++;
+}
+
+void DialogueValidator::OnMessageDeleted(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message, int32_t deletedID) {
+    SetMessageFlags(character, message, 0);
+    flags[character].erase(flags[character].begin() + message);
+    RecheckID(characters, index, deletedID);
+    version++;
+}
+
+void DialogueValidator::OnCharacterAdded(const std::vector<Character>& characters, const DialogueIndex& index, int character) {
+    const auto& messages = characters[character].messages;
+    flags.insert(flags.begin() + character, std::vector<uint16_t>(messages.size(), 0));
+    characterFlags.insert(characterFlags.begin() + character, 0);
+    problemsIn.insert(problemsIn.begin() + character, 0);
+    SetCharacterFlags(character, characters[character].name.empty() ? ProblemNoName : 0);
+    for (auto& message : messages) {
+        RecheckID(characters, index, message.ID);
+    }
+    version++;
+}
+
+void DialogueValidator::OnCharacterRenamed(const std::vector<Character>& characters, int character) {
+    SetCharacterFlags(character, characters[character].name.empty() ? ProblemNoName : 0);
+    version++;
+}
+
+void DialogueValidator::OnCharacterDeleted(const std::vector<Character>& characters, const DialogueIndex& index, int character, const std::vector<int32_t>& deletedIDs) {
+    //only IDs that were shared can change anything elsewhere
+    std::vector<int32_t> shared;
+    for (std::size_t j = 0; j < flags[character].size(); j++) {
+        if (flags[character][j] & ProblemDuplicateID) {
+            shared.push_back(deletedIDs[j]);
+        }
+        SetMessageFlags(character, static_cast<int>(j), 0);
+    }
+    SetCharacterFlags(character, 0);
+    flags.erase(flags.begin() + character);
+    characterFlags.erase(characterFlags.begin() + character);
+    problemsIn.erase(problemsIn.begin() + character);
+
+    std::sort(shared.begin(), shared.end());
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    for (int32_t id : shared) {
+        RecheckID(characters, index, id);
+    }
+    version++;
+}
+
+uint16_t DialogueValidator::CheckMessage(const Message& message, const DialogueIndex& index) const {
+    uint16_t value = 0;
+    if (index.CountMessages(message.ID) > 1) {
+        value |= ProblemDuplicateID;
+    }
+    if (message.ID < options.minID || message.ID > options.maxID) {
+        value |= ProblemIDOutOfRange;
+    }
+    //the loader keeps whatever integer the file had
+    int relationship = static_cast<int>(message.relationship);
+    if (relationship < POSITIVE || relationship > NEGATIVE) {
+        value |= ProblemBadRelationship;
+    }
+    if (message.responce[0].content.empty() && message.responce[1].content.empty()) {
+        value |= ProblemNoResponses;
+    }
+    for (auto& response : message.responce) {
+        if (response.content.empty() && !response.reply.empty()) {
+            value |= ProblemReplyWithoutContent;
+        }
+        if (response.health < options.minHealth || response.health > options.maxHealth) {
+            value |= ProblemHealthOutlier;
+        }
+    }
+    if (message.timeToRespond < 0) {
+        value |= ProblemNegativeTime;
+    }
+    return value;
+}
+
+void DialogueValidator::SetMessageFlags(int character, int message, uint16_t value) {
+    uint16_t& slot = flags[character][message];
+    if (slot != 0) {
+        Count(slot, -1);
+        problemsIn[character]--;
+    }
+    slot = value;
+    if (slot != 0) {
+        Count(slot, 1);
+        problemsIn[character]++;
+    }
+}
+
+void DialogueValidator::SetCharacterFlags(int character, uint16_t value) {
+    uint16_t& slot = characterFlags[character];
+    if (slot != 0) {
+        Count(slot, -1);
+        problemsIn[character]--;
+    }
+    slot = value;
+    if (slot != 0) {
+        Count(slot, 1);
+        problemsIn[character]++;
+    }
+}
+
+void DialogueValidator::Count(uint16_t value, int direction) {
+    problemCount += direction;
+    for (int bit = 0; bit < kProblemKinds; bit++) {
+        if (value & (1u << bit)) {
+            kindCounts[bit] += direction;
+        }
+    }
+}
+
+void DialogueValidator::RecheckID(const std::vector<Character>& characters, const DialogueIndex& index, int32_t id) {
+    for (const MessageLocation& location : index.FindMessages(id)) {
+        SetMessageFlags(location.character, location.message, CheckMessage(characters[location.character].messages[location.message], index));
+    }
+}
+
+const char* ProblemName(ProblemFlag kind) {
+    return kProblemNames[KindOf(kind)];
+}
+
+std::string DescribeProblem(const std::vector<Character>& characters, const Problem& problem) {
+    const Character& character = characters[problem.character];
+    std::string text = character.name.empty() ? "(unnamed)" : character.name;
+    if (problem.message != -1) {
+        text += " / ID " + std::to_string(character.messages[problem.message].ID);
+    }
+    text += ":";
+    bool first = true;
+    for (int bit = 0; bit < kProblemKinds; bit++) {
+        if (problem.flags & (1u << bit)) {
+            text += first ? " " : ", ";
+            text += kProblemNames[bit];
+            first = false;
+        }
+    }
+    return text;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One bit per kind of problem, so a message's problems fit in a uint16_t.
+enum ProblemFlag : uint16_t {
+    ProblemDuplicateID = 1 << 0,
+    ProblemIDOutOfRange = 1 << 1,
+    ProblemBadRelationship = 1 << 2,
+    ProblemNoResponses = 1 << 3,
+    ProblemReplyWithoutContent = 1 << 4,
+    ProblemHealthOutlier = 1 << 5,
+    ProblemNegativeTime = 1 << 6,
+    //character level
+    ProblemNoName = 1 << 7,
+};
+
+const int kProblemKinds = 8;
+
+struct ValidationOptions {
+    int32_t minID = 0;
+    int32_t maxID = INT32_MAX;
+    // response health outside this range is reported as an outlier
+    int minHealth = -100;
+    int maxHealth = 100;
+};
+
+// A character (message == -1) or message with at least one problem.
+struct Problem {
+    int character = -1;
+    int message = -1;
+    uint16_t flags = 0;
+};
+
+// Checks every message of the dialogue and keeps the result per message, so the editor can
+// show a problems list without rechecking anything each frame.
+//
+// Every check only looks at the message itself, plus the DialogueIndex for how many messages
+// share its ID, so the first full pass splits the corpus into chunks checked on all cores.
+// After that only the messages an edit can affect are checked again: the edited message and,
+// when an ID changes, appears or goes away, every message holding that ID.
+//
+// The On* calls mirror DialogueIndex's and must come after the index has been updated.
+class DialogueValidator {
+public:
+    explicit DialogueValidator(const ValidationOptions& options = ValidationOptions()) : options(options) {}
+
+    // threads == 0 uses every hardware thread.
+    void ValidateAll(const std::vector<Character>& characters, const DialogueIndex& index, unsigned threads = 0);
+
+    uint16_t MessageFlags(int character, int message) const { return flags[character][message]; }
+    uint16_t CharacterFlags(int character) const { return characterFlags[character]; }
+    // Characters and messages with at least one problem.
+    std::size_t ProblemCount() const { return problemCount; }
+    // How many characters or messages have this problem.
+    std::size_t KindCount(ProblemFlag kind) const;
+    // The first maxProblems problems in document order.
+    std::vector<Problem> Collect(std::size_t maxProblems) const;
+
+    // Anything but the ID changed: text, relationship, health, time to respond.
+    void OnMessageChanged(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message);
+    void OnMessageIDChanged(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message, int32_t oldID);
+    void OnMessageAdded(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message);
+    // Call after the message has been erased; deletedID is the ID it had.
+    void OnMessageDeleted(const std::vector<Character>& characters, const DialogueIndex& index, int character, int message, int32_t deletedID);
+    void OnCharacterAdded(const std::vector<Character>& characters, const DialogueIndex& index, int character);
+    void OnCharacterRenamed(const std::vector<Character>& characters, int character);
+    // Call after the character has been erased; it took its messages' IDs with it.
+    void OnCharacterDeleted(const std::vector<Character>& characters, const DialogueIndex& index, int character, const std::vector<int32_t>& deletedIDs);
+
+    // Bumped by every change, so a cached problems list can tell it is stale.
+    uint64_t Version() const { return version; }
+
+private:
+    uint16_t CheckMessage(const Message& message, const DialogueIndex& index) const;
+    void SetMessageFlags(int character, int message, uint16_t value);
+    void SetCharacterFlags(int character, uint16_t value);
+    void Count(uint16_t value, int direction);
+    void RecheckID(const std::vector<Character>& characters, const DialogueIndex& index, int32_t id);
+
+    ValidationOptions options;
+    // character -> message -> ProblemFlag bits
+    std::vector<std::vector<uint16_t>> flags;
+    std::vector<uint16_t> characterFlags;
+    // problems per character, its own and its messages', so Collect can skip clean characters
+    std::vector<std::size_t> problemsIn;
+    std::size_t problemCount = 0;
+    std::size_t kindCounts[kProblemKinds] = {};
+    uint64_t version = 0;
+};
+
+const char* ProblemName(ProblemFlag kind);
+// "King / ID 100: duplicate ID, health out of range"
+std::string DescribeProblem(const std::vector<Character>& characters, const Problem& problem);
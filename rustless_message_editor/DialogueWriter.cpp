@@ -0,0 +1,258 @@
+#include "DialogueWriter.h"
+#include "Profiler.h"
+
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr std::size_t kFlushSize = 1 << 20;
+
+// Appends to a block buffer and hands it to the stream in large writes.
+class JsonOut {
+public:
+    JsonOut(std::ostream& out, bool compact) : out(out), compact(compact) {
+        buffer.reserve(kFlushSize + 4096);
+    }
+
+    void Raw(const char* text) {
+        buffer.append(text);
+    }
+
+    // newline plus indentation in pretty mode, nothing in compact mode
+    void Line(int depth) {
+        if (!compact) {
+            buffer += '\n';
+            buffer.append(static_cast<std::size_t>(depth) * 4, ' ');
+        }
+    }
+
+    void Key(int depth, const char* key, bool first) {
+        if (!first) {
+            buffer += ',';
+        }
+        Line(depth);
+        buffer += '"';
+        buffer.append(key);
+        buffer.append(compact ? "\":" : "\": ");
+    }
+
+    void Int(long long value) {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        buffer.append(digits, static_cast<std::size_t>(end - digits));
+    }
+
+    // Borrowed text is a json string that had no escape sequences, so it needs none now either.
+    void String(const Text& text) {
+        if (!text.Borrowed()) {
+            String(text.View());
+            return;
+        }
+        buffer += '"';
+        buffer.append(text.View());
+        buffer += '"';
+    }
+
+    // Same escaping as nlohmann's dump() without ensure_ascii: UTF-8 passes through untouched.
+    void String(std::string_view text) {
+        buffer += '"';
+        std::size_t clean = 0;
+        for (std::size_t i = 0; i < text.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            buffer.append(text, clean, i - clean);
+            clean = i + 1;
+            switch (c) {
+            case '"': buffer.append("\\\""); break;
+            case '\\': buffer.append("\\\\"); break;
+            case '\b': buffer.append("\\b"); break;
+            case '\f': buffer.append("\\f"); break;
+            case '\n': buffer.append("\\n"); break;
+            case '\r': buffer.append("\\r"); break;
+            case '\t': buffer.append("\\t"); break;
+            default: {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                buffer.append(escaped, 6);
+                break;
+            }
+            }
+        }
+        buffer.append(text, clean, text.size() - clean);
+        buffer += '"';
+    }
+
+    void MaybeFlush() {
+        if (buffer.size() >= kFlushSize) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        ProfileSpan span("save/write");
+        span.AddBytes(buffer.size());
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        written += buffer.size();
+        buffer.clear();
+    }
+
+    std::size_t written = 0;
+
+private:
+    std::ostream& out;
+    bool compact;
+    std::string buffer;
+};
+
+//keys go out in the same (alphabetical) order nlohmann's object map used
+void WriteMessage(JsonOut& json, const std::string& from, const Message& message) {
+    json.Raw("{");
+    json.Key(3, "ID", true);
+    json.Int(message.ID);
+    json.Key(3, "content", false);
+    json.String(message.content);
+    json.Key(3, "from", false);
+    json.String(from);
+    json.Key(3, "relationship", false);
+    json.Int(message.relationship);
+    json.Key(3, "responses", false);
+    json.Raw("[");
+    for (int i = 0; i < 2; i++) {
+        if (i != 0) {
+            json.Raw(",");
+        }
+        json.Line(4);
+        json.Raw("{");
+        json.Key(5, "content", true);
+        json.String(message.responce[i].content);
+        json.Key(5, "health", false);
+        json.Int(message.responce[i].health);
+        json.Key(5, "reply", false);
+        json.String(message.responce[i].reply);
+        json.Line(4);
+        json.Raw("}");
+    }
+    json.Line(3);
+    json.Raw("]");
+    json.Key(3, "timeToRespond", false);
+    json.Int(message.timeToRespond);
+    json.Line(2);
+    json.Raw("}");
+}
+
+}
+
+struct CharacterWriter::Json {
+    Json(std::ostream& out, bool compact) : out(out, compact) {
+    }
+
+    JsonOut out;
+};
+
+CharacterWriter::CharacterWriter(std::ostream& out, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten)
+    : json(new Json(out, options.compact)), messagesWritten(messagesWritten) {
+    json->out.Raw("{");
+    json->out.Key(1, "messages", true);
+    json->out.Raw("[");
+}
+
+CharacterWriter::~CharacterWriter() = default;
+
+void CharacterWriter::Write(const Character& character) {
+    ProfileSpan span("save/serialize");
+    std::size_t before = json->out.written;
+    JsonOut& out = json->out;
+    for (auto& message : character.messages) {
+        if (!first) {
+            out.Raw(",");
+        }
+        first = false;
+        out.Line(2);
+        WriteMessage(out, character.name, message);
+        out.MaybeFlush();
+        if (messagesWritten != nullptr) {
+            messagesWritten->fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    span.AddBytes(json->out.written - before);
+}
+
+std::size_t CharacterWriter::Finish() {
+    JsonOut& out = json->out;
+    if (!first) {
+        out.Line(1);
+    }
+    out.Raw("]");
+    out.Line(0);
+    out.Raw("}\n");
+    out.Flush();
+    return out.written;
+}
+
+std::size_t WriteCharacters(std::ostream& out, const Character* characters, std::size_t count, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten) {
+    CharacterWriter writer(out, options, messagesWritten);
+    for (std::size_t c = 0; c < count; c++) {
+        writer.Write(characters[c]);
+    }
+    return writer.Finish();
+}
+
+std::size_t WriteCharacters(std::ostream& out, const std::vector<Character>& characters, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten) {
+    return WriteCharacters(out, characters.data(), characters.size(), options, messagesWritten);
+}
+
+SaveResult SaveCharactersToFile(const std::string& path, const Character* characters, std::size_t count, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten) {
+    return SaveCharacterStream(path, options, [&](CharacterWriter& writer, std::string&) {
+        for (std::size_t c = 0; c < count; c++) {
+            writer.Write(characters[c]);
+        }
+        return true;
+    }, messagesWritten);
+}
+
+SaveResult SaveCharacterStream(const std::string& path, const WriteOptions& options, const std::function<bool(CharacterWriter&, std::string&)>& write,
+    std::atomic<std::size_t>* messagesWritten) {
+    SaveResult result;
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            result.ok = false;
+            result.error = "Failed to open file for writing: check directory " + std::filesystem::path(path).parent_path().string() + " exists";
+            return result;
+        }
+        CharacterWriter writer(file, options, messagesWritten);
+        if (!write(writer, result.error)) {
+            result.ok = false;
+        }
+        result.bytesWritten = writer.Finish();
+        file.flush();
+        if (result.ok && !file.good()) {
+            result.ok = false;
+            result.error = "Failed writing " + tempPath;
+        }
+    }
+
+    std::error_code ec;
+    if (result.ok) {
+        ProfileSpan span("save/replace file");
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            result.ok = false;
+            result.error = "Failed to replace " + path + ": " + ec.message();
+        }
+    }
+    if (!result.ok) {
+        std::filesystem::remove(tempPath, ec);
+    }
+    return result;
+}
+
+SaveResult SaveCharactersToFile(const std::string& path, const std::vector<Character>& characters, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten) {
+    return SaveCharactersToFile(path, characters.data(), characters.size(), options, messagesWritten);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct WriteOptions {
+    // no indentation or newlines; smaller and faster to write
+    bool compact = false;
+};
+
+struct SaveResult {
+    bool ok = true;
+    std::string error = "";
+    std::size_t bytesWritten = 0;
+};
+
+// Writes a messages json a character at a time, so output made as it goes (a merge of files too
+// big to hold, say) never has to be in memory whole. Same layout as WriteCharacters.
+class CharacterWriter {
+public:
+    CharacterWriter(std::ostream& out, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+    ~CharacterWriter();
+
+    CharacterWriter(const CharacterWriter&) = delete;
+    CharacterWriter& operator=(const CharacterWriter&) = delete;
+
+    void Write(const Character& character);
+    // Closes the json and returns how many bytes went out in all.
+    std::size_t Finish();
+
+private:
+    struct Json;
+    std::unique_ptr<Json> json;
+    std::atomic<std::size_t>* messagesWritten;
+    bool first = true;
+};
+
+// Streams characters out as a messages json, one message at a time, without building a json DOM.
+// The pretty layout matches what `std::setw(4) << json` produced so existing files diff cleanly.
+// messagesWritten, when given, is bumped as each message goes out so another thread can show progress.
+std::size_t WriteCharacters(std::ostream& out, const Character* characters, std::size_t count, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+std::size_t WriteCharacters(std::ostream& out, const std::vector<Character>& characters, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+
+// Writes to "<path>.tmp" and renames it over path once it is complete, so a crash
+// or full disk never leaves a half written file behind.
+SaveResult SaveCharactersToFile(const std::string& path, const Character* characters, std::size_t count, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+SaveResult SaveCharactersToFile(const std::string& path, const std::vector<Character>& characters, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+
+// The same for output written a character at a time by write, which returns false (with error
+// set) to give up; the file at path is then left as it was.
+SaveResult SaveCharacterStream(const std::string& path, const WriteOptions& options, const std::function<bool(CharacterWriter&, std::string&)>& write,
+    std::atomic<std::size_t>* messagesWritten = nullptr);
@@ -0,0 +1,833 @@
+#include "EditJournal.h"
+#include "FileWatcher.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// File layout: the magic, then records of [u32 payload length][u32 checksum][payload], all
+// little-endian. The first record is the base, optionally followed by a snapshot; every record
+// after that is one edit.
+const char kJournalMagic[8] = { 'R', 'L', 'J', 'O', 'U', 'R', 'N', '1' };
+const std::size_t kRecordHeader = 8;
+
+enum RecordType : uint8_t {
+    RecordBase = 1,
+    RecordSnapshot = 2,
+    RecordEdit = 3
+};
+
+// unsynced edits wait this long for company before the thread writes them
+const auto kSyncDelay = std::chrono::milliseconds(500);
+// or until this much has piled up
+const std::size_t kSyncBytes = 64 * 1024;
+// after a failed write, how long until NeedsCompaction asks for a fresh file
+const auto kRetryDelay = std::chrono::seconds(5);
+
+uint32_t Checksum(const char* data, std::size_t size) {
+    //FNV-1a
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint64_t HashStamp(uint64_t hash, const FileStamp& stamp) {
+    uint64_t values[2] = { stamp.size, static_cast<uint64_t>(stamp.modified) };
+    for (uint64_t value : values) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void PutU8(std::string& out, uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+void PutU32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+}
+
+void PutU64(std::string& out, uint64_t value) {
+    PutU32(out, static_cast<uint32_t>(value));
+    PutU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void PutI32(std::string& out, int32_t value) {
+    PutU32(out, static_cast<uint32_t>(value));
+}
+
+void PutString(std::string& out, std::string_view text) {
+    PutU32(out, static_cast<uint32_t>(text.size()));
+    out.append(text.data(), text.size());
+}
+
+void SetU32(std::string& out, std::size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[offset + i] = static_cast<char>((value >> (i * 8)) & 0xff);
+    }
+}
+
+// Reads what the Put functions wrote; any read past the end clears ok and returns zeros.
+struct ByteReader {
+    const char* at;
+    const char* end;
+    bool ok = true;
+
+    bool Has(std::size_t bytes) {
+        if (ok && static_cast<std::size_t>(end - at) >= bytes) {
+            return true;
+        }
+        ok = false;
+        return false;
+    }
+    uint8_t U8() {
+        return Has(1) ? static_cast<uint8_t>(*at++) : 0;
+    }
+    uint32_t U32() {
+        if (!Has(4)) {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(*at++)) << shift;
+        }
+        return value;
+    }
+    uint64_t U64() {
+        uint64_t low = U32();
+        return low | (static_cast<uint64_t>(U32()) << 32);
+    }
+    int32_t I32() {
+        return static_cast<int32_t>(U32());
+    }
+    std::string_view String() {
+        uint32_t size = U32();
+        if (!Has(size)) {
+            return std::string_view();
+        }
+        std::string_view text(at, size);
+        at += size;
+        return text;
+    }
+};
+
+void PutMessage(std::string& out, const Message& message) {
+    PutString(out, message.content);
+    PutI32(out, message.timeToRespond);
+    PutU8(out, static_cast<uint8_t>(message.relationship));
+    PutI32(out, message.ID);
+    for (auto& response : message.responce) {
+        PutString(out, response.reply);
+        PutString(out, response.content);
+        PutI32(out, response.health);
+    }
+    PutU8(out, message.dirty ? 1 : 0);
+}
+
+bool ReadMessage(ByteReader& in, Message& message) {
+    message.content = in.String();
+    message.timeToRespond = in.I32();
+    uint8_t relationship = in.U8();
+    message.relationship = static_cast<Relationship>(relationship);
+    message.ID = in.I32();
+    for (auto& response : message.responce) {
+        response.reply = in.String();
+        response.content = in.String();
+        response.health = in.I32();
+    }
+    message.dirty = in.U8() != 0;
+    return in.ok && relationship <= NEGATIVE;
+}
+
+void PutCharacter(std::string& out, const Character& character) {
+    PutString(out, character.name);
+    PutString(out, character.shard);
+    PutU8(out, character.dirty ? 1 : 0);
+    PutI32(out, character.lazySlot);
+    PutU32(out, static_cast<uint32_t>(character.messages.size()));
+    for (auto& message : character.messages) {
+        PutMessage(out, message);
+    }
+}
+
+bool ReadCharacter(ByteReader& in, Character& character) {
+    character.name = std::string(in.String());
+    character.shard = std::string(in.String());
+    character.dirty = in.U8() != 0;
+    character.lazySlot = in.I32();
+    uint32_t count = in.U32();
+    //every message takes well over one byte, so a bad count can't make this allocate much
+    if (!in.Has(count)) {
+        return false;
+    }
+    character.messages.resize(count);
+    for (auto& message : character.messages) {
+        if (!ReadMessage(in, message)) {
+            return false;
+        }
+    }
+    return in.ok;
+}
+
+// Reserves the record header; EndRecord fills it in once the payload is there.
+std::size_t BeginRecord(std::string& out, RecordType type) {
+    std::size_t start = out.size();
+    out.append(kRecordHeader, '\0');
+    PutU8(out, type);
+    return start;
+}
+
+void EndRecord(std::string& out, std::size_t start) {
+    std::size_t payload = start + kRecordHeader;
+    SetU32(out, start, static_cast<uint32_t>(out.size() - payload));
+    SetU32(out, start + 4, Checksum(out.data() + payload, out.size() - payload));
+}
+
+void PutBase(std::string& out, const JournalBase& base) {
+    std::size_t start = BeginRecord(out, RecordBase);
+    PutString(out, base.source);
+    PutU64(out, base.stamp);
+    EndRecord(out, start);
+}
+
+void PutSnapshot(std::string& out, const JournalSnapshot& snapshot) {
+    std::size_t start = BeginRecord(out, RecordSnapshot);
+    PutU32(out, static_cast<uint32_t>(snapshot.characters.size()));
+    for (std::size_t i = 0; i < snapshot.characters.size(); i++) {
+        PutString(out, i < snapshot.treeNames.size() ? std::string_view(snapshot.treeNames[i]) : std::string_view(snapshot.characters[i].name));
+        PutCharacter(out, snapshot.characters[i]);
+    }
+    EndRecord(out, start);
+}
+
+// Whether applying edit the way undo says puts a message or character in, rather than taking one out.
+bool Inserts(const Edit& edit, bool undo) {
+    return (edit.kind == EditKind::MessageAdded || edit.kind == EditKind::CharacterAdded) != undo;
+}
+
+void PutValue(std::string& out, MessageField field, const FieldValue& value) {
+    PutU8(out, static_cast<uint8_t>(field));
+    if (IsTextField(field)) {
+        PutString(out, value.text);
+    }
+    else {
+        PutI32(out, value.number);
+    }
+}
+
+bool ReadValue(ByteReader& in, MessageField& field, FieldValue& value) {
+    uint8_t read = in.U8();
+    if (read > static_cast<uint8_t>(MessageField::Health2)) {
+        return false;
+    }
+    field = static_cast<MessageField>(read);
+    if (IsTextField(field)) {
+        value.text = std::string(in.String());
+    }
+    else {
+        value.number = in.I32();
+    }
+    return in.ok;
+}
+
+void PutEdit(std::string& out, const Edit& edit, bool undo) {
+    std::size_t start = BeginRecord(out, RecordEdit);
+    PutU8(out, static_cast<uint8_t>(edit.kind));
+    PutU8(out, undo ? 1 : 0);
+    PutI32(out, edit.character);
+    PutI32(out, edit.message);
+    const FieldValue& value = undo ? edit.before : edit.after;
+    switch (edit.kind) {
+    case EditKind::Field:
+        PutValue(out, edit.field, value);
+        break;
+    case EditKind::Rename:
+        PutString(out, value.text);
+        break;
+    case EditKind::MessageAdded:
+    case EditKind::MessageDeleted:
+        if (Inserts(edit, undo)) {
+            PutMessage(out, edit.messageData);
+        }
+        break;
+    case EditKind::CharacterAdded:
+    case EditKind::CharacterDeleted:
+        if (Inserts(edit, undo)) {
+            PutString(out, edit.treeName);
+            PutCharacter(out, edit.characterData);
+        }
+        break;
+    case EditKind::Batch:
+        PutU32(out, static_cast<uint32_t>(edit.changes.size()));
+        for (auto& change : edit.changes) {
+            PutI32(out, change.character);
+            PutI32(out, change.message);
+            PutValue(out, change.field, undo ? change.before : change.after);
+        }
+        break;
+    }
+    EndRecord(out, start);
+}
+
+bool ReadEdit(ByteReader& in, JournalEdit& journaled) {
+    Edit& edit = journaled.edit;
+    uint8_t kind = in.U8();
+    if (kind > static_cast<uint8_t>(EditKind::Batch)) {
+        return false;
+    }
+    edit.kind = static_cast<EditKind>(kind);
+    journaled.undo = in.U8() != 0;
+    edit.character = in.I32();
+    edit.message = in.I32();
+    FieldValue& value = journaled.undo ? edit.before : edit.after;
+    switch (edit.kind) {
+    case EditKind::Field:
+        if (!ReadValue(in, edit.field, value)) {
+            return false;
+        }
+        break;
+    case EditKind::Rename:
+        value.text = std::string(in.String());
+        break;
+    case EditKind::MessageAdded:
+    case EditKind::MessageDeleted:
+        if (Inserts(edit, journaled.undo) && !ReadMessage(in, edit.messageData)) {
+            return false;
+        }
+        break;
+    case EditKind::CharacterAdded:
+    case EditKind::CharacterDeleted:
+        if (Inserts(edit, journaled.undo)) {
+            edit.treeName = std::string(in.String());
+            if (!ReadCharacter(in, edit.characterData)) {
+                return false;
+            }
+        }
+        break;
+    case EditKind::Batch: {
+        uint32_t count = in.U32();
+        //each change takes at least 13 bytes, so a bad count can't make this reserve much
+        if (!in.Has(static_cast<std::size_t>(count) * 13)) {
+            return false;
+        }
+        edit.changes.resize(count);
+        for (auto& change : edit.changes) {
+            change.character = in.I32();
+            change.message = in.I32();
+            if (!ReadValue(in, change.field, journaled.undo ? change.before : change.after)) {
+                return false;
+            }
+        }
+        break;
+    }
+    }
+    return in.ok;
+}
+
+#ifdef _WIN32
+
+using FileHandle = void*;
+FileHandle const kNoFile = nullptr;
+
+std::string LastError() {
+    return "error " + std::to_string(::GetLastError());
+}
+
+// Opens path for appending, cut back to keepBytes (created when it isn't there).
+FileHandle OpenForAppend(const std::string& path, uint64_t keepBytes, std::string& error) {
+    HANDLE handle = ::CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = "could not open " + path + ": " + LastError();
+        return kNoFile;
+    }
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(keepBytes);
+    if (!::SetFilePointerEx(handle, position, nullptr, FILE_BEGIN) || !::SetEndOfFile(handle)) {
+        error = "could not cut " + path + " back: " + LastError();
+        ::CloseHandle(handle);
+        return kNoFile;
+    }
+    return handle;
+}
+
+bool WriteAll(FileHandle file, const std::string& bytes, std::string& error) {
+    std::size_t done = 0;
+    while (done < bytes.size()) {
+        DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(bytes.size() - done, 1 << 30));
+        DWORD wrote = 0;
+        if (!::WriteFile(static_cast<HANDLE>(file), bytes.data() + done, chunk, &wrote, nullptr)) {
+            error = "could not write the journal: " + LastError();
+            return false;
+        }
+        done += wrote;
+    }
+    return true;
+}
+
+bool SyncAll(FileHandle file, std::string& error) {
+    if (!::FlushFileBuffers(static_cast<HANDLE>(file))) {
+        error = "could not flush the journal: " + LastError();
+        return false;
+    }
+    return true;
+}
+
+void CloseFile(FileHandle& file) {
+    if (file != kNoFile) {
+        ::CloseHandle(static_cast<HANDLE>(file));
+        file = kNoFile;
+    }
+}
+
+// A rename is already durable once MoveFileEx returns; fs::rename doesn't ask it to be.
+bool SwapInFile(const std::string& from, const std::string& to, std::string& error) {
+    if (!::MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        error = "could not replace " + to + ": " + LastError();
+        return false;
+    }
+    return true;
+}
+
+#else
+
+using FileHandle = int;
+FileHandle const kNoFile = -1;
+
+std::string LastError() {
+    return std::strerror(errno);
+}
+
+FileHandle OpenForAppend(const std::string& path, uint64_t keepBytes, std::string& error) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "could not open " + path + ": " + LastError();
+        return kNoFile;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(keepBytes)) != 0 || ::lseek(fd, 0, SEEK_END) < 0) {
+        error = "could not cut " + path + " back: " + LastError();
+        ::close(fd);
+        return kNoFile;
+    }
+    return fd;
+}
+
+bool WriteAll(FileHandle file, const std::string& bytes, std::string& error) {
+    std::size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t wrote = ::write(file, bytes.data() + done, bytes.size() - done);
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = "could not write the journal: " + LastError();
+            return false;
+        }
+        done += static_cast<std::size_t>(wrote);
+    }
+    return true;
+}
+
+bool SyncAll(FileHandle file, std::string& error) {
+#ifdef __APPLE__
+    int synced = ::fsync(file);
+#else
+    //the size only changes with the data, and fdatasync covers that
+    int synced = ::fdatasync(file);
+#endif
+    if (synced != 0) {
+        error = "could not sync the journal: " + LastError();
+        return false;
+    }
+    return true;
+}
+
+void CloseFile(FileHandle& file) {
+    if (file != kNoFile) {
+        ::close(file);
+        file = kNoFile;
+    }
+}
+
+// Renames, then syncs the directory so the rename itself survives a crash.
+bool SwapInFile(const std::string& from, const std::string& to, std::string& error) {
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        error = "could not replace " + to + ": " + LastError();
+        return false;
+    }
+    fs::path directory = fs::path(to).parent_path();
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+    return true;
+}
+
+#endif
+
+}
+
+uint64_t StampSource(const std::string& path) {
+    uint64_t hash = 14695981039346656037ull;
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) {
+        return HashStamp(hash, StampFile(path));
+    }
+    std::vector<std::string> files;
+    for (auto& entry : fs::directory_iterator(path, ec)) {
+        if (entry.is_regular_file(ec)) {
+            files.push_back(entry.path().string());
+        }
+    }
+    //directory order isn't stable between runs
+    std::sort(files.begin(), files.end());
+    for (auto& file : files) {
+        for (char c : file) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        hash = HashStamp(hash, StampFile(file));
+    }
+    return hash;
+}
+
+bool ReadJournal(const std::string& path, JournalContents& contents, std::string& error) {
+    contents = JournalContents();
+    std::string bytes;
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            error = "no journal at " + path;
+            return false;
+        }
+        bytes.assign(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        if (!file.read(&bytes[0], static_cast<std::streamsize>(bytes.size()))) {
+            error = "could not read " + path;
+            return false;
+        }
+    }
+    if (bytes.size() < sizeof(kJournalMagic) || std::memcmp(bytes.data(), kJournalMagic, sizeof(kJournalMagic)) != 0) {
+        error = path + " is not an edit journal";
+        return false;
+    }
+
+    bool hasBase = false;
+    std::size_t offset = sizeof(kJournalMagic);
+    while (bytes.size() - offset >= kRecordHeader) {
+        ByteReader header{ bytes.data() + offset, bytes.data() + offset + kRecordHeader };
+        uint32_t length = header.U32();
+        uint32_t checksum = header.U32();
+        const char* payload = bytes.data() + offset + kRecordHeader;
+        if (length > bytes.size() - offset - kRecordHeader || Checksum(payload, length) != checksum) {
+            break;
+        }
+
+        ByteReader in{ payload, payload + length };
+        uint8_t type = in.U8();
+        bool good = false;
+        bool isBase = !hasBase;
+        if (isBase) {
+            good = type == RecordBase;
+            contents.base.source = std::string(in.String());
+            contents.base.stamp = in.U64();
+        }
+        else if (type == RecordSnapshot && !contents.hasSnapshot && contents.edits.empty()) {
+            uint32_t count = in.U32();
+            good = in.Has(count);
+            for (uint32_t i = 0; good && i < count; i++) {
+                contents.snapshot.treeNames.emplace_back(in.String());
+                contents.snapshot.characters.emplace_back();
+                good = ReadCharacter(in, contents.snapshot.characters.back());
+            }
+            contents.hasSnapshot = good;
+        }
+        else if (type == RecordEdit) {
+            JournalEdit edit;
+            good = ReadEdit(in, edit);
+            edit.end = offset + kRecordHeader + length;
+            if (good) {
+                contents.edits.push_back(std::move(edit));
+            }
+        }
+        if (!good || !in.ok || in.at != in.end) {
+            break;
+        }
+        hasBase = true;
+        offset += kRecordHeader + length;
+        if (type != RecordEdit) {
+            contents.baseBytes = offset;
+        }
+    }
+    if (!hasBase) {
+        error = path + " has no readable base";
+        return false;
+    }
+    contents.validBytes = offset;
+    contents.tornBytes = bytes.size() - offset;
+    return true;
+}
+
+EditJournal::~EditJournal() {
+    Stop();
+}
+
+bool EditJournal::Start(const std::string& journalPath, const JournalBase& base, const JournalContents* continued, std::string& error) {
+    Stop();
+    path = journalPath;
+    std::string header;
+    if (continued == nullptr) {
+        header.assign(kJournalMagic, sizeof(kJournalMagic));
+        PutBase(header, base);
+    }
+    file = OpenForAppend(path, continued == nullptr ? 0 : continued->validBytes, error);
+    if (file == kNoFile) {
+        return false;
+    }
+    if (!WriteAll(file, header, error) || !SyncAll(file, error)) {
+        CloseFile(file);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        flushing = false;
+        pending.clear();
+        lastCoalescable = false;
+        hasRewrite = false;
+        rewrite = Rewrite();
+        appended = 0;
+        written = 0;
+        failed = false;
+        status = JournalStatus();
+        status.editBytes = continued == nullptr ? 0 : continued->validBytes - continued->baseBytes;
+        status.records = continued == nullptr ? 0 : continued->edits.size();
+    }
+    thread = std::thread(&EditJournal::Run, this);
+    return true;
+}
+
+void EditJournal::Stop() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+    CloseFile(file);
+}
+
+void EditJournal::Append(const Edit& edit, bool undo) {
+    if (!IsOpen()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failed) {
+            //the file has a gap now; only a rewrite from a snapshot can fix it
+            return;
+        }
+        bool coalescable = edit.kind == EditKind::Field || edit.kind == EditKind::Rename;
+        //a keystroke that only changes what the previous unwritten one set replaces it
+        if (coalescable && lastCoalescable && lastKind == edit.kind && lastCharacter == edit.character && lastMessage == edit.message
+            && lastField == edit.field && lastUndo == undo) {
+            status.editBytes -= pending.size() - lastOffset;
+            pending.resize(lastOffset);
+        }
+        else {
+            status.records++;
+        }
+        lastOffset = pending.size();
+        lastCoalescable = coalescable;
+        lastKind = edit.kind;
+        lastCharacter = edit.character;
+        lastMessage = edit.message;
+        lastField = edit.field;
+        lastUndo = undo;
+        PutEdit(pending, edit, undo);
+        status.editBytes += pending.size() - lastOffset;
+        appended++;
+    }
+    //the thread waits out the batch delay itself unless this one filled the batch
+    wake.notify_one();
+}
+
+void EditJournal::Compact(JournalSnapshot snapshot, const JournalBase& base) {
+    if (!IsOpen()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rewrite.base = base;
+        rewrite.snapshot = std::move(snapshot);
+        hasRewrite = true;
+        //everything not written yet is in the snapshot already
+        pending.clear();
+        lastCoalescable = false;
+        status.editBytes = 0;
+        status.records = 0;
+        status.compacting = true;
+        appended++;
+    }
+    wake.notify_one();
+}
+
+void EditJournal::Flush() {
+    if (!IsOpen()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = appended;
+    if (written >= target) {
+        return;
+    }
+    flushing = true;
+    wake.notify_one();
+    synced.wait(lock, [this, target] { return written >= target; });
+    flushing = false;
+}
+
+JournalStatus EditJournal::Status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
+
+bool EditJournal::NeedsCompaction(std::size_t threshold) const {
+    if (!IsOpen()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (hasRewrite) {
+        return false;
+    }
+    if (failed) {
+        return std::chrono::steady_clock::now() - failedAt >= kRetryDelay;
+    }
+    return status.editBytes >= threshold;
+}
+
+bool EditJournal::RewriteFile(const Rewrite& job, const std::string& tail, std::string& error) {
+    ProfileSpan span("journal/compact");
+    std::string bytes(kJournalMagic, sizeof(kJournalMagic));
+    PutBase(bytes, job.base);
+    PutSnapshot(bytes, job.snapshot);
+    bytes += tail;
+    span.AddBytes(bytes.size());
+
+    std::string tempPath = path + ".tmp";
+    FileHandle temp = OpenForAppend(tempPath, 0, error);
+    if (temp == kNoFile) {
+        return false;
+    }
+    bool ok = WriteAll(temp, bytes, error) && SyncAll(temp, error);
+    CloseFile(temp);
+    if (!ok) {
+        std::error_code ec;
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    //Windows can't rename over a file that is still open
+    CloseFile(file);
+    if (!SwapInFile(tempPath, path, error)) {
+        std::error_code ec;
+        fs::remove(tempPath, ec);
+    }
+    //keep appending to whichever journal is there now; after a failure the next rewrite retries
+    std::string reopenError;
+    std::error_code ec;
+    auto size = fs::file_size(path, ec);
+    file = OpenForAppend(path, ec ? 0 : static_cast<uint64_t>(size), reopenError);
+    if (file == kNoFile && error.empty()) {
+        error = reopenError;
+    }
+    return error.empty();
+}
+
+void EditJournal::Run() {
+    while (true) {
+        std::string bytes;
+        Rewrite job;
+        bool rewriting;
+        bool skip;
+        uint64_t target;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || flushing || hasRewrite || !pending.empty(); });
+            //let the batch fill up unless somebody is waiting on it
+            wake.wait_for(lock, kSyncDelay, [this] { return stopping || flushing || hasRewrite || pending.size() >= kSyncBytes; });
+            if (stopping && pending.empty() && !hasRewrite) {
+                return;
+            }
+            rewriting = hasRewrite;
+            if (rewriting) {
+                job = std::move(rewrite);
+                rewrite = Rewrite();
+                hasRewrite = false;
+            }
+            bytes = std::move(pending);
+            pending.clear();
+            lastCoalescable = false;
+            skip = failed && !rewriting;
+            target = appended;
+        }
+
+        std::string error;
+        bool ok = true;
+        if (rewriting) {
+            ok = RewriteFile(job, bytes, error);
+        }
+        else if (!skip) {
+            ProfileSpan span("journal/sync");
+            span.AddBytes(bytes.size());
+            ok = file != kNoFile && WriteAll(file, bytes, error) && SyncAll(file, error);
+            if (file == kNoFile && error.empty()) {
+                error = "the journal is not open";
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = target;
+            if (ok && !skip) {
+                status.syncs++;
+            }
+            if (ok && rewriting) {
+                failed = false;
+                status.error.clear();
+            }
+            else if (!ok) {
+                failed = true;
+                failedAt = std::chrono::steady_clock::now();
+                status.error = error;
+            }
+            status.compacting = hasRewrite;
+        }
+        synced.notify_all();
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "UndoHistory.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What a journal's edits go on top of: the project file or directory the editor loaded, as it
+// was on disk when the journal started.
+struct JournalBase {
+    std::string source = "";
+    uint64_t stamp = 0;
+};
+
+// The whole document at one point, which a compacted journal starts from instead of the source.
+// Characters a LazyLoader hasn't parsed yet keep their lazySlot and no messages.
+struct JournalSnapshot {
+    std::vector<Character> characters;
+    std::vector<std::string> treeNames;
+};
+
+// One edit as it was applied. Only the side that was applied is kept: edit.after for a redo,
+// edit.before for an undo, and the message or character only when it was inserted.
+struct JournalEdit {
+    Edit edit;
+    bool undo = false;
+    // file offset just past this edit's record
+    std::size_t end = 0;
+};
+
+struct JournalContents {
+    JournalBase base;
+    bool hasSnapshot = false;
+    JournalSnapshot snapshot;
+    std::vector<JournalEdit> edits;
+    // file offset past the base and snapshot records, where the edits start
+    std::size_t baseBytes = 0;
+    // file offset past the last whole record; anything after it was cut off by a crash
+    std::size_t validBytes = 0;
+    std::size_t tornBytes = 0;
+};
+
+struct JournalStatus {
+    // bytes of edits since the base or the last snapshot, which compaction folds away
+    std::size_t editBytes = 0;
+    uint64_t records = 0;
+    uint64_t syncs = 0;
+    bool compacting = false;
+    std::string error = "";
+};
+
+// A hash of a project's size and modification times: the file itself, or every file directly
+// in a project directory. Tells whether a journal still goes on top of what is on disk.
+uint64_t StampSource(const std::string& path);
+
+// Reads a journal written by EditJournal, up to the first record that was cut off or fails its
+// checksum. Returns false when there is no journal at path or it isn't one.
+bool ReadJournal(const std::string& path, JournalContents& contents, std::string& error);
+
+// Crash-safe record of every edit since the project was loaded, so nothing is lost between
+// saves. Each edit is appended as a small checksummed binary record and the file is synced on
+// the journal's own thread in batches: half a second after the first unsynced edit, or sooner
+// once enough has piled up. Typing in one field only keeps its newest value per batch.
+//
+// The file is rewritten from a snapshot when Compact is called, e.g. once it holds too many
+// edits or the source it was based on changed; the new file replaces the old one atomically.
+// Characters in a snapshot borrow their text like any other copy, so the journal has to go
+// before the LazyLoader or mapping they came from.
+class EditJournal {
+public:
+    EditJournal() = default;
+    ~EditJournal();
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    // Starts journaling to path on top of base. With continued (a journal just read from path
+    // and replayed), the file is kept and appended to, cut back to continued->validBytes;
+    // otherwise whatever was at path is replaced by an empty journal.
+    bool Start(const std::string& path, const JournalBase& base, const JournalContents* continued, std::string& error);
+    // Syncs whatever is still pending and closes the file, which stays for the next Start.
+    void Stop();
+    bool IsOpen() const { return thread.joinable(); }
+
+    void Append(const Edit& edit, bool undo);
+    // Rewrites the journal as base plus snapshot, dropping every edit appended before this call.
+    void Compact(JournalSnapshot snapshot, const JournalBase& base);
+    // Blocks until everything appended so far is synced.
+    void Flush();
+
+    JournalStatus Status() const;
+    // Over threshold bytes of edits, or failed a while ago and worth rewriting from a snapshot.
+    bool NeedsCompaction(std::size_t threshold) const;
+
+private:
+    struct Rewrite {
+        JournalBase base;
+        JournalSnapshot snapshot;
+    };
+
+    // Writes base, snapshot and tail to a new file and swaps it in for the journal.
+    bool RewriteFile(const Rewrite& job, const std::string& tail, std::string& error);
+    void Run();
+
+    std::string path;
+
+#ifdef _WIN32
+    void* file = nullptr;
+#else
+    int file = -1;
+#endif
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable synced;
+    bool stopping = false;
+    bool flushing = false;
+    //records not handed to the thread yet
+    std::string pending;
+    //where the last pending record starts and what it changed, so typing can replace it
+    std::size_t lastOffset = 0;
+    bool lastCoalescable = false;
+    EditKind lastKind = EditKind::Field;
+    int lastCharacter = -1;
+    int lastMessage = -1;
+    MessageField lastField = MessageField::Content;
+    bool lastUndo = false;
+    bool hasRewrite = false;
+    Rewrite rewrite;
+    //Append calls so far, and how many of them are on disk
+    uint64_t appended = 0;
+    uint64_t written = 0;
+    bool failed = false;
+    std::chrono::steady_clock::time_point failedAt;
+    JournalStatus status;
+    std::thread thread;
+};
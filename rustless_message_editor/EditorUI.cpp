@@ -0,0 +1,2046 @@
+#include "EditorUI.h"
+
+#include "DialogueLoader.h"
+#include "InputString.h"
+#include "Profiler.h"
+#include "ProjectFiles.h"
+
+#include "imgui_internal.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const char* relationahipListItems[] = { "Positive", "Neutral", "Negative" };
+
+// how many problems the panel lists; the counts above it cover all of them
+const std::size_t kListedProblems = 1000;
+
+// load.json at least this big is loaded lazily, a character at a time (see LazyLoader)
+const std::uintmax_t kLazyLoadBytes = 16ull * 1024 * 1024;
+
+// every edit since the load, kept next to what Save writes (see EditJournal)
+const char* kJournalPath = "Content/Data/autosave.journal";
+
+// a batch changing more fields than this updates each index once for all of them, not field by field
+const std::size_t kBatchBulkChanges = 4096;
+
+// The message list is drawn as lines that are each one frame-high widget, so
+// ImGuiListClipper can tell which lines are on screen and only those get built.
+enum MessageLine {
+    LineContent,
+    LineTimeToRespond,
+    LineRelationship,
+    LineID,
+    LineResponses,
+    LineContent1,
+    LineReply1,
+    LineHealth1,
+    LineContent2,
+    LineReply2,
+    LineHealth2,
+    LineDelete,
+    LineSpacer,
+    LineCount
+};
+
+const int kClosedLines = LineCount - (LineHealth2 - LineResponses);
+const int kOpenLines = LineCount;
+
+// Where each message starts in the list. Only needed once some message has its responses
+// open; otherwise every message is kClosedLines long and the layout is plain arithmetic.
+struct MessageLayout {
+    std::vector<int> firstLine;
+    int lines = 0;
+
+    void Build(const Character& character) {
+        firstLine.clear();
+        int count = static_cast<int>(character.messages.size());
+        if (character.openResponses == 0) {
+            lines = count * kClosedLines;
+            return;
+        }
+        firstLine.reserve(count + 1);
+        lines = 0;
+        for (auto& message : character.messages) {
+            firstLine.push_back(lines);
+            lines += message.responsesOpen ? kOpenLines : kClosedLines;
+        }
+        firstLine.push_back(lines);
+    }
+
+    int FirstLine(int message) const {
+        return firstLine.empty() ? message * kClosedLines : firstLine[message];
+    }
+
+    void Locate(int line, int& message, MessageLine& part) const {
+        int offset;
+        bool open = false;
+        if (firstLine.empty()) {
+            message = line / kClosedLines;
+            offset = line % kClosedLines;
+        }
+        else {
+            message = static_cast<int>(std::upper_bound(firstLine.begin(), firstLine.end(), line) - firstLine.begin()) - 1;
+            offset = line - firstLine[message];
+            open = firstLine[message + 1] - firstLine[message] == kOpenLines;
+        }
+        //a closed message skips straight from the Responses node to Delete
+        if (!open && offset > LineResponses) {
+            offset += LineHealth2 - LineResponses;
+        }
+        part = static_cast<MessageLine>(offset);
+    }
+};
+
+void MarkEdited(Character& character, Message& message) {
+    message.dirty = true;
+    character.dirty = true;
+}
+
+// Opens the trees down to a message on the next list pass and scrolls there; response fields
+// are only on screen with the message's responses open.
+void RevealMessage(EditorState& state, int i, int j, bool response) {
+    state.jumpTo = MessageLocation{ i, j };
+    Message& message = state.characters[i].messages[j];
+    if (response && !message.responsesOpen) {
+        message.responsesOpen = true;
+        state.characters[i].openResponses++;
+    }
+}
+
+// Everything that has to follow a field's new value: dirty flags and the indexes.
+void FieldChanged(EditorState& state, int i, int j, MessageField field, int32_t oldID) {
+    Character& character = state.characters[i];
+    Message& message = character.messages[j];
+    MarkEdited(character, message);
+    if (field == MessageField::ID) {
+        state.index.OnMessageIDChanged(i, j, oldID, message.ID);
+        state.validator.OnMessageIDChanged(state.characters, state.index, i, j, oldID);
+        return;
+    }
+    if (IsTextField(field)) {
+        state.search.OnMessageChanged(state.characters, i, j);
+        state.glyphs.Add(message);
+    }
+    state.validator.OnMessageChanged(state.characters, state.index, i, j);
+}
+
+void CharacterRenamed(EditorState& state, int i) {
+    state.characters[i].dirty = true;
+    state.glyphs.Add(std::string_view(state.characters[i].name));
+    state.index.OnCharacterRenamed(state.characters, i);
+    state.validator.OnCharacterRenamed(state.characters, i);
+}
+
+// Structural changes, shared by the buttons and undo/redo.
+void InsertMessage(EditorState& state, int i, int j, Message message) {
+    Character& character = state.characters[i];
+    if (message.responsesOpen) {
+        character.openResponses++;
+    }
+    message.dirty = true;
+    character.messages.insert(character.messages.begin() + j, std::move(message));
+    character.dirty = true;
+    state.glyphs.Add(character.messages[j]);
+    state.index.OnMessageAdded(state.characters, i, j);
+    state.search.OnMessageAdded(state.characters, i, j);
+    state.validator.OnMessageAdded(state.characters, state.index, i, j);
+}
+
+Message EraseMessage(EditorState& state, int i, int j) {
+    Character& character = state.characters[i];
+    Message message = std::move(character.messages[j]);
+    if (message.responsesOpen) {
+        character.openResponses--;
+    }
+    character.messages.erase(character.messages.begin() + j);
+    character.dirty = true;
+    state.index.OnMessageDeleted(state.characters, i, j, message.ID);
+    state.search.OnMessageDeleted(i, j);
+    state.validator.OnMessageDeleted(state.characters, state.index, i, j, message.ID);
+    return message;
+}
+
+void InsertCharacter(EditorState& state, int i, Character character, std::string treeName) {
+    character.dirty = true;
+    state.characters.insert(state.characters.begin() + i, std::move(character));
+    state.treeNames.insert(state.treeNames.begin() + i, std::move(treeName));
+    state.glyphs.Add(state.characters[i]);
+    state.index.OnCharacterAdded(state.characters, i);
+    state.search.OnCharacterAdded(state.characters, i);
+    state.validator.OnCharacterAdded(state.characters, state.index, i);
+}
+
+Character EraseCharacter(EditorState& state, int i, std::string& treeName) {
+    Character character = std::move(state.characters[i]);
+    treeName = std::move(state.treeNames[i]);
+    std::vector<int32_t> deletedIDs;
+    for (auto& message : character.messages) {
+        deletedIDs.push_back(message.ID);
+    }
+    state.characters.erase(state.characters.begin() + i);
+    state.treeNames.erase(state.treeNames.begin() + i);
+    state.index.OnCharacterDeleted(state.characters, i);
+    state.search.OnCharacterDeleted(i);
+    state.validator.OnCharacterDeleted(state.characters, state.index, i, deletedIDs);
+    return character;
+}
+
+// Applies a batch or takes it back, and brings the indexes along: a field at a time like
+// typing does when it's small, in one pass per index when it's big.
+void BatchChanged(EditorState& state, const std::vector<FieldChange>& changes, bool undo) {
+    if (changes.size() <= kBatchBulkChanges) {
+        for (std::size_t k = 0; k < changes.size(); k++) {
+            const FieldChange& change = changes[undo ? changes.size() - 1 - k : k];
+            Message& message = state.characters[change.character].messages[change.message];
+            int32_t oldID = message.ID;
+            SetField(message, change.field, undo ? change.before : change.after);
+            FieldChanged(state, change.character, change.message, change.field, oldID);
+        }
+        return;
+    }
+    ApplyBatch(state.characters, changes, undo);
+    ProfileSpan span("batch/update indexes");
+    bool ids = false;
+    std::vector<std::pair<int, int>> texts;
+    for (auto& change : changes) {
+        ids |= change.field == MessageField::ID;
+        if (IsTextField(change.field)) {
+            state.glyphs.Add(std::string_view((undo ? change.before : change.after).text));
+            //changes come grouped by message, so a repeat is always the one just added
+            if (texts.empty() || texts.back() != std::make_pair(change.character, change.message)) {
+                texts.emplace_back(change.character, change.message);
+            }
+        }
+    }
+    if (ids) {
+        state.index.Rebuild(state.characters);
+    }
+    if (!texts.empty()) {
+        state.search.OnMessagesChanged(state.characters, texts);
+    }
+    state.validator.ValidateAll(state.characters, state.index);
+}
+
+void ApplyEdit(EditorState& state, const Edit& edit, bool undo) {
+    int i = edit.character;
+    int j = edit.message;
+    switch (edit.kind) {
+    case EditKind::Field: {
+        Message& message = state.characters[i].messages[j];
+        int32_t oldID = message.ID;
+        SetField(message, edit.field, undo ? edit.before : edit.after);
+        FieldChanged(state, i, j, edit.field, oldID);
+        RevealMessage(state, i, j, edit.field >= MessageField::Content1);
+        break;
+    }
+    case EditKind::Rename:
+        state.characters[i].name = undo ? edit.before.text : edit.after.text;
+        CharacterRenamed(state, i);
+        state.jumpTo = MessageLocation{ i, -1 };
+        break;
+    case EditKind::MessageAdded:
+    case EditKind::MessageDeleted:
+        if (undo == (edit.kind == EditKind::MessageAdded)) {
+            EraseMessage(state, i, j);
+            state.jumpTo = MessageLocation{ i, std::min(j, static_cast<int>(state.characters[i].messages.size()) - 1) };
+        }
+        else {
+            InsertMessage(state, i, j, edit.messageData);
+            state.jumpTo = MessageLocation{ i, j };
+        }
+        break;
+    case EditKind::CharacterAdded:
+    case EditKind::CharacterDeleted:
+        if (undo == (edit.kind == EditKind::CharacterAdded)) {
+            std::string treeName;
+            EraseCharacter(state, i, treeName);
+        }
+        else {
+            InsertCharacter(state, i, edit.characterData, edit.treeName);
+            state.jumpTo = MessageLocation{ i, -1 };
+        }
+        break;
+    case EditKind::Batch:
+        BatchChanged(state, edit.changes, undo);
+        break;
+    }
+}
+
+// Every change to the document after loading goes through here, edits, undos and redos alike.
+void JournalApplied(EditorState& state, const Edit& edit, bool undo) {
+    state.journal.Append(edit, undo);
+    state.edits++;
+}
+
+// Every edit the window makes goes to the undo history and, the way it was applied, to the journal.
+void RecordEdit(EditorState& state, Edit edit, bool coalesce) {
+    JournalApplied(state, edit, false);
+    state.history.Record(std::move(edit), coalesce);
+}
+
+// Rewrites the journal from the document as it is now, on top of the source as it is on disk now.
+// The snapshot shares its text with the document (see Text), so this costs the frame a copy of
+// the message structs and not of the text.
+void CompactJournal(EditorState& state) {
+    if (!state.journal.IsOpen()) {
+        return;
+    }
+    ProfileSpan span("journal/snapshot");
+    state.journalBase.stamp = StampSource(state.journalBase.source);
+    JournalSnapshot snapshot;
+    snapshot.characters = state.characters;
+    snapshot.treeNames = state.treeNames;
+    state.journal.Compact(std::move(snapshot), state.journalBase);
+}
+
+// A save or reload that changed the source leaves the journal on top of something that isn't
+// there any more.
+void RebaseJournal(EditorState& state) {
+    if (state.journal.IsOpen() && StampSource(state.journalBase.source) != state.journalBase.stamp) {
+        CompactJournal(state);
+    }
+}
+
+bool SameContent(const Message& a, const Message& b) {
+    if (a.content != b.content || a.timeToRespond != b.timeToRespond || a.relationship != b.relationship || a.ID != b.ID) {
+        return false;
+    }
+    for (int k = 0; k < 2; k++) {
+        if (a.responce[k].reply != b.responce[k].reply || a.responce[k].content != b.responce[k].content || a.responce[k].health != b.responce[k].health) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where a reloaded message is in the document: the occurrence-th message of its speaker with its ID.
+int FindReloaded(const EditorState& state, int i, const ReloadKey& key) {
+    std::vector<int> found;
+    for (auto& location : state.index.FindMessages(key.id)) {
+        if (location.character == i) {
+            found.push_back(location.message);
+        }
+    }
+    if (key.occurrence >= static_cast<int>(found.size())) {
+        return -1;
+    }
+    std::nth_element(found.begin(), found.begin() + key.occurrence, found.end());
+    return found[key.occurrence];
+}
+
+// Merges one reload of load.json. Messages with unsaved edits keep them, and nothing is moved:
+// changed messages are updated in place, with their responses left open or closed, and new ones
+// go at the end of their speaker, so the trees stay as they were. Returns whether anything changed.
+bool ApplyReload(EditorState& state, ReloadChanges& changes) {
+    bool applied = false;
+    for (auto& changed : changes.changed) {
+        int i = state.index.FindCharacter(changed.key.from);
+        if (i == -1) {
+            i = static_cast<int>(state.characters.size());
+            Character character;
+            character.name = changed.key.from;
+            InsertCharacter(state, i, std::move(character), changed.key.from);
+        }
+        Character& character = state.characters[i];
+        int j = FindReloaded(state, i, changed.key);
+        if (j == -1) {
+            j = static_cast<int>(character.messages.size());
+            InsertMessage(state, i, j, std::move(changed.message));
+            //matches the file, only the character needs saving again
+            character.messages[j].dirty = false;
+            applied = true;
+            continue;
+        }
+        Message& message = character.messages[j];
+        if (message.dirty || SameContent(message, changed.message)) {
+            continue;
+        }
+        changed.message.responsesOpen = message.responsesOpen;
+        message = std::move(changed.message);
+        character.dirty = true;
+        state.glyphs.Add(message);
+        state.search.OnMessageChanged(state.characters, i, j);
+        state.validator.OnMessageChanged(state.characters, state.index, i, j);
+        applied = true;
+    }
+
+    //last occurrences first, so the ones still to go keep their numbers
+    std::sort(changes.removed.begin(), changes.removed.end(), [](const ReloadKey& a, const ReloadKey& b) {
+        return a.occurrence > b.occurrence;
+    });
+    bool erased = false;
+    for (auto& removed : changes.removed) {
+        int i = state.index.FindCharacter(removed.from);
+        int j = i == -1 ? -1 : FindReloaded(state, i, removed);
+        if (j == -1 || state.characters[i].messages[j].dirty) {
+            continue;
+        }
+        EraseMessage(state, i, j);
+        erased = true;
+    }
+    if (erased) {
+        //erasing moved messages the recorded steps point at
+        state.history.Clear();
+    }
+    return applied || erased;
+}
+
+// The text a field had when it was focused, which is what undoing the typing run goes back to.
+std::string TextBeforeEdit(std::string_view fallback) {
+    if (const ImGuiInputTextState* input = ImGui::GetInputTextState(ImGui::GetItemID())) {
+        if (input->InitialTextA.Size > 0) {
+            return std::string(input->InitialTextA.Data);
+        }
+    }
+    return std::string(fallback);
+}
+
+int UnloadedCharacters(const EditorState& state) {
+    int unloaded = 0;
+    for (auto& character : state.characters) {
+        unloaded += character.lazySlot >= 0 ? 1 : 0;
+    }
+    return unloaded;
+}
+
+// Messages from state.lazy go to whichever character still has their slot, with the indexes
+// told as if the character had been removed and put back with them.
+void CharacterLoaded(EditorState& state, LazyLoaded& loaded) {
+    int i = 0;
+    while (i < static_cast<int>(state.characters.size()) && state.characters[i].lazySlot != loaded.slot) {
+        i++;
+    }
+    if (i == static_cast<int>(state.characters.size())) {
+        state.lazy.Release(loaded.slot);
+        return;
+    }
+    if (!loaded.result.ok) {
+        std::cout << "\033[31m" << "Failed to load " << state.characters[i].name << "'s messages: " << state.lazy.Error(loaded.slot) << "\033[0m" << "\n";
+        return;
+    }
+
+    std::string treeName;
+    Character character = EraseCharacter(state, i, treeName);
+    bool dirty = character.dirty;
+    character.messages = std::move(loaded.messages);
+    character.lazySlot = -1;
+    InsertCharacter(state, i, std::move(character), std::move(treeName));
+    state.characters[i].dirty = dirty;
+}
+
+// Parses a lazily loaded character's messages right now, for replaying edits to them.
+bool LoadCharacterNow(EditorState& state, int i) {
+    int slot = state.characters[i].lazySlot;
+    if (slot < 0) {
+        return true;
+    }
+    LazyLoaded loaded;
+    loaded.slot = slot;
+    loaded.result = state.lazy.LoadNow(slot, loaded.messages);
+    CharacterLoaded(state, loaded);
+    return loaded.result.ok;
+}
+
+// The journal the last run left, if it still goes on top of what was just loaded. One that
+// doesn't is moved aside rather than replayed onto the wrong document or thrown away.
+bool FindJournal(EditorState& state, JournalContents& journal) {
+    std::error_code ec;
+    if (!std::filesystem::exists(kJournalPath, ec)) {
+        return false;
+    }
+    std::string error;
+    bool usable = ReadJournal(kJournalPath, journal, error);
+    if (usable && (journal.base.source != state.journalBase.source || journal.base.stamp != state.journalBase.stamp)) {
+        usable = false;
+        error = journal.base.source + " changed since the journal was written";
+    }
+    if (usable && journal.hasSnapshot) {
+        std::vector<bool> used(state.lazy.Slots(), false);
+        for (auto& character : journal.snapshot.characters) {
+            int slot = character.lazySlot;
+            if (slot < -1 || slot >= static_cast<int>(used.size()) || (slot >= 0 && used[slot])) {
+                usable = false;
+                error = "its snapshot doesn't match " + journal.base.source;
+                break;
+            }
+            if (slot >= 0) {
+                used[slot] = true;
+            }
+        }
+    }
+    if (!usable) {
+        std::string aside = std::string(kJournalPath) + ".stale";
+        std::filesystem::rename(kJournalPath, aside, ec);
+        std::cout << "\033[31m" << "Not replaying the edit journal, " << error << ". It was moved to " << aside << "\033[0m" << "\n";
+    }
+    return usable;
+}
+
+// Whether a replayed edit fits the document, parsing its character first if it has to.
+bool ReplayedEditFits(EditorState& state, const Edit& edit, bool undo) {
+    int characters = static_cast<int>(state.characters.size());
+    bool inserting = (edit.kind == EditKind::MessageAdded || edit.kind == EditKind::CharacterAdded) != undo;
+    if (edit.kind == EditKind::CharacterAdded || edit.kind == EditKind::CharacterDeleted) {
+        if (!inserting) {
+            return edit.character >= 0 && edit.character < characters;
+        }
+        int slot = edit.characterData.lazySlot;
+        if (edit.character < 0 || edit.character > characters || slot < -1 || slot >= static_cast<int>(state.lazy.Slots())) {
+            return false;
+        }
+        for (auto& character : state.characters) {
+            if (slot >= 0 && character.lazySlot == slot) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (edit.kind == EditKind::Batch) {
+        for (auto& change : edit.changes) {
+            if (change.character < 0 || change.character >= characters || !LoadCharacterNow(state, change.character) || change.message < 0
+                || change.message >= static_cast<int>(state.characters[change.character].messages.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (edit.character < 0 || edit.character >= characters) {
+        return false;
+    }
+    if (edit.kind == EditKind::Rename) {
+        return true;
+    }
+    if (!LoadCharacterNow(state, edit.character)) {
+        return false;
+    }
+    int messages = static_cast<int>(state.characters[edit.character].messages.size());
+    bool insertingMessage = edit.kind != EditKind::Field && inserting;
+    return edit.message >= 0 && edit.message < messages + (insertingMessage ? 1 : 0);
+}
+
+// Applies the journal's edits in order and returns how many. Stops at the first one that
+// doesn't fit, which only a journal of some other document could hold.
+std::size_t ReplayJournal(EditorState& state, const std::vector<JournalEdit>& edits) {
+    std::size_t applied = 0;
+    for (auto& journaled : edits) {
+        if (!ReplayedEditFits(state, journaled.edit, journaled.undo)) {
+            break;
+        }
+        ApplyEdit(state, journaled.edit, journaled.undo);
+        applied++;
+    }
+    return applied;
+}
+
+// Saves and bakes need every message. Whatever isn't loaded yet is asked for first, and the
+// save starts from DrawEditor once it's all there.
+void StartSave(EditorState& state, PendingSave kind) {
+    auto& characters = state.characters;
+    state.pendingSave = PendingSave::None;
+    bool waiting = false;
+    for (auto& character : characters) {
+        if (!character.loadError.empty()) {
+            std::cout << "\033[31m" << "Not saving: " << character.name << "'s file failed to load: " << character.loadError << "\033[0m" << "\n";
+            return;
+        }
+        if (character.lazySlot < 0) {
+            continue;
+        }
+        std::string error = state.lazy.Error(character.lazySlot);
+        if (!error.empty()) {
+            std::cout << "\033[31m" << "Not saving: " << character.name << "'s messages failed to load: " << error << "\033[0m" << "\n";
+            return;
+        }
+        state.lazy.Request(character.lazySlot);
+        waiting = true;
+    }
+    if (waiting) {
+        state.pendingSave = kind;
+        return;
+    }
+
+    ProfileSpan span("save/snapshot");
+    if (kind == PendingSave::Bake) {
+        //binary export for the game, doesn't touch the json or the dirty flags
+        state.saveWorker.StartBake(characters, "Content/Data/messages.bin");
+    }
+    else if (state.shardedSave) {
+        //only characters edited since the last save get their shard rewritten
+        state.saveWorker.StartSharded(PrepareShardedSave(characters), "Content/Data/messages", state.saveOptions);
+    }
+    else {
+        state.saveWorker.Start(characters, "Content/Data/messages.json", state.saveOptions);
+        ClearDirty(characters);
+    }
+    if (kind == PendingSave::Save) {
+        //the journal starts over from what is being saved, clean flags and all, so a crash replays
+        //the edits since this save and not every one since load.json
+        CompactJournal(state);
+        state.savedEdits = state.edits;
+    }
+}
+
+// The "Messages" node of a character whose messages are still being parsed.
+void DrawUnloaded(EditorState& state, int i) {
+    int slot = state.characters[i].lazySlot;
+    std::string error = state.lazy.Error(slot);
+    if (!error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Failed to load: %s", error.c_str());
+        return;
+    }
+    ImGui::TextDisabled("Loading %zu messages...", state.lazy.MessageCount(slot));
+}
+
+bool TextField(EditorState& state, int i, int j, const char* label, MessageField field, Text& text) {
+    bool edited = InputString(label, text);
+    if (ImGui::IsItemActivated()) {
+        state.history.Seal();
+    }
+    if (edited) {
+        Edit edit;
+        edit.character = i;
+        edit.message = j;
+        edit.field = field;
+        edit.before.text = TextBeforeEdit(text);
+        edit.after.text = text;
+        RecordEdit(state, std::move(edit), true);
+        FieldChanged(state, i, j, field, state.characters[i].messages[j].ID);
+    }
+    return edited;
+}
+
+void RecordNumber(EditorState& state, int i, int j, MessageField field, int before, bool coalesce) {
+    Edit edit;
+    edit.character = i;
+    edit.message = j;
+    edit.field = field;
+    edit.before.number = before;
+    edit.after = GetField(state.characters[i].messages[j], field);
+    RecordEdit(state, std::move(edit), coalesce);
+}
+
+void DrawMessageLine(EditorState& state, int i, int j, MessageLine part, int& deleteMessage) {
+    Character& character = state.characters[i];
+    Message& message = character.messages[j];
+
+    switch (part) {
+    case LineContent:
+        TextField(state, i, j, "Content", MessageField::Content, message.content);
+        break;
+
+    case LineTimeToRespond: {
+        int TimeToRespondContent = message.timeToRespond;
+        if (ImGui::InputInt("Time to respond", &TimeToRespondContent)) {
+            int before = message.timeToRespond;
+            message.timeToRespond = TimeToRespondContent;
+            RecordNumber(state, i, j, MessageField::TimeToRespond, before, true);
+            FieldChanged(state, i, j, MessageField::TimeToRespond, message.ID);
+        }
+        if (ImGui::IsItemActivated()) {
+            state.history.Seal();
+        }
+        break;
+    }
+
+    case LineRelationship: {
+        int currentItem = message.relationship;
+        if (ImGui::Combo("Relationship", &currentItem, relationahipListItems, IM_ARRAYSIZE(relationahipListItems))) {
+            try {
+                if (currentItem >= 0 && currentItem < IM_ARRAYSIZE(relationahipListItems)) {
+                    int before = message.relationship;
+                    message.relationship = static_cast<Relationship>(currentItem);
+                    RecordNumber(state, i, j, MessageField::Relationship, before, false);
+                    FieldChanged(state, i, j, MessageField::Relationship, message.ID);
+                }
+                else {
+                    throw (currentItem);
+                }
+            }
+            catch (int badNum) {
+                std::cout << "\033[31m" << "Relationship Enum failed cast, num is " << badNum << ". Number shoud be 1 - 3, check it is in json" << "\033[0m" << "\n";
+            }
+        }
+        break;
+    }
+
+    case LineID: {
+        int MessageID = message.ID;
+        if (ImGui::InputInt("ID", &MessageID)) {
+            int32_t oldID = message.ID;
+            message.ID = MessageID;
+            RecordNumber(state, i, j, MessageField::ID, oldID, true);
+            FieldChanged(state, i, j, MessageField::ID, oldID);
+        }
+        if (ImGui::IsItemActivated()) {
+            state.history.Seal();
+        }
+        break;
+    }
+
+    case LineResponses: {
+        //open state lives on the message so the layout knows the size before drawing
+        ImGui::SetNextItemOpen(message.responsesOpen);
+        bool open = ImGui::TreeNodeEx("Responses", ImGuiTreeNodeFlags_FramePadding | ImGuiTreeNodeFlags_NoTreePushOnOpen);
+        if (open != message.responsesOpen) {
+            message.responsesOpen = open;
+            character.openResponses += open ? 1 : -1;
+        }
+        break;
+    }
+
+    case LineContent1:
+    case LineReply1:
+    case LineHealth1:
+    case LineContent2:
+    case LineReply2:
+    case LineHealth2: {
+        bool second = part >= LineContent2;
+        Response& response = message.responce[second ? 1 : 0];
+        MessageLine field = static_cast<MessageLine>(part - (second ? LineContent2 - LineContent1 : 0));
+
+        ImGui::Indent();
+        if (field == LineContent1) {
+            TextField(state, i, j, second ? "Content 2" : "Content 1", second ? MessageField::Content2 : MessageField::Content1, response.content);
+        }
+        else if (field == LineReply1) {
+            TextField(state, i, j, second ? "reply 2" : "reply 1", second ? MessageField::Reply2 : MessageField::Reply1, response.reply);
+        }
+        else {
+            int health = response.health;
+            if (ImGui::InputInt(second ? "Health 2" : "Health 1", &health)) {
+                MessageField healthField = second ? MessageField::Health2 : MessageField::Health1;
+                int before = response.health;
+                response.health = health;
+                RecordNumber(state, i, j, healthField, before, true);
+                FieldChanged(state, i, j, healthField, message.ID);
+            }
+            if (ImGui::IsItemActivated()) {
+                state.history.Seal();
+            }
+        }
+        ImGui::Unindent();
+        break;
+    }
+
+    case LineDelete:
+        if (ImGui::Button("Delete Message")) {
+            deleteMessage = j;
+        }
+        break;
+
+    default:
+        ImGui::Dummy(ImVec2(0.0f, ImGui::GetFrameHeight()));
+        break;
+    }
+}
+
+void DrawMessages(EditorState& state, int i) {
+    Character& character = state.characters[i];
+
+    if (ImGui::Button("New Message")) {
+        Edit edit;
+        edit.kind = EditKind::MessageAdded;
+        edit.character = i;
+        edit.message = static_cast<int>(character.messages.size());
+        InsertMessage(state, i, edit.message, edit.messageData);
+        RecordEdit(state, std::move(edit), false);
+    }
+
+    ImGui::Dummy(ImVec2(0.0f, 5.0f));
+
+    MessageLayout layout;
+    layout.Build(character);
+
+    int jumpLine = -1;
+    if (state.jumpTo.character == i && state.jumpTo.message >= 0 && state.jumpTo.message < static_cast<int>(character.messages.size())) {
+        jumpLine = layout.FirstLine(state.jumpTo.message);
+    }
+
+    //deleting shifts every later line, so it waits until the list is done
+    int deleteMessage = -1;
+    ImGuiListClipper clipper;
+    clipper.Begin(layout.lines, ImGui::GetFrameHeightWithSpacing());
+    if (jumpLine != -1) {
+        clipper.IncludeItemByIndex(jumpLine);
+    }
+    while (clipper.Step()) {
+        for (int line = clipper.DisplayStart; line < clipper.DisplayEnd; line++) {
+            int j;
+            MessageLine part;
+            layout.Locate(line, j, part);
+
+            ImGui::PushID(j);
+            DrawMessageLine(state, i, j, part, deleteMessage);
+            ImGui::PopID();
+
+            if (line == jumpLine) {
+                ImGui::SetScrollHereY();
+            }
+        }
+    }
+    clipper.End();
+
+    if (deleteMessage != -1) {
+        Edit edit;
+        edit.kind = EditKind::MessageDeleted;
+        edit.character = i;
+        edit.message = deleteMessage;
+        edit.messageData = EraseMessage(state, i, deleteMessage);
+        RecordEdit(state, std::move(edit), false);
+    }
+}
+
+void DrawMenuBar(EditorState& state) {
+    auto& characters = state.characters;
+
+    if (ImGui::Button("Save") || (ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S)))
+    {
+        StartSave(state, PendingSave::Save);
+    }
+    //while a field is focused Ctrl+Z belongs to its own text undo
+    ImGuiIO& io = ImGui::GetIO();
+    bool shortcuts = io.KeyCtrl && !io.WantTextInput;
+    ImGui::BeginDisabled(!state.history.CanUndo());
+    if (ImGui::Button("Undo") || (shortcuts && !io.KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z))) {
+        UndoEdit(state);
+    }
+    ImGui::EndDisabled();
+    ImGui::BeginDisabled(!state.history.CanRedo());
+    if (ImGui::Button("Redo") || (shortcuts && (ImGui::IsKeyPressed(ImGuiKey_Y) || (io.KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z))))) {
+        RedoEdit(state);
+    }
+    ImGui::EndDisabled();
+    ImGui::Checkbox("Compact", &state.saveOptions.compact);
+    ImGui::Checkbox("Sharded", &state.shardedSave);
+    ImGui::Checkbox("Stats", &state.showStats);
+    ImGui::Checkbox("Simulate", &state.showSimulation);
+    ImGui::Checkbox("Batch", &state.showBatch);
+    ImGui::Checkbox("Merge", &state.showMerge);
+    if (ImGui::Button("Bake")) {
+        StartSave(state, PendingSave::Bake);
+    }
+    if (ImGui::Button("New Character")) {
+        Edit edit;
+        edit.kind = EditKind::CharacterAdded;
+        edit.character = static_cast<int>(characters.size());
+        edit.characterData.name = "New character";
+        edit.treeName = edit.characterData.name;
+        InsertCharacter(state, edit.character, edit.characterData, edit.treeName);
+        RecordEdit(state, std::move(edit), false);
+    }
+    if (ImGui::Button("Update tree names"))
+    {
+        for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+            state.treeNames[i] = characters[i].name;
+        }
+    }
+
+    ImGui::SetNextItemWidth(120);
+    bool findEntered = ImGui::InputInt("##FindID", &state.findID, 0, 0, ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    if (ImGui::Button("Find ID") || findEntered) {
+        state.jumpTo = state.index.FindMessage(state.findID);
+        if (state.jumpTo.character == -1) {
+            std::cout << "\033[31m" << "No message has ID " << state.findID;
+            int unloaded = UnloadedCharacters(state);
+            if (unloaded != 0) {
+                std::cout << " (" << unloaded << " characters aren't loaded yet)";
+            }
+            std::cout << "\033[0m" << "\n";
+        }
+    }
+
+    SaveStatus saveStatus = state.saveWorker.Status();
+    if (state.pendingSave != PendingSave::None) {
+        ImGui::Text("Loading %d characters to save...", UnloadedCharacters(state));
+    }
+    else if (saveStatus.state == SaveState::Saving) {
+        float fraction = saveStatus.totalMessages > 0 ? static_cast<float>(saveStatus.messagesWritten) / saveStatus.totalMessages : 0.0f;
+        ImGui::ProgressBar(fraction, ImVec2(150, 0), "Saving...");
+    }
+    else if (saveStatus.state == SaveState::Done) {
+        ImGui::Text("Saved %.1f MB in %.2f s", saveStatus.bytesWritten / (1024.0 * 1024.0), saveStatus.seconds);
+    }
+    else if (saveStatus.state == SaveState::Failed) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Save failed");
+        ImGui::SetItemTooltip("%s", saveStatus.error.c_str());
+    }
+    ReloadStatus reloadStatus = state.reload.Status();
+    if (!reloadStatus.error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Reload failed");
+        ImGui::SetItemTooltip("%s", reloadStatus.error.c_str());
+    }
+    if (!state.reloadOff.empty()) {
+        ImGui::TextDisabled("Live reload off");
+        ImGui::SetItemTooltip("%s", state.reloadOff.c_str());
+    }
+    JournalStatus journalStatus = state.journal.Status();
+    if (!journalStatus.error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Autosave failed");
+        ImGui::SetItemTooltip("%s", journalStatus.error.c_str());
+    }
+    //counted, not read off state: a job queued behind a failed one may already have started
+    if (saveStatus.failed != state.saveFailuresSeen) {
+        std::cout << "\033[31m" << saveStatus.lastFailure << "\033[0m" << std::endl;
+        state.saveFailuresSeen = saveStatus.failed;
+    }
+    //a failed bake leaves the saved document as it was
+    if (saveStatus.failedSaves != state.failedSavesSeen) {
+        //nothing can be trusted to be on disk, so the next save rewrites everything, and the
+        //journal forgets the save it started over from
+        MarkAllDirty(characters);
+        CompactJournal(state);
+        state.edits++;
+        state.failedSavesSeen = saveStatus.failedSaves;
+    }
+    if (saveStatus.finished != state.savesSeen) {
+        if (saveStatus.state == SaveState::Done) {
+            std::cout << "\033[32m" << "saved!\n";
+        }
+        //a sharded save writes the project the journal goes on top of
+        RebaseJournal(state);
+        state.savesSeen = saveStatus.finished;
+    }
+}
+
+// A line of the field's text around the hit, cut on UTF-8 boundaries.
+std::string HitSnippet(std::string_view text, std::size_t offset) {
+    std::size_t start = offset > 20 ? offset - 20 : 0;
+    std::size_t end = std::min(text.size(), offset + 60);
+    while (start > 0 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) {
+        start--;
+    }
+    while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+        end++;
+    }
+    std::string snippet(text.substr(start, end - start));
+    std::replace(snippet.begin(), snippet.end(), '\n', ' ');
+    if (start > 0) {
+        snippet.insert(0, "...");
+    }
+    if (end < text.size()) {
+        snippet += "...";
+    }
+    return snippet;
+}
+
+void DrawSearch(EditorState& state) {
+    ImGui::SetNextItemWidth(300);
+    InputString("##Search", state.searchText);
+    ImGui::SameLine();
+    ImGui::Checkbox("Whole word", &state.searchOptions.wholeWord);
+
+    if (state.searchText != state.searchedText || state.searchOptions.wholeWord != state.searchedWholeWord || state.search.Version() != state.searchedVersion) {
+        state.searchResults = state.search.Find(state.searchText, state.searchOptions);
+        state.searchedText = state.searchText;
+        state.searchedWholeWord = state.searchOptions.wholeWord;
+        state.searchedVersion = state.search.Version();
+    }
+    if (state.searchText.empty()) {
+        return;
+    }
+
+    auto& hits = state.searchResults.hits;
+    ImGui::SameLine();
+    ImGui::Text("%zu%s matches", hits.size(), state.searchResults.truncated ? "+" : "");
+    if (hits.empty()) {
+        return;
+    }
+
+    float height = ImGui::GetTextLineHeightWithSpacing() * std::min<float>(static_cast<float>(hits.size()), 8.0f) + ImGui::GetStyle().WindowPadding.y * 2.0f;
+    if (ImGui::BeginChild("Search results", ImVec2(0.0f, height), ImGuiChildFlags_Border)) {
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(hits.size()));
+        while (clipper.Step()) {
+            for (int k = clipper.DisplayStart; k < clipper.DisplayEnd; k++) {
+                const SearchHit& hit = hits[k];
+                Character& character = state.characters[hit.character];
+                Message& message = character.messages[hit.message];
+                std::string label = character.name + " / " + std::to_string(message.ID) + " / " + SearchFieldName(hit.field) + ": " +
+                    HitSnippet(SearchFieldText(message, hit.field), hit.offset);
+
+                ImGui::PushID(k);
+                if (ImGui::Selectable(label.c_str())) {
+                    RevealMessage(state, hit.character, hit.message, hit.field != SearchField::Content);
+                }
+                ImGui::PopID();
+            }
+        }
+        clipper.End();
+    }
+    ImGui::EndChild();
+}
+
+void DrawProblems(EditorState& state) {
+    const DialogueValidator& validator = state.validator;
+    if (validator.ProblemCount() == 0) {
+        return;
+    }
+
+    char header[64];
+    std::snprintf(header, sizeof(header), "Problems (%zu)###Problems", validator.ProblemCount());
+    if (!ImGui::CollapsingHeader(header)) {
+        return;
+    }
+
+    if (state.problemsVersion != validator.Version()) {
+        state.problems = validator.Collect(kListedProblems);
+        state.problemsVersion = validator.Version();
+    }
+
+    for (int bit = 0; bit < kProblemKinds; bit++) {
+        ProblemFlag kind = static_cast<ProblemFlag>(1 << bit);
+        if (validator.KindCount(kind) != 0) {
+            ImGui::Text("%s: %zu", ProblemName(kind), validator.KindCount(kind));
+            ImGui::SameLine(0.0f, 20.0f);
+        }
+    }
+    ImGui::NewLine();
+
+    float height = ImGui::GetTextLineHeightWithSpacing() * std::min<float>(static_cast<float>(state.problems.size()), 8.0f) + ImGui::GetStyle().WindowPadding.y * 2.0f;
+    if (ImGui::BeginChild("Problem list", ImVec2(0.0f, height), ImGuiChildFlags_Border)) {
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(state.problems.size()));
+        while (clipper.Step()) {
+            for (int k = clipper.DisplayStart; k < clipper.DisplayEnd; k++) {
+                const Problem& problem = state.problems[k];
+                ImGui::PushID(k);
+                if (ImGui::Selectable(DescribeProblem(state.characters, problem).c_str())) {
+                    state.jumpTo = MessageLocation{ problem.character, problem.message };
+                }
+                ImGui::PopID();
+            }
+        }
+        clipper.End();
+    }
+    ImGui::EndChild();
+}
+
+// Timings of the profiler's spans, see Profiler.h.
+void DrawStats(EditorState& state) {
+    ImGui::SetNextWindowSize(ImVec2(760, 360), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Stats", &state.showStats)) {
+        ImGui::End();
+        return;
+    }
+    GlyphAtlasStats atlas = state.glyphAtlas.Stats();
+    if (atlas.glyphs != 0) {
+        ImGui::Text("Font atlas: %zu glyphs of %zu used, %dx%d, %.1f KB, built in %.1f ms from %s", atlas.glyphs, state.glyphs.Count(), atlas.width, atlas.height,
+            atlas.textureBytes / 1024.0, atlas.seconds * 1000.0, atlas.font.c_str());
+    }
+#ifdef RUSTLESS_NO_PROFILING
+    ImGui::TextUnformatted("Profiling was compiled out (RUSTLESS_NO_PROFILING).");
+#else
+    bool profiling = ProfilingEnabled();
+    if (ImGui::Checkbox("Profile", &profiling)) {
+        SetProfiling(profiling);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) {
+        ResetProfile();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        std::string error;
+        if (ExportProfileTrace("profile.json", error)) {
+            std::cout << "\033[32m" << "wrote profile.json, open it in chrome://tracing or ui.perfetto.dev" << "\033[0m" << "\n";
+        }
+        else {
+            std::cout << "\033[31m" << error << "\033[0m" << "\n";
+        }
+    }
+
+    ProfileSnapshot snapshot = TakeProfileSnapshot();
+    ImGui::SameLine();
+    ImGui::Text("%zu events%s", snapshot.events, snapshot.droppedEvents != 0 ? " (trace full)" : "");
+
+    //spans nest, so a parent's time includes its children's
+    if (ImGui::BeginTable("Spans", 7, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Span", ImGuiTableColumnFlags_WidthStretch, 3.0f);
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableSetupColumn("MB/s");
+        ImGui::TableSetupColumn("Allocs/call");
+        ImGui::TableHeadersRow();
+        for (auto& span : snapshot.spans) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(span.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(span.calls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", span.lastSeconds * 1000.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", span.totalSeconds * 1000.0 / static_cast<double>(span.calls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", span.maxSeconds * 1000.0);
+            ImGui::TableNextColumn();
+            if (span.bytes != 0 && span.totalSeconds > 0.0) {
+                ImGui::Text("%.1f", static_cast<double>(span.bytes) / (1024.0 * 1024.0) / span.totalSeconds);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", static_cast<double>(span.allocations) / static_cast<double>(span.calls));
+        }
+        ImGui::EndTable();
+    }
+    for (auto& counter : snapshot.counters) {
+        ImGui::Text("%s: %lld", counter.name, static_cast<long long>(counter.value));
+    }
+#endif
+    ImGui::End();
+}
+
+double Percent(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+// Opens message m of the simulated model in the editor, if the document still has it.
+void RevealSimulated(EditorState& state, std::size_t c, uint32_t m) {
+    const SimCharacter& character = state.simModel.characters[c];
+    int i = character.source;
+    int j = static_cast<int>(m - character.firstMessage);
+    if (i < static_cast<int>(state.characters.size()) && j < static_cast<int>(state.characters[i].messages.size())) {
+        RevealMessage(state, i, j, false);
+    }
+}
+
+void DrawSimulationResult(EditorState& state) {
+    const SimModel& model = state.simModel;
+    const SimResult& result = state.simResult;
+    ImGui::Text("%llu playthroughs%s in %.2f s, %.1f%% ran out of health", static_cast<unsigned long long>(result.playthroughs),
+        result.cancelled ? " (cancelled)" : "", result.seconds, Percent(result.deaths, result.playthroughs));
+
+    float buckets[kSimHealthBuckets];
+    for (int k = 0; k < kSimHealthBuckets; k++) {
+        buckets[k] = static_cast<float>(result.finalHealth[k]);
+    }
+    char label[128];
+    std::snprintf(label, sizeof(label), "Final health, %d per bar", result.bucketWidth);
+    ImGui::PlotHistogram("##Final health", buckets, kSimHealthBuckets, 0, label, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+
+    if (ImGui::BeginTable("Relationships", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Relationship");
+        ImGui::TableSetupColumn("Messages");
+        ImGui::TableSetupColumn("Missed %");
+        ImGui::TableSetupColumn("Hurt %");
+        ImGui::TableSetupColumn("Helped %");
+        ImGui::TableSetupColumn("Mean change");
+        ImGui::TableHeadersRow();
+        for (int r = 0; r < IM_ARRAYSIZE(relationahipListItems); r++) {
+            const SimRelationshipStats& stats = result.relationships[r];
+            uint64_t answered = stats.hurt + stats.unchanged + stats.helped;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(relationahipListItems[r]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(stats.reached));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", Percent(stats.missed, stats.reached));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", Percent(stats.hurt, answered));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", Percent(stats.helped, answered));
+            ImGui::TableNextColumn();
+            ImGui::Text("%+.2f", answered == 0 ? 0.0 : static_cast<double>(stats.healthSum) / static_cast<double>(answered));
+        }
+        ImGui::EndTable();
+    }
+
+    //one row per character; the selected one's health trajectory and deadliest message are below
+    float height = ImGui::GetTextLineHeightWithSpacing() * std::min<float>(static_cast<float>(model.characters.size()) + 1.0f, 10.0f);
+    if (ImGui::BeginTable("Characters", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_ScrollY,
+        ImVec2(0.0f, height))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Character", ImGuiTableColumnFlags_WidthStretch, 3.0f);
+        ImGui::TableSetupColumn("Died %");
+        ImGui::TableSetupColumn("Final health");
+        ImGui::TableSetupColumn("Time s");
+        ImGui::TableSetupColumn("Budget s");
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(model.characters.size()));
+        while (clipper.Step()) {
+            for (int c = clipper.DisplayStart; c < clipper.DisplayEnd; c++) {
+                const SimCharacterStats& stats = result.characters[c];
+                double runs = static_cast<double>(std::max<uint64_t>(1, stats.playthroughs));
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::PushID(c);
+                if (ImGui::Selectable(model.names[c].c_str(), state.simCharacter == c, ImGuiSelectableFlags_SpanAllColumns)) {
+                    state.simCharacter = c;
+                }
+                ImGui::PopID();
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", Percent(stats.deaths, stats.playthroughs));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f (%lld to %lld)", static_cast<double>(stats.finalHealthSum) / runs, static_cast<long long>(stats.finalHealthMin),
+                    static_cast<long long>(stats.finalHealthMax));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f (max %.1f)", static_cast<double>(stats.timeMsSum) / runs / 1000.0, static_cast<double>(stats.timeMsMax) / 1000.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", static_cast<double>(model.characters[c].budgetMs) / 1000.0);
+            }
+        }
+        clipper.End();
+        ImGui::EndTable();
+    }
+
+    if (state.simCharacter >= static_cast<int>(model.characters.size())) {
+        return;
+    }
+    const SimCharacter& character = model.characters[state.simCharacter];
+    std::vector<float> trajectory;
+    uint32_t worst = character.firstMessage;
+    for (uint32_t m = character.firstMessage; m < character.firstMessage + character.messageCount; m++) {
+        const SimMessageStats& stats = result.messages[m];
+        trajectory.push_back(stats.reached == 0 ? 0.0f : static_cast<float>(static_cast<double>(stats.healthSum) / static_cast<double>(stats.reached)));
+        if (stats.deaths > result.messages[worst].deaths) {
+            worst = m;
+        }
+    }
+    ImGui::PlotLines("##Trajectory", trajectory.data(), static_cast<int>(trajectory.size()), 0, "Mean health, message by message", FLT_MAX, FLT_MAX,
+        ImVec2(0.0f, 80.0f));
+    if (result.messages[worst].deaths != 0) {
+        const SimMessageStats& stats = result.messages[worst];
+        std::snprintf(label, sizeof(label), "Deadliest: ID %d, %.1f%% of the playthroughs reaching it die there", model.ids[worst], Percent(stats.deaths, stats.reached));
+        if (ImGui::Selectable(label)) {
+            RevealSimulated(state, state.simCharacter, worst);
+        }
+    }
+}
+
+// Runs playthroughs of the document on the simulation thread and shows what they add up to.
+void DrawSimulation(EditorState& state) {
+    if (state.simulation.Take(state.simModel, state.simResult)) {
+        state.hasSimResult = true;
+        state.simCharacter = 0;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(760, 560), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Simulation", &state.showSimulation)) {
+        ImGui::End();
+        return;
+    }
+    SimOptions& options = state.simOptions;
+    ImGui::PushItemWidth(140);
+    const ImU64 step = 100000;
+    ImGui::InputScalar("Playthroughs", ImGuiDataType_U64, &options.playthroughs, &step);
+    ImGui::SameLine();
+    const char* policies[] = { "Random", "Kindest", "Cruelest" };
+    int policy = static_cast<int>(options.policy);
+    if (ImGui::Combo("Player", &policy, policies, 3)) {
+        options.policy = static_cast<SimPolicy>(policy);
+    }
+    ImGui::InputInt("Start health", &options.startHealth);
+    ImGui::SameLine();
+    ImGui::InputInt("Think ms", &options.thinkMs, 500);
+    ImGui::SameLine();
+    ImGui::InputScalar("Seed", ImGuiDataType_U64, &options.seed);
+    ImGui::PopItemWidth();
+
+    SimStatus status = state.simulation.Status();
+    if (ImGui::Button("Run")) {
+        state.simulation.Start(BuildSimModel(state.characters), options);
+    }
+    if (status.running) {
+        float fraction = status.total > 0 ? static_cast<float>(static_cast<double>(status.done) / static_cast<double>(status.total)) : 0.0f;
+        ImGui::SameLine();
+        ImGui::ProgressBar(fraction, ImVec2(150, 0), "Simulating...");
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            state.simulation.Cancel();
+        }
+    }
+    int unloaded = UnloadedCharacters(state);
+    if (unloaded != 0) {
+        ImGui::SameLine();
+        ImGui::Text("%d characters aren't loaded yet and are left out", unloaded);
+    }
+
+    if (state.hasSimResult) {
+        DrawSimulationResult(state);
+    }
+    ImGui::End();
+}
+
+
+// The value inputs for one transform, which depend on what it does and to what.
+bool DrawTransformValues(BatchTransform& transform) {
+    bool changed = false;
+    uint32_t textFields = 0;
+    ParseBatchFields("text", textFields);
+    bool text = (transform.fields & textFields) != 0;
+    switch (transform.op) {
+    case BatchOp::Set:
+        if (text) {
+            changed |= InputString("##text", transform.text);
+        }
+        else {
+            changed |= ImGui::InputDouble("##value", &transform.value, 0.0, 0.0, "%.0f");
+        }
+        break;
+    case BatchOp::Add:
+    case BatchOp::Scale:
+        changed |= ImGui::InputDouble("##value", &transform.value, 0.0, 0.0, "%.3f");
+        break;
+    case BatchOp::Clamp:
+        changed |= ImGui::InputInt("##low", &transform.low);
+        ImGui::SameLine();
+        ImGui::TextUnformatted("to");
+        ImGui::SameLine();
+        changed |= ImGui::InputInt("##high", &transform.high);
+        break;
+    case BatchOp::Replace:
+    case BatchOp::RegexReplace:
+        changed |= InputString("##pattern", transform.pattern);
+        ImGui::SameLine();
+        ImGui::TextUnformatted("with");
+        ImGui::SameLine();
+        changed |= InputString("##text", transform.text);
+        break;
+    }
+    return changed;
+}
+
+// What a previewed batch would change, a row per field; clicking one shows the message.
+void DrawBatchChanges(EditorState& state) {
+    const std::vector<FieldChange>& changes = state.batchPlan.changes;
+    if (!ImGui::BeginTable("Changes", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_ScrollY)) {
+        return;
+    }
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Message", ImGuiTableColumnFlags_WidthStretch, 1.5f);
+    ImGui::TableSetupColumn("Field", ImGuiTableColumnFlags_WidthStretch, 1.0f);
+    ImGui::TableSetupColumn("Before", ImGuiTableColumnFlags_WidthStretch, 3.0f);
+    ImGui::TableSetupColumn("After", ImGuiTableColumnFlags_WidthStretch, 3.0f);
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(changes.size()));
+    while (clipper.Step()) {
+        for (int k = clipper.DisplayStart; k < clipper.DisplayEnd; k++) {
+            const FieldChange& change = changes[k];
+            const Character& character = state.characters[change.character];
+            std::string label = character.name + " #" + std::to_string(character.messages[change.message].ID);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::PushID(k);
+            if (ImGui::Selectable(label.c_str(), false, ImGuiSelectableFlags_SpanAllColumns)) {
+                RevealMessage(state, change.character, change.message, change.field >= MessageField::Content1);
+            }
+            ImGui::PopID();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(BatchFieldLabel(change.field));
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(DescribeValue(change.field, change.before).c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(DescribeValue(change.field, change.after).c_str());
+        }
+    }
+    clipper.End();
+    ImGui::EndTable();
+}
+
+// Bulk edits: which messages, what to do to them, a preview of every field that would change,
+// and Apply to make it one undo step.
+void DrawBatch(EditorState& state) {
+    ImGui::SetNextWindowSize(ImVec2(860, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Batch", &state.showBatch)) {
+        ImGui::End();
+        return;
+    }
+    BatchFilter& filter = state.batchFilter;
+    bool changed = false;
+
+    ImGui::SeparatorText("Messages");
+    ImGui::PushItemWidth(180);
+    if (ImGui::BeginCombo("Character", filter.character.empty() ? "Any" : filter.character.c_str())) {
+        if (ImGui::Selectable("Any", filter.character.empty())) {
+            filter.character.clear();
+            changed = true;
+        }
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(state.characters.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                ImGui::PushID(i);
+                if (ImGui::Selectable(state.characters[i].name.c_str(), filter.character == state.characters[i].name)) {
+                    filter.character = state.characters[i].name;
+                    changed = true;
+                }
+                ImGui::PopID();
+            }
+        }
+        clipper.End();
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    const char* relationships[] = { "Any", "Positive", "Neutral", "Negative" };
+    int relationship = filter.relationship + 1;
+    if (ImGui::Combo("Relationship", &relationship, relationships, IM_ARRAYSIZE(relationships))) {
+        filter.relationship = relationship - 1;
+        changed = true;
+    }
+    bool anyID = filter.minID == INT32_MIN && filter.maxID == INT32_MAX;
+    if (ImGui::Checkbox("Any ID", &anyID)) {
+        filter.minID = anyID ? INT32_MIN : 0;
+        filter.maxID = anyID ? INT32_MAX : 1000;
+        changed = true;
+    }
+    if (!anyID) {
+        ImGui::SameLine();
+        changed |= ImGui::InputInt("From", &filter.minID);
+        ImGui::SameLine();
+        changed |= ImGui::InputInt("To", &filter.maxID);
+    }
+    ImGui::SetNextItemWidth(360);
+    changed |= InputString("Text", filter.text);
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("Regex", &filter.textRegex);
+
+    ImGui::SeparatorText("Changes");
+    const char* ops[] = { "Set", "Add", "Scale by", "Clamp", "Replace", "Regex replace" };
+    const char* fields[kBatchFieldNameCount];
+    for (int f = 0; f < kBatchFieldNameCount; f++) {
+        fields[f] = kBatchFieldNames[f].name;
+    }
+    int removed = -1;
+    for (int t = 0; t < static_cast<int>(state.batchTransforms.size()); t++) {
+        BatchTransform& transform = state.batchTransforms[t];
+        ImGui::PushID(t);
+        ImGui::SetNextItemWidth(130);
+        int op = static_cast<int>(transform.op);
+        if (ImGui::Combo("##op", &op, ops, IM_ARRAYSIZE(ops))) {
+            transform.op = static_cast<BatchOp>(op);
+            changed = true;
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(130);
+        int field = 0;
+        while (field < kBatchFieldNameCount - 1 && kBatchFieldNames[field].fields != transform.fields) {
+            field++;
+        }
+        if (ImGui::Combo("##field", &field, fields, kBatchFieldNameCount)) {
+            transform.fields = kBatchFieldNames[field].fields;
+            changed = true;
+        }
+        ImGui::SameLine();
+        changed |= DrawTransformValues(transform);
+        ImGui::SameLine();
+        if (ImGui::Button("Remove")) {
+            removed = t;
+        }
+        ImGui::PopID();
+    }
+    ImGui::PopItemWidth();
+    if (removed >= 0) {
+        state.batchTransforms.erase(state.batchTransforms.begin() + removed);
+        changed = true;
+    }
+    if (ImGui::Button("Add change")) {
+        BatchTransform transform;
+        transform.op = BatchOp::Scale;
+        ParseBatchFields("health", transform.fields);
+        transform.value = 1.0;
+        state.batchTransforms.push_back(transform);
+        changed = true;
+    }
+    if (changed) {
+        state.hasBatchPlan = false;
+    }
+
+    ImGui::Separator();
+    //every message has to be there to be picked
+    int unloaded = UnloadedCharacters(state);
+    for (auto& character : state.characters) {
+        if (character.lazySlot >= 0) {
+            state.lazy.Request(character.lazySlot);
+        }
+    }
+    bool fresh = state.hasBatchPlan && state.batchPlanVersion == state.validator.Version();
+    ImGui::BeginDisabled(unloaded != 0 || state.batchTransforms.empty());
+    if (ImGui::Button("Preview")) {
+        state.batchPlan = PlanBatch(state.characters, filter, state.batchTransforms);
+        state.hasBatchPlan = true;
+        state.batchPlanVersion = state.validator.Version();
+        fresh = true;
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!fresh || state.batchPlan.changes.empty());
+    if (ImGui::Button("Apply")) {
+        Edit edit;
+        edit.kind = EditKind::Batch;
+        edit.changes = std::move(state.batchPlan.changes);
+        std::size_t fieldCount = edit.changes.size();
+        MakeEdit(state, std::move(edit));
+        std::cout << "\033[32m" << "batch changed " << fieldCount << " fields in " << state.batchPlan.changedMessages << " messages" << "\033[0m" << "\n";
+        state.hasBatchPlan = false;
+        fresh = false;
+    }
+    ImGui::EndDisabled();
+    ImGui::EndDisabled();
+    if (unloaded != 0) {
+        ImGui::SameLine();
+        ImGui::Text("Loading %d characters...", unloaded);
+    }
+
+    if (state.hasBatchPlan && !state.batchPlan.ok) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", state.batchPlan.error.c_str());
+    }
+    else if (state.hasBatchPlan && !fresh) {
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "The document changed since the preview, preview again");
+    }
+    else if (state.hasBatchPlan) {
+        ImGui::Text("%zu messages picked, %zu of them change: %zu fields", state.batchPlan.matched, state.batchPlan.changedMessages,
+            state.batchPlan.changes.size());
+        DrawBatchChanges(state);
+    }
+    ImGui::End();
+}
+
+void DrawMergeConflicts(EditorState& state) {
+    const char* sides[] = { "Ours", "Theirs", "Base" };
+    if (!ImGui::BeginTable("Conflicts", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_ScrollY)) {
+        return;
+    }
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Message", ImGuiTableColumnFlags_WidthStretch, 1.5f);
+    ImGui::TableSetupColumn("Field", ImGuiTableColumnFlags_WidthStretch, 1.0f);
+    ImGui::TableSetupColumn("Base", ImGuiTableColumnFlags_WidthStretch, 2.5f);
+    ImGui::TableSetupColumn("Ours", ImGuiTableColumnFlags_WidthStretch, 2.5f);
+    ImGui::TableSetupColumn("Theirs", ImGuiTableColumnFlags_WidthStretch, 2.5f);
+    ImGui::TableSetupColumn("Keep", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(state.mergeConflicts.size()));
+    while (clipper.Step()) {
+        for (int k = clipper.DisplayStart; k < clipper.DisplayEnd; k++) {
+            const MergeConflict& conflict = state.mergeConflicts[k];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::PushID(k);
+            if (ImGui::Selectable(DescribeKey(conflict.key).c_str(), false)) {
+                //where it is in the document, if ours still has it
+                int i = state.index.FindCharacter(conflict.key.from);
+                int j = i == -1 ? -1 : FindReloaded(state, i, ReloadKey{ conflict.key.from, conflict.key.id, conflict.key.occurrence });
+                if (j != -1) {
+                    RevealMessage(state, i, j, conflict.field >= MessageField::Content1);
+                }
+            }
+            ImGui::TableNextColumn();
+            if (conflict.kind == ConflictKind::DeleteChanged) {
+                ImGui::TextUnformatted("deleted");
+                ImGui::TableNextColumn();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(conflict.deletedBy == MergeSide::Ours ? "deleted" : "changed");
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(conflict.deletedBy == MergeSide::Theirs ? "deleted" : "changed");
+            }
+            else {
+                ImGui::TextUnformatted(BatchFieldLabel(conflict.field));
+                ImGui::TableNextColumn();
+                if (conflict.kind == ConflictKind::Field) {
+                    ImGui::TextUnformatted(DescribeValue(conflict.field, conflict.base).c_str());
+                }
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(DescribeValue(conflict.field, conflict.ours).c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(DescribeValue(conflict.field, conflict.theirs).c_str());
+            }
+            ImGui::TableNextColumn();
+            ImGui::SetNextItemWidth(-FLT_MIN);
+            int side = static_cast<int>(state.mergeChoices[k]);
+            //a message both sides added has no base to go back to
+            if (ImGui::Combo("##keep", &side, sides, conflict.kind == ConflictKind::BothAdded ? 2 : 3)) {
+                state.mergeChoices[k] = static_cast<MergeSide>(side);
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+    ImGui::EndTable();
+}
+
+// Three-way merge of another writer's copy into the document: the file both started from, theirs,
+// then every conflict with a side to keep, and Apply.
+void DrawMerge(EditorState& state) {
+    ImGui::SetNextWindowSize(ImVec2(900, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Merge", &state.showMerge)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::SetNextItemWidth(420);
+    bool changed = InputString("Base (what both started from)", state.mergeBase);
+    ImGui::SetNextItemWidth(420);
+    changed |= InputString("Theirs", state.mergeTheirs);
+    if (changed) {
+        state.hasMerge = false;
+    }
+
+    int unloaded = UnloadedCharacters(state);
+    for (auto& character : state.characters) {
+        if (character.lazySlot >= 0) {
+            state.lazy.Request(character.lazySlot);
+        }
+    }
+    bool fresh = state.hasMerge && state.mergeVersion == state.validator.Version();
+    ImGui::BeginDisabled(unloaded != 0 || state.mergeBase.empty() || state.mergeTheirs.empty());
+    if (ImGui::Button("Merge")) {
+        fresh = MergeIntoDocument(state);
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(!fresh);
+    if (ImGui::Button("Apply")) {
+        ApplyMerge(state);
+        fresh = false;
+    }
+    ImGui::EndDisabled();
+    ImGui::EndDisabled();
+    if (unloaded != 0) {
+        ImGui::SameLine();
+        ImGui::Text("Loading %d characters...", unloaded);
+    }
+
+    const MergeStats& stats = state.mergeStats;
+    if (!state.mergeError.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", state.mergeError.c_str());
+    }
+    else if (state.hasMerge && !fresh) {
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "The document changed since the merge, merge again");
+    }
+    else if (state.hasMerge) {
+        ImGui::Text("%zu messages: %zu unchanged, %zu from ours, %zu from theirs, %zu from both, %zu added, %zu removed", stats.messages,
+            stats.unchanged, stats.fromOurs, stats.fromTheirs, stats.combined, stats.added, stats.removed);
+        if (state.mergeConflicts.empty()) {
+            ImGui::Text("No conflicts");
+        }
+        else {
+            ImGui::Text("%zu conflicts", state.mergeConflicts.size());
+            ImGui::SameLine();
+            for (MergeSide side : { MergeSide::Ours, MergeSide::Theirs }) {
+                std::string label = std::string("Keep all ") + MergeSideName(side);
+                if (ImGui::SmallButton(label.c_str())) {
+                    std::fill(state.mergeChoices.begin(), state.mergeChoices.end(), side);
+                }
+                ImGui::SameLine();
+            }
+            ImGui::NewLine();
+            DrawMergeConflicts(state);
+        }
+    }
+    ImGui::End();
+}
+}
+
+bool UndoEdit(EditorState& state) {
+    const Edit* edit = state.history.Undo();
+    if (edit != nullptr) {
+        ApplyEdit(state, *edit, true);
+        JournalApplied(state, *edit, true);
+    }
+    return edit != nullptr;
+}
+
+bool RedoEdit(EditorState& state) {
+    const Edit* edit = state.history.Redo();
+    if (edit != nullptr) {
+        ApplyEdit(state, *edit, false);
+        JournalApplied(state, *edit, false);
+    }
+    return edit != nullptr;
+}
+
+void MakeEdit(EditorState& state, Edit edit) {
+    int i = edit.character;
+    switch (edit.kind) {
+    case EditKind::Field:
+        edit.before = GetField(state.characters[i].messages[edit.message], edit.field);
+        break;
+    case EditKind::Rename:
+        edit.before.text = state.characters[i].name;
+        break;
+    case EditKind::MessageDeleted:
+        edit.messageData = state.characters[i].messages[edit.message];
+        break;
+    case EditKind::CharacterDeleted:
+        edit.characterData = state.characters[i];
+        edit.treeName = state.treeNames[i];
+        break;
+    case EditKind::Batch:
+        for (auto& change : edit.changes) {
+            change.before = GetField(state.characters[change.character].messages[change.message], change.field);
+        }
+        break;
+    default:
+        break;
+    }
+    ApplyEdit(state, edit, false);
+    RecordEdit(state, std::move(edit), false);
+}
+
+bool MergeIntoDocument(EditorState& state) {
+    ProfileSpan span("merge/editor");
+    state.hasMerge = false;
+    state.merged.clear();
+    state.mergeConflicts.clear();
+    state.mergeStats = MergeStats();
+    state.mergeError.clear();
+    DialogueVersion base;
+    DialogueVersion ours;
+    DialogueVersion theirs;
+    LoadResult result = base.Open(state.mergeBase);
+    if (result.ok) {
+        result = theirs.Open(state.mergeTheirs);
+    }
+    ours.Use(state.characters);
+    if (result.ok) {
+        result = MergeDialogue(base, ours, theirs, [&](Character& character) {
+            //the files are closed once this returns, so nothing may borrow from them
+            for (auto& message : character.messages) {
+                message.content = message.content.View();
+                for (auto& response : message.responce) {
+                    response.content = response.content.View();
+                    response.reply = response.reply.View();
+                }
+            }
+            state.merged.push_back(std::move(character));
+        }, state.mergeConflicts, state.mergeStats);
+    }
+    if (!result.ok) {
+        state.mergeError = result.error;
+        state.merged.clear();
+        state.mergeConflicts.clear();
+        std::cout << "\033[31m" << "Could not merge: " << result.error << "\033[0m" << "\n";
+        return false;
+    }
+    state.mergeChoices.assign(state.mergeConflicts.size(), MergeSide::Ours);
+    state.hasMerge = true;
+    state.mergeVersion = state.validator.Version();
+    return true;
+}
+
+void ApplyMerge(EditorState& state) {
+    ProfileSpan span("merge/apply");
+    ResolveConflicts(state.merged, state.mergeConflicts, state.mergeChoices);
+    std::vector<FieldChange> changes;
+    std::vector<std::pair<int, int>> removed;
+    std::vector<MessageDiff> added;
+    DialogueVersion document;
+    DialogueVersion merged;
+    document.Use(state.characters);
+    merged.Use(state.merged);
+    DiffStats stats;
+    DiffDialogue(document, merged, [&](const MessageDiff& diff) {
+        if (diff.kind == DiffKind::Removed) {
+            removed.emplace_back(diff.beforeCharacter, diff.beforeMessage);
+            return;
+        }
+        if (diff.kind == DiffKind::Added) {
+            added.push_back(diff);
+            return;
+        }
+        for (auto& field : diff.fields) {
+            FieldChange change;
+            change.character = diff.beforeCharacter;
+            change.message = diff.beforeMessage;
+            change.field = field.field;
+            change.after = field.after;
+            changes.push_back(std::move(change));
+        }
+    }, stats);
+
+    if (removed.empty() && added.empty()) {
+        if (!changes.empty()) {
+            Edit edit;
+            edit.kind = EditKind::Batch;
+            edit.changes = std::move(changes);
+            MakeEdit(state, std::move(edit));
+        }
+    }
+    else {
+        //messages come and go, which undo steps can't follow as one; it goes in like a reload
+        for (auto& change : changes) {
+            change.before = GetField(state.characters[change.character].messages[change.message], change.field);
+        }
+        BatchChanged(state, changes, false);
+        std::sort(removed.begin(), removed.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a > b; });
+        for (auto& message : removed) {
+            EraseMessage(state, message.first, message.second);
+        }
+        //in merged order, each at its place among the messages already there
+        for (auto& diff : added) {
+            int i = state.index.FindCharacter(diff.key.from);
+            if (i == -1) {
+                i = static_cast<int>(state.characters.size());
+                Character character;
+                character.name = diff.key.from;
+                InsertCharacter(state, i, std::move(character), diff.key.from);
+            }
+            InsertMessage(state, i, diff.afterMessage, state.merged[diff.afterCharacter].messages[diff.afterMessage]);
+        }
+        state.history.Clear();
+        CompactJournal(state);
+    }
+    std::cout << "\033[32m" << "merged " << state.mergeBase << " and " << state.mergeTheirs << ": " << stats.changed << " messages changed, "
+        << stats.added << " added, " << stats.removed << " removed" << "\033[0m" << "\n";
+    state.merged.clear();
+    state.mergeConflicts.clear();
+    state.mergeChoices.clear();
+    state.hasMerge = false;
+}
+
+void LoadEditorProject(EditorState& state) {
+    //legacy single file first, otherwise the sharded project Save writes when "Sharded" is ticked,
+    //or a directory of chapter files
+    std::string loadPath = "load.json";
+    if (!std::filesystem::exists(loadPath) && (IsShardedProject("Content/Data/messages") || IsChapterProject("Content/Data/messages"))) {
+        loadPath = "Content/Data/messages";
+    }
+    //LoadResult loaded = LoadCharactersFromFile("Content/Data/messages.json", characters);
+    std::vector<FileLoadError> fileErrors;
+    std::error_code ec;
+    LoadResult loaded;
+    ProfileSpan loadSpan("load");
+    auto size = std::filesystem::file_size(loadPath, ec);
+    bool lazy = !ec && !std::filesystem::is_directory(loadPath, ec) && size >= kLazyLoadBytes;
+    if (lazy) {
+        loaded = state.lazy.Open(loadPath, state.characters);
+    }
+    else {
+        loaded = LoadProject(loadPath, state.characters, &fileErrors);
+    }
+    if (!loaded.ok && fileErrors.empty()) {
+        fileErrors.push_back(FileLoadError{ loadPath, loaded });
+    }
+    for (auto& failed : fileErrors) {
+        std::cout << "\033[31m" << "Failed to load " << failed.file << ": " << failed.result.error;
+        if (failed.result.line != 0) {
+            std::cout << " (line " << failed.result.line << ", column " << failed.result.column << ")";
+        }
+        std::cout << "\033[0m" << "\n";
+    }
+
+    if (!lazy && !std::filesystem::is_directory(loadPath, ec)) {
+        //pick up load.json being rewritten by other tools while the editor is open. Not when lazy:
+        //the loader still reads the file, and a tool truncating it in place would pull the text
+        //out from under the characters. Started before the journal is replayed, since
+        //reloads are diffed against what was read from the file
+        state.reload.Start(loadPath, state.characters);
+    }
+    else if (lazy) {
+        state.reloadOff = loadPath + " is loaded a character at a time, so changes other tools make to it aren't picked up until the editor is restarted";
+    }
+
+    state.journalBase.source = loadPath;
+    state.journalBase.stamp = StampSource(loadPath);
+    JournalContents journal;
+    //a project that didn't load whole keeps its journal for a run where it does
+    bool replay = loaded.ok && FindJournal(state, journal);
+    if (replay && journal.hasSnapshot) {
+        state.characters = std::move(journal.snapshot.characters);
+        state.treeNames = std::move(journal.snapshot.treeNames);
+    }
+    else {
+        for (auto& character : state.characters) {
+            state.treeNames.push_back(character.name);
+        }
+    }
+
+    {
+        ProfileSpan span("load/build indexes");
+        state.index.Rebuild(state.characters);
+        state.search.Rebuild(state.characters);
+    }
+    {
+        ProfileSpan span("load/validate");
+        state.validator.ValidateAll(state.characters, state.index);
+    }
+    if (replay) {
+        ProfileSpan span("load/replay journal");
+        std::size_t applied = ReplayJournal(state, journal.edits);
+        //whatever didn't replay is cut off, so edits from now on follow the ones that did
+        journal.validBytes = applied == 0 ? journal.baseBytes : journal.edits[applied - 1].end;
+        state.jumpTo = MessageLocation();
+        if (applied != 0 || journal.hasSnapshot) {
+            //what came back may not be in any saved file, so the journal keeps it until a save is
+            state.edits++;
+            std::cout << "\033[32m" << "recovered " << (journal.hasSnapshot ? "a snapshot and " : "") << applied << " unsaved edits from the journal" << "\033[0m" << "\n";
+        }
+        if (applied != journal.edits.size() || journal.tornBytes != 0) {
+            std::cout << "\033[31m" << "dropped " << journal.edits.size() - applied << " journaled edits that didn't fit and " << journal.tornBytes << " bytes cut off by a crash" << "\033[0m" << "\n";
+        }
+    }
+    if (loaded.ok) {
+        std::string error;
+        std::filesystem::create_directories(std::filesystem::path(kJournalPath).parent_path(), ec);
+        if (!state.journal.Start(kJournalPath, state.journalBase, replay ? &journal : nullptr, error)) {
+            std::cout << "\033[31m" << "Autosave is off: " << error << "\033[0m" << "\n";
+        }
+    }
+    state.shardedSave = IsShardedProject(loadPath);
+    for (auto& character : state.characters) {
+        state.glyphs.Add(character);
+    }
+}
+
+void CloseEditorProject(EditorState& state) {
+    while (state.saveWorker.Busy()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (state.saveWorker.Status().failedSaves != state.failedSavesSeen) {
+        MarkAllDirty(state.characters);
+        CompactJournal(state);
+        state.edits++;
+    }
+    bool open = state.journal.IsOpen();
+    state.journal.Stop();
+    if (!open) {
+        return;
+    }
+    if (state.edits == state.savedEdits) {
+        std::error_code ec;
+        std::filesystem::remove(kJournalPath, ec);
+    }
+    else {
+        std::cout << "\033[32m" << "unsaved edits are kept in " << kJournalPath << " and come back next time" << "\033[0m" << "\n";
+    }
+}
+
+void DrawEditor(EditorState& state, const ImVec2& windowSize) {
+    auto& characters = state.characters;
+
+    std::vector<LazyLoaded> lazyLoaded;
+    if (state.lazy.Take(lazyLoaded)) {
+        for (auto& loaded : lazyLoaded) {
+            CharacterLoaded(state, loaded);
+        }
+    }
+    if (state.pendingSave != PendingSave::None && UnloadedCharacters(state) == 0) {
+        StartSave(state, state.pendingSave);
+    }
+
+    std::vector<ReloadChanges> reloads;
+    if (state.reload.Take(reloads)) {
+        ProfileSpan span("frame/apply reload");
+        bool changed = false;
+        for (auto& reload : reloads) {
+            changed |= ApplyReload(state, reload);
+        }
+        if (changed) {
+            std::cout << "\033[32m" << "reloaded changes from disk" << "\033[0m" << "\n";
+        }
+    }
+    if (!reloads.empty()) {
+        RebaseJournal(state);
+    }
+    if (state.journal.NeedsCompaction(state.compactJournalBytes)) {
+        CompactJournal(state);
+    }
+    if (state.glyphs.Count() != state.glyphsRequested) {
+        state.glyphAtlas.Request(state.glyphs);
+        state.glyphsRequested = state.glyphs.Count();
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::SetNextWindowSize(windowSize);
+    ImGui::Begin("Message Editor", nullptr,
+        ImGuiWindowFlags_NoResize |
+        ImGuiWindowFlags_NoMove |
+        ImGuiWindowFlags_NoCollapse |
+        ImGuiWindowFlags_NoTitleBar |
+        ImGuiWindowFlags_MenuBar);
+
+    float windowWidth = ImGui::GetWindowWidth();
+    ImGui::PushItemWidth(windowWidth - 200);
+
+    if (ImGui::BeginMenuBar()) {
+        DrawMenuBar(state);
+        ImGui::EndMenuBar();
+    }
+    DrawSearch(state);
+    DrawProblems(state);
+
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+
+        if (state.jumpTo.character == i) {
+            ImGui::SetNextItemOpen(true);
+        }
+        if (ImGui::TreeNode(state.treeNames.at(i).c_str())) {
+            //first opened, so its messages are wanted soon
+            if (characters[i].lazySlot >= 0) {
+                state.lazy.Request(characters[i].lazySlot);
+            }
+            ImGui::PushID(i);
+            if (InputString("Name", characters[i].name)) {
+                Edit edit;
+                edit.kind = EditKind::Rename;
+                edit.character = i;
+                edit.before.text = TextBeforeEdit(characters[i].name);
+                edit.after.text = characters[i].name;
+                RecordEdit(state, std::move(edit), true);
+                CharacterRenamed(state, i);
+                //treeNames[i] = characterName;
+            }
+            if (ImGui::IsItemActivated()) {
+                state.history.Seal();
+            }
+
+            if (state.jumpTo.character == i) {
+                ImGui::SetNextItemOpen(true);
+            }
+            if (ImGui::TreeNode("Messages")) {
+                if (characters[i].lazySlot >= 0) {
+                    DrawUnloaded(state, i);
+                }
+                else if (!characters[i].loadError.empty()) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Failed to load: %s", characters[i].loadError.c_str());
+                }
+                else {
+                    DrawMessages(state, i);
+                }
+                ImGui::TreePop();
+            }
+
+            if (ImGui::Button("Delete Character")) {
+                Edit edit;
+                edit.kind = EditKind::CharacterDeleted;
+                edit.character = i;
+                edit.characterData = EraseCharacter(state, i, edit.treeName);
+                RecordEdit(state, std::move(edit), false);
+            }
+
+            ImGui::PopID();
+
+            ImGui::Dummy(ImVec2(0.0f, 10.0f));
+
+            ImGui::TreePop();
+        }
+    }
+
+    state.jumpTo = MessageLocation();
+
+    ImGui::PopItemWidth();
+    ImGui::End();
+
+    if (state.showStats) {
+        DrawStats(state);
+    }
+    if (state.showSimulation) {
+        DrawSimulation(state);
+    }
+    if (state.showBatch) {
+        DrawBatch(state);
+    }
+    if (state.showMerge) {
+        DrawMerge(state);
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "BackgroundSave.h"
+#include "Dialogue.h"
+#include "DialogueBatch.h"
+#include "DialogueIndex.h"
+#include "DialogueMerge.h"
+#include "DialogueSim.h"
+#include "DialogueValidator.h"
+#include "DialogueWriter.h"
+#include "EditJournal.h"
+#include "GlyphAtlas.h"
+#include "GlyphSet.h"
+#include "LazyLoad.h"
+#include "LiveReload.h"
+#include "SearchIndex.h"
+#include "UndoHistory.h"
+
+#include "imgui.h"
+
+#include <string>
+#include <vector>
+
+// A save or bake asked for while some characters weren't loaded yet; it starts once they are.
+enum class PendingSave {
+    None,
+    Save,
+    Bake
+};
+
+// Everything the editor window edits or remembers between frames. Kept apart from the
+// Win32/DirectX code in main.cpp so the UI can also be driven without a window.
+struct EditorState {
+    //a large load.json is loaded a character at a time and unedited text points into it, so it's
+    //declared before everything that can hold text and goes away after them
+    LazyLoader lazy;
+    //list of characters
+    std::vector<Character> characters;
+    std::vector<std::string> treeNames;
+    DialogueIndex index;
+    DialogueValidator validator;
+    //first problems in document order, redone when the validator's version moves
+    std::vector<Problem> problems;
+    uint64_t problemsVersion = 0;
+
+    UndoHistory history;
+
+    //message the "Find ID" box asked to open and scroll to
+    int findID = 0;
+    MessageLocation jumpTo;
+
+    //search box; results are redone when the text, the options or the index change
+    SearchIndex search;
+    std::string searchText;
+    SearchOptions searchOptions;
+    SearchResults searchResults;
+    std::string searchedText;
+    bool searchedWholeWord = false;
+    uint64_t searchedVersion = 0;
+
+    //load.json changed on disk, merged in at the start of a frame
+    ReloadWorker reload;
+    //why load.json isn't being watched, shown in the menu bar; empty when it is or isn't a file
+    std::string reloadOff = "";
+
+    SaveWorker saveWorker;
+    WriteOptions saveOptions;
+    //the worker's finished and failed counts as of the last frame
+    std::size_t savesSeen = 0;
+    std::size_t saveFailuresSeen = 0;
+    std::size_t failedSavesSeen = 0;
+    bool shardedSave = false;
+    PendingSave pendingSave = PendingSave::None;
+
+    //every edit since the last save (or the load), replayed by the next LoadEditorProject after a
+    //crash; rewritten from a snapshot in the background on every save and once it holds
+    //compactJournalBytes of edits
+    EditJournal journal;
+    JournalBase journalBase;
+    std::size_t compactJournalBytes = std::size_t(8) << 20;
+    //changes journaled so far (a failed save and a replayed journal count as one), and how many
+    //of them the last full save started had; they only match at exit when every change is saved
+    std::size_t edits = 0;
+    std::size_t savedEdits = 0;
+    //every code point the document uses; the font atlas is rebuilt with just those glyphs on
+    //glyphAtlas's thread whenever it grows, and main.cpp installs it between frames
+    GlyphSet glyphs;
+    std::size_t glyphsRequested = 0;
+    GlyphAtlasWorker glyphAtlas;
+    //profiler window, see Profiler.h
+    bool showStats = false;
+    //playthrough simulator window, see DialogueSim.h; a result keeps the model it ran on, so its
+    //rows still make sense after the document has been edited
+    bool showSimulation = false;
+    SimWorker simulation;
+    SimOptions simOptions;
+    SimModel simModel;
+    SimResult simResult;
+    bool hasSimResult = false;
+    int simCharacter = 0;
+    //bulk edits window, see DialogueBatch.h; a preview is only applied while the document is still
+    //the one it was planned on, which the validator's version tells
+    bool showBatch = false;
+    BatchFilter batchFilter;
+    std::vector<BatchTransform> batchTransforms;
+    BatchPlan batchPlan;
+    bool hasBatchPlan = false;
+    uint64_t batchPlanVersion = 0;
+    //merge window, see DialogueMerge.h: a common base and another writer's copy merged into the
+    //document. merged holds the result, with text of its own, until it's applied; like a batch
+    //preview it's only applied to the document it was made from
+    bool showMerge = false;
+    std::string mergeBase = "";
+    std::string mergeTheirs = "";
+    std::vector<Character> merged;
+    std::vector<MergeConflict> mergeConflicts;
+    std::vector<MergeSide> mergeChoices;
+    MergeStats mergeStats;
+    std::string mergeError = "";
+    bool hasMerge = false;
+    uint64_t mergeVersion = 0;
+};
+
+// Loads load.json, or else the sharded or chapter project in Content/Data/messages, and rebuilds the indexes.
+// A single load.json is watched from then on and changes to it are merged in by DrawEditor, unless
+// it was big enough to be loaded lazily by state.lazy: then only the character names are read
+// up front and each character's messages are parsed when its tree node is first opened.
+// The edit journal the last run left behind is replayed on top, as long as the project on disk
+// is still the one it was made against, and journaling goes on from there.
+void LoadEditorProject(EditorState& state);
+// For a normal exit: lets queued saves finish, then removes the journal when they wrote every
+// edit in it, so the next LoadEditorProject only replays after a crash or an exit with unsaved
+// edits.
+void CloseEditorProject(EditorState& state);
+
+// Makes edit the way the window does: applied with the indexes kept up to date, recorded for
+// undo and written to the journal. The before values and removed data are filled in here.
+void MakeEdit(EditorState& state, Edit edit);
+
+// Reverts or reapplies one step of state.history, as the Undo/Redo buttons and Ctrl+Z/Ctrl+Y do.
+// Returns false when there was nothing to undo or redo.
+bool UndoEdit(EditorState& state);
+bool RedoEdit(EditorState& state);
+
+// Three-way merges the files at state.mergeBase and state.mergeTheirs into the document, which
+// has to be loaded in full, leaving the result in state.merged and every conflict, settled as
+// ours for now, in state.mergeConflicts. Returns false with state.mergeError set when it can't.
+bool MergeIntoDocument(EditorState& state);
+// Makes the document state.merged with the sides picked in state.mergeChoices: one undo step when
+// the merge only changed fields, otherwise applied the way a reload is and the undo history
+// starts over.
+void ApplyMerge(EditorState& state);
+
+// Builds the whole editor window for this frame, between ImGui::NewFrame and ImGui::Render.
+void DrawEditor(EditorState& state, const ImVec2& windowSize);
@@ -0,0 +1,125 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileStamp StampFile(const std::string& path) {
+    FileStamp stamp;
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return stamp;
+    }
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return stamp;
+    }
+    stamp.exists = true;
+    stamp.size = static_cast<uint64_t>(size);
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return stamp;
+}
+
+bool PollingFileWatcher::Watch(const std::string& watched) {
+    path = watched;
+    last = StampFile(path);
+    return true;
+}
+
+bool PollingFileWatcher::WaitForChange(double timeoutSeconds) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeoutSeconds));
+    Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+    while (true) {
+        FileStamp stamp = StampFile(path);
+        if (stamp != last) {
+            last = stamp;
+            return true;
+        }
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::min(deadline - now, step));
+    }
+}
+
+#ifdef __linux__
+namespace {
+
+// Watches the file's directory rather than the file: editors and tools usually save by writing a
+// temporary and renaming it over the original, which would end a watch on the file itself.
+class InotifyFileWatcher : public FileWatcher {
+public:
+    InotifyFileWatcher() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+    ~InotifyFileWatcher() override {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool Valid() const { return fd >= 0; }
+
+    bool Watch(const std::string& path) override {
+        if (watch >= 0) {
+            inotify_rm_watch(fd, watch);
+            watch = -1;
+        }
+        std::filesystem::path file(path);
+        name = file.filename().string();
+        std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+        watch = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB);
+        return watch >= 0;
+    }
+
+    bool WaitForChange(double timeoutSeconds) override {
+        pollfd waitFor{ fd, POLLIN, 0 };
+        if (poll(&waitFor, 1, static_cast<int>(timeoutSeconds * 1000.0)) <= 0) {
+            return false;
+        }
+        //drain everything queued, the directory may see a burst for one save
+        bool changed = false;
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+            for (char* at = buffer; at < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(at);
+                if (event->len != 0 && name == event->name) {
+                    changed = true;
+                }
+                at += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+
+private:
+    int fd;
+    int watch = -1;
+    std::string name;
+};
+
+}
+#endif
+
+std::unique_ptr<FileWatcher> CreateFileWatcher() {
+#ifdef __linux__
+    auto watcher = std::make_unique<InotifyFileWatcher>();
+    if (watcher->Valid()) {
+        return watcher;
+    }
+#endif
+    return std::make_unique<PollingFileWatcher>();
+}
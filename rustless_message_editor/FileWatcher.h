@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Size and modification time of a file, for telling a real change from a spurious wake-up.
+struct FileStamp {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return exists == other.exists && size == other.size && modified == other.modified;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+FileStamp StampFile(const std::string& path);
+
+// Waits for one file to change. A change may be reported more than once, or for a write that
+// left the file as it was, so callers compare stamps or contents before doing real work.
+class FileWatcher {
+public:
+    virtual ~FileWatcher() = default;
+
+    // Starts watching path, dropping any earlier one. The file does not have to exist yet.
+    virtual bool Watch(const std::string& path) = 0;
+    // Blocks for up to timeoutSeconds; true when the file may have changed.
+    virtual bool WaitForChange(double timeoutSeconds) = 0;
+};
+
+// Checks the file's stamp every interval. Works everywhere, at the cost of the interval's latency.
+class PollingFileWatcher : public FileWatcher {
+public:
+    explicit PollingFileWatcher(double intervalSeconds = 0.25) : interval(intervalSeconds) {}
+
+    bool Watch(const std::string& path) override;
+    bool WaitForChange(double timeoutSeconds) override;
+
+private:
+    std::string path;
+    FileStamp last;
+    double interval;
+};
+
+// The best watcher for this platform: inotify on Linux, polling elsewhere.
+std::unique_ptr<FileWatcher> CreateFileWatcher();
@@ -0,0 +1,52 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(double burstSeconds)
+    : burst(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(burstSeconds))) {
+}
+
+void FrameScheduler::OnInput(Clock::time_point now) {
+    burstUntil = std::max(burstUntil, now + burst);
+}
+
+void FrameScheduler::Wake() {
+    woken.store(true, std::memory_order_release);
+}
+
+void FrameScheduler::RequestFrame() {
+    frameRequested = true;
+}
+
+void FrameScheduler::RequestFrameIn(Clock::time_point now, double seconds) {
+    //a late caller's negative delay means now, and nothing may run the time_point past its range
+    seconds = std::clamp(seconds, 0.0, kMaxWaitSeconds);
+    RequestFrameAt(now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds)));
+}
+
+void FrameScheduler::RequestFrameAt(Clock::time_point when) {
+    timer = std::min(timer, when);
+}
+
+bool FrameScheduler::ShouldRender(Clock::time_point now) const {
+    return frameRequested || woken.load(std::memory_order_acquire) || now < burstUntil || now >= timer;
+}
+
+double FrameScheduler::WaitSeconds(Clock::time_point now) const {
+    if (ShouldRender(now)) {
+        return 0.0;
+    }
+    if (timer == Clock::time_point::max()) {
+        return -1.0;
+    }
+    return std::min(std::chrono::duration<double>(timer - now).count(), kMaxWaitSeconds);
+}
+
+void FrameScheduler::BeginFrame(Clock::time_point now) {
+    //cleared before the frame is built, so a Wake or RequestFrame made while building it gets another one
+    frameRequested = false;
+    woken.store(false, std::memory_order_release);
+    if (now >= timer) {
+        timer = Clock::time_point::max();
+    }
+}
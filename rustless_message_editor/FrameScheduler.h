@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// Decides when the editor has to draw a frame and how long it may sleep otherwise.
+// It never looks at the clock or the OS itself: the caller passes "now" in and does the
+// waiting through a FrameWaiter, so the policy runs the same with or without a window.
+//
+// A frame is drawn when
+//  - input arrived less than burstSeconds ago (ImGui needs a few frames to settle hovers,
+//    nav and animations after an event),
+//  - a timer set with RequestFrameIn/At is due,
+//  - another thread called Wake (a save finished, a file changed, ...),
+//  - the last frame asked for another one with RequestFrame.
+// Otherwise the loop should block until the next timer, or forever if there is none.
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Longest wait WaitSeconds asks for; a timer further out only costs the loop a spare wake-up.
+    static constexpr double kMaxWaitSeconds = 3600.0;
+
+    explicit FrameScheduler(double burstSeconds = 0.25);
+
+    // Any OS event: input, resize, focus, paint.
+    void OnInput(Clock::time_point now);
+    // Thread safe. Pair it with FrameWaiter::Wake so a blocked loop notices.
+    void Wake();
+    // Draw again straight after this frame.
+    void RequestFrame();
+    // seconds is clamped to 0..kMaxWaitSeconds.
+    void RequestFrameIn(Clock::time_point now, double seconds);
+    void RequestFrameAt(Clock::time_point when);
+
+    bool ShouldRender(Clock::time_point now) const;
+    // How long the loop may block before something is due, at most kMaxWaitSeconds; negative means
+    // until the next event.
+    double WaitSeconds(Clock::time_point now) const;
+    // Call just before building a frame; consumes the requests it satisfies.
+    void BeginFrame(Clock::time_point now);
+
+private:
+    Clock::duration burst;
+    Clock::time_point burstUntil;
+    Clock::time_point timer = Clock::time_point::max();
+    bool frameRequested = true;
+    std::atomic<bool> woken{ false };
+};
+
+// Platform side of the idle wait.
+class FrameWaiter {
+public:
+    virtual ~FrameWaiter() = default;
+    // Blocks until an event arrives, Wake is called or the timeout (seconds, negative = none) passes.
+    virtual void Wait(double timeoutSeconds) = 0;
+    // Thread safe; makes a Wait in progress return.
+    virtual void Wake() = 0;
+};
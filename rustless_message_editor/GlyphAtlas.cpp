@@ -0,0 +1,230 @@
+#include "GlyphAtlas.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const kFontCandidates[] = {
+    "Content/Fonts/editor.ttf",
+#ifdef _WIN32
+    "C:/Windows/Fonts/segoeui.ttf",
+    "C:/Windows/Fonts/arial.ttf",
+#else
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/usr/share/fonts/truetype/noto/NotoSans-Regular.ttf",
+    "/Library/Fonts/Arial Unicode.ttf",
+#endif
+};
+
+//what ImGui draws on its own: printable ASCII, and the ellipsis it cuts long labels with
+void AddUiGlyphs(GlyphSet& glyphs) {
+    for (uint32_t c = 0x20; c < 0x7F; c++) {
+        glyphs.Add(c);
+    }
+    glyphs.Add(uint32_t(0x2026));
+}
+
+}
+
+std::string FindEditorFont() {
+    for (const char* candidate : kFontCandidates) {
+        std::error_code ec;
+        if (fs::is_regular_file(candidate, ec)) {
+            return candidate;
+        }
+    }
+    return std::string();
+}
+
+std::vector<ImWchar> GlyphAtlasRanges(const GlyphSet& glyphs) {
+    GlyphSet all = glyphs;
+    AddUiGlyphs(all);
+    std::vector<ImWchar> ranges;
+    for (auto& range : all.Ranges()) {
+        //control characters have no glyphs, and 0 would end the list
+        uint32_t first = std::max<uint32_t>(range.first, 0x20);
+        uint32_t last = std::min<uint32_t>(range.second, IM_UNICODE_CODEPOINT_MAX);
+        if (first > last) {
+            continue;
+        }
+        ranges.push_back(static_cast<ImWchar>(first));
+        ranges.push_back(static_cast<ImWchar>(last));
+    }
+    ranges.push_back(0);
+    return ranges;
+}
+
+bool BuildGlyphAtlas(ImFontAtlas& atlas, const std::string& font, float size, const ImWchar* ranges, GlyphAtlasStats& stats) {
+    ProfileSpan span("font atlas build");
+    auto start = std::chrono::steady_clock::now();
+    atlas.Clear();
+    ImFontConfig config;
+    config.GlyphRanges = ranges;
+    if (font.empty()) {
+        atlas.AddFontDefault(&config);
+    }
+    else {
+        //the atlas frees its copy with IM_FREE
+        void* data = IM_ALLOC(font.size());
+        std::memcpy(data, font.data(), font.size());
+        config.SizePixels = size;
+        atlas.AddFontFromMemoryTTF(data, static_cast<int>(font.size()), size, &config, ranges);
+    }
+    if (!atlas.Build()) {
+        return false;
+    }
+    unsigned char* pixels;
+    int width;
+    int height;
+    atlas.GetTexDataAsRGBA32(&pixels, &width, &height);
+    stats.glyphs = atlas.Fonts.empty() ? 0 : static_cast<std::size_t>(atlas.Fonts[0]->Glyphs.Size);
+    stats.width = width;
+    stats.height = height;
+    stats.textureBytes = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+GlyphAtlasWorker::GlyphAtlasWorker() : thread(&GlyphAtlasWorker::Run, this) {
+}
+
+GlyphAtlasWorker::~GlyphAtlasWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    if (hasBuilt) {
+        IM_DELETE(built.atlas);
+    }
+}
+
+void GlyphAtlasWorker::SetFont(const std::string& path, float size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    fontPath = path;
+    fontSize = size;
+    fontRead = false;
+}
+
+void GlyphAtlasWorker::Request(const GlyphSet& glyphs) {
+    std::vector<ImWchar> ranges = GlyphAtlasRanges(glyphs);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(ranges);
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+bool GlyphAtlasWorker::Busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hasPending || building;
+}
+
+bool GlyphAtlasWorker::Install(ImGuiIO& io) {
+    Built ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasBuilt) {
+            return false;
+        }
+        ready = std::move(built);
+        built = Built();
+        hasBuilt = false;
+    }
+    //the context owns io.Fonts and deletes whichever atlas is there when it goes
+    ImFontAtlas* old = io.Fonts;
+    io.Fonts = ready.atlas;
+    io.FontDefault = nullptr;
+    IM_DELETE(old);
+    std::lock_guard<std::mutex> lock(mutex);
+    installedRanges = std::move(ready.ranges);
+    installed = ready.stats;
+    return true;
+}
+
+GlyphAtlasStats GlyphAtlasWorker::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return installed;
+}
+
+void GlyphAtlasWorker::SetOnBuilt(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onBuilt = std::move(callback);
+}
+
+void GlyphAtlasWorker::Run() {
+    std::string fontName;
+    while (true) {
+        Built job;
+        std::string path;
+        float size;
+        bool readFont;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return hasPending || stopping; });
+            if (stopping) {
+                return;
+            }
+            job.ranges = std::move(pending);
+            hasPending = false;
+            building = true;
+            path = fontPath;
+            size = fontSize;
+            readFont = !fontRead;
+            fontRead = true;
+        }
+
+        if (readFont) {
+            font.clear();
+            fontName = "built-in";
+            path = path.empty() ? FindEditorFont() : path;
+            std::ifstream file(path, std::ios::binary);
+            if (!path.empty() && file) {
+                font.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                fontName = path;
+            }
+            else if (!path.empty()) {
+                std::cout << "\033[31m" << "Could not read the font " << path << ", using the built-in one" << "\033[0m" << "\n";
+            }
+        }
+
+        //ImGui's allocation counter is bumped from here too, which only its metrics window reads
+        job.atlas = IM_NEW(ImFontAtlas)();
+        bool ok = BuildGlyphAtlas(*job.atlas, font, size, job.ranges.data(), job.stats);
+        job.stats.font = fontName;
+        if (!ok) {
+            std::cout << "\033[31m" << "Could not build a font atlas from " << fontName << "\033[0m" << "\n";
+            IM_DELETE(job.atlas);
+        }
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            building = false;
+            if (ok) {
+                if (hasBuilt) {
+                    IM_DELETE(built.atlas);
+                }
+                built = std::move(job);
+                hasBuilt = true;
+                callback = onBuilt;
+            }
+        }
+        if (callback) {
+            callback();
+        }
+    }
+}
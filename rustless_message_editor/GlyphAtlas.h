@@ -0,0 +1,89 @@
+#pragma once
+
+#include "GlyphSet.h"
+
+#include "imgui.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GlyphAtlasStats {
+    std::string font = "";
+    std::size_t glyphs = 0;
+    int width = 0;
+    int height = 0;
+    // the RGBA32 texture the renderer uploads
+    std::size_t textureBytes = 0;
+    double seconds = 0.0;
+};
+
+// The first font file the editor finds: Content/Fonts/editor.ttf, then a system font. Empty when
+// there is none, and ImGui's built-in font (ASCII and Latin-1 only) is used.
+std::string FindEditorFont();
+
+// ImFontAtlas glyph ranges (pairs, then a 0) for what ImGui draws itself plus every code point in
+// glyphs that fits an ImWchar; anything above U+FFFF needs IMGUI_USE_WCHAR32 and is left out.
+std::vector<ImWchar> GlyphAtlasRanges(const GlyphSet& glyphs);
+
+// Builds atlas from a TTF file's bytes, or ImGui's built-in font when font is empty, with the
+// glyphs in ranges, and converts it to RGBA32 the way the renderer asks for it. ranges must
+// outlive the atlas. Safe off the UI thread: an atlas doesn't need an ImGui context.
+bool BuildGlyphAtlas(ImFontAtlas& atlas, const std::string& font, float size, const ImWchar* ranges, GlyphAtlasStats& stats);
+
+// Keeps the editor's font atlas down to the glyphs the dialogue uses. Request hands over the
+// document's GlyphSet whenever it grew; the atlas is rebuilt from it on this worker's thread
+// (a few milliseconds for a few hundred glyphs) and Install swaps it in between frames.
+class GlyphAtlasWorker {
+public:
+    GlyphAtlasWorker();
+    ~GlyphAtlasWorker();
+
+    GlyphAtlasWorker(const GlyphAtlasWorker&) = delete;
+    GlyphAtlasWorker& operator=(const GlyphAtlasWorker&) = delete;
+
+    // The font is read on the first build; empty uses FindEditorFont.
+    void SetFont(const std::string& path, float size);
+    // Only the newest request is built.
+    void Request(const GlyphSet& glyphs);
+    bool Busy() const;
+    // Puts the newest built atlas in io.Fonts and deletes the old one. Only between
+    // ImGui::Render and the next NewFrame; returns true when it swapped, after which the
+    // renderer's font texture has to be made again.
+    bool Install(ImGuiIO& io);
+    // What the installed atlas holds.
+    GlyphAtlasStats Stats() const;
+    // Called on the worker's thread when an atlas is ready to install.
+    void SetOnBuilt(std::function<void()> callback);
+
+private:
+    struct Built {
+        ImFontAtlas* atlas = nullptr;
+        std::vector<ImWchar> ranges;
+        GlyphAtlasStats stats;
+    };
+
+    void Run();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool building = false;
+    bool hasPending = false;
+    std::vector<ImWchar> pending;
+    std::string fontPath = "";
+    float fontSize = 16.0f;
+    bool fontRead = false;
+    std::string font;
+    bool hasBuilt = false;
+    Built built;
+    //ranges the installed atlas was built from, which it keeps pointing at
+    std::vector<ImWchar> installedRanges;
+    GlyphAtlasStats installed;
+    std::function<void()> onBuilt;
+    std::thread thread;
+};
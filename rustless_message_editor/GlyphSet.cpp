@@ -0,0 +1,98 @@
+#include "GlyphSet.h"
+
+namespace {
+
+constexpr uint32_t kCodePoints = 0x110000;
+
+}
+
+GlyphSet::GlyphSet() : bits(kCodePoints / 64, 0) {
+}
+
+bool GlyphSet::Add(uint32_t codePoint) {
+    if (codePoint >= kCodePoints) {
+        return false;
+    }
+    uint64_t& word = bits[codePoint >> 6];
+    uint64_t bit = uint64_t(1) << (codePoint & 63);
+    if ((word & bit) != 0) {
+        return false;
+    }
+    word |= bit;
+    count++;
+    return true;
+}
+
+bool GlyphSet::Contains(uint32_t codePoint) const {
+    return codePoint < kCodePoints && (bits[codePoint >> 6] >> (codePoint & 63) & 1) != 0;
+}
+
+std::size_t GlyphSet::Add(std::string_view text) {
+    std::size_t added = 0;
+    const unsigned char* at = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = at + text.size();
+    while (at < end) {
+        //most dialogue is ASCII, which needs no decoding
+        if (*at < 0x80) {
+            added += Add(static_cast<uint32_t>(*at)) ? 1 : 0;
+            at++;
+            continue;
+        }
+        int length = *at >= 0xF0 ? 4 : *at >= 0xE0 ? 3 : *at >= 0xC0 ? 2 : 0;
+        if (length == 0 || end - at < length) {
+            at++;
+            continue;
+        }
+        uint32_t codePoint = *at & (0x7F >> length);
+        int k = 1;
+        for (; k < length && (at[k] & 0xC0) == 0x80; k++) {
+            codePoint = (codePoint << 6) | (at[k] & 0x3F);
+        }
+        if (k < length) {
+            at++;
+            continue;
+        }
+        added += Add(codePoint) ? 1 : 0;
+        at += length;
+    }
+    return added;
+}
+
+std::size_t GlyphSet::Add(const Message& message) {
+    std::size_t added = Add(message.content.View());
+    for (auto& response : message.responce) {
+        added += Add(response.reply.View());
+        added += Add(response.content.View());
+    }
+    return added;
+}
+
+std::size_t GlyphSet::Add(const Character& character) {
+    std::size_t added = Add(std::string_view(character.name));
+    for (auto& message : character.messages) {
+        added += Add(message);
+    }
+    return added;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> GlyphSet::Ranges() const {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    for (uint32_t word = 0; word < bits.size(); word++) {
+        if (bits[word] == 0) {
+            continue;
+        }
+        for (uint32_t bit = 0; bit < 64; bit++) {
+            if ((bits[word] >> bit & 1) == 0) {
+                continue;
+            }
+            uint32_t codePoint = word * 64 + bit;
+            if (!ranges.empty() && ranges.back().second + 1 == codePoint) {
+                ranges.back().second = codePoint;
+            }
+            else {
+                ranges.emplace_back(codePoint, codePoint);
+            }
+        }
+    }
+    return ranges;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The Unicode code points some text uses, as a bitmap over all of Unicode (136 KB), so the
+// editor's font atlas can hold just those glyphs. Only ever grows; Count tells whether it did.
+class GlyphSet {
+public:
+    GlyphSet();
+
+    // Adds every code point of UTF-8 text, skipping malformed bytes. Returns how many were new.
+    std::size_t Add(std::string_view text);
+    // Content, replies and response text.
+    std::size_t Add(const Message& message);
+    // Name and every message.
+    std::size_t Add(const Character& character);
+    bool Add(uint32_t codePoint);
+
+    bool Contains(uint32_t codePoint) const;
+    std::size_t Count() const { return count; }
+    // Runs of consecutive code points as inclusive first/last pairs, lowest first.
+    std::vector<std::pair<uint32_t, uint32_t>> Ranges() const;
+
+private:
+    std::vector<uint64_t> bits;
+    std::size_t count = 0;
+};
@@ -0,0 +1,46 @@
+#include "InputString.h"
+
+namespace {
+
+int ResizeString(ImGuiInputTextCallbackData* data) {
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        //ImGui asks for BufTextLen + 1 bytes; std::string always keeps room for the terminator itself
+        std::string* text = static_cast<std::string*>(data->UserData);
+        IM_ASSERT(data->Buf == text->data());
+        text->resize(static_cast<std::size_t>(data->BufTextLen));
+        data->Buf = text->data();
+    }
+    return 0;
+}
+
+int ResizeText(ImGuiInputTextCallbackData* data) {
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        Text* text = static_cast<Text*>(data->UserData);
+        IM_ASSERT(data->Buf == text->EditBuffer());
+        text->Resize(static_cast<std::size_t>(data->BufTextLen));
+        data->Buf = text->EditBuffer();
+    }
+    return 0;
+}
+
+}
+
+bool InputString(const char* label, std::string& text, ImGuiInputTextFlags flags) {
+    IM_ASSERT((flags & ImGuiInputTextFlags_CallbackResize) == 0);
+    return ImGui::InputText(label, text.data(), text.capacity() + 1, flags | ImGuiInputTextFlags_CallbackResize, ResizeString, &text);
+}
+
+bool InputString(const char* label, Text& text, ImGuiInputTextFlags flags) {
+    IM_ASSERT((flags & ImGuiInputTextFlags_CallbackResize) == 0);
+    if (text.Capacity() == 0) {
+        //borrowed bytes are read-only and not terminated, and an empty field has no buffer yet;
+        //a copy per frame of the few fields on screen beats owning every field ever drawn
+        std::string shown(text.View());
+        if (!InputString(label, shown, flags)) {
+            return false;
+        }
+        text = shown;
+        return true;
+    }
+    return ImGui::InputText(label, text.EditBuffer(), text.Capacity() + 1, flags | ImGuiInputTextFlags_CallbackResize, ResizeText, &text);
+}
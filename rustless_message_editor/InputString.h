@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Text.h"
+
+#include "imgui.h"
+
+#include <string>
+
+// ImGui::InputText straight on a std::string: ImGui edits the string's own buffer and grows it
+// through ImGuiInputTextFlags_CallbackResize, so there is no copy per frame and no length limit.
+bool InputString(const char* label, std::string& text, ImGuiInputTextFlags flags = 0);
+
+// The same on a Text. Owned text is edited in place like a std::string; borrowed text is shown
+// from a copy, and only becomes the field's own once it is actually edited.
+bool InputString(const char* label, Text& text, ImGuiInputTextFlags flags = 0);
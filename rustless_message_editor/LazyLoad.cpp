@@ -0,0 +1,159 @@
+#include "LazyLoad.h"
+#include "Profiler.h"
+
+#include <utility>
+
+LazyLoader::~LazyLoader() {
+    Close();
+}
+
+LoadResult LazyLoader::Open(const std::string& path, std::vector<Character>& characters) {
+    Close();
+    LoadResult result;
+    //saves go to Content/Data and never replace this file, so it stays mapped on Windows too
+    if (!mapped.Open(path, result.error)) {
+        result.ok = false;
+        return result;
+    }
+    data = mapped.Data();
+    size = mapped.Size();
+
+    result = OutlineCharacters(data, data + size, outline);
+    if (!result.ok) {
+        Close();
+        return result;
+    }
+    for (int slot = 0; slot < static_cast<int>(outline.size()); slot++) {
+        Character character;
+        character.name = outline[slot].name;
+        character.lazySlot = slot;
+        characters.push_back(std::move(character));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        queue.clear();
+        states.assign(outline.size(), SlotState::Idle);
+        errors.assign(outline.size(), std::string());
+        done.clear();
+    }
+    thread = std::thread(&LazyLoader::Run, this);
+    return result;
+}
+
+void LazyLoader::Close() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+    outline.clear();
+    mapped.Close();
+    data = nullptr;
+    size = 0;
+}
+
+void LazyLoader::Request(int slot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (slot < 0 || slot >= static_cast<int>(states.size()) || states[slot] == SlotState::Parsed) {
+            return;
+        }
+        //a slot queued behind others moves to the front; the stale entry is skipped later
+        if (states[slot] == SlotState::Queued && !queue.empty() && queue.front() == slot) {
+            return;
+        }
+        states[slot] = SlotState::Queued;
+        queue.push_front(slot);
+    }
+    wake.notify_one();
+}
+
+void LazyLoader::Release(int slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= 0 && slot < static_cast<int>(states.size())) {
+        states[slot] = SlotState::Idle;
+        errors[slot].clear();
+    }
+}
+
+LoadResult LazyLoader::LoadNow(int slot, std::vector<Message>& messages) {
+    {
+        //the thread skips a slot that is no longer queued
+        std::lock_guard<std::mutex> lock(mutex);
+        states[slot] = SlotState::Parsed;
+    }
+    LoadResult result;
+    {
+        ProfileSpan span("load/character");
+        result = LoadMessageRuns(data, data + size, outline[slot].runs, messages);
+    }
+    if (!result.ok) {
+        std::lock_guard<std::mutex> lock(mutex);
+        errors[slot] = result.error + " (line " + std::to_string(result.line) + ", column " + std::to_string(result.column) + ")";
+    }
+    return result;
+}
+
+std::string LazyLoader::Error(int slot) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slot >= 0 && slot < static_cast<int>(errors.size()) ? errors[slot] : std::string();
+}
+
+bool LazyLoader::Take(std::vector<LazyLoaded>& loaded) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (done.empty()) {
+        return false;
+    }
+    loaded = std::move(done);
+    done.clear();
+    return true;
+}
+
+void LazyLoader::SetOnLoaded(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onLoaded = std::move(callback);
+}
+
+void LazyLoader::Run() {
+    while (true) {
+        int slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            slot = queue.front();
+            queue.pop_front();
+            if (states[slot] != SlotState::Queued) {
+                continue;
+            }
+        }
+
+        LazyLoaded loaded;
+        loaded.slot = slot;
+        {
+            ProfileSpan span("load/character");
+            loaded.result = LoadMessageRuns(data, data + size, outline[slot].runs, loaded.messages);
+        }
+
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            states[slot] = SlotState::Parsed;
+            if (!loaded.result.ok) {
+                errors[slot] = loaded.result.error + " (line " + std::to_string(loaded.result.line) + ", column " + std::to_string(loaded.result.column) + ")";
+            }
+            done.push_back(std::move(loaded));
+            callback = onLoaded;
+        }
+        if (callback) {
+            callback();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueLoader.h"
+#include "MappedFile.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One character's messages, parsed on the loader's thread.
+struct LazyLoaded {
+    int slot = -1;
+    std::vector<Message> messages;
+    LoadResult result;
+};
+
+// Opens a big messages file without parsing it: Open only outlines where every character's
+// messages are (see OutlineCharacters) and hands back the characters with no messages, each
+// tagged with its lazySlot. A character's messages are parsed on the loader's own thread once
+// the editor asks for them, with their text borrowed from the file like LoadCharactersMapped.
+//
+// The file stays open until Close, so the loader has to outlive every character, snapshot and
+// undo step that came from it.
+class LazyLoader {
+public:
+    LazyLoader() = default;
+    ~LazyLoader();
+
+    LazyLoader(const LazyLoader&) = delete;
+    LazyLoader& operator=(const LazyLoader&) = delete;
+
+    // Maps path and appends one character per speaker, not merged with any already there. characters is left
+    // alone when the file can't be outlined.
+    LoadResult Open(const std::string& path, std::vector<Character>& characters);
+    void Close();
+    bool IsOpen() const { return thread.joinable(); }
+
+    std::size_t Slots() const { return outline.size(); }
+    std::size_t MessageCount(int slot) const { return outline[slot].messages; }
+    // Queues slot ahead of everything asked for before it; asking again for a slot that was
+    // parsed already does nothing.
+    void Request(int slot);
+    // The result for slot had no character left to go to (it was deleted meanwhile); a later
+    // Request parses it again.
+    void Release(int slot);
+    // Parses slot right away on the calling thread, for when the messages can't wait for a frame
+    // (replaying the edit journal). Take won't hand them out again.
+    LoadResult LoadNow(int slot, std::vector<Message>& messages);
+    // Why slot failed to parse, empty while it hasn't.
+    std::string Error(int slot) const;
+
+    // Moves out the characters parsed since the last call. Returns false when there were none.
+    bool Take(std::vector<LazyLoaded>& loaded);
+    // Called on the loader's thread after each character, e.g. to wake an idle UI.
+    void SetOnLoaded(std::function<void()> callback);
+
+private:
+    enum class SlotState {
+        Idle,
+        Queued,
+        Parsed
+    };
+
+    void Run();
+
+    MappedFile mapped;
+    const char* data = nullptr;
+    std::size_t size = 0;
+    //not changed while the thread runs
+    std::vector<CharacterOutline> outline;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::deque<int> queue;
+    std::vector<SlotState> states;
+    std::vector<std::string> errors;
+    std::vector<LazyLoaded> done;
+    std::function<void()> onLoaded;
+    std::thread thread;
+};
@@ -0,0 +1,216 @@
+#include "LiveReload.h"
+#include "DialogueLoader.h"
+
+#include <chrono>
+#include <fstream>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+//how often the thread looks at stopping while the file is quiet
+constexpr double kWaitSeconds = 0.1;
+
+uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+uint64_t HashText(uint64_t hash, std::string_view text) {
+    return Mix(hash, std::hash<std::string_view>()(text));
+}
+
+uint64_t HashMessage(const Message& message) {
+    uint64_t hash = HashText(0, message.content);
+    hash = Mix(hash, static_cast<uint64_t>(message.timeToRespond));
+    hash = Mix(hash, static_cast<uint64_t>(message.relationship));
+    hash = Mix(hash, static_cast<uint64_t>(message.ID));
+    for (auto& response : message.responce) {
+        hash = HashText(hash, response.reply);
+        hash = HashText(hash, response.content);
+        hash = Mix(hash, static_cast<uint64_t>(response.health));
+    }
+    return hash;
+}
+
+uint64_t HashKey(const std::string& from, int32_t id, int occurrence) {
+    uint64_t hash = HashText(0, from);
+    hash = Mix(hash, static_cast<uint64_t>(static_cast<uint32_t>(id)));
+    return Mix(hash, static_cast<uint64_t>(occurrence));
+}
+
+bool ReadFile(const std::string& path, std::string& buffer) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    buffer.assign(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    return static_cast<bool>(file.read(&buffer[0], static_cast<std::streamsize>(buffer.size())));
+}
+
+}
+
+ReloadWorker::~ReloadWorker() {
+    Stop();
+}
+
+void ReloadWorker::Start(const std::string& watched, const std::vector<Character>& loaded, std::unique_ptr<FileWatcher> fileWatcher) {
+    Stop();
+    path = watched;
+    watcher = fileWatcher ? std::move(fileWatcher) : CreateFileWatcher();
+    watcher->Watch(path);
+    //hashing what was loaded is far cheaper than parsing the file a second time; the contents
+    //hash stays unknown until the first reload
+    stamp = StampFile(path);
+    contentHash = 0;
+    names.clear();
+    baseline.clear();
+    Rebase(loaded, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        pending.clear();
+        status = ReloadStatus();
+    }
+    thread = std::thread(&ReloadWorker::Run, this);
+}
+
+void ReloadWorker::Stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    thread.join();
+}
+
+bool ReloadWorker::Take(std::vector<ReloadChanges>& batches) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.empty()) {
+        return false;
+    }
+    batches = std::move(pending);
+    pending.clear();
+    return true;
+}
+
+ReloadStatus ReloadWorker::Status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
+
+void ReloadWorker::SetOnReloaded(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onReloaded = std::move(callback);
+}
+
+void ReloadWorker::Run() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+        }
+        if (!watcher->WaitForChange(kWaitSeconds)) {
+            continue;
+        }
+        if (Reload()) {
+            std::function<void()> callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                callback = onReloaded;
+            }
+            if (callback) {
+                callback();
+            }
+        }
+    }
+}
+
+// Makes characters the baseline the next reload is diffed against; with changes set, also
+// records how they differ from the current one.
+void ReloadWorker::Rebase(const std::vector<Character>& characters, ReloadChanges* changes) {
+    std::unordered_map<uint64_t, Baseline> next;
+    next.reserve(baseline.size());
+    std::vector<std::string> nextNames;
+    std::unordered_map<int32_t, int> occurrences;
+    for (auto& character : characters) {
+        uint32_t name = static_cast<uint32_t>(nextNames.size());
+        nextNames.push_back(character.name);
+        occurrences.clear();
+        for (auto& message : character.messages) {
+            int occurrence = occurrences[message.ID]++;
+            uint64_t key = HashKey(character.name, message.ID, occurrence);
+            uint64_t messageHash = HashMessage(message);
+            next[key] = Baseline{ messageHash, name, message.ID, occurrence };
+
+            if (changes != nullptr) {
+                auto before = baseline.find(key);
+                if (before == baseline.end() || before->second.hash != messageHash) {
+                    changes->changed.push_back(ReloadedMessage{ ReloadKey{ character.name, message.ID, occurrence }, message });
+                }
+            }
+        }
+    }
+    if (changes != nullptr) {
+        for (auto& [key, entry] : baseline) {
+            if (next.find(key) == next.end()) {
+                changes->removed.push_back(ReloadKey{ names[entry.name], entry.id, entry.occurrence });
+            }
+        }
+    }
+    baseline = std::move(next);
+    names = std::move(nextNames);
+}
+
+// Reads and diffs the file if it really changed; true when there is a new batch or error to show.
+bool ReloadWorker::Reload() {
+    FileStamp current = StampFile(path);
+    if (current == stamp) {
+        std::lock_guard<std::mutex> lock(mutex);
+        status.skipped++;
+        return false;
+    }
+    stamp = current;
+
+    auto start = std::chrono::steady_clock::now();
+    std::string buffer;
+    if (!current.exists || !ReadFile(path, buffer)) {
+        //gone or mid-replace; the write that brings it back is another change
+        return false;
+    }
+    //touched or rewritten with the same bytes
+    uint64_t hash = std::hash<std::string_view>()(buffer);
+    if (hash == contentHash) {
+        std::lock_guard<std::mutex> lock(mutex);
+        status.skipped++;
+        return false;
+    }
+
+    std::vector<Character> characters;
+    LoadResult loaded = LoadCharacters(buffer.data(), buffer.data() + buffer.size(), characters);
+    if (!loaded.ok) {
+        //keep the last good baseline; a half-written file gets another go when the write finishes
+        std::lock_guard<std::mutex> lock(mutex);
+        status.error = loaded.error + " (line " + std::to_string(loaded.line) + ", column " + std::to_string(loaded.column) + ")";
+        return true;
+    }
+    contentHash = hash;
+
+    ReloadChanges changes;
+    Rebase(characters, &changes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    status.reloads++;
+    status.error.clear();
+    if (changes.changed.empty() && changes.removed.empty()) {
+        return false;
+    }
+    pending.push_back(std::move(changes));
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "FileWatcher.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Messages are matched across reloads by speaker and ID; occurrence tells apart the messages
+// one speaker has under the same ID, in file order.
+struct ReloadKey {
+    std::string from = "";
+    int32_t id = 0;
+    int occurrence = 0;
+};
+
+struct ReloadedMessage {
+    ReloadKey key;
+    Message message;
+};
+
+// What one reload found different from the previous one.
+struct ReloadChanges {
+    //new in the file, or with different content
+    std::vector<ReloadedMessage> changed;
+    //no longer in the file
+    std::vector<ReloadKey> removed;
+};
+
+struct ReloadStatus {
+    std::size_t reloads = 0;
+    //wake-ups where neither the stamp nor the contents had changed
+    std::size_t skipped = 0;
+    //read, parse and diff time of the last reload
+    double seconds = 0.0;
+    //the last parse error, empty after a good reload
+    std::string error = "";
+};
+
+// Watches a messages json and re-parses it on its own thread whenever it changes on disk, so
+// a file written by another tool shows up without restarting and without a frame hitch. Each
+// reload is diffed against the last good parse by per-message hashes, and only the messages
+// that differ are handed over; applying them is the editor's job.
+class ReloadWorker {
+public:
+    ReloadWorker() = default;
+    ~ReloadWorker();
+
+    ReloadWorker(const ReloadWorker&) = delete;
+    ReloadWorker& operator=(const ReloadWorker&) = delete;
+
+    // Watches path with watcher (CreateFileWatcher() when null); loaded is what the editor read
+    // from it, and the first reload is diffed against that.
+    void Start(const std::string& path, const std::vector<Character>& loaded, std::unique_ptr<FileWatcher> watcher = nullptr);
+    void Stop();
+    bool Running() const { return thread.joinable(); }
+
+    // Moves out the reloads not taken yet, oldest first. Returns false when there were none.
+    bool Take(std::vector<ReloadChanges>& batches);
+    ReloadStatus Status() const;
+    // Called on the reload thread after a reload that changed something.
+    void SetOnReloaded(std::function<void()> callback);
+
+private:
+    struct Baseline {
+        uint64_t hash;
+        uint32_t name;
+        int32_t id;
+        int occurrence;
+    };
+
+    void Run();
+    void Rebase(const std::vector<Character>& characters, ReloadChanges* changes);
+    bool Reload();
+
+    std::string path;
+    std::unique_ptr<FileWatcher> watcher;
+
+    //reload thread only
+    FileStamp stamp;
+    uint64_t contentHash = 0;
+    std::vector<std::string> names;
+    std::unordered_map<uint64_t, Baseline> baseline;
+
+    mutable std::mutex mutex;
+    bool stopping = false;
+    std::vector<ReloadChanges> pending;
+    ReloadStatus status;
+    std::function<void()> onReloaded;
+    std::thread thread;
+};
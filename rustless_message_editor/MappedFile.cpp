@@ -0,0 +1,139 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data = other.data;
+        size = other.size;
+        open = other.open;
+#ifdef _WIN32
+        file = other.file;
+        mapping = other.mapping;
+        other.file = nullptr;
+        other.mapping = nullptr;
+#endif
+        other.data = nullptr;
+        other.size = 0;
+        other.open = false;
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, std::string& error) {
+    Close();
+    HANDLE handle = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    LARGE_INTEGER length;
+    if (!::GetFileSizeEx(handle, &length)) {
+        ::CloseHandle(handle);
+        error = "could not read the size of " + path;
+        return false;
+    }
+
+    file = handle;
+    open = true;
+    size = static_cast<std::size_t>(length.QuadPart);
+    if (size == 0) {
+        return true;
+    }
+
+    mapping = ::CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+        data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data == nullptr) {
+        Close();
+        error = "could not map " + path;
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) {
+        ::UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr) {
+        ::CloseHandle(mapping);
+    }
+    if (file != nullptr) {
+        ::CloseHandle(file);
+    }
+    data = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+    size = 0;
+    open = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, std::string& error) {
+    Close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        error = "could not read the size of " + path;
+        return false;
+    }
+
+    size = static_cast<std::size_t>(info.st_size);
+    open = true;
+    if (size != 0) {
+        void* view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            ::close(fd);
+            size = 0;
+            open = false;
+            error = "could not map " + path;
+            return false;
+        }
+        data = static_cast<const char*>(view);
+    }
+    //the mapping keeps the file alive on its own
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data != nullptr) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    open = false;
+}
+
+#endif
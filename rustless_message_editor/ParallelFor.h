@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// How many threads ParallelFor runs count items on when asked for threads (0 = one per core).
+inline unsigned ParallelThreads(std::size_t count, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, count)));
+}
+
+// ParallelFor that also tells work which thread it is on: work(k, worker) with worker in
+// [0, ParallelThreads(count, threads)), so each thread can add into its own totals without locking
+// and they are summed once everything has run.
+template <typename Work>
+void ParallelForWorkers(std::size_t count, unsigned threads, Work&& work) {
+    threads = ParallelThreads(count, threads);
+
+    std::atomic<std::size_t> next{ 0 };
+    auto worker = [&](unsigned t) {
+        for (std::size_t k = next++; k < count; k = next++) {
+            work(k, t);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// Runs work(k) for every k in [0, count) on up to threads threads (0 = one per core), the calling
+// thread being one of them. Items are claimed one at a time from a shared cursor, so a thread that
+// finishes early takes the next unclaimed item instead of idling while another works through a
+// fixed share: uneven items balance out as long as the expensive ones come first.
+template <typename Work>
+void ParallelFor(std::size_t count, unsigned threads, Work&& work) {
+    ParallelForWorkers(count, threads, [&](std::size_t k, unsigned) { work(k); });
+}
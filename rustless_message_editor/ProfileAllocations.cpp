@@ -0,0 +1,32 @@
+// Replacement operator new that reports every allocation to the profiler, so its spans can show
+// how many were made inside them. Linked into the editor and the CLI; the bench has its own
+// operator new, which reports as well.
+
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifndef RUSTLESS_NO_PROFILING
+
+namespace {
+
+void* CountedAlloc(std::size_t size) {
+    ProfileAllocation();
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+#endif
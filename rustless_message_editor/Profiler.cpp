@@ -0,0 +1,191 @@
+#include "Profiler.h"
+
+#ifndef RUSTLESS_NO_PROFILING
+
+#include <json.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+std::atomic<bool> g_ProfilingEnabled{ false };
+thread_local uint64_t t_ProfileAllocations = 0;
+
+namespace {
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// ~24 MB of events, about an hour of idle-ish frames or a few thousand loads and saves
+constexpr std::size_t kMaxEvents = 1 << 19;
+
+struct ProfileEvent {
+    const char* name;
+    //nanoseconds since the profiler started
+    int64_t start;
+    //-1 for a counter sample
+    int64_t duration;
+    //bytes for a span, the running total for a counter
+    int64_t value;
+    uint64_t allocations;
+    uint32_t thread;
+};
+
+struct Profile {
+    std::mutex mutex;
+    std::vector<ProfileEvent> events;
+    std::size_t dropped = 0;
+    std::vector<ProfileSpanStats> spans;
+    std::vector<ProfileCounterStats> counters;
+};
+
+const Clock::time_point g_Epoch = Clock::now();
+std::atomic<uint32_t> g_NextThread{ 1 };
+thread_local uint32_t t_Thread = g_NextThread++;
+
+Profile& GetProfile() {
+    static Profile profile;
+    return profile;
+}
+
+int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_Epoch).count();
+}
+
+bool SameName(const char* a, const char* b) {
+    return a == b || std::strcmp(a, b) == 0;
+}
+
+template <typename Stats>
+Stats& FindStats(std::vector<Stats>& all, const char* name) {
+    for (auto& stats : all) {
+        if (SameName(stats.name, name)) {
+            return stats;
+        }
+    }
+    all.emplace_back();
+    all.back().name = name;
+    return all.back();
+}
+
+void Record(Profile& profile, const ProfileEvent& event) {
+    if (profile.events.size() < kMaxEvents) {
+        profile.events.push_back(event);
+    }
+    else {
+        profile.dropped++;
+    }
+}
+
+//"load/parse" goes in category "load"
+std::string Category(const char* name) {
+    const char* slash = std::strchr(name, '/');
+    return slash == nullptr ? std::string(name) : std::string(name, slash);
+}
+
+}
+
+void SetProfiling(bool enabled) {
+    g_ProfilingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void ProfileSpan::Begin() {
+    allocations = t_ProfileAllocations;
+    start = Now();
+}
+
+void ProfileSpan::End() {
+    int64_t duration = Now() - start;
+    uint64_t allocated = t_ProfileAllocations - allocations;
+    double seconds = static_cast<double>(duration) * 1e-9;
+
+    Profile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    Record(profile, ProfileEvent{ name, start, duration, static_cast<int64_t>(bytes), allocated, t_Thread });
+    ProfileSpanStats& stats = FindStats(profile.spans, name);
+    stats.calls++;
+    stats.totalSeconds += seconds;
+    stats.lastSeconds = seconds;
+    if (seconds > stats.maxSeconds) {
+        stats.maxSeconds = seconds;
+    }
+    stats.bytes += bytes;
+    stats.allocations += allocated;
+}
+
+void ProfileCountSlow(const char* name, int64_t value) {
+    int64_t now = Now();
+    Profile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    ProfileCounterStats& stats = FindStats(profile.counters, name);
+    stats.value += value;
+    Record(profile, ProfileEvent{ name, now, -1, stats.value, 0, t_Thread });
+}
+
+ProfileSnapshot TakeProfileSnapshot() {
+    Profile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    ProfileSnapshot snapshot;
+    snapshot.spans = profile.spans;
+    snapshot.counters = profile.counters;
+    snapshot.events = profile.events.size();
+    snapshot.droppedEvents = profile.dropped;
+    return snapshot;
+}
+
+void ResetProfile() {
+    Profile& profile = GetProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    profile.events.clear();
+    profile.events.shrink_to_fit();
+    profile.dropped = 0;
+    profile.spans.clear();
+    profile.counters.clear();
+}
+
+bool ExportProfileTrace(const std::string& path, std::string& error) {
+    std::vector<ProfileEvent> events;
+    {
+        Profile& profile = GetProfile();
+        std::lock_guard<std::mutex> lock(profile.mutex);
+        events = profile.events;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "could not open " + path + " for writing";
+        return false;
+    }
+    //one event per line, so a big capture never has to sit in memory as a json tree
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent& event = events[i];
+        json out;
+        out["name"] = event.name;
+        out["cat"] = Category(event.name);
+        out["pid"] = 1;
+        out["tid"] = event.thread;
+        //trace timestamps are in microseconds
+        out["ts"] = static_cast<double>(event.start) / 1000.0;
+        if (event.duration < 0) {
+            out["ph"] = "C";
+            out["args"] = { { "value", event.value } };
+        }
+        else {
+            out["ph"] = "X";
+            out["dur"] = static_cast<double>(event.duration) / 1000.0;
+            out["args"] = { { "bytes", event.value }, { "allocations", event.allocations } };
+        }
+        file << (i == 0 ? "\n" : ",\n") << out.dump();
+    }
+    file << "\n]}\n";
+    file.flush();
+    if (!file.good()) {
+        error = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timing spans and counters for load, save and the frame loop.
+//
+// A ProfileSpan times the scope it lives in and can carry the bytes it processed; spans nest, so
+// "save/serialize" includes the "save/write file" spans inside it. Allocations made on the span's
+// thread while it was open are counted too, when the program's operator new reports them through
+// ProfileAllocation() (ProfileAllocations.cpp does for the editor and the CLI).
+//
+// Profiling is off until SetProfiling(true); until then a span is one relaxed load. Building with
+// RUSTLESS_NO_PROFILING compiles all of it out, leaving empty inline stand-ins.
+
+struct ProfileSpanStats {
+    const char* name = "";
+    uint64_t calls = 0;
+    double totalSeconds = 0.0;
+    double maxSeconds = 0.0;
+    double lastSeconds = 0.0;
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+};
+
+struct ProfileCounterStats {
+    const char* name = "";
+    int64_t value = 0;
+};
+
+struct ProfileSnapshot {
+    // in the order each name was first seen
+    std::vector<ProfileSpanStats> spans;
+    std::vector<ProfileCounterStats> counters;
+    std::size_t events = 0;
+    // events not kept for the trace once it was full; the totals above still include them
+    std::size_t droppedEvents = 0;
+};
+
+#ifndef RUSTLESS_NO_PROFILING
+
+extern std::atomic<bool> g_ProfilingEnabled;
+extern thread_local uint64_t t_ProfileAllocations;
+
+inline bool ProfilingEnabled() { return g_ProfilingEnabled.load(std::memory_order_relaxed); }
+void SetProfiling(bool enabled);
+
+inline void ProfileAllocation() { t_ProfileAllocations++; }
+
+// Names must be string literals (or otherwise live forever): only the pointer is kept.
+class ProfileSpan {
+public:
+    explicit ProfileSpan(const char* name) : name(name) {
+        if (ProfilingEnabled()) {
+            Begin();
+        }
+    }
+    ~ProfileSpan() {
+        if (start >= 0) {
+            End();
+        }
+    }
+
+    ProfileSpan(const ProfileSpan&) = delete;
+    ProfileSpan& operator=(const ProfileSpan&) = delete;
+
+    void AddBytes(uint64_t count) { bytes += count; }
+
+private:
+    void Begin();
+    void End();
+
+    const char* name;
+    int64_t start = -1;
+    uint64_t bytes = 0;
+    //the thread's allocation count when the span began
+    uint64_t allocations = 0;
+};
+
+void ProfileCountSlow(const char* name, int64_t value);
+// Adds value to the named counter, e.g. lookups made during a load.
+inline void ProfileCount(const char* name, int64_t value) {
+    if (ProfilingEnabled()) {
+        ProfileCountSlow(name, value);
+    }
+}
+
+ProfileSnapshot TakeProfileSnapshot();
+// Forgets all events, spans and counters.
+void ResetProfile();
+// Writes the kept events as Chrome trace-event json, which chrome://tracing, Perfetto and
+// Speedscope open. Spans are complete ("X") events, counters are "C" events.
+bool ExportProfileTrace(const std::string& path, std::string& error);
+
+#else
+
+inline bool ProfilingEnabled() { return false; }
+inline void SetProfiling(bool) {}
+inline void ProfileAllocation() {}
+
+class ProfileSpan {
+public:
+    explicit ProfileSpan(const char*) {}
+    void AddBytes(uint64_t) {}
+};
+
+inline void ProfileCount(const char*, int64_t) {}
+
+inline ProfileSnapshot TakeProfileSnapshot() { return ProfileSnapshot(); }
+inline void ResetProfile() {}
+inline bool ExportProfileTrace(const std::string&, std::string& error) {
+    error = "profiling was compiled out (RUSTLESS_NO_PROFILING)";
+    return false;
+}
+
+#endif
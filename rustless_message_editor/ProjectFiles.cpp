@@ -0,0 +1,399 @@
+#include "ProjectFiles.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+
+#include <json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* kManifestName = "manifest.json";
+const int kManifestVersion = 1;
+
+std::string Lowercase(std::string text) {
+    for (auto& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// Shard names have to survive any file system, so only keep plain ASCII letters, digits, - and _.
+std::string ShardBaseName(const std::string& name) {
+    std::string base;
+    for (char c : name) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_') {
+            base += c;
+        }
+        else {
+            base += '_';
+        }
+        if (base.size() == 48) {
+            break;
+        }
+    }
+    return base.empty() ? "character" : base;
+}
+
+bool IsPlainFileName(const std::string& file) {
+    return !file.empty() && file.find_first_of("/\\:") == std::string::npos && file != "." && file != "..";
+}
+
+bool ReadManifest(const fs::path& path, std::vector<ShardEntry>& entries, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "could not open " + path.string();
+        return false;
+    }
+
+    json manifest = json::parse(file, nullptr, false);
+    if (manifest.is_discarded() || !manifest.is_object() || !manifest["characters"].is_array()) {
+        error = path.string() + " is not a valid manifest";
+        return false;
+    }
+
+    for (auto& character : manifest["characters"]) {
+        ShardEntry entry;
+        if (character["file"].is_string()) {
+            entry.file = character["file"];
+        }
+        if (character["name"].is_string()) {
+            entry.name = character["name"];
+        }
+        if (character["messages"].is_number_unsigned()) {
+            entry.messages = character["messages"];
+        }
+        if (!IsPlainFileName(entry.file)) {
+            error = path.string() + " has a bad shard file name \"" + entry.file + "\"";
+            return false;
+        }
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool WriteManifest(const fs::path& path, const std::vector<ShardEntry>& entries, std::string& error) {
+    json manifest;
+    manifest["version"] = kManifestVersion;
+    manifest["characters"] = json::array();
+    for (auto& entry : entries) {
+        json character;
+        character["name"] = entry.name;
+        character["file"] = entry.file;
+        character["messages"] = entry.messages;
+        manifest["characters"].push_back(character);
+    }
+
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            error = "Failed to open " + tempPath.string() + " for writing";
+            return false;
+        }
+        file << std::setw(4) << manifest << std::endl;
+        if (!file.good()) {
+            error = "Failed writing " + tempPath.string();
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        error = "Failed to replace " + path.string() + ": " + ec.message();
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+// The messages json files of a chapter project, in file name order.
+std::vector<fs::path> ChapterFiles(const std::string& directory) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        return files;
+    }
+    for (auto& entry : fs::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file(ec) && Lowercase(entry.path().extension().string()) == ".json") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const fs::path& a, const fs::path& b) {
+        return a.filename().string() < b.filename().string();
+    });
+    return files;
+}
+
+struct ParsedFile {
+    std::vector<Character> characters;
+    LoadResult result;
+};
+
+// Parses every file on its own, spread over the pool. The biggest files are handed out first so
+// the last one to start is a short one, not the file everybody else ends up waiting for.
+std::vector<ParsedFile> ParseFiles(const std::vector<fs::path>& paths, unsigned threads) {
+    std::vector<std::uintmax_t> sizes(paths.size(), 0);
+    for (std::size_t k = 0; k < paths.size(); k++) {
+        std::error_code ec;
+        sizes[k] = fs::file_size(paths[k], ec);
+        if (ec) {
+            sizes[k] = 0;
+        }
+    }
+    std::vector<std::size_t> order(paths.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return sizes[a] > sizes[b];
+    });
+
+    ProfileSpan span("load/files");
+    span.AddBytes(std::accumulate(sizes.begin(), sizes.end(), std::uintmax_t(0)));
+    std::vector<ParsedFile> parsed(paths.size());
+    ParallelFor(order.size(), threads, [&](std::size_t k) {
+        ParsedFile& file = parsed[order[k]];
+        file.result = LoadCharactersFromFile(paths[order[k]].string(), file.characters);
+    });
+    return parsed;
+}
+
+// Folds the files that failed into the overall result, which then reads like the first of them.
+void ReportFailures(LoadResult& result, std::vector<FileLoadError>& failures, std::vector<FileLoadError>* fileErrors) {
+    if (failures.empty()) {
+        return;
+    }
+    const FileLoadError& first = failures.front();
+    result.ok = false;
+    result.error = first.file + ": " + first.result.error;
+    result.line = first.result.line;
+    result.column = first.result.column;
+    if (failures.size() > 1) {
+        result.error += " (and " + std::to_string(failures.size() - 1) + " more files)";
+    }
+    if (fileErrors != nullptr) {
+        for (auto& failure : failures) {
+            fileErrors->push_back(std::move(failure));
+        }
+    }
+}
+
+}
+
+bool IsShardedProject(const std::string& path) {
+    std::error_code ec;
+    return fs::is_directory(path, ec) && fs::is_regular_file(fs::path(path) / kManifestName, ec);
+}
+
+bool IsChapterProject(const std::string& path) {
+    return !IsShardedProject(path) && !ChapterFiles(path).empty();
+}
+
+LoadResult LoadProject(const std::string& path, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors, unsigned threads) {
+    fs::path given(path);
+    if (given.filename() == kManifestName && IsShardedProject(given.parent_path().string())) {
+        return LoadShardedProject(given.parent_path().string(), characters, fileErrors, threads);
+    }
+    if (IsShardedProject(path)) {
+        return LoadShardedProject(path, characters, fileErrors, threads);
+    }
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+        return LoadChapterProject(path, characters, fileErrors, threads);
+    }
+    return LoadCharactersFromFile(path, characters);
+}
+
+LoadResult LoadShardedProject(const std::string& directory, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors, unsigned threads) {
+    LoadResult result;
+    std::vector<ShardEntry> entries;
+    if (!ReadManifest(fs::path(directory) / kManifestName, entries, result.error)) {
+        result.ok = false;
+        return result;
+    }
+
+    std::vector<fs::path> paths;
+    for (auto& entry : entries) {
+        paths.push_back(fs::path(directory) / entry.file);
+    }
+    std::vector<ParsedFile> parsed = ParseFiles(paths, threads);
+
+    std::vector<FileLoadError> failures;
+    characters.reserve(characters.size() + entries.size());
+    for (std::size_t k = 0; k < entries.size(); k++) {
+        //the manifest owns the name, so characters without messages survive the round trip; one
+        //whose shard failed is kept empty and marked, so a save neither removes nor overwrites the
+        //file nobody could read
+        Character character;
+        character.name = entries[k].name;
+        character.shard = entries[k].file;
+        if (!parsed[k].result.ok) {
+            character.loadError = parsed[k].result.error;
+            failures.push_back(FileLoadError{ entries[k].file, std::move(parsed[k].result) });
+        }
+        else {
+            result.bytesRead += parsed[k].result.bytesRead;
+            for (auto& part : parsed[k].characters) {
+                if (character.messages.empty()) {
+                    character.messages = std::move(part.messages);
+                    continue;
+                }
+                for (auto& message : part.messages) {
+                    character.messages.push_back(std::move(message));
+                }
+            }
+        }
+        characters.push_back(std::move(character));
+    }
+    ReportFailures(result, failures, fileErrors);
+    return result;
+}
+
+LoadResult LoadChapterProject(const std::string& directory, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors, unsigned threads) {
+    LoadResult result;
+    std::vector<fs::path> paths = ChapterFiles(directory);
+    if (paths.empty()) {
+        result.ok = false;
+        result.error = directory + " has no manifest and no .json files";
+        return result;
+    }
+    std::vector<ParsedFile> parsed = ParseFiles(paths, threads);
+
+    //merged by speaker in file order, exactly as loading the files one by one into characters would
+    std::unordered_map<std::string, std::size_t> byName;
+    for (std::size_t i = 0; i < characters.size(); i++) {
+        byName.emplace(characters[i].name, i);
+    }
+    std::vector<FileLoadError> failures;
+    for (std::size_t k = 0; k < paths.size(); k++) {
+        if (!parsed[k].result.ok) {
+            failures.push_back(FileLoadError{ paths[k].filename().string(), std::move(parsed[k].result) });
+            continue;
+        }
+        result.bytesRead += parsed[k].result.bytesRead;
+        for (auto& character : parsed[k].characters) {
+            auto found = byName.find(character.name);
+            if (found == byName.end()) {
+                byName.emplace(character.name, characters.size());
+                characters.push_back(std::move(character));
+                continue;
+            }
+            auto& messages = characters[found->second].messages;
+            messages.reserve(messages.size() + character.messages.size());
+            for (auto& message : character.messages) {
+                messages.push_back(std::move(message));
+            }
+        }
+    }
+    ReportFailures(result, failures, fileErrors);
+    return result;
+}
+
+ShardedSaveJob PrepareShardedSave(std::vector<Character>& characters) {
+    ShardedSaveJob job;
+
+    //keep the shard names characters already have, unless two of them collide
+    std::unordered_set<std::string> taken;
+    for (auto& character : characters) {
+        if (!character.shard.empty() && !taken.insert(Lowercase(character.shard)).second) {
+            character.shard.clear();
+        }
+    }
+
+    for (auto& character : characters) {
+        if (character.shard.empty()) {
+            std::string base = ShardBaseName(character.name);
+            std::string file = base + ".json";
+            for (int n = 2; !taken.insert(Lowercase(file)).second; n++) {
+                file = base + "_" + std::to_string(n) + ".json";
+            }
+            character.shard = file;
+            character.dirty = true;
+        }
+
+        ShardEntry entry;
+        entry.name = character.name;
+        entry.file = character.shard;
+        entry.messages = character.messages.size();
+        job.manifest.push_back(entry);
+
+        //a shard that failed to load holds messages the character hasn't got
+        if (character.dirty && character.loadError.empty()) {
+            job.changed.push_back(character);
+            character.dirty = false;
+            for (auto& message : character.messages) {
+                message.dirty = false;
+            }
+        }
+    }
+    return job;
+}
+
+SaveResult SaveShardedProject(const std::string& directory, const ShardedSaveJob& job, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten) {
+    SaveResult result;
+    fs::path root(directory);
+    std::error_code ec;
+    fs::create_directories(root, ec);
+    if (ec) {
+        result.ok = false;
+        result.error = "Failed to create " + directory + ": " + ec.message();
+        return result;
+    }
+
+    //shards the previous manifest listed; anything no longer used gets removed at the end
+    std::vector<ShardEntry> previous;
+    std::string ignored;
+    if (fs::exists(root / kManifestName, ec)) {
+        ReadManifest(root / kManifestName, previous, ignored);
+    }
+
+    for (auto& character : job.changed) {
+        SaveResult shard = SaveCharactersToFile((root / character.shard).string(), &character, 1, options, messagesWritten);
+        if (!shard.ok) {
+            return shard;
+        }
+        result.bytesWritten += shard.bytesWritten;
+    }
+
+    if (!WriteManifest(root / kManifestName, job.manifest, result.error)) {
+        result.ok = false;
+        return result;
+    }
+
+    std::unordered_set<std::string> used;
+    for (auto& entry : job.manifest) {
+        used.insert(Lowercase(entry.file));
+    }
+    for (auto& entry : previous) {
+        if (used.count(Lowercase(entry.file)) == 0) {
+            fs::remove(root / entry.file, ec);
+        }
+    }
+    return result;
+}
+
+void ClearDirty(std::vector<Character>& characters) {
+    for (auto& character : characters) {
+        character.dirty = false;
+        for (auto& message : character.messages) {
+            message.dirty = false;
+        }
+    }
+}
+
+void MarkAllDirty(std::vector<Character>& characters) {
+    for (auto& character : characters) {
+        character.dirty = true;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueLoader.h"
+#include "DialogueWriter.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// A sharded project is a directory holding manifest.json plus one messages json per character:
+//
+//   {
+//       "characters": [ { "file": "King.json", "messages": 7, "name": "King" }, ... ],
+//       "version": 1
+//   }
+//
+// Each shard has the same layout as the single messages.json, so either can be loaded
+// with the same reader and a save only has to rewrite the characters that changed.
+//
+// A directory without a manifest is a chapter project: every *.json in it is a messages json
+// with any mix of speakers, merged by speaker in file name order.
+
+struct ShardEntry {
+    std::string name = "";
+    std::string file = "";
+    std::size_t messages = 0;
+};
+
+struct ShardedSaveJob {
+    // every character, in order, for the manifest
+    std::vector<ShardEntry> manifest;
+    // copies of the characters whose shard has to be rewritten
+    std::vector<Character> changed;
+};
+
+// A file of a multi-file load that could not be read; the others still load.
+struct FileLoadError {
+    std::string file = "";
+    LoadResult result;
+};
+
+bool IsShardedProject(const std::string& path);
+bool IsChapterProject(const std::string& path);
+
+// Loads a legacy single messages json, a sharded project (its directory or its manifest.json)
+// or a chapter directory. The files of a project are parsed on up to threads threads (0 = one
+// per core); the result is the same as loading them one after another. A file that fails is
+// listed in fileErrors and the result is not ok, but everything else is still loaded.
+LoadResult LoadProject(const std::string& path, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors = nullptr, unsigned threads = 0);
+LoadResult LoadShardedProject(const std::string& directory, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors = nullptr, unsigned threads = 0);
+LoadResult LoadChapterProject(const std::string& directory, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors = nullptr, unsigned threads = 0);
+
+// Gives every character a shard file name, copies out the dirty ones and clears their dirty flags.
+// Characters whose shard failed to load (see Character::loadError) are never copied out.
+ShardedSaveJob PrepareShardedSave(std::vector<Character>& characters);
+
+// Rewrites the changed shards, then the manifest, then removes shards no character uses any more.
+SaveResult SaveShardedProject(const std::string& directory, const ShardedSaveJob& job, const WriteOptions& options, std::atomic<std::size_t>* messagesWritten = nullptr);
+
+void ClearDirty(std::vector<Character>& characters);
+void MarkAllDirty(std::vector<Character>& characters);
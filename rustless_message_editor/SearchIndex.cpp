@@ -0,0 +1,645 @@
+#include "SearchIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+const SearchField kFields[] = { SearchField::Content, SearchField::Reply1, SearchField::Content1, SearchField::Reply2, SearchField::Content2 };
+
+uint32_t FoldCodepoint(uint32_t cp) {
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;
+    if (cp >= 0x100 && cp <= 0x137 && cp != 0x130) return cp | 1;
+    if (cp >= 0x139 && cp <= 0x148 && (cp & 1) == 1) return cp + 1;
+    if (cp >= 0x14A && cp <= 0x177) return cp | 1;
+    if (cp == 0x178) return 0xFF;
+    if (cp >= 0x179 && cp <= 0x17E && (cp & 1) == 1) return cp + 1;
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) return cp + 0x20;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    return cp;
+}
+
+void AppendFolded(std::string& out, std::string_view text) {
+    std::size_t start = out.size();
+    out.append(text.data(), text.size());
+    char* bytes = &out[start];
+    std::size_t size = text.size();
+    for (std::size_t i = 0; i < size; i++) {
+        unsigned char c = static_cast<unsigned char>(bytes[i]);
+        if (c < 0x80) {
+            if (c >= 'A' && c <= 'Z') {
+                bytes[i] = static_cast<char>(c + ('a' - 'A'));
+            }
+        }
+        else if (c >= 0xC2 && c <= 0xDF && i + 1 < size && (static_cast<unsigned char>(bytes[i + 1]) & 0xC0) == 0x80) {
+            //every mapping above stays a two byte sequence, so rewrite it in place
+            uint32_t cp = FoldCodepoint(((c & 0x1Fu) << 6) | (static_cast<unsigned char>(bytes[i + 1]) & 0x3Fu));
+            bytes[i] = static_cast<char>(0xC0 | (cp >> 6));
+            bytes[i + 1] = static_cast<char>(0x80 | (cp & 0x3F));
+            i++;
+        }
+    }
+}
+
+// Every trigram of a document, repeats included. The document is read as if framed by '\0', so
+// a field's first and last two bytes get a gram too (with '\0' on the outside); grams with '\0'
+// in the middle belong to no field and are skipped.
+template <typename Visit>
+void ForEachDocumentTrigram(std::string_view text, Visit&& visit) {
+    uint32_t gram = 0;
+    for (char c : text) {
+        gram = ((gram << 8) | static_cast<unsigned char>(c)) & 0xFFFFFF;
+        if ((gram & 0xFF00) != 0) {
+            visit(gram);
+        }
+    }
+    gram = (gram << 8) & 0xFFFFFF;
+    if ((gram & 0xFF00) != 0) {
+        visit(gram);
+    }
+}
+
+// sorted and unique
+void CollectDocumentTrigrams(std::string_view text, std::vector<uint32_t>& trigrams) {
+    trigrams.clear();
+    ForEachDocumentTrigram(text, [&](uint32_t trigram) { trigrams.push_back(trigram); });
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+// sorted and unique; a query never holds '\0', so these are plain grams
+void CollectQueryTrigrams(std::string_view query, std::vector<uint32_t>& trigrams) {
+    trigrams.clear();
+    for (std::size_t i = 0; i + 3 <= query.size(); i++) {
+        trigrams.push_back((uint32_t(static_cast<unsigned char>(query[i])) << 16) |
+            (uint32_t(static_cast<unsigned char>(query[i + 1])) << 8) | static_cast<unsigned char>(query[i + 2]));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+// Adds the grams centred on text[first, last), the only ones that can differ from another text
+// sharing everything before first - 1 and after last.
+void AddCentredTrigrams(std::string_view text, std::size_t first, std::size_t last, std::vector<uint32_t>& trigrams) {
+    for (std::size_t k = first; k < last; k++) {
+        if (text[k] == '\0') {
+            continue;
+        }
+        uint32_t before = k > 0 ? static_cast<unsigned char>(text[k - 1]) : 0;
+        uint32_t after = k + 1 < text.size() ? static_cast<unsigned char>(text[k + 1]) : 0;
+        trigrams.push_back((before << 16) | (uint32_t(static_cast<unsigned char>(text[k])) << 8) | after);
+    }
+}
+
+// Drops from candidates (sorted) every gram that text has somewhere.
+void DropPresent(std::string_view text, std::vector<uint32_t>& candidates) {
+    if (candidates.empty()) {
+        return;
+    }
+    //a bit per hashed candidate turns most of the text's grams away before any search
+    uint64_t maybe[4] = {};
+    for (uint32_t candidate : candidates) {
+        uint32_t bit = (candidate * 2654435761u) >> 24;
+        maybe[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+    //the candidates found are marked in their top bit, which no gram uses
+    ForEachDocumentTrigram(text, [&](uint32_t trigram) {
+        uint32_t bit = (trigram * 2654435761u) >> 24;
+        if ((maybe[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0) {
+            return;
+        }
+        auto at = std::lower_bound(candidates.begin(), candidates.end(), trigram, [](uint32_t candidate, uint32_t gram) { return (candidate & 0xFFFFFF) < gram; });
+        if (at != candidates.end() && (*at & 0xFFFFFF) == trigram) {
+            *at |= 0x80000000u;
+        }
+    });
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](uint32_t candidate) { return (candidate & 0x80000000u) != 0; }), candidates.end());
+}
+
+// The trigrams only before has (gone) and only after has (came), for two documents with the
+// same fields. Fields that didn't change are skipped, and in one that did, grams made of bytes
+// both sides share at the field's start or end are the same, so only the ones around the bytes
+// in between are candidates; a candidate only counts if the other document has it nowhere.
+// removed and added are scratch space.
+void DiffTrigrams(std::string_view before, std::string_view after, std::vector<uint32_t>& gone, std::vector<uint32_t>& came,
+    std::vector<uint32_t>& removed, std::vector<uint32_t>& added) {
+    gone.clear();
+    came.clear();
+    removed.clear();
+    added.clear();
+    std::size_t beforeStart = 0;
+    std::size_t afterStart = 0;
+    while (beforeStart <= before.size() && afterStart <= after.size()) {
+        std::size_t beforeEnd = std::min(before.find('\0', beforeStart), before.size());
+        std::size_t afterEnd = std::min(after.find('\0', afterStart), after.size());
+        std::string_view oldField = before.substr(beforeStart, beforeEnd - beforeStart);
+        std::string_view newField = after.substr(afterStart, afterEnd - afterStart);
+        if (oldField != newField) {
+            std::size_t limit = std::min(oldField.size(), newField.size());
+            std::size_t prefix = 0;
+            while (prefix < limit && oldField[prefix] == newField[prefix]) {
+                prefix++;
+            }
+            std::size_t suffix = 0;
+            while (suffix < limit - prefix && oldField[oldField.size() - 1 - suffix] == newField[newField.size() - 1 - suffix]) {
+                suffix++;
+            }
+            std::size_t first = prefix > 0 ? prefix - 1 : 0;
+            AddCentredTrigrams(before, beforeStart + first, beforeStart + std::min(oldField.size(), oldField.size() - suffix + 1), removed);
+            AddCentredTrigrams(after, afterStart + first, afterStart + std::min(newField.size(), newField.size() - suffix + 1), added);
+        }
+        beforeStart = beforeEnd + 1;
+        afterStart = afterEnd + 1;
+    }
+    if (removed.empty() && added.empty()) {
+        return;
+    }
+    std::sort(removed.begin(), removed.end());
+    removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end()), added.end());
+    std::set_difference(removed.begin(), removed.end(), added.begin(), added.end(), std::back_inserter(gone));
+    std::set_difference(added.begin(), added.end(), removed.begin(), removed.end(), std::back_inserter(came));
+    DropPresent(after, gone);
+    DropPresent(before, came);
+}
+
+bool IsWordByte(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 0x80 || u == '_' || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z');
+}
+
+}
+
+std::string FoldCase(std::string_view text) {
+    std::string folded;
+    AppendFolded(folded, text);
+    return folded;
+}
+
+std::string_view SearchFieldText(const Message& message, SearchField field) {
+    switch (field) {
+    case SearchField::Reply1: return message.responce[0].reply;
+    case SearchField::Content1: return message.responce[0].content;
+    case SearchField::Reply2: return message.responce[1].reply;
+    case SearchField::Content2: return message.responce[1].content;
+    default: return message.content;
+    }
+}
+
+const char* SearchFieldName(SearchField field) {
+    switch (field) {
+    case SearchField::Reply1: return "reply 1";
+    case SearchField::Content1: return "Content 1";
+    case SearchField::Reply2: return "reply 2";
+    case SearchField::Content2: return "Content 2";
+    default: return "Content";
+    }
+}
+
+void SearchIndex::Rebuild(const std::vector<Character>& characters) {
+    arena.clear();
+    liveBytes = 0;
+    spans.clear();
+    documents.clear();
+    freeDocuments.clear();
+    documentOf.assign(characters.size(), {});
+    blockOf.clear();
+    slots.clear();
+    lists.clear();
+
+    std::size_t total = 0;
+    for (auto& character : characters) {
+        total += character.messages.size();
+    }
+    documents.reserve(total);
+    spans.reserve(total);
+
+    for (int i = 0; i < static_cast<int>(characters.size()); i++) {
+        const auto& messages = characters[i].messages;
+        documentOf[i].reserve(messages.size());
+        for (int j = 0; j < static_cast<int>(messages.size()); j++) {
+            uint32_t document = NewDocument(i, j);
+            documentOf[i].push_back(document);
+            WriteDocument(document, messages[j]);
+            AddTrigrams(document);
+        }
+    }
+    version++;
+}
+
+SearchResults SearchIndex::Find(const std::string& query, const SearchOptions& options) const {
+    SearchResults results;
+    std::string folded = FoldCase(query);
+    if (folded.empty() || options.maxHits == 0) {
+        return results;
+    }
+
+    if (folded.size() >= 3) {
+        std::vector<uint32_t> trigrams;
+        CollectQueryTrigrams(folded, trigrams);
+        std::vector<const std::vector<uint32_t>*> candidates;
+        for (uint32_t trigram : trigrams) {
+            const std::vector<uint32_t>* list = Postings(trigram);
+            if (list == nullptr || list->empty()) {
+                return results;
+            }
+            candidates.push_back(list);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+            return a->size() < b->size();
+        });
+
+        //walk the rarest trigram's documents and keep those every other list also has
+        for (uint32_t document : *candidates[0]) {
+            bool everywhere = true;
+            for (std::size_t k = 1; k < candidates.size() && everywhere; k++) {
+                everywhere = std::binary_search(candidates[k]->begin(), candidates[k]->end(), document);
+            }
+            if (everywhere && !MatchDocument(document, folded, options, results)) {
+                break;
+            }
+        }
+    }
+    else if (folded.size() == 2) {
+        //every "xy" is followed by a byte or by the '\0' that ends its field, so the documents
+        //holding it are the union of the 256 lists of trigrams "xy?"
+        uint32_t prefix = (uint32_t(static_cast<unsigned char>(folded[0])) << 16) | (uint32_t(static_cast<unsigned char>(folded[1])) << 8);
+        std::vector<const std::vector<uint32_t>*> candidates;
+        std::size_t total = 0;
+        for (uint32_t last = 0; last < 256; last++) {
+            const std::vector<uint32_t>* list = Postings(prefix | last);
+            if (list != nullptr && !list->empty()) {
+                candidates.push_back(list);
+                total += list->size();
+            }
+        }
+        if (total > documents.size()) {
+            //common pair: hits are everywhere and the scan finds maxHits of them soonest
+            ScanArena(folded, options, results);
+        }
+        else {
+            std::vector<uint64_t> marked((documents.size() + 63) / 64, 0);
+            for (auto* list : candidates) {
+                for (uint32_t document : *list) {
+                    marked[document / 64] |= uint64_t(1) << (document % 64);
+                }
+            }
+            bool more = true;
+            for (std::size_t word = 0; word < marked.size() && more; word++) {
+                for (uint64_t bits = marked[word]; bits != 0 && more; bits &= bits - 1) {
+                    int bit = 0;
+                    while ((bits & (uint64_t(1) << bit)) == 0) {
+                        bit++;
+                    }
+                    more = MatchDocument(static_cast<uint32_t>(word * 64 + bit), folded, options, results);
+                }
+            }
+        }
+    }
+    else {
+        ScanArena(folded, options, results);
+    }
+
+    std::sort(results.hits.begin(), results.hits.end(), [](const SearchHit& a, const SearchHit& b) {
+        if (a.character != b.character) return a.character < b.character;
+        if (a.message != b.message) return a.message < b.message;
+        return a.field < b.field;
+    });
+    return results;
+}
+
+void SearchIndex::OnMessageChanged(const std::vector<Character>& characters, int character, int message) {
+    uint32_t document = documentOf[character][message];
+    Document& entry = documents[document];
+
+    std::vector<uint32_t> before;
+    CollectDocumentTrigrams(std::string_view(arena).substr(entry.offset, entry.length), before);
+    liveBytes -= entry.length + 1;
+    WriteDocument(document, characters[character].messages[message]);
+    std::vector<uint32_t> after;
+    CollectDocumentTrigrams(std::string_view(arena).substr(entry.offset, entry.length), after);
+
+    //a keystroke only moves a handful of trigrams, so only those posting lists are touched
+    std::vector<uint32_t> changed;
+    std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(changed));
+    for (uint32_t trigram : changed) {
+        auto& list = PostingsFor(trigram);
+        list.erase(std::lower_bound(list.begin(), list.end(), document));
+    }
+    changed.clear();
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(changed));
+    for (uint32_t trigram : changed) {
+        auto& list = PostingsFor(trigram);
+        list.insert(std::lower_bound(list.begin(), list.end(), document), document);
+    }
+
+    CompactIfWasteful();
+    version++;
+}
+
+void SearchIndex::OnMessagesChanged(const std::vector<Character>& characters, const std::vector<std::pair<int, int>>& messages) {
+    //documents in ascending order, so every posting list's changes come out sorted too
+    std::vector<uint32_t> changed;
+    changed.reserve(messages.size());
+    for (auto& message : messages) {
+        changed.push_back(documentOf[message.first][message.second]);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    //(posting list, document), the top bit set when the document leaves the list
+    const uint32_t kGone = 0x80000000u;
+    std::vector<std::pair<uint32_t, uint32_t>> moves;
+    std::vector<uint32_t> gone;
+    std::vector<uint32_t> came;
+    std::vector<uint32_t> removed;
+    std::vector<uint32_t> added;
+    for (uint32_t document : changed) {
+        Document& entry = documents[document];
+        std::size_t oldOffset = entry.offset;
+        std::size_t oldLength = entry.length;
+        liveBytes -= entry.length + 1;
+        WriteDocument(document, characters[entry.character].messages[entry.message]);
+        DiffTrigrams(std::string_view(arena).substr(oldOffset, oldLength), std::string_view(arena).substr(entry.offset, entry.length), gone, came, removed, added);
+        for (uint32_t trigram : gone) {
+            moves.emplace_back(ListFor(trigram), document | kGone);
+        }
+        for (uint32_t trigram : came) {
+            moves.emplace_back(ListFor(trigram), document);
+        }
+    }
+
+    //grouped by list, keeping each list's moves in document order
+    std::vector<uint32_t> start(lists.size() + 1, 0);
+    for (auto& move : moves) {
+        start[move.first + 1]++;
+    }
+    for (std::size_t list = 0; list < lists.size(); list++) {
+        start[list + 1] += start[list];
+    }
+    std::vector<uint32_t> grouped(moves.size());
+    std::vector<uint32_t> next(start.begin(), start.end() - 1);
+    for (auto& move : moves) {
+        grouped[next[move.first]++] = move.second;
+    }
+
+    std::vector<uint32_t> merged;
+    for (std::size_t l = 0; l < lists.size(); l++) {
+        if (start[l] == start[l + 1]) {
+            continue;
+        }
+        std::vector<uint32_t>& list = lists[l];
+        merged.clear();
+        merged.reserve(list.size() + (start[l + 1] - start[l]));
+        std::size_t at = 0;
+        for (uint32_t k = start[l]; k < start[l + 1]; k++) {
+            uint32_t document = grouped[k] & ~kGone;
+            while (at < list.size() && list[at] < document) {
+                merged.push_back(list[at++]);
+            }
+            bool listed = at < list.size() && list[at] == document;
+            if ((grouped[k] & kGone) != 0) {
+                at += listed ? 1 : 0;
+            }
+            else if (!listed) {
+                merged.push_back(document);
+            }
+        }
+        merged.insert(merged.end(), list.begin() + at, list.end());
+        list.swap(merged);
+    }
+
+    CompactIfWasteful();
+    version++;
+}
+
+void SearchIndex::OnMessageAdded(const std::vector<Character>& characters, int character, int message) {
+    auto& messages = documentOf[character];
+    for (std::size_t k = message; k < messages.size(); k++) {
+        documents[messages[k]].message++;
+    }
+    uint32_t document = NewDocument(character, message);
+    messages.insert(messages.begin() + message, document);
+    WriteDocument(document, characters[character].messages[message]);
+    AddTrigrams(document);
+    version++;
+}
+
+void SearchIndex::OnMessageDeleted(int character, int message) {
+    auto& messages = documentOf[character];
+    FreeDocument(messages[message]);
+    messages.erase(messages.begin() + message);
+    for (std::size_t k = message; k < messages.size(); k++) {
+        documents[messages[k]].message--;
+    }
+    CompactIfWasteful();
+    version++;
+}
+
+void SearchIndex::OnCharacterAdded(const std::vector<Character>& characters, int character) {
+    documentOf.insert(documentOf.begin() + character, std::vector<uint32_t>());
+    for (std::size_t c = character + 1; c < documentOf.size(); c++) {
+        for (uint32_t document : documentOf[c]) {
+            documents[document].character++;
+        }
+    }
+    const auto& messages = characters[character].messages;
+    for (int j = 0; j < static_cast<int>(messages.size()); j++) {
+        uint32_t document = NewDocument(character, j);
+        documentOf[character].push_back(document);
+        WriteDocument(document, messages[j]);
+        AddTrigrams(document);
+    }
+    version++;
+}
+
+void SearchIndex::OnCharacterDeleted(int character) {
+    for (uint32_t document : documentOf[character]) {
+        FreeDocument(document);
+    }
+    documentOf.erase(documentOf.begin() + character);
+    for (std::size_t c = character; c < documentOf.size(); c++) {
+        for (uint32_t document : documentOf[c]) {
+            documents[document].character--;
+        }
+    }
+    CompactIfWasteful();
+    version++;
+}
+
+uint32_t SearchIndex::NewDocument(int character, int message) {
+    uint32_t document;
+    if (!freeDocuments.empty()) {
+        document = freeDocuments.back();
+        freeDocuments.pop_back();
+    }
+    else {
+        document = static_cast<uint32_t>(documents.size());
+        documents.emplace_back();
+    }
+    documents[document].character = character;
+    documents[document].message = message;
+    return document;
+}
+
+void SearchIndex::WriteDocument(uint32_t document, const Message& message) {
+    //always appended; the old copy, if any, becomes waste until the next compaction
+    Document& entry = documents[document];
+    entry.offset = arena.size();
+    for (SearchField field : kFields) {
+        if (field != SearchField::Content) {
+            arena += '\0';
+        }
+        AppendFolded(arena, SearchFieldText(message, field));
+    }
+    entry.length = arena.size() - entry.offset;
+    arena += '\0';
+    liveBytes += entry.length + 1;
+    spans.push_back(Span{ entry.offset, document });
+}
+
+void SearchIndex::FreeDocument(uint32_t document) {
+    RemoveTrigrams(document);
+    liveBytes -= documents[document].length + 1;
+    documents[document] = Document();
+    freeDocuments.push_back(document);
+}
+
+void SearchIndex::AddTrigrams(uint32_t document) {
+    const Document& entry = documents[document];
+    //no sort needed: a repeat of a gram within this document finds itself already in the list
+    ForEachDocumentTrigram(std::string_view(arena).substr(entry.offset, entry.length), [&](uint32_t trigram) {
+        auto& list = PostingsFor(trigram);
+        if (list.empty() || list.back() < document) {
+            list.push_back(document);
+        }
+        else if (list.back() != document) {
+            auto at = std::lower_bound(list.begin(), list.end(), document);
+            if (*at != document) {
+                list.insert(at, document);
+            }
+        }
+    });
+}
+
+void SearchIndex::RemoveTrigrams(uint32_t document) {
+    const Document& entry = documents[document];
+    std::vector<uint32_t> trigrams;
+    CollectDocumentTrigrams(std::string_view(arena).substr(entry.offset, entry.length), trigrams);
+    for (uint32_t trigram : trigrams) {
+        auto& list = PostingsFor(trigram);
+        list.erase(std::lower_bound(list.begin(), list.end(), document));
+    }
+}
+
+const std::vector<uint32_t>* SearchIndex::Postings(uint32_t trigram) const {
+    if (blockOf.empty() || blockOf[trigram >> 8] == 0) {
+        return nullptr;
+    }
+    uint32_t list = slots[(blockOf[trigram >> 8] - 1) * 256 + (trigram & 0xFF)];
+    return list == 0 ? nullptr : &lists[list - 1];
+}
+
+std::vector<uint32_t>& SearchIndex::PostingsFor(uint32_t trigram) {
+    return lists[ListFor(trigram)];
+}
+
+uint32_t SearchIndex::ListFor(uint32_t trigram) {
+    if (blockOf.empty()) {
+        blockOf.assign(1 << 16, 0);
+    }
+    if (blockOf[trigram >> 8] == 0) {
+        slots.resize(slots.size() + 256, 0);
+        blockOf[trigram >> 8] = static_cast<uint32_t>(slots.size() / 256);
+    }
+    uint32_t& list = slots[(blockOf[trigram >> 8] - 1) * 256 + (trigram & 0xFF)];
+    if (list == 0) {
+        lists.emplace_back();
+        list = static_cast<uint32_t>(lists.size());
+    }
+    return list - 1;
+}
+
+void SearchIndex::CompactIfWasteful() {
+    if (arena.size() < (1u << 20) || arena.size() < liveBytes * 2) {
+        return;
+    }
+    std::string compacted;
+    compacted.reserve(liveBytes);
+    spans.clear();
+    for (auto& messages : documentOf) {
+        for (uint32_t document : messages) {
+            Document& entry = documents[document];
+            std::size_t offset = compacted.size();
+            compacted.append(arena, entry.offset, entry.length + 1);
+            entry.offset = offset;
+            spans.push_back(Span{ offset, document });
+        }
+    }
+    arena.swap(compacted);
+}
+
+void SearchIndex::ScanArena(std::string_view query, const SearchOptions& options, SearchResults& results) const {
+    //memchr gets through the arena at memory speed
+    const char* begin = arena.data();
+    const char* end = begin + arena.size();
+    const char* at = begin;
+    std::size_t span = 0;
+    while (at + query.size() <= end) {
+        at = static_cast<const char*>(std::memchr(at, query[0], static_cast<std::size_t>(end - at)));
+        if (at == nullptr || at + query.size() > end) {
+            break;
+        }
+        if (std::memcmp(at, query.data(), query.size()) != 0) {
+            at++;
+            continue;
+        }
+
+        std::size_t offset = static_cast<std::size_t>(at - begin);
+        while (span + 1 < spans.size() && spans[span + 1].offset <= offset) {
+            span++;
+        }
+        const Document& document = documents[spans[span].document];
+        if (document.character != -1 && document.offset == spans[span].offset) {
+            if (!MatchDocument(spans[span].document, query, options, results)) {
+                break;
+            }
+        }
+        //one visit per document; stale spans are skipped the same way
+        at = span + 1 < spans.size() ? begin + spans[span + 1].offset : end;
+    }
+}
+
+bool SearchIndex::MatchDocument(uint32_t document, std::string_view query, const SearchOptions& options, SearchResults& results) const {
+    const Document& entry = documents[document];
+    std::string_view text = std::string_view(arena).substr(entry.offset, entry.length);
+
+    std::size_t fieldStart = 0;
+    for (SearchField field : kFields) {
+        std::size_t fieldEnd = text.find('\0', fieldStart);
+        if (fieldEnd == std::string_view::npos) {
+            fieldEnd = text.size();
+        }
+        std::string_view fieldText = text.substr(fieldStart, fieldEnd - fieldStart);
+
+        for (std::size_t at = fieldText.find(query); at != std::string_view::npos; at = fieldText.find(query, at + 1)) {
+            if (options.wholeWord) {
+                std::size_t after = at + query.size();
+                if ((at != 0 && IsWordByte(fieldText[at - 1])) || (after < fieldText.size() && IsWordByte(fieldText[after]))) {
+                    continue;
+                }
+            }
+            if (results.hits.size() == options.maxHits) {
+                results.truncated = true;
+                return false;
+            }
+            results.hits.push_back(SearchHit{ entry.character, entry.message, field, at });
+            break;
+        }
+        fieldStart = fieldEnd + 1;
+    }
+    return true;
+}
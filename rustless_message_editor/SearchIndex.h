@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class SearchField {
+    Content,
+    Reply1,
+    Content1,
+    Reply2,
+    Content2
+};
+
+struct SearchHit {
+    int character = -1;
+    int message = -1;
+    SearchField field = SearchField::Content;
+    // byte offset of the match in that field's text
+    std::size_t offset = 0;
+};
+
+struct SearchOptions {
+    bool wholeWord = false;
+    // the search stops once it has this many hits
+    std::size_t maxHits = 1000;
+};
+
+struct SearchResults {
+    std::vector<SearchHit> hits;
+    // maxHits was reached, there may be more
+    bool truncated = false;
+};
+
+// Case-insensitive substring search over every message's content and both responses.
+//
+// Each message is one document: its five texts case folded and joined with '\0'. A trigram
+// index maps every three bytes of a document (counting the '\0' at either end of a field) to
+// the sorted list of documents holding them. Queries of three or more bytes only look at the
+// documents that have all of the query's trigrams, two byte queries at those with a trigram
+// starting or ending with both bytes. The folded documents also live back to back in one arena,
+// so a single byte, or two common ones, is answered by a memchr driven scan over it instead
+// (memchr is vectorized by the C runtime) which reaches maxHits almost at once.
+//
+// Folding maps ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic capitals to lower case and
+// never changes a character's UTF-8 length, so offsets in the folded text are offsets in the
+// original too.
+//
+// Like DialogueIndex, the editor keeps it in step with the vector through the On* calls.
+class SearchIndex {
+public:
+    void Rebuild(const std::vector<Character>& characters);
+
+    SearchResults Find(const std::string& query, const SearchOptions& options) const;
+
+    // Call after any of the message's texts changed.
+    void OnMessageChanged(const std::vector<Character>& characters, int character, int message);
+    // The same for many messages at once, given as (character, message) pairs, e.g. after a batch
+    // edit. Only the trigrams around the bytes that differ are looked at, and each posting list
+    // they touch is merged with its changes in one pass, instead of an insert or erase per message.
+    void OnMessagesChanged(const std::vector<Character>& characters, const std::vector<std::pair<int, int>>& messages);
+    void OnMessageAdded(const std::vector<Character>& characters, int character, int message);
+    // Call after the message has been erased from the vector.
+    void OnMessageDeleted(int character, int message);
+    void OnCharacterAdded(const std::vector<Character>& characters, int character);
+    // Call after the character has been erased from the vector.
+    void OnCharacterDeleted(int character);
+
+    // Bumped by every change, so a cached result can tell it is stale.
+    uint64_t Version() const { return version; }
+
+private:
+    struct Document {
+        int character = -1;
+        int message = -1;
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    // where an arena range came from; stale once the document has been rewritten elsewhere
+    struct Span {
+        std::size_t offset;
+        uint32_t document;
+    };
+
+    uint32_t NewDocument(int character, int message);
+    void WriteDocument(uint32_t document, const Message& message);
+    void FreeDocument(uint32_t document);
+    void AddTrigrams(uint32_t document);
+    void RemoveTrigrams(uint32_t document);
+    const std::vector<uint32_t>* Postings(uint32_t trigram) const;
+    std::vector<uint32_t>& PostingsFor(uint32_t trigram);
+    // index in lists of the trigram's posting list, made empty if it has none yet
+    uint32_t ListFor(uint32_t trigram);
+    void CompactIfWasteful();
+    void ScanArena(std::string_view query, const SearchOptions& options, SearchResults& results) const;
+    bool MatchDocument(uint32_t document, std::string_view query, const SearchOptions& options, SearchResults& results) const;
+
+    std::string arena;
+    std::size_t liveBytes = 0;
+    std::vector<Span> spans;
+    std::vector<Document> documents;
+    std::vector<uint32_t> freeDocuments;
+    // character -> message -> document
+    std::vector<std::vector<uint32_t>> documentOf;
+    // trigram -> posting list, as a two level table: the first two bytes pick a block of 256
+    // slots in slots, the third byte the slot, which holds the list's index + 1 (0 = none yet)
+    std::vector<uint32_t> blockOf;
+    std::vector<uint32_t> slots;
+    std::vector<std::vector<uint32_t>> lists;
+    uint64_t version = 0;
+};
+
+// Lower cases text as described above; the result always has the same byte length.
+std::string FoldCase(std::string_view text);
+
+std::string_view SearchFieldText(const Message& message, SearchField field);
+const char* SearchFieldName(SearchField field);
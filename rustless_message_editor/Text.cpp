@@ -0,0 +1,159 @@
+#include "Text.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace {
+
+//owned bytes come right after the count of texts sharing them
+using RefCount = std::atomic<uint32_t>;
+//new char[] is aligned for any type, so the count at its start is too
+constexpr std::size_t kHeaderBytes = sizeof(RefCount);
+
+RefCount& Refs(const char* data) {
+    return *std::launder(reinterpret_cast<RefCount*>(const_cast<char*>(data) - kHeaderBytes));
+}
+
+void Unref(const char* data) {
+    if (Refs(data).fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete[] (const_cast<char*>(data) - kHeaderBytes);
+    }
+}
+
+}
+
+Text::Text(const Text& other) : data(other.data), length(other.length), capacity(other.capacity) {
+    //borrowed or empty: the copy borrows the same bytes; owned: it shares them until one side writes
+    if (capacity != 0) {
+        Refs(data).fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+Text::Text(Text&& other) noexcept : data(other.data), length(other.length), capacity(other.capacity) {
+    other.data = "";
+    other.length = 0;
+    other.capacity = 0;
+}
+
+Text& Text::operator=(const Text& other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (other.capacity != 0) {
+        Refs(other.data).fetch_add(1, std::memory_order_relaxed);
+    }
+    Release();
+    data = other.data;
+    length = other.length;
+    capacity = other.capacity;
+    return *this;
+}
+
+Text& Text::operator=(Text&& other) noexcept {
+    if (this != &other) {
+        Release();
+        data = other.data;
+        length = other.length;
+        capacity = other.capacity;
+        other.data = "";
+        other.length = 0;
+        other.capacity = 0;
+    }
+    return *this;
+}
+
+Text& Text::operator+=(std::string_view more) {
+    std::size_t oldLength = length;
+    Resize(oldLength + more.size());
+    std::memcpy(const_cast<char*>(data) + oldLength, more.data(), more.size());
+    return *this;
+}
+
+Text Text::Borrow(std::string_view text) {
+    Text borrowed;
+    if (!text.empty()) {
+        borrowed.data = text.data();
+        borrowed.length = static_cast<uint32_t>(text.size());
+    }
+    return borrowed;
+}
+
+void Text::clear() {
+    if (capacity == 0 || Shared()) {
+        Release();
+    }
+    else {
+        const_cast<char*>(data)[0] = '\0';
+    }
+    length = 0;
+}
+
+char* Text::EditBuffer() {
+    if (capacity == 0) {
+        //a copy of the borrowed bytes, or room to type into an empty field
+        Reserve(std::max<std::size_t>(length, 15));
+    }
+    else if (Shared()) {
+        Reserve(capacity);
+    }
+    return const_cast<char*>(data);
+}
+
+void Text::Resize(std::size_t newLength) {
+    if (newLength > capacity) {
+        Reserve(std::max<std::size_t>(newLength, std::size_t(capacity) * 2));
+    }
+    else if (Shared()) {
+        Reserve(capacity);
+    }
+    length = static_cast<uint32_t>(newLength);
+    const_cast<char*>(data)[length] = '\0';
+}
+
+void Text::Assign(std::string_view text) {
+    if (text.size() > capacity || Shared()) {
+        //nothing worth keeping, so no copy of the old bytes
+        Release();
+        if (text.empty()) {
+            return;
+        }
+        Reserve(text.size());
+    }
+    else if (capacity == 0) {
+        //empty text into a borrowed or empty one
+        Release();
+        return;
+    }
+    std::memmove(const_cast<char*>(data), text.data(), text.size());
+    length = static_cast<uint32_t>(text.size());
+    const_cast<char*>(data)[length] = '\0';
+}
+
+bool Text::Shared() const {
+    //at 1 no other text holds the bytes, and only a copy of this one could add another
+    return capacity != 0 && Refs(data).load(std::memory_order_acquire) != 1;
+}
+
+void Text::Reserve(std::size_t newCapacity) {
+    char* block = new char[kHeaderBytes + newCapacity + 1];
+    new (block) RefCount(1);
+    char* grown = block + kHeaderBytes;
+    std::memcpy(grown, data, length);
+    grown[length] = '\0';
+    if (capacity != 0) {
+        Unref(data);
+    }
+    data = grown;
+    capacity = static_cast<uint32_t>(newCapacity);
+}
+
+void Text::Release() {
+    if (capacity != 0) {
+        Unref(data);
+        capacity = 0;
+    }
+    data = "";
+    length = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A message or response text. It either owns its bytes or borrows them from the file it was
+// loaded from (see LoadCharactersMapped), which has to stay mapped for as long as the text or
+// any copy of it is around. Most text is never edited, so it stays where the loader found it and
+// only gets a copy of its own once something assigns to it. Copies of owned text share its bytes
+// until one of them is written to, so snapshotting a document for a save on another thread costs a
+// count per text rather than a copy of it.
+//
+// Owned text is kept null-terminated; borrowed text is not, so read it through View().
+class Text {
+public:
+    Text() = default;
+    explicit Text(std::string_view text) { Assign(text); }
+    Text(const Text& other);
+    Text(Text&& other) noexcept;
+    ~Text() { Release(); }
+
+    Text& operator=(const Text& other);
+    Text& operator=(Text&& other) noexcept;
+    Text& operator=(std::string_view text) {
+        Assign(text);
+        return *this;
+    }
+    Text& operator+=(std::string_view more);
+
+    // Points at text without copying it; copies of the result point at it too. The loader only
+    // borrows json strings that had no escape sequences, and the writer counts on borrowed text
+    // needing no escaping.
+    static Text Borrow(std::string_view text);
+
+    std::string_view View() const { return std::string_view(data, length); }
+    operator std::string_view() const { return View(); }
+    std::string String() const { return std::string(data, length); }
+
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    bool Borrowed() const { return capacity == 0 && length != 0; }
+    // Heap bytes this text owns, 0 when borrowed or empty; bytes shared by copies count for each.
+    std::size_t OwnedBytes() const { return capacity == 0 ? 0 : capacity + 1; }
+    void clear();
+
+    // For in-place editors: a writable, null-terminated buffer of Capacity() + 1 bytes holding the
+    // text, copied out of the source first when borrowed or shared with a copy.
+    char* EditBuffer();
+    std::size_t Capacity() const { return capacity; }
+    // Sets the length after the bytes were written through EditBuffer, growing the buffer (and
+    // keeping what it holds) when newLength is beyond Capacity().
+    void Resize(std::size_t newLength);
+
+private:
+    void Assign(std::string_view text);
+    void Reserve(std::size_t newCapacity);
+    void Release();
+    //owned bytes another copy also holds, which nothing may write to
+    bool Shared() const;
+
+    const char* data = "";
+    uint32_t length = 0;
+    //chars owned at data, not counting the terminator; 0 when borrowed or empty. Owned bytes are
+    //preceded by a count of the texts sharing them
+    uint32_t capacity = 0;
+};
+
+inline bool operator==(const Text& a, const Text& b) { return a.View() == b.View(); }
+inline bool operator!=(const Text& a, const Text& b) { return a.View() != b.View(); }
+inline bool operator==(const Text& a, std::string_view b) { return a.View() == b; }
+inline bool operator!=(const Text& a, std::string_view b) { return a.View() != b; }
+inline bool operator==(std::string_view a, const Text& b) { return a == b.View(); }
+inline bool operator!=(std::string_view a, const Text& b) { return a != b.View(); }
@@ -0,0 +1,137 @@
+#include "UndoHistory.h"
+
+namespace {
+
+std::size_t MessageBytes(const Message& message) {
+    std::size_t total = sizeof(Message) + message.content.OwnedBytes();
+    for (auto& response : message.responce) {
+        total += response.reply.OwnedBytes() + response.content.OwnedBytes();
+    }
+    return total;
+}
+
+std::size_t EditBytes(const Edit& edit) {
+    std::size_t total = sizeof(Edit) + edit.before.text.capacity() + edit.after.text.capacity() + edit.treeName.capacity();
+    if (edit.kind == EditKind::MessageAdded || edit.kind == EditKind::MessageDeleted) {
+        total += MessageBytes(edit.messageData) - sizeof(Message);
+    }
+    total += edit.characterData.name.capacity() + edit.characterData.shard.capacity();
+    for (auto& message : edit.characterData.messages) {
+        total += MessageBytes(message);
+    }
+    total += edit.changes.capacity() * sizeof(FieldChange);
+    for (auto& change : edit.changes) {
+        total += change.before.text.capacity() + change.after.text.capacity();
+    }
+    return total;
+}
+
+bool SameTarget(const Edit& a, const Edit& b) {
+    if (a.kind != b.kind || a.character != b.character) {
+        return false;
+    }
+    return a.kind == EditKind::Rename || (a.kind == EditKind::Field && a.message == b.message && a.field == b.field);
+}
+
+}
+
+bool IsTextField(MessageField field) {
+    switch (field) {
+    case MessageField::Content:
+    case MessageField::Content1:
+    case MessageField::Reply1:
+    case MessageField::Content2:
+    case MessageField::Reply2:
+        return true;
+    default:
+        return false;
+    }
+}
+
+FieldValue GetField(const Message& message, MessageField field) {
+    FieldValue value;
+    switch (field) {
+    case MessageField::Content: value.text = message.content; break;
+    case MessageField::TimeToRespond: value.number = message.timeToRespond; break;
+    case MessageField::Relationship: value.number = static_cast<int>(message.relationship); break;
+    case MessageField::ID: value.number = message.ID; break;
+    case MessageField::Content1: value.text = message.responce[0].content; break;
+    case MessageField::Reply1: value.text = message.responce[0].reply; break;
+    case MessageField::Health1: value.number = message.responce[0].health; break;
+    case MessageField::Content2: value.text = message.responce[1].content; break;
+    case MessageField::Reply2: value.text = message.responce[1].reply; break;
+    case MessageField::Health2: value.number = message.responce[1].health; break;
+    }
+    return value;
+}
+
+void SetField(Message& message, MessageField field, const FieldValue& value) {
+    switch (field) {
+    case MessageField::Content: message.content = value.text; break;
+    case MessageField::TimeToRespond: message.timeToRespond = value.number; break;
+    case MessageField::Relationship: message.relationship = static_cast<Relationship>(value.number); break;
+    case MessageField::ID: message.ID = value.number; break;
+    case MessageField::Content1: message.responce[0].content = value.text; break;
+    case MessageField::Reply1: message.responce[0].reply = value.text; break;
+    case MessageField::Health1: message.responce[0].health = value.number; break;
+    case MessageField::Content2: message.responce[1].content = value.text; break;
+    case MessageField::Reply2: message.responce[1].reply = value.text; break;
+    case MessageField::Health2: message.responce[1].health = value.number; break;
+    }
+}
+
+void UndoHistory::Record(Edit edit, bool coalesce) {
+    while (steps.size() > applied) {
+        bytes -= EditBytes(steps.back());
+        steps.pop_back();
+    }
+
+    if (coalesce && !sealed && !steps.empty() && SameTarget(steps.back(), edit)) {
+        Edit& last = steps.back();
+        bytes -= EditBytes(last);
+        last.after = std::move(edit.after);
+        if (last.after.text == last.before.text && last.after.number == last.before.number) {
+            //typed and then reverted (Escape does this): nothing left to undo
+            steps.pop_back();
+            applied--;
+            sealed = true;
+            return;
+        }
+        bytes += EditBytes(last);
+    }
+    else {
+        bytes += EditBytes(edit);
+        steps.push_back(std::move(edit));
+        applied++;
+    }
+    sealed = !coalesce;
+
+    while (bytes > maxBytes && steps.size() > 1) {
+        bytes -= EditBytes(steps.front());
+        steps.pop_front();
+        applied--;
+    }
+}
+
+void UndoHistory::Clear() {
+    steps.clear();
+    applied = 0;
+    sealed = true;
+    bytes = 0;
+}
+
+const Edit* UndoHistory::Undo() {
+    if (applied == 0) {
+        return nullptr;
+    }
+    sealed = true;
+    return &steps[--applied];
+}
+
+const Edit* UndoHistory::Redo() {
+    if (applied == steps.size()) {
+        return nullptr;
+    }
+    sealed = true;
+    return &steps[applied++];
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+// The message fields the editor changes one widget at a time.
+enum class MessageField {
+    Content,
+    TimeToRespond,
+    Relationship,
+    ID,
+    Content1,
+    Reply1,
+    Health1,
+    Content2,
+    Reply2,
+    Health2
+};
+
+// A field's value: text fields use text, the others number.
+struct FieldValue {
+    std::string text = "";
+    int number = 0;
+};
+
+bool IsTextField(MessageField field);
+FieldValue GetField(const Message& message, MessageField field);
+void SetField(Message& message, MessageField field, const FieldValue& value);
+
+enum class EditKind {
+    Field,
+    Rename,
+    MessageAdded,
+    MessageDeleted,
+    CharacterAdded,
+    CharacterDeleted,
+    Batch
+};
+
+// One field of one message as a batch changed it.
+struct FieldChange {
+    int character = -1;
+    int message = -1;
+    MessageField field = MessageField::Content;
+    FieldValue before;
+    FieldValue after;
+};
+
+// One undo step. It holds only what the edit changed: a field's or name's value before and
+// after, or the message or character that was added or removed, never a copy of the document.
+struct Edit {
+    EditKind kind = EditKind::Field;
+    int character = -1;
+    int message = -1;
+    // Field: the field; Rename: before.text and after.text are the names
+    MessageField field = MessageField::Content;
+    FieldValue before;
+    FieldValue after;
+    // MessageAdded/Deleted: the message; CharacterAdded/Deleted: the character and its tree label
+    Message messageData;
+    Character characterData;
+    std::string treeName = "";
+    // Batch: every field it changed, in document order, applied and undone as one step
+    std::vector<FieldChange> changes;
+};
+
+// Linear undo/redo over Edit steps. Applying a step is the editor's job (it has to keep the
+// indexes in step too); the history only decides which step comes next.
+//
+// Typing is coalesced: a Field or Rename edit recorded with coalesce set is merged into the
+// previous step when that one changed the same thing and Seal has not been called since, so
+// a run of keystrokes in one field undoes as one step. The editor seals whenever a field gains
+// focus. Once the steps take more than maxBytes the oldest are dropped.
+class UndoHistory {
+public:
+    explicit UndoHistory(std::size_t maxBytes = std::size_t(256) << 20) : maxBytes(maxBytes) {}
+
+    // Adds a step after the current one, dropping whatever could have been redone.
+    void Record(Edit edit, bool coalesce);
+    void Seal() { sealed = true; }
+    void Clear();
+
+    bool CanUndo() const { return applied != 0; }
+    bool CanRedo() const { return applied != steps.size(); }
+    // The step to revert or apply again, or nullptr; valid until the next Record or Clear.
+    const Edit* Undo();
+    const Edit* Redo();
+
+    std::size_t Steps() const { return steps.size(); }
+    std::size_t Bytes() const { return bytes; }
+
+private:
+    std::deque<Edit> steps;
+    // steps[0, applied) are done, the rest undone
+    std::size_t applied = 0;
+    bool sealed = true;
+    std::size_t bytes = 0;
+    std::size_t maxBytes;
+};
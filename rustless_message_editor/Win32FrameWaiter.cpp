@@ -0,0 +1,13 @@
+#include "Win32FrameWaiter.h"
+
+#include <cmath>
+
+void Win32FrameWaiter::Wait(double timeoutSeconds) {
+    DWORD milliseconds = timeoutSeconds < 0.0 ? INFINITE : static_cast<DWORD>(std::ceil(timeoutSeconds * 1000.0));
+    //MWMO_INPUTAVAILABLE also returns for messages that were already queued but not yet looked at
+    ::MsgWaitForMultipleObjectsEx(0, nullptr, milliseconds, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+void Win32FrameWaiter::Wake() {
+    ::PostMessageW(window, WM_NULL, 0, 0);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "FrameScheduler.h"
+
+#include <windows.h>
+
+// Idle wait for the Win32 message loop: sleeps in MsgWaitForMultipleObjectsEx until a message
+// is queued, and wakes by posting WM_NULL to the window.
+class Win32FrameWaiter : public FrameWaiter {
+public:
+    explicit Win32FrameWaiter(HWND window) : window(window) {}
+
+    void Wait(double timeoutSeconds) override;
+    void Wake() override;
+
+private:
+    HWND window;
+};
@@ -0,0 +1,122 @@
+#include "Bench.h"
+#include "BackgroundSave.h"
+#include "BakedDialogue.h"
+#include "DialogueBake.h"
+#include "DialogueLoader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Also the round-trip check for the baked format: json -> bake -> unbake must give the same characters.
+int RunBakeBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 64.0) * 1024 * 1024;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+
+    const std::string jsonPath = "rustless_bench_bake.json";
+    const std::string bakedPath = "rustless_bench_bake.bin";
+    std::size_t messages = WriteSyntheticCorpus(jsonPath, options);
+
+    std::vector<Character> characters;
+    BenchTimer jsonTimer;
+    LoadResult loaded = LoadCharactersFromFile(jsonPath, characters);
+    double jsonSeconds = jsonTimer.Seconds();
+    if (!loaded.ok) {
+        std::printf("json load failed: %s\n", loaded.error.c_str());
+        return 1;
+    }
+
+    BenchTimer bakeTimer;
+    SaveResult saved = SaveBakedFile(bakedPath, characters);
+    double bakeSeconds = bakeTimer.Seconds();
+    if (!saved.ok) {
+        std::printf("bake failed: %s\n", saved.error.c_str());
+        return 1;
+    }
+
+    BakedDialogue baked;
+    std::string error;
+    BenchTimer openTimer;
+    bool opened = baked.Open(bakedPath, error);
+    double openSeconds = openTimer.Seconds();
+    if (!opened) {
+        std::printf("open failed: %s\n", error.c_str());
+        return 1;
+    }
+
+    //touch every record and string once, which is what a game would pay on top of Open
+    BenchTimer touchTimer;
+    std::size_t textBytes = 0;
+    for (uint32_t m = 0; m < baked.MessageCount(); m++) {
+        const BakedMessage& message = baked.MessageAt(m);
+        textBytes += baked.String(message.content).size();
+        for (auto& response : message.responses) {
+            textBytes += baked.String(response.reply).size() + baked.String(response.content).size();
+        }
+    }
+    double touchSeconds = touchTimer.Seconds();
+
+    BenchTimer findTimer;
+    std::size_t misses = 0;
+    for (auto& character : characters) {
+        for (auto& message : character.messages) {
+            if (baked.FindMessage(message.ID) < 0) {
+                misses++;
+            }
+        }
+    }
+    double findSeconds = findTimer.Seconds();
+
+    std::vector<Character> unbaked;
+    UnbakeCharacters(baked, unbaked);
+    bool same = SameCharacters(characters, unbaked);
+
+    std::printf("corpus: %.1f MB json, %zu messages -> %.1f MB baked (%zu text bytes)\n",
+        ToMegabytes(loaded.bytesRead), messages, ToMegabytes(saved.bytesWritten), textBytes);
+    std::printf("json load        %9.3f ms\n", jsonSeconds * 1e3);
+    std::printf("bake + write     %9.3f ms\n", bakeSeconds * 1e3);
+    std::printf("baked open       %9.3f ms\n", openSeconds * 1e3);
+    std::printf("baked touch all  %9.3f ms\n", touchSeconds * 1e3);
+    std::printf("find by ID       %9.1f ns each\n", findSeconds * 1e9 / static_cast<double>(messages));
+    std::printf("round trip       %s\n", same && misses == 0 ? "ok" : "MISMATCH");
+    baked.Close();
+
+    //what a save costs the frame that starts it; the copies share text until either side edits
+    BenchTimer snapshotTimer;
+    std::vector<Character> snapshot = characters;
+    double snapshotSeconds = snapshotTimer.Seconds();
+    Text& edited = characters.front().messages.front().content;
+    std::string before = edited.String();
+    edited += " (edited)";
+    snapshot.back().messages.back().responce[0].reply = "changed in the snapshot";
+    bool apart = snapshot.front().messages.front().content == before && characters.back().messages.back().responce[0].reply != "changed in the snapshot";
+    edited = before;
+    snapshot.clear();
+    std::printf("save snapshot    %9.3f ms, %s\n", snapshotSeconds * 1e3, apart ? "copies apart" : "MISMATCH: an edit showed through a copy");
+
+    //a bake asked for while a save waits behind another one goes after it, not in its place
+    const std::string queuedPath = "rustless_bench_bake_queued.json";
+    std::remove(bakedPath.c_str());
+    bool queued = false;
+    {
+        SaveWorker worker;
+        worker.Start(characters, jsonPath, WriteOptions());
+        worker.Start(characters, queuedPath, WriteOptions());
+        worker.StartBake(characters, bakedPath);
+        while (worker.Busy()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::vector<Character> written;
+        SaveStatus status = worker.Status();
+        queued = status.finished == 3 && status.failed == 0 && LoadCharactersFromFile(queuedPath, written).ok && SameCharacters(characters, written)
+            && baked.Open(bakedPath, error);
+        baked.Close();
+    }
+    std::printf("queued bake      %s\n", queued ? "ok" : "MISMATCH");
+
+    std::remove(jsonPath.c_str());
+    std::remove(bakedPath.c_str());
+    std::remove(queuedPath.c_str());
+    return same && misses == 0 && apart && queued ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+#include "Bench.h"
+#include "DialogueBatch.h"
+#include "EditJournal.h"
+#include "EditorUI.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+struct BatchCase {
+    const char* name;
+    BatchFilter filter;
+    std::vector<BatchTransform> transforms;
+    // applying it again changes nothing more
+    bool idempotent;
+};
+
+BatchTransform Transform(BatchOp op, const char* fields, double value = 0.0) {
+    BatchTransform transform;
+    transform.op = op;
+    ParseBatchFields(fields, transform.fields);
+    transform.value = value;
+    return transform;
+}
+
+BatchTransform TextTransform(BatchOp op, const char* fields, const char* pattern, const char* text) {
+    BatchTransform transform = Transform(op, fields);
+    transform.pattern = pattern;
+    transform.text = text;
+    return transform;
+}
+
+std::vector<BatchCase> MakeCases(const std::vector<Character>& characters) {
+    std::vector<BatchCase> cases;
+
+    BatchCase scale{ "scale one character's health by 0.8", BatchFilter(), {}, false };
+    scale.filter.character = characters[0].name;
+    scale.transforms.push_back(Transform(BatchOp::Scale, "health", 0.8));
+    cases.push_back(scale);
+
+    BatchCase clamp{ "clamp every time to 5..60", BatchFilter(), {}, true };
+    BatchTransform range = Transform(BatchOp::Clamp, "time");
+    range.low = 5;
+    range.high = 60;
+    BatchTransform slower = Transform(BatchOp::Set, "time", 90.0);
+    clamp.transforms.push_back(slower);
+    clamp.transforms.push_back(range);
+    cases.push_back(clamp);
+
+    BatchCase replace{ "replace a term in all text", BatchFilter(), {}, true };
+    replace.transforms.push_back(TextTransform(BatchOp::Replace, "text", "serf", "peasant"));
+    cases.push_back(replace);
+
+    BatchCase regex{ "regex replace in replies", BatchFilter(), {}, true };
+    regex.transforms.push_back(TextTransform(BatchOp::RegexReplace, "reply", "\\bthine\\b", "your"));
+    cases.push_back(regex);
+
+    BatchCase picked{ "negative messages with \"dragon\" in an ID range", BatchFilter(), {}, false };
+    picked.filter.relationship = NEGATIVE;
+    picked.filter.minID = 0;
+    picked.filter.maxID = 50000000;
+    picked.filter.text = "dragon";
+    picked.transforms.push_back(Transform(BatchOp::Set, "relationship", NEUTERAL));
+    picked.transforms.push_back(Transform(BatchOp::Add, "health", -5.0));
+    cases.push_back(picked);
+    return cases;
+}
+
+bool SameChanges(const std::vector<FieldChange>& a, const std::vector<FieldChange>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t k = 0; k < a.size(); k++) {
+        if (a[k].character != b[k].character || a[k].message != b[k].message || a[k].field != b[k].field || a[k].before.text != b[k].before.text
+            || a[k].before.number != b[k].before.number || a[k].after.text != b[k].after.text || a[k].after.number != b[k].after.number) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every case planned on one thread and on many, applied, planned again and undone.
+int RunCases(const std::vector<Character>& original) {
+    int failed = 0;
+    unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<Character> characters = original;
+    for (auto& batch : MakeCases(original)) {
+        BenchTimer serialTimer;
+        BatchPlan serial = PlanBatch(characters, batch.filter, batch.transforms, 1);
+        double serialSeconds = serialTimer.Seconds();
+        BenchTimer parallelTimer;
+        BatchPlan plan = PlanBatch(characters, batch.filter, batch.transforms, threads);
+        double parallelSeconds = parallelTimer.Seconds();
+
+        BenchTimer applyTimer;
+        ApplyBatch(characters, plan.changes, false);
+        double applySeconds = applyTimer.Seconds();
+        BatchPlan again = PlanBatch(characters, batch.filter, batch.transforms);
+        BenchTimer undoTimer;
+        ApplyBatch(characters, plan.changes, true);
+        double undoSeconds = undoTimer.Seconds();
+
+        bool checked = plan.ok && SameChanges(serial.changes, plan.changes) && serial.matched == plan.matched && (!batch.idempotent || again.changes.empty())
+            && SameCharacters(characters, original);
+        if (batch.transforms[0].op == BatchOp::Scale) {
+            for (auto& change : plan.changes) {
+                checked &= change.character == 0 && (change.field == MessageField::Health1 || change.field == MessageField::Health2)
+                    && change.after.number == static_cast<int>(std::round(change.before.number * 0.8));
+            }
+        }
+        std::printf("%-48s plan %7.1f ms (1 thread) %7.1f ms (%u threads), apply %6.1f ms, undo %6.1f ms  %8zu picked %8zu fields in %8zu messages  %s\n",
+            batch.name, serialSeconds * 1e3, parallelSeconds * 1e3, threads, applySeconds * 1e3, undoSeconds * 1e3, plan.matched, plan.changes.size(),
+            plan.changedMessages, checked ? "ok" : "MISMATCH");
+        if (!plan.changes.empty()) {
+            std::printf("    e.g. %s\n", DescribeChange(characters, plan.changes[0]).c_str());
+        }
+        failed += checked ? 0 : 1;
+    }
+
+    std::vector<BatchTransform> bad{ TextTransform(BatchOp::RegexReplace, "text", "(unclosed", "x") };
+    BatchPlan refused = PlanBatch(characters, BatchFilter(), bad);
+    std::printf("bad regex: %s\n", refused.ok ? "ACCEPTED" : refused.error.c_str());
+    failed += refused.ok ? 1 : 0;
+    return failed;
+}
+
+// The index the editor kept up to date finds what one built from scratch does.
+bool SameSearches(const EditorState& state) {
+    SearchIndex fresh;
+    fresh.Rebuild(state.characters);
+    SearchOptions every;
+    every.maxHits = SIZE_MAX;
+    for (const char* query : { "serf", "peasant", "sant", " se", "t\xC3", "dragon" }) {
+        std::vector<SearchHit> kept = state.search.Find(query, every).hits;
+        std::vector<SearchHit> built = fresh.Find(query, every).hits;
+        if (kept.size() != built.size()) {
+            return false;
+        }
+        for (std::size_t k = 0; k < kept.size(); k++) {
+            if (kept[k].character != built[k].character || kept[k].message != built[k].message || kept[k].field != built[k].field
+                || kept[k].offset != built[k].offset) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The editor applying a batch as one undo step: the indexes follow it, undo takes all of it back,
+// and the journal holds it as one record that reads back the same.
+int RunEditor(const std::vector<Character>& original) {
+    int failed = 0;
+    EditorState state;
+    state.characters = original;
+    for (auto& character : state.characters) {
+        state.treeNames.push_back(character.name);
+    }
+    state.index.Rebuild(state.characters);
+    state.search.Rebuild(state.characters);
+    state.validator.ValidateAll(state.characters, state.index);
+
+    //a small batch goes through the same incremental updates typing does
+    BatchFilter few;
+    few.character = original[1].name;
+    few.minID = original[1].messages.front().ID;
+    few.maxID = few.minID + 100 * 500;
+    std::vector<BatchTransform> scale{ Transform(BatchOp::Scale, "health", 2.0) };
+    BatchPlan small = PlanBatch(state.characters, few, scale);
+    std::size_t smallFields = small.changes.size();
+    Edit edit;
+    edit.kind = EditKind::Batch;
+    edit.changes = std::move(small.changes);
+    BenchTimer smallTimer;
+    MakeEdit(state, std::move(edit));
+    double smallSeconds = smallTimer.Seconds();
+    UndoEdit(state);
+    bool smallUndone = SameCharacters(state.characters, original);
+    std::printf("editor, %zu fields: incremental apply %.2f ms, undone %s\n", smallFields, smallSeconds * 1e3, smallUndone ? "ok" : "MISMATCH");
+    failed += smallUndone ? 0 : 1;
+
+    SearchOptions whole;
+    whole.wholeWord = true;
+    std::vector<BatchTransform> replace{ TextTransform(BatchOp::Replace, "text", "serf", "peasant") };
+    BatchPlan plan = PlanBatch(state.characters, BatchFilter(), replace);
+    std::size_t fields = plan.changes.size();
+    edit = Edit();
+    edit.kind = EditKind::Batch;
+    edit.changes = std::move(plan.changes);
+    BenchTimer makeTimer;
+    MakeEdit(state, std::move(edit));
+    double makeSeconds = makeTimer.Seconds();
+    bool replaced = state.search.Find("serf", whole).hits.empty() && !state.search.Find("peasant", whole).hits.empty() && state.history.Steps() == 1
+        && SameSearches(state);
+    BenchTimer undoTimer;
+    UndoEdit(state);
+    double undoSeconds = undoTimer.Seconds();
+    bool undone = SameCharacters(state.characters, original) && !state.search.Find("serf", whole).hits.empty()
+        && state.search.Find("peasant", whole).hits.empty() && SameSearches(state);
+    std::printf("editor, %zu fields: apply %.1f ms, undo %.1f ms, one undo step %s, undone %s\n", fields, makeSeconds * 1e3,
+        undoSeconds * 1e3, replaced ? "ok" : "MISMATCH", undone ? "ok" : "MISMATCH");
+    failed += replaced && undone ? 0 : 1;
+
+    //clamping every time makes a batch of numbers, journaled as one record
+    BatchTransform clamp = Transform(BatchOp::Clamp, "time");
+    clamp.low = 25;
+    clamp.high = 60;
+    BatchPlan clamped = PlanBatch(state.characters, BatchFilter(), { clamp });
+    Edit journaled;
+    journaled.kind = EditKind::Batch;
+    journaled.changes = clamped.changes;
+    const std::string path = "rustless_bench_batch.journal";
+    EditJournal journal;
+    std::string error;
+    JournalBase base{ "load.json", 1 };
+    bool started = journal.Start(path, base, nullptr, error);
+    BenchTimer journalTimer;
+    journal.Append(journaled, false);
+    journal.Append(journaled, true);
+    journal.Flush();
+    double journalSeconds = journalTimer.Seconds();
+    journal.Stop();
+    JournalContents contents;
+    bool read = started && ReadJournal(path, contents, error) && contents.edits.size() == 2;
+    if (read) {
+        const Edit& redo = contents.edits[0].edit;
+        const Edit& undo = contents.edits[1].edit;
+        read = redo.kind == EditKind::Batch && !contents.edits[0].undo && contents.edits[1].undo && redo.changes.size() == clamped.changes.size()
+            && undo.changes.size() == clamped.changes.size();
+        for (std::size_t k = 0; read && k < clamped.changes.size(); k++) {
+            read = redo.changes[k].message == clamped.changes[k].message && redo.changes[k].after.number == clamped.changes[k].after.number
+                && undo.changes[k].before.number == clamped.changes[k].before.number;
+        }
+    }
+    std::printf("journal, %zu fields and their undo: appended and synced in %.1f ms, %.1f MB, read back %s\n", clamped.changes.size(), journalSeconds * 1e3,
+        ToMegabytes(journal.Status().editBytes), read ? "ok" : ("MISMATCH " + error).c_str());
+    failed += read ? 0 : 1;
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return failed;
+}
+
+}
+
+int RunBatchBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.messages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 1000000;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+    options.minWords = 2;
+    options.maxWords = 8;
+    std::vector<Character> characters = MakeSyntheticCharacters(options);
+    std::printf("%zu messages, %d characters\n", options.messages, options.characters);
+
+    int failed = RunCases(characters);
+    failed += RunEditor(characters);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "Bench.h"
+#include "Profiler.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+
+namespace {
+
+std::atomic<std::size_t> g_Allocations{ 0 };
+std::atomic<std::size_t> g_LiveBytes{ 0 };
+std::atomic<std::size_t> g_PeakBytes{ 0 };
+
+// every block carries its size in front so operator delete can keep liveBytes exact
+constexpr std::size_t kHeader = alignof(std::max_align_t);
+
+void* TrackedAlloc(std::size_t size) {
+    void* block = std::malloc(size + kHeader);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t*>(block) = size;
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    ProfileAllocation();
+    std::size_t live = g_LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    std::size_t peak = g_PeakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + kHeader;
+}
+
+void TrackedFree(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - kHeader;
+    g_LiveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+const char* kWords[] = {
+    "thine", "majesty", "serf", "plague", "jester", "shift", "maiden", "queen", "phone", "daughter",
+    "castle", "dragon", "knight", "lmao", "fr", "cannot", "humorous", "kingdom", "help", "area",
+    "tavern", "ale", "quest", "sword", "bard", "\\\"quoted\\\"", "thine\xE2\x80\x99s", "can\xE2\x80\x99t", "meme", "scroll"
+};
+
+}
+
+void* operator new(std::size_t size) { return TrackedAlloc(size); }
+void* operator new[](std::size_t size) { return TrackedAlloc(size); }
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+
+AllocStats GetAllocStats() {
+    AllocStats stats;
+    stats.allocations = g_Allocations.load();
+    stats.liveBytes = g_LiveBytes.load();
+    stats.peakBytes = g_PeakBytes.load();
+    return stats;
+}
+
+void ResetAllocStats() {
+    g_Allocations = 0;
+    g_PeakBytes = g_LiveBytes.load();
+}
+
+std::size_t WriteSyntheticCorpus(std::ostream& out, const CorpusOptions& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> wordCount(options.minWords, options.maxWords);
+    std::uniform_int_distribution<int> word(0, static_cast<int>(sizeof(kWords) / sizeof(kWords[0])) - 1);
+    std::uniform_int_distribution<int> health(-50, 50);
+    std::uniform_int_distribution<int> relationship(0, 2);
+
+    auto sentence = [&](std::string& text) {
+        int words = wordCount(rng);
+        for (int i = 0; i < words; i++) {
+            if (i != 0) {
+                text += ' ';
+            }
+            text += kWords[word(rng)];
+        }
+    };
+
+    std::size_t characters = static_cast<std::size_t>(options.characters);
+    std::size_t bytesPerCharacter = options.targetBytes / characters + 1;
+    std::size_t messages = 0;
+    std::size_t written = 0;
+    std::size_t speaker = 0;
+    std::size_t speakerBytes = 0;
+    std::string chunk;
+    chunk.reserve(1 << 16);
+
+    out << "{\n    \"messages\": [";
+    while (true) {
+        if (options.messages != 0) {
+            if (messages == options.messages) {
+                break;
+            }
+            speaker = options.interleave ? messages % characters : messages * characters / options.messages;
+        }
+        else if (options.interleave) {
+            if (written >= options.targetBytes) {
+                break;
+            }
+            speaker = messages % characters;
+        }
+        else if (speakerBytes >= bytesPerCharacter) {
+            //move on to the next character once this one has its share of the bytes
+            if (++speaker == characters) {
+                break;
+            }
+            speakerBytes = 0;
+        }
+
+        chunk.clear();
+        chunk += messages == 0 ? "\n" : ",\n";
+        chunk += "        {\n            \"ID\": " + std::to_string(messages * 100);
+        chunk += ",\n            \"content\": \"";
+        sentence(chunk);
+        chunk += "\",\n            \"from\": \"Character " + std::to_string(speaker);
+        chunk += "\",\n            \"relationship\": " + std::to_string(relationship(rng));
+        chunk += ",\n            \"responses\": [";
+        for (int r = 0; r < 2; r++) {
+            chunk += r == 0 ? "\n" : ",\n";
+            chunk += "                {\n                    \"content\": \"";
+            sentence(chunk);
+            chunk += "\",\n                    \"health\": " + std::to_string(health(rng));
+            chunk += ",\n                    \"reply\": \"";
+            if (rng() % 2 == 0) {
+                sentence(chunk);
+            }
+            chunk += "\"\n                }";
+        }
+        chunk += "\n            ],\n            \"timeToRespond\": 20\n        }";
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        written += chunk.size();
+        speakerBytes += chunk.size();
+        messages++;
+    }
+    out << "\n    ]\n}\n";
+    return messages;
+}
+
+std::size_t WriteSyntheticCorpus(const std::string& path, const CorpusOptions& options) {
+    std::ofstream file(path, std::ios::binary);
+    return WriteSyntheticCorpus(file, options);
+}
+
+std::vector<Character> MakeSyntheticCharacters(const CorpusOptions& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<int> wordCount(options.minWords, options.maxWords);
+    std::uniform_int_distribution<int> word(0, static_cast<int>(sizeof(kWords) / sizeof(kWords[0])) - 1);
+    std::uniform_int_distribution<int> health(-50, 50);
+    std::uniform_int_distribution<int> relationship(0, 2);
+
+    std::string text;
+    auto sentence = [&](Text& out) {
+        text.clear();
+        int words = wordCount(rng);
+        for (int i = 0; i < words; i++) {
+            if (i != 0) {
+                text += ' ';
+            }
+            //kWords is json escaped for the corpus writer
+            for (const char* c = kWords[word(rng)]; *c != '\0'; c++) {
+                if (*c != '\\') {
+                    text += *c;
+                }
+            }
+        }
+        out = text;
+    };
+
+    std::size_t characterCount = static_cast<std::size_t>(options.characters);
+    std::size_t messages = options.messages != 0 ? options.messages : characterCount;
+    std::vector<Character> characters(characterCount);
+    for (std::size_t i = 0; i < characterCount; i++) {
+        characters[i].name = "Character " + std::to_string(i);
+        characters[i].messages.reserve(messages / characterCount + 1);
+    }
+
+    for (std::size_t k = 0; k < messages; k++) {
+        std::size_t speaker = options.interleave ? k % characterCount : k * characterCount / messages;
+        Message message;
+        message.ID = static_cast<int32_t>(k * 100);
+        sentence(message.content);
+        message.relationship = static_cast<Relationship>(relationship(rng));
+        for (auto& response : message.responce) {
+            sentence(response.content);
+            response.health = health(rng);
+            if (rng() % 2 == 0) {
+                sentence(response.reply);
+            }
+        }
+        characters[speaker].messages.push_back(std::move(message));
+    }
+    return characters;
+}
+
+int DoesCharacterExist(std::vector<Character> characters, std::string name) {
+
+    for (std::size_t i = 0; i < characters.size(); i++) {
+        if (characters[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+bool SameCharacters(const std::vector<Character>& a, const std::vector<Character>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].messages.size() != b[i].messages.size()) {
+            return false;
+        }
+        for (std::size_t j = 0; j < a[i].messages.size(); j++) {
+            const Message& x = a[i].messages[j];
+            const Message& y = b[i].messages[j];
+            if (x.content != y.content || x.timeToRespond != y.timeToRespond || x.relationship != y.relationship || x.ID != y.ID) {
+                return false;
+            }
+            for (int r = 0; r < 2; r++) {
+                if (x.responce[r].reply != y.responce[r].reply || x.responce[r].content != y.responce[r].content || x.responce[r].health != y.responce[r].health) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+double ToMegabytes(std::size_t bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
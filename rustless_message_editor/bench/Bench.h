@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Dialogue.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Heap statistics gathered by the replacement operator new in BenchMain.cpp.
+struct AllocStats {
+    std::size_t allocations = 0;
+    std::size_t liveBytes = 0;
+    std::size_t peakBytes = 0;
+};
+
+AllocStats GetAllocStats();
+// Restarts peak tracking from the current live size and zeroes the allocation count.
+void ResetAllocStats();
+
+class BenchTimer {
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+    double Seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+struct CorpusOptions {
+    std::size_t targetBytes = 1 << 20;
+    // when non-zero, write exactly this many messages and ignore targetBytes
+    std::size_t messages = 0;
+    int characters = 64;
+    // round-robin speakers instead of one contiguous run per character
+    bool interleave = false;
+    int minWords = 4;
+    int maxWords = 40;
+    uint32_t seed = 777;
+};
+
+// Writes a pretty-printed messages json shaped like the editor's own Save() output
+// and returns the number of messages written.
+std::size_t WriteSyntheticCorpus(std::ostream& out, const CorpusOptions& options);
+std::size_t WriteSyntheticCorpus(const std::string& path, const CorpusOptions& options);
+
+// Builds the same kind of dialogue straight in memory, for datasets too big to go through json.
+// Uses messages (or 1 per character when 0), characters, interleave, minWords, maxWords and seed.
+std::vector<Character> MakeSyntheticCharacters(const CorpusOptions& options);
+
+// The editor's original by-value linear lookup, kept as a baseline.
+int DoesCharacterExist(std::vector<Character> characters, std::string name);
+
+bool SameCharacters(const std::vector<Character>& a, const std::vector<Character>& b);
+
+double ToMegabytes(std::size_t bytes);
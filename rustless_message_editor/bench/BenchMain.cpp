@@ -0,0 +1,73 @@
+// Benchmarks for the dialogue data pipeline. Runs headless, no window or device needed.
+//
+//   rustless_bench <suite> [options]
+//
+// Built as the rustless_bench target of the top-level CMakeLists.txt.
+
+#include <cstring>
+#include <iostream>
+
+int RunLoadBench(int argc, char** argv);
+int RunIndexBench(int argc, char** argv);
+int RunBakeBench(int argc, char** argv);
+int RunUiBench(int argc, char** argv);
+int RunSearchBench(int argc, char** argv);
+int RunValidateBench(int argc, char** argv);
+int RunStoreBench(int argc, char** argv);
+int RunReloadBench(int argc, char** argv);
+int RunProjectBench(int argc, char** argv);
+int RunMappedBench(int argc, char** argv);
+int RunProfileBench(int argc, char** argv);
+int RunLazyBench(int argc, char** argv);
+int RunJournalBench(int argc, char** argv);
+int RunPipelineBench(int argc, char** argv);
+int RunSimBench(int argc, char** argv);
+int RunGlyphBench(int argc, char** argv);
+int RunBatchBench(int argc, char** argv);
+int RunMergeBench(int argc, char** argv);
+int RunFrameBench(int argc, char** argv);
+
+struct BenchSuite {
+    const char* name;
+    const char* usage;
+    int (*run)(int argc, char** argv);
+};
+
+static const BenchSuite g_Suites[] = {
+    { "load", "load [megabytes=256] [characters=64]   SAX loader vs the old json DOM walk", RunLoadBench },
+    { "index", "index [max messages=1000000] [characters=1000] [old lookup limit=20000]   load and lookup scaling", RunIndexBench },
+    { "bake", "bake [megabytes=64] [characters=64]   baked binary vs json load, plus round-trip check", RunBakeBench },
+    { "ui", "ui [small|wide|deep|long|all=all] [frames per phase=120]   editor frame times, no window or GPU", RunUiBench },
+    { "search", "search [messages=1000000] [characters=100] [edits=20000]   search index build, edit and query times, checked against a full scan", RunSearchBench },
+    { "validate", "validate [messages=1000000] [characters=100] [edits=20000]   full and incremental validation, checked against a fresh pass", RunValidateBench },
+    { "store", "store [megabytes=256] [characters=64] [max words per text=12]   column/arena DialogueStore vs the Message structs: memory per message and load time", RunStoreBench },
+    { "reload", "reload [messages=200000] [characters=64] [edits per round=100]   live reload latency and diff, native watcher and polling", RunReloadBench },
+    { "project", "project [megabytes=64] [max files=64] [characters=64] [threads=cores]   chapter directory load on one thread vs many, 1 to max files", RunProjectBench },
+    { "mapped", "mapped [megabytes=256] [characters=64] [edits=10000]   memory-mapped load borrowing its text vs the copying load, then edit and save over the mapped file", RunMappedBench },
+    { "profile", "profile [megabytes=64] [spans=1000000]   profiler span cost while off and on, load and save overhead, trace export check", RunProfileBench },
+    { "lazy", "lazy [megabytes=256] [characters=64]   outline-only open vs eager load, per-character loading, and the editor saving a lazily loaded file", RunLazyBench },
+    { "journal", "journal [megabytes=8] [edits=20000]   edit journal append and sync batching, crash replay with a torn tail, compaction, stale journal", RunJournalBench },
+    { "pipeline", "pipeline [megabytes=1,16,64] [fuzz cases=300] [results=rustless_bench_pipeline.json] [baseline results]   load/save throughput, lookups and peak memory per scale plus round-trip fuzzing, as json", RunPipelineBench },
+    { "sim", "sim [messages=1000] [characters=64] [playthroughs=10000000]   playthrough simulator throughput, same totals on any thread count, policies, cancelling", RunSimBench },
+    { "glyphs", "glyphs [megabytes=64] [font=the editor's]   code point scan, font atlas of the used glyphs vs broad and whole-BMP ranges, rebuild after an edit", RunGlyphBench },
+    { "batch", "batch [messages=1000000] [characters=64]   bulk edit planning on one thread and many, apply and undo, the editor's one-step batch edit and its journal record", RunBatchBench },
+    { "merge", "merge [megabytes=64] [characters=64]   keyed diff and three-way merge of files, throughput and heap peak against file size, checked against a plain merge, and the editor settling conflicts", RunMergeBench },
+    { "frames", "frames [wakes=1000]   redraw scheduling against a fake waiter: input bursts, timer deadlines, wait clamping, Wake from another thread", RunFrameBench },
+};
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2) {
+        for (auto& suite : g_Suites) {
+            if (std::strcmp(argv[1], suite.name) == 0) {
+                return suite.run(argc - 2, argv + 2);
+            }
+        }
+    }
+
+    std::cout << "usage: rustless_bench <suite> [options]\n";
+    for (auto& suite : g_Suites) {
+        std::cout << "  " << suite.usage << "\n";
+    }
+    return 1;
+}
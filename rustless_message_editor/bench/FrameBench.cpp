@@ -0,0 +1,219 @@
+#include "Bench.h"
+#include "FrameScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = FrameScheduler::Clock;
+
+Clock::duration ToDuration(double seconds) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// Stands in for Win32FrameWaiter. Timed waits move a fake clock instead of sleeping; a wait with
+// no timeout really blocks until Wake, like the message loop does, and a Wake that comes before
+// the wait is kept the way a posted WM_NULL stays queued.
+class FakeWaiter : public FrameWaiter {
+public:
+    explicit FakeWaiter(Clock::time_point start) : now(start) {}
+
+    void Wait(double timeoutSeconds) override {
+        waits++;
+        std::unique_lock<std::mutex> lock(mutex);
+        if (timeoutSeconds >= 0.0) {
+            if (!pending) {
+                now += ToDuration(timeoutSeconds);
+            }
+        }
+        else if (!wakeable.wait_for(lock, std::chrono::seconds(5), [this] { return pending; })) {
+            stuck = true;
+        }
+        pending = false;
+    }
+
+    void Wake() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = true;
+        }
+        wakeable.notify_one();
+    }
+
+    Clock::time_point now;
+    int waits = 0;
+    //a wait without timeout that nothing woke
+    bool stuck = false;
+
+private:
+    std::mutex mutex;
+    std::condition_variable wakeable;
+    bool pending = false;
+};
+
+// One turn of main.cpp's loop: wait if nothing is due, then draw a frame if one is wanted, taking
+// frameSeconds of fake time. True when a frame was drawn.
+bool RunFrame(FrameScheduler& scheduler, FakeWaiter& waiter, double frameSeconds) {
+    double wait = scheduler.WaitSeconds(waiter.now);
+    if (wait != 0.0) {
+        waiter.Wait(wait);
+    }
+    if (!scheduler.ShouldRender(waiter.now)) {
+        return false;
+    }
+    scheduler.BeginFrame(waiter.now);
+    waiter.now += ToDuration(frameSeconds);
+    return true;
+}
+
+bool Near(double a, double b) {
+    return std::fabs(a - b) < 1e-6;
+}
+
+void Report(const char* label, bool ok, bool& allOk) {
+    std::printf("%-40s %s\n", label, ok ? "ok" : "MISMATCH");
+    allOk = allOk && ok;
+}
+
+}
+
+// Checks the redraw policy main.cpp runs on: it draws for a burst after input, on timers and on
+// Wake, and otherwise asks to sleep for as long as it can.
+int RunFrameBench(int argc, char** argv) {
+    int wakes = argc >= 1 ? std::atoi(argv[0]) : 1000;
+    const double frameSeconds = 0.02;
+    const double burstSeconds = 0.25;
+    bool allOk = true;
+
+    //the first frame is always drawn, then input keeps frames coming for the burst and no longer
+    {
+        FakeWaiter waiter(Clock::now());
+        FrameScheduler scheduler(burstSeconds);
+        bool first = RunFrame(scheduler, waiter, frameSeconds) && scheduler.WaitSeconds(waiter.now) < 0.0;
+        scheduler.OnInput(waiter.now);
+        Clock::time_point input = waiter.now;
+        int frames = 0;
+        while (scheduler.WaitSeconds(waiter.now) == 0.0 && frames < 1000) {
+            frames += RunFrame(scheduler, waiter, frameSeconds) ? 1 : 0;
+        }
+        int expected = static_cast<int>(std::ceil(burstSeconds / frameSeconds));
+        bool idle = waiter.now >= input + ToDuration(burstSeconds) && scheduler.WaitSeconds(waiter.now) < 0.0;
+        std::printf("burst: %d frames of %.0f ms for %.0f ms of input, then idle\n", frames, frameSeconds * 1e3, burstSeconds * 1e3);
+        Report("burst after input", first && frames == expected && idle && waiter.waits == 0, allOk);
+
+        //input during the burst extends it from the latest event
+        scheduler.OnInput(waiter.now);
+        waiter.now += ToDuration(burstSeconds * 0.5);
+        scheduler.OnInput(waiter.now);
+        waiter.now += ToDuration(burstSeconds * 0.75);
+        Report("burst extended by later input", scheduler.ShouldRender(waiter.now), allOk);
+    }
+
+    //timers: the loop sleeps exactly until the earliest one and draws one frame for it
+    {
+        FakeWaiter waiter(Clock::now());
+        FrameScheduler scheduler(burstSeconds);
+        RunFrame(scheduler, waiter, frameSeconds);
+        Clock::time_point start = waiter.now;
+        scheduler.RequestFrameIn(start, 0.4);
+        scheduler.RequestFrameIn(start, 0.1);
+        scheduler.RequestFrameIn(start, 0.25);
+        bool waitsForEarliest = Near(scheduler.WaitSeconds(start), 0.1);
+        bool drawn = RunFrame(scheduler, waiter, frameSeconds);
+        bool onTime = waiter.now - ToDuration(frameSeconds) == start + ToDuration(0.1);
+        //the frame consumed the timer; callers ask again each frame for what they still need
+        bool consumed = scheduler.WaitSeconds(waiter.now) < 0.0;
+        Report("timer deadline", waitsForEarliest && drawn && onTime && consumed && waiter.waits == 1, allOk);
+
+        Clock::time_point at = waiter.now + ToDuration(2.0);
+        scheduler.RequestFrameAt(at);
+        bool before = !scheduler.ShouldRender(at - Clock::duration(1));
+        RunFrame(scheduler, waiter, 0.0);
+        Report("timer by time point", before && waiter.now == at, allOk);
+    }
+
+    //clamping: never a negative wait for something overdue, never past kMaxWaitSeconds
+    {
+        FakeWaiter waiter(Clock::now());
+        FrameScheduler scheduler(burstSeconds);
+        RunFrame(scheduler, waiter, frameSeconds);
+        Clock::time_point now = waiter.now;
+        bool none = scheduler.WaitSeconds(now) < 0.0;
+
+        scheduler.RequestFrameIn(now, 1.0);
+        bool overdue = scheduler.WaitSeconds(now + ToDuration(5.0)) == 0.0;
+        bool remaining = Near(scheduler.WaitSeconds(now + ToDuration(0.75)), 0.25);
+        scheduler.BeginFrame(now + ToDuration(5.0));
+
+        scheduler.RequestFrameIn(now, -3.0);
+        bool late = scheduler.ShouldRender(now) && scheduler.WaitSeconds(now) == 0.0;
+        scheduler.BeginFrame(now);
+
+        //far past any time_point a double could be added to
+        scheduler.RequestFrameIn(now, 1e300);
+        bool far = Near(scheduler.WaitSeconds(now), FrameScheduler::kMaxWaitSeconds);
+        scheduler.BeginFrame(now + ToDuration(FrameScheduler::kMaxWaitSeconds));
+        scheduler.RequestFrameAt(now + std::chrono::hours(24 * 365));
+        bool farAt = Near(scheduler.WaitSeconds(now), FrameScheduler::kMaxWaitSeconds);
+        std::printf("waits: none %s, overdue 0, far timer %.0f s\n", none ? "-1" : "set", scheduler.WaitSeconds(now));
+        Report("wait clamping", none && overdue && remaining && late && far && farAt, allOk);
+    }
+
+    //Wake from another thread gets a frame out of a loop blocked with no timeout, whether it lands
+    //before the wait starts or during it
+    {
+        FakeWaiter waiter(Clock::now());
+        FrameScheduler scheduler(burstSeconds);
+        RunFrame(scheduler, waiter, frameSeconds);
+        std::atomic<int> round{ -1 };
+        std::atomic<int> woken{ 0 };
+        std::thread waker([&] {
+            std::mt19937 rng(11);
+            for (int i = 0; i < wakes; i++) {
+                while (round.load(std::memory_order_acquire) < i) {
+                    std::this_thread::yield();
+                }
+                if (rng() % 2 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(rng() % 200));
+                }
+                scheduler.Wake();
+                waiter.Wake();
+                woken.fetch_add(1, std::memory_order_release);
+            }
+        });
+        int frames = 0;
+        int lost = 0;
+        BenchTimer timer;
+        for (int i = 0; i < wakes; i++) {
+            round.store(i, std::memory_order_release);
+            //spin through spurious turns until the wake of this round got its frame
+            bool drawn = false;
+            for (int tries = 0; tries < 3 && !drawn; tries++) {
+                drawn = RunFrame(scheduler, waiter, 0.0);
+            }
+            frames += drawn ? 1 : 0;
+            lost += drawn ? 0 : 1;
+            while (woken.load(std::memory_order_acquire) <= i) {
+                std::this_thread::yield();
+            }
+            if (waiter.stuck) {
+                break;
+            }
+        }
+        round.store(wakes, std::memory_order_release);
+        waker.join();
+        double seconds = timer.Seconds();
+        std::printf("wake: %d of %d wakes drew a frame, %.1f us each\n", frames, wakes, seconds * 1e6 / static_cast<double>(wakes));
+        Report("wake from another thread", frames == wakes && lost == 0 && !waiter.stuck, allOk);
+    }
+
+    return allOk ? 0 : 1;
+}
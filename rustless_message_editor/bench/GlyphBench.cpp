@@ -0,0 +1,207 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "EditorUI.h"
+#include "GlyphAtlas.h"
+#include "GlyphSet.h"
+
+#include "imgui.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Dialogue beyond ASCII, the way localized and stylized lines tend to be.
+const char* kUnicodeLines[] = {
+    "\xE2\x80\x9CThou art a serf\xE2\x80\x9D \xE2\x80\x94 said the king\xE2\x80\xA6",
+    "Caf\xC3\xA9 na\xC3\xAFve fa\xC3\xA7" "ade \xC3\xBC" "ber sch\xC3\xB6n",
+    "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82, \xD0\xBA\xD0\xBE\xD1\x80\xD0\xBE\xD0\xBB\xD1\x8C",
+    "\xCE\x9A\xCE\xB1\xCE\xBB\xCE\xB7\xCE\xBC\xCE\xAD\xCF\x81\xCE\xB1 \xCE\xB2\xCE\xB1\xCF\x83\xCE\xB9\xCE\xBB\xCE\xB9\xCE\xAC",
+    "\xE7\x8E\x8B\xE6\xA7\x98\xE3\x81\xAF\xE3\x81\x93\xE3\x81\xA1\xE3\x82\x89\xE3\x81\xA7\xE3\x81\x99",
+    "lol \xF0\x9F\x98\x80 \xE2\x99\xA5 \xE2\x9C\x93",
+};
+
+// Waits for the worker to finish a build and installs it, like main.cpp does between frames.
+bool WaitAndInstall(GlyphAtlasWorker& worker, double& seconds) {
+    BenchTimer timer;
+    while (timer.Seconds() < 30.0) {
+        if (worker.Install(ImGui::GetIO())) {
+            seconds = timer.Seconds();
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return false;
+}
+
+void Frame(EditorState& state) {
+    ImGui::NewFrame();
+    DrawEditor(state, ImGui::GetIO().DisplaySize);
+    ImGui::Render();
+}
+
+void PrintAtlas(const char* label, const GlyphAtlasStats& stats) {
+    std::printf("  %-16s %8.2f ms  %6zu glyphs  %5dx%-5d  %8.1f KB RGBA32\n", label, stats.seconds * 1000.0, stats.glyphs, stats.width, stats.height,
+        stats.textureBytes / 1024.0);
+}
+
+// The minimal atlas against the broad range sets projects usually add, and against every glyph
+// of the Basic Multilingual Plane the font has; each built like the worker does.
+int CompareBuilds(const GlyphSet& glyphs, const std::string& font) {
+    std::vector<ImWchar> minimal = GlyphAtlasRanges(glyphs);
+    ImFontAtlas shared;
+    ImFontGlyphRangesBuilder broadBuilder;
+    broadBuilder.AddRanges(shared.GetGlyphRangesDefault());
+    broadBuilder.AddRanges(shared.GetGlyphRangesGreek());
+    broadBuilder.AddRanges(shared.GetGlyphRangesCyrillic());
+    broadBuilder.AddRanges(shared.GetGlyphRangesVietnamese());
+    broadBuilder.AddRanges(shared.GetGlyphRangesJapanese());
+    ImVector<ImWchar> broad;
+    broadBuilder.BuildRanges(&broad);
+    const ImWchar whole[] = { 0x20, 0xFFFF, 0 };
+
+    GlyphAtlasStats minimalStats;
+    GlyphAtlasStats broadStats;
+    GlyphAtlasStats wholeStats;
+    ImFontAtlas minimalAtlas;
+    ImFontAtlas broadAtlas;
+    ImFontAtlas wholeAtlas;
+    bool built = BuildGlyphAtlas(minimalAtlas, font, 16.0f, minimal.data(), minimalStats) && BuildGlyphAtlas(broadAtlas, font, 16.0f, broad.Data, broadStats)
+        && BuildGlyphAtlas(wholeAtlas, font, 16.0f, whole, wholeStats);
+    if (!built) {
+        std::printf("MISMATCH: an atlas failed to build\n");
+        return 1;
+    }
+    PrintAtlas("used glyphs", minimalStats);
+    PrintAtlas("broad ranges", broadStats);
+    PrintAtlas("whole BMP", wholeStats);
+    std::printf("  used glyphs: %.0fx faster to build and %.0fx less texture than the broad ranges\n", broadStats.seconds / minimalStats.seconds,
+        static_cast<double>(broadStats.textureBytes) / static_cast<double>(minimalStats.textureBytes));
+
+    //every used code point the font has must have made it into the small atlas
+    int missing = 0;
+    for (auto& range : glyphs.Ranges()) {
+        for (uint32_t c = std::max<uint32_t>(range.first, 0x20); c <= range.second && c <= IM_UNICODE_CODEPOINT_MAX; c++) {
+            if (wholeAtlas.Fonts[0]->FindGlyphNoFallback(static_cast<ImWchar>(c)) != nullptr
+                && minimalAtlas.Fonts[0]->FindGlyphNoFallback(static_cast<ImWchar>(c)) == nullptr) {
+                missing++;
+            }
+        }
+    }
+    if (missing != 0) {
+        std::printf("MISMATCH: %d used glyphs the font has are missing from the atlas\n", missing);
+        return 1;
+    }
+    return 0;
+}
+
+// The editor itself: the atlas for a loaded project, then an edit bringing in a new code point.
+int RunEditor(const fs::path& directory, const CorpusOptions& options) {
+    fs::create_directories(directory / "Content" / "Data");
+    WriteSyntheticCorpus((directory / "load.json").string(), options);
+    fs::path previous = fs::current_path();
+    fs::current_path(directory);
+
+    int failed = 0;
+    {
+        EditorState state;
+        LoadEditorProject(state);
+        Frame(state);
+        double firstSeconds = 0.0;
+        bool first = WaitAndInstall(state.glyphAtlas, firstSeconds);
+        Frame(state);
+
+        //a letter no synthetic line has, typed into the first message
+        const ImWchar added = 0x0416;
+        Edit edit;
+        edit.character = 0;
+        edit.message = 0;
+        edit.field = MessageField::Content;
+        edit.after.text = std::string(state.characters[0].messages[0].content.View()) + " \xD0\x96";
+        MakeEdit(state, std::move(edit));
+        BenchTimer extendTimer;
+        Frame(state);
+        double installSeconds = 0.0;
+        bool extended = WaitAndInstall(state.glyphAtlas, installSeconds);
+        double extendSeconds = extendTimer.Seconds();
+        Frame(state);
+
+        ImFont* font = ImGui::GetIO().Fonts->Fonts[0];
+        bool hasGlyph = font->FindGlyphNoFallback(added) != nullptr;
+        GlyphAtlasStats stats = state.glyphAtlas.Stats();
+        std::printf("editor: first atlas %s, %zu glyphs; after an edit with a new letter, rebuilt and installed in %.2f ms (%s)\n", first ? "installed" : "NOT BUILT",
+            stats.glyphs, extendSeconds * 1000.0, hasGlyph ? "glyph present" : "GLYPH MISSING");
+        //the built-in font has no Cyrillic, so only a real font can be expected to draw it
+        if (!first || !extended || (!stats.font.empty() && stats.font != "built-in" && !hasGlyph)) {
+            failed++;
+        }
+    }
+    fs::current_path(previous);
+    return failed;
+}
+
+}
+
+int RunGlyphBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 64.0) * 1024 * 1024;
+    std::string font = argc >= 2 ? argv[1] : FindEditorFont();
+    std::string fontBytes;
+    if (!font.empty()) {
+        std::ifstream file(font, std::ios::binary);
+        fontBytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::printf("font: %s (%.1f KB)\n", font.empty() ? "ImGui built-in" : font.c_str(), fontBytes.size() / 1024.0);
+
+    //a scan over a big corpus, then the lines beyond ASCII added on top
+    const std::string path = "rustless_bench_glyphs.json";
+    WriteSyntheticCorpus(path, options);
+    std::vector<Character> characters;
+    LoadCharactersFromFile(path, characters);
+    std::size_t textBytes = 0;
+    for (auto& character : characters) {
+        for (auto& message : character.messages) {
+            textBytes += message.content.size() + message.responce[0].content.size() + message.responce[1].content.size() + message.responce[0].reply.size()
+                + message.responce[1].reply.size();
+        }
+    }
+    GlyphSet glyphs;
+    BenchTimer scanTimer;
+    for (auto& character : characters) {
+        glyphs.Add(character);
+    }
+    double scanSeconds = scanTimer.Seconds();
+    for (const char* line : kUnicodeLines) {
+        glyphs.Add(std::string_view(line));
+    }
+    std::printf("scan: %.1f MB of text in %.3f s (%.0f MB/s), %zu code points used\n", ToMegabytes(textBytes), scanSeconds, ToMegabytes(textBytes) / scanSeconds,
+        glyphs.Count());
+
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 800.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = nullptr;
+    unsigned char* pixels;
+    int width;
+    int height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    int failed = CompareBuilds(glyphs, fontBytes);
+    CorpusOptions small;
+    small.targetBytes = 1 << 20;
+    failed += RunEditor("rustless_bench_glyphs", small);
+    ImGui::DestroyContext();
+
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove_all("rustless_bench_glyphs", ec);
+    return failed == 0 ? 0 : 1;
+}
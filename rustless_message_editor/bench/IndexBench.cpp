@@ -0,0 +1,108 @@
+#include "Bench.h"
+#include "DialogueIndex.h"
+#include "DialogueLoader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+namespace {
+
+// Replays the old load loop's character lookup (one by-value DoesCharacterExist per message).
+double TimeBaselineLookup(const std::vector<Character>& loaded, std::size_t messages, bool interleave) {
+    std::vector<Character> built;
+    std::size_t perCharacter = messages / loaded.size();
+    BenchTimer timer;
+    for (std::size_t k = 0; k < messages; k++) {
+        std::size_t speaker = interleave ? k % loaded.size() : k / perCharacter;
+        const std::string& name = loaded[speaker < loaded.size() ? speaker : loaded.size() - 1].name;
+        int charLoc = DoesCharacterExist(built, name);
+        if (charLoc != -1) {
+            built.at(charLoc).messages.push_back(Message());
+        }
+        else {
+            Character newCharacter;
+            newCharacter.name = name;
+            newCharacter.messages.push_back(Message());
+            built.push_back(newCharacter);
+        }
+    }
+    return timer.Seconds();
+}
+
+}
+
+int RunIndexBench(int argc, char** argv) {
+    std::size_t maxMessages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 1000000;
+    int characters = argc >= 2 ? std::atoi(argv[1]) : 1000;
+    std::size_t baselineLimit = argc >= 3 ? static_cast<std::size_t>(std::atoll(argv[2])) : 20000;
+
+    std::printf("%10s %14s %14s %12s %14s %14s\n", "messages", "old lookup", "load ns/msg", "rebuild ms", "find ID ns", "find name ns");
+    for (std::size_t messages = 10000; messages <= maxMessages; messages *= 10) {
+        CorpusOptions options;
+        options.messages = messages;
+        options.characters = characters;
+        options.interleave = true;
+        options.minWords = 1;
+        options.maxWords = 4;
+
+        std::string corpus;
+        {
+            std::ostringstream out;
+            WriteSyntheticCorpus(out, options);
+            corpus = out.str();
+        }
+
+        std::vector<Character> loaded;
+        BenchTimer loadTimer;
+        LoadResult result = LoadCharacters(corpus.data(), corpus.data() + corpus.size(), loaded);
+        double loadSeconds = loadTimer.Seconds();
+        corpus.clear();
+        corpus.shrink_to_fit();
+        if (!result.ok) {
+            std::printf("load failed: %s\n", result.error.c_str());
+            return 1;
+        }
+
+        char baseline[32] = "-";
+        if (messages <= baselineLimit) {
+            std::snprintf(baseline, sizeof(baseline), "%.3f s", TimeBaselineLookup(loaded, messages, options.interleave));
+        }
+
+        DialogueIndex index;
+        BenchTimer rebuildTimer;
+        index.Rebuild(loaded);
+        double rebuildSeconds = rebuildTimer.Seconds();
+
+        //IDs are written as message * 100, so mix hits with misses
+        const int lookups = 1000000;
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int32_t> id(0, static_cast<int32_t>(messages * 100));
+        std::uniform_int_distribution<int> speaker(0, characters * 2);
+        long long found = 0;
+        BenchTimer idTimer;
+        for (int i = 0; i < lookups; i++) {
+            found += index.FindMessage(id(rng) / 100 * 100).message;
+        }
+        double idSeconds = idTimer.Seconds();
+
+        std::vector<std::string> names;
+        for (int i = 0; i <= characters * 2; i++) {
+            names.push_back("Character " + std::to_string(i));
+        }
+        BenchTimer nameTimer;
+        for (int i = 0; i < lookups; i++) {
+            found += index.FindCharacter(names[speaker(rng)]);
+        }
+        double nameSeconds = nameTimer.Seconds();
+
+        std::printf("%10zu %14s %14.1f %12.2f %14.1f %14.1f\n", messages, baseline,
+            loadSeconds * 1e9 / static_cast<double>(messages), rebuildSeconds * 1e3,
+            idSeconds * 1e9 / lookups, nameSeconds * 1e9 / lookups);
+        if (found == 42) {
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
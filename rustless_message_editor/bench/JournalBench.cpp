@@ -0,0 +1,371 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "EditJournal.h"
+#include "EditorUI.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* kJournal = "Content/Data/autosave.journal";
+
+const MessageField kTextFields[] = { MessageField::Content, MessageField::Content1, MessageField::Reply1, MessageField::Content2, MessageField::Reply2 };
+const MessageField kNumberFields[] = { MessageField::TimeToRespond, MessageField::ID, MessageField::Health1, MessageField::Health2 };
+
+// Raw append cost and how few syncs the batching leaves, without the editor around it.
+int RunAppend(int appends) {
+    const std::string path = "rustless_bench_append.journal";
+    EditJournal journal;
+    std::string error;
+    if (!journal.Start(path, JournalBase{ "load.json", 1 }, nullptr, error)) {
+        std::printf("could not start a journal: %s\n", error.c_str());
+        return 1;
+    }
+    Edit edit;
+    edit.after.text = "a typical line of dialogue, about as long as most of them are";
+    BenchTimer timer;
+    for (int k = 0; k < appends; k++) {
+        //a different message every time, so nothing coalesces
+        edit.character = k % 64;
+        edit.message = k;
+        journal.Append(edit, false);
+    }
+    double appendSeconds = timer.Seconds();
+    journal.Flush();
+    double flushedSeconds = timer.Seconds();
+    JournalStatus status = journal.Status();
+    journal.Stop();
+
+    JournalContents contents;
+    bool read = ReadJournal(path, contents, error);
+    std::error_code ec;
+    std::size_t bytes = static_cast<std::size_t>(fs::file_size(path, ec));
+    fs::remove(path, ec);
+    std::printf("append: %d edits, %.0f ns each, all synced after %.3f s in %llu syncs, %.1f MB\n", appends, appendSeconds * 1e9 / appends, flushedSeconds,
+        static_cast<unsigned long long>(status.syncs), ToMegabytes(bytes));
+    if (!read || contents.edits.size() != static_cast<std::size_t>(appends) || contents.tornBytes != 0) {
+        std::printf("MISMATCH: read back %zu of %d edits\n", contents.edits.size(), appends);
+        return 1;
+    }
+    return 0;
+}
+
+// Edits like a user makes them: mostly typing into text fields a keystroke at a time, plus
+// numbers, renames, added and deleted messages and characters, and some undo and redo.
+void RandomEdits(EditorState& state, std::mt19937& random, int count) {
+    int made = 0;
+    while (made < count) {
+        int i = static_cast<int>(random() % state.characters.size());
+        Character& character = state.characters[i];
+        int roll = static_cast<int>(random() % 100);
+        int messages = static_cast<int>(character.messages.size());
+        Edit edit;
+        edit.character = i;
+        if (character.lazySlot >= 0 || roll >= 90) {
+            if (roll < 95 || state.characters.size() < 8) {
+                edit.kind = EditKind::Rename;
+                edit.after.text = character.name + "'";
+            }
+            else if (roll < 98) {
+                edit.kind = EditKind::CharacterAdded;
+                edit.characterData.name = "Bench character " + std::to_string(made);
+                edit.characterData.messages.resize(2);
+                edit.treeName = edit.characterData.name;
+            }
+            else {
+                edit.kind = EditKind::CharacterDeleted;
+            }
+            MakeEdit(state, std::move(edit));
+            made++;
+            continue;
+        }
+        if (messages == 0 || roll < 3) {
+            edit.kind = EditKind::MessageAdded;
+            edit.message = static_cast<int>(random() % (messages + 1));
+            edit.messageData.content = "added by the journal bench";
+            edit.messageData.ID = 900000000 + made;
+            MakeEdit(state, std::move(edit));
+            made++;
+            continue;
+        }
+        edit.message = static_cast<int>(random() % messages);
+        if (roll < 6) {
+            edit.kind = EditKind::MessageDeleted;
+            MakeEdit(state, std::move(edit));
+            made++;
+        }
+        else if (roll < 70) {
+            edit.field = kTextFields[random() % 5];
+            std::string text = GetField(character.messages[edit.message], edit.field).text;
+            for (char c : std::string(" typed")) {
+                text += c;
+                edit.after.text = text;
+                MakeEdit(state, edit);
+                made++;
+            }
+        }
+        else if (roll < 80) {
+            edit.field = kNumberFields[random() % 4];
+            edit.after.number = static_cast<int>(random() % 1000);
+            MakeEdit(state, std::move(edit));
+            made++;
+        }
+        else if (roll < 84) {
+            edit.field = MessageField::Relationship;
+            edit.after.number = static_cast<int>(random() % 3);
+            MakeEdit(state, std::move(edit));
+            made++;
+        }
+        else {
+            UndoEdit(state);
+            if (roll % 2 == 0) {
+                RedoEdit(state);
+            }
+            made++;
+        }
+    }
+}
+
+struct Expected {
+    std::vector<Character> characters;
+    std::vector<std::string> treeNames;
+};
+
+bool Matches(const EditorState& state, const Expected& expected) {
+    return SameCharacters(state.characters, expected.characters) && state.treeNames == expected.treeNames;
+}
+
+// Runs one editor frame, which is where compaction is started from.
+void Frame(EditorState& state) {
+    ImGui::NewFrame();
+    DrawEditor(state, ImGui::GetIO().DisplaySize);
+    ImGui::Render();
+}
+
+// Ctrl+S, then frames until the save is written and the menu bar has seen it finish.
+bool SaveInEditor(EditorState& state) {
+    ImGuiIO& io = ImGui::GetIO();
+    io.AddKeyEvent(ImGuiMod_Ctrl, true);
+    io.AddKeyEvent(ImGuiKey_S, true);
+    Frame(state);
+    io.AddKeyEvent(ImGuiKey_S, false);
+    io.AddKeyEvent(ImGuiMod_Ctrl, false);
+    BenchTimer timer;
+    while (timer.Seconds() < 120.0 && (state.pendingSave != PendingSave::None || state.saveWorker.Busy())) {
+        Frame(state);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Frame(state);
+    return state.saveWorker.Status().state == SaveState::Done;
+}
+
+// Cuts the journal's last record in half, the way a crash in the middle of a write would.
+void TearLastRecord() {
+    JournalContents contents;
+    std::string error;
+    ReadJournal(kJournal, contents, error);
+    std::size_t cut = contents.edits.size() < 2 ? contents.validBytes : (contents.edits[contents.edits.size() - 2].end + contents.validBytes) / 2;
+    fs::resize_file(kJournal, cut);
+}
+
+int RunEditorSessions(int edits) {
+    int failed = 0;
+    std::mt19937 random(1234);
+    Expected expected;
+
+    //a session that crashes: everything it synced has to come back
+    {
+        EditorState state;
+        LoadEditorProject(state);
+        BenchTimer timer;
+        RandomEdits(state, random, edits);
+        double editSeconds = timer.Seconds();
+        state.journal.Flush();
+        double flushSeconds = timer.Seconds() - editSeconds;
+        JournalStatus status = state.journal.Status();
+        std::printf("session 1: %d edits in %.3f s (%.1f us each), %llu records after coalescing typing, %llu syncs, %.2f MB journal, last flush %.3f s\n",
+            edits, editSeconds, editSeconds * 1e6 / edits, static_cast<unsigned long long>(status.records), static_cast<unsigned long long>(status.syncs),
+            ToMegabytes(status.editBytes), flushSeconds);
+        //one more edit, torn below, which is the only thing a crash may lose
+        expected.characters = state.characters;
+        expected.treeNames = state.treeNames;
+        Edit edit;
+        edit.kind = EditKind::Rename;
+        edit.character = 0;
+        edit.after.text = "lost in the crash";
+        MakeEdit(state, std::move(edit));
+        state.journal.Flush();
+    }
+    TearLastRecord();
+
+    //replays it, cut off where the crash was, then gets compacted
+    {
+        EditorState state;
+        BenchTimer timer;
+        LoadEditorProject(state);
+        double loadSeconds = timer.Seconds();
+        JournalContents contents;
+        std::string error;
+        ReadJournal(kJournal, contents, error);
+        std::printf("session 2: loaded and replayed in %.3f s, torn record %s\n", loadSeconds, contents.tornBytes == 0 ? "cut off" : "STILL THERE");
+        if (!Matches(state, expected) || contents.tornBytes != 0) {
+            std::printf("MISMATCH: the replayed document differs from the one before the crash\n");
+            failed++;
+        }
+
+        std::error_code ec;
+        std::size_t before = static_cast<std::size_t>(fs::file_size(kJournal, ec));
+        state.compactJournalBytes = 1;
+        timer = BenchTimer();
+        Frame(state);
+        state.compactJournalBytes = std::size_t(8) << 20;
+        RandomEdits(state, random, edits / 10);
+        state.journal.Flush();
+        double compactSeconds = timer.Seconds();
+        std::size_t after = static_cast<std::size_t>(fs::file_size(kJournal, ec));
+        std::printf("  compacted %.2f MB of journal into a %.2f MB snapshot plus %d edits in %.3f s\n", ToMegabytes(before), ToMegabytes(after), edits / 10, compactSeconds);
+        if (!state.journal.Status().error.empty()) {
+            std::printf("MISMATCH: compaction failed: %s\n", state.journal.Status().error.c_str());
+            failed++;
+        }
+        expected.characters = state.characters;
+        expected.treeNames = state.treeNames;
+    }
+
+    //starts from the snapshot
+    {
+        EditorState state;
+        BenchTimer timer;
+        LoadEditorProject(state);
+        std::printf("session 3: loaded the snapshot and replayed in %.3f s\n", timer.Seconds());
+        if (!Matches(state, expected)) {
+            std::printf("MISMATCH: the document restored from the snapshot differs\n");
+            failed++;
+        }
+    }
+
+    //load.json changed under the journal, which mustn't be replayed onto it
+    {
+        std::ofstream out("load.json", std::ios::binary | std::ios::app);
+        out << "\n";
+    }
+    {
+        EditorState state;
+        LoadEditorProject(state);
+        std::vector<Character> fresh;
+        LoadCharactersFromFile("load.json", fresh);
+        //a big load.json opened lazily still has most characters unparsed
+        std::vector<Character> loaded = state.characters;
+        for (auto& character : loaded) {
+            if (character.lazySlot >= 0) {
+                state.lazy.LoadNow(character.lazySlot, character.messages);
+            }
+        }
+        std::error_code ec;
+        bool aside = fs::exists(std::string(kJournal) + ".stale", ec);
+        std::printf("session 4: source changed, journal %s\n", aside ? "set aside" : "NOT SET ASIDE");
+        if (!aside || !SameCharacters(loaded, fresh)) {
+            std::printf("MISMATCH: a stale journal was replayed\n");
+            failed++;
+        }
+    }
+
+    //a save starts the journal over, so a crash after it replays only the edits that came later
+    bool saved;
+    {
+        EditorState state;
+        LoadEditorProject(state);
+        RandomEdits(state, random, edits / 10);
+        saved = SaveInEditor(state);
+        RandomEdits(state, random, 3);
+        state.journal.Flush();
+        expected.characters = state.characters;
+        expected.treeNames = state.treeNames;
+    }
+    {
+        JournalContents contents;
+        std::string error;
+        ReadJournal(kJournal, contents, error);
+        EditorState state;
+        LoadEditorProject(state);
+        std::printf("session 5: crashed after a save, journal holds %s and %zu edits\n", contents.hasSnapshot ? "the save" : "NO SNAPSHOT", contents.edits.size());
+        if (!saved || !contents.hasSnapshot || contents.edits.empty() || contents.edits.size() > 3 || !Matches(state, expected)) {
+            std::printf("MISMATCH: the journal wasn't started over from the save\n");
+            failed++;
+        }
+        //what came back isn't saved yet, so a normal exit keeps it
+        CloseEditorProject(state);
+        std::error_code ec;
+        if (!fs::exists(kJournal, ec)) {
+            std::printf("MISMATCH: a normal exit dropped unsaved edits\n");
+            failed++;
+        }
+    }
+
+    //a normal exit with everything saved leaves nothing to replay
+    {
+        EditorState state;
+        LoadEditorProject(state);
+        saved = SaveInEditor(state);
+        CloseEditorProject(state);
+    }
+    {
+        std::error_code ec;
+        bool removed = !fs::exists(kJournal, ec);
+        EditorState state;
+        LoadEditorProject(state);
+        bool clean = std::none_of(state.characters.begin(), state.characters.end(), [](const Character& character) { return character.dirty; });
+        std::printf("session 6: saved and closed, journal %s, next load %s\n", removed ? "removed" : "STILL THERE", clean ? "clean" : "REPLAYED");
+        if (!saved || !removed || !clean) {
+            std::printf("MISMATCH: a journal outlived a clean exit\n");
+            failed++;
+        }
+    }
+    return failed;
+}
+
+}
+
+int RunJournalBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 8.0) * 1024 * 1024;
+    int edits = argc >= 2 ? std::atoi(argv[1]) : 20000;
+
+    int failed = RunAppend(edits * 5);
+
+    const fs::path directory = "rustless_bench_journal";
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+    fs::create_directories(directory / "Content" / "Data");
+    std::size_t messages = WriteSyntheticCorpus((directory / "load.json").string(), options);
+    std::printf("%.1f MB load.json, %zu messages, %d characters\n", ToMegabytes(static_cast<std::size_t>(fs::file_size(directory / "load.json"))), messages, options.characters);
+    fs::path previous = fs::current_path();
+    fs::current_path(directory);
+
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 800.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = nullptr;
+    unsigned char* pixels;
+    int width;
+    int height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    failed += RunEditorSessions(edits);
+    ImGui::DestroyContext();
+
+    fs::current_path(previous);
+    fs::remove_all(directory, ec);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "EditorUI.h"
+#include "LazyLoad.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Waits for the loader's next results, polling like an idle editor woken by SetOnLoaded would.
+bool WaitForLoaded(LazyLoader& loader, std::vector<LazyLoaded>& loaded, double timeoutSeconds) {
+    BenchTimer timer;
+    while (!loader.Take(loaded)) {
+        if (timer.Seconds() > timeoutSeconds) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+// Outline, one character, then everything, checked against the eager load of the same file.
+int RunLoader(const char* label, const std::string& path, const CorpusOptions& options) {
+    std::size_t messages = WriteSyntheticCorpus(path, options);
+    std::printf("%s: %.1f MB, %zu messages, %d characters\n", label, ToMegabytes(static_cast<std::size_t>(fs::file_size(path))), messages, options.characters);
+
+    std::vector<Character> eager;
+    BenchTimer eagerTimer;
+    LoadResult eagerLoad = LoadCharactersFromFile(path, eager);
+    double eagerSeconds = eagerTimer.Seconds();
+
+    LazyLoader loader;
+    std::vector<Character> lazy;
+    BenchTimer openTimer;
+    LoadResult opened = loader.Open(path, lazy);
+    double openSeconds = openTimer.Seconds();
+    if (!eagerLoad.ok || !opened.ok) {
+        std::printf("load failed: %s\n", eagerLoad.ok ? opened.error.c_str() : eagerLoad.error.c_str());
+        return 1;
+    }
+
+    std::vector<LazyLoaded> loaded;
+    BenchTimer firstTimer;
+    loader.Request(0);
+    bool gotFirst = WaitForLoaded(loader, loaded, 60.0);
+    double firstSeconds = firstTimer.Seconds();
+    for (auto& character : loaded) {
+        lazy[character.slot].messages = std::move(character.messages);
+    }
+
+    BenchTimer restTimer;
+    for (int slot = 1; slot < static_cast<int>(lazy.size()); slot++) {
+        loader.Request(slot);
+    }
+    std::size_t remaining = lazy.size() - 1;
+    int failed = 0;
+    while (remaining > 0 && WaitForLoaded(loader, loaded, 60.0)) {
+        for (auto& character : loaded) {
+            failed += character.result.ok ? 0 : 1;
+            lazy[character.slot].messages = std::move(character.messages);
+            remaining--;
+        }
+    }
+    double restSeconds = restTimer.Seconds();
+
+    std::printf("  eager load           %8.3f s\n", eagerSeconds);
+    std::printf("  outline (first frame)%8.3f s   %.1fx sooner\n", openSeconds, eagerSeconds / openSeconds);
+    std::printf("  first character      %8.3f s   (%zu messages)\n", firstSeconds, loader.MessageCount(0));
+    std::printf("  all the rest         %8.3f s\n", restSeconds);
+    for (auto& character : lazy) {
+        character.lazySlot = -1;
+    }
+    if (!gotFirst || remaining != 0 || failed != 0 || !SameCharacters(eager, lazy)) {
+        std::printf("MISMATCH: the lazily loaded characters differ from the eager load\n");
+        return 1;
+    }
+    return 0;
+}
+
+// A broken message still lets the file open; only its character fails, with the file position.
+int RunBrokenMessage(const std::string& path) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "{ \"messages\": [\n"
+               "  { \"from\": \"a\", \"content\": \"fine\", \"ID\": 1 },\n"
+               "  { \"from\": \"b\", \"content\": \"broken\", \"ID\": \"two\" }\n"
+               "] }\n";
+    }
+    LazyLoader loader;
+    std::vector<Character> characters;
+    LoadResult opened = loader.Open(path, characters);
+    loader.Request(0);
+    loader.Request(1);
+    std::vector<LazyLoaded> all;
+    std::vector<LazyLoaded> loaded;
+    while (all.size() < 2 && WaitForLoaded(loader, loaded, 10.0)) {
+        for (auto& character : loaded) {
+            all.push_back(std::move(character));
+        }
+    }
+    std::string error = loader.Error(1);
+    std::printf("broken message: opened %s, error \"%s\"\n", opened.ok ? "ok" : "FAILED", error.c_str());
+    bool good = opened.ok && all.size() == 2 && loader.Error(0).empty() && error.find("line 3") != std::string::npos;
+    return good ? 0 : 1;
+}
+
+// The editor itself: load.json opened lazily, one character expanded, then a save that has to
+// wait for the rest.
+int RunEditor(const fs::path& directory, const CorpusOptions& options) {
+    fs::create_directories(directory / "Content" / "Data");
+    WriteSyntheticCorpus((directory / "load.json").string(), options);
+    fs::path previous = fs::current_path();
+    fs::current_path(directory);
+
+    int failed = 0;
+    {
+        EditorState state;
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(1280.0f, 800.0f);
+        io.DeltaTime = 1.0f / 60.0f;
+        io.IniFilename = nullptr;
+        unsigned char* pixels;
+        int width;
+        int height;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+        auto frame = [&]() {
+            ImGui::NewFrame();
+            DrawEditor(state, io.DisplaySize);
+            ImGui::Render();
+        };
+
+        BenchTimer firstFrameTimer;
+        LoadEditorProject(state);
+        //smaller files are loaded whole
+        bool lazy = std::any_of(state.characters.begin(), state.characters.end(), [](const Character& character) { return character.lazySlot >= 0; });
+        frame();
+        double firstFrame = firstFrameTimer.Seconds();
+
+        //jumpTo opens the character's tree node, which asks for its messages
+        BenchTimer expandTimer;
+        while (state.characters[0].lazySlot >= 0 && expandTimer.Seconds() < 60.0) {
+            state.jumpTo = MessageLocation{ 0, -1 };
+            frame();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double expand = expandTimer.Seconds();
+
+        BenchTimer saveTimer;
+        io.AddKeyEvent(ImGuiMod_Ctrl, true);
+        io.AddKeyEvent(ImGuiKey_S, true);
+        frame();
+        io.AddKeyEvent(ImGuiKey_S, false);
+        io.AddKeyEvent(ImGuiMod_Ctrl, false);
+        while (saveTimer.Seconds() < 120.0) {
+            frame();
+            SaveState saved = state.saveWorker.Status().state;
+            if (state.pendingSave == PendingSave::None && (saved == SaveState::Done || saved == SaveState::Failed)) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double save = saveTimer.Seconds();
+        std::printf("editor: first frame %.3f s, opened one character in %.3f s, loaded the rest and saved in %.3f s\n", firstFrame, expand, save);
+
+        std::vector<Character> original;
+        std::vector<Character> written;
+        LoadCharactersFromFile("load.json", original);
+        LoadCharactersFromFile("Content/Data/messages.json", written);
+        if (state.saveWorker.Status().state != SaveState::Done || !SameCharacters(original, written)) {
+            std::printf("MISMATCH: the save of a lazily loaded project differs from the file\n");
+            failed++;
+        }
+        //live reload can't watch a file the loader is still reading, and the menu bar says so
+        if (lazy && (state.reload.Running() || state.reloadOff.empty())) {
+            std::printf("MISMATCH: a lazily loaded load.json doesn't show live reload as off\n");
+            failed++;
+        }
+        ImGui::DestroyContext();
+    }
+
+    fs::current_path(previous);
+    return failed;
+}
+
+}
+
+int RunLazyBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 256.0) * 1024 * 1024;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+
+    const std::string path = "rustless_bench_lazy.json";
+    int failed = 0;
+    failed += RunLoader("grouped", path, options);
+    options.interleave = true;
+    failed += RunLoader("interleaved", path, options);
+    failed += RunBrokenMessage(path);
+
+    const fs::path directory = "rustless_bench_lazy";
+    options.interleave = false;
+    failed += RunEditor(directory, options);
+
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove_all(directory, ec);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+
+#include <json.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+// The load loop main() used before the SAX loader, kept as the baseline.
+// Only the character lookup differs: it checks the previous speaker first like the
+// SAX loader does, because the original per-message DoesCharacterExist copy is
+// quadratic and would never finish at these sizes (the index bench covers that part).
+void LoadCharactersDom(const std::string& path, std::vector<Character>& characters) {
+    std::ifstream f(path);
+    json data;
+    if (f.good()) {
+        data = json::parse(f);
+    }
+
+    int lastCharacter = -1;
+    for (auto& messages : data["messages"]) {
+        Message newMessage;
+
+        if (messages["content"].is_null()) {
+            newMessage.content = "";
+        }
+        else {
+            newMessage.content = messages["content"].get<std::string>();
+        }
+
+        if (messages["timeToRespond"].is_null()) {
+            newMessage.timeToRespond = 20;
+        }
+        else {
+            newMessage.timeToRespond = messages["timeToRespond"];
+        }
+
+        if (messages["relationship"].is_null()) {
+            newMessage.relationship = NEUTERAL;
+        }
+        else {
+            newMessage.relationship = messages["relationship"];
+        }
+
+        if (messages["ID"].is_null()) {
+            newMessage.ID = 0;
+        }
+        else {
+            newMessage.ID = messages["ID"];
+        }
+
+        int responseTrack = 0;
+        for (auto& response : messages["responses"]) {
+            if (response["reply"].is_null()) {
+                newMessage.responce[responseTrack].reply = "";
+            }
+            else {
+                newMessage.responce[responseTrack].reply = response["reply"].get<std::string>();
+            }
+
+            if (response["content"].is_null()) {
+                newMessage.responce[responseTrack].content = "";
+            }
+            else {
+                newMessage.responce[responseTrack].content = response["content"].get<std::string>();
+            }
+
+            if (response["health"].is_null()) {
+                newMessage.responce[responseTrack].health = 0;
+            }
+            else {
+                newMessage.responce[responseTrack].health = response["health"];
+            }
+            responseTrack++;
+        }
+
+        std::string from = messages["from"];
+        int charLoc = lastCharacter;
+        if (charLoc == -1 || characters[charLoc].name != from) {
+            charLoc = DoesCharacterExist(characters, from);
+        }
+        if (charLoc != -1) {
+            characters.at(charLoc).messages.push_back(newMessage);
+        }
+        else {
+            Character newCharacter;
+            newCharacter.name = from;
+            newCharacter.messages.push_back(newMessage);
+            characters.push_back(newCharacter);
+            charLoc = static_cast<int>(characters.size()) - 1;
+        }
+        lastCharacter = charLoc;
+    }
+}
+
+void Report(const char* name, double seconds, std::size_t fileBytes, std::size_t liveBefore) {
+    AllocStats stats = GetAllocStats();
+    std::printf("%-6s %8.3f s  %8.1f MB/s  peak heap %9.1f MB  allocations %11zu\n",
+        name, seconds, ToMegabytes(fileBytes) / seconds, ToMegabytes(stats.peakBytes - liveBefore), stats.allocations);
+}
+
+}
+
+int RunLoadBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 256.0) * 1024 * 1024;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+
+    const std::string path = "rustless_bench_load.json";
+    std::size_t messages = WriteSyntheticCorpus(path, options);
+    std::size_t fileBytes = 0;
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        fileBytes = static_cast<std::size_t>(file.tellg());
+    }
+    std::printf("corpus: %.1f MB, %zu messages, %d characters\n", ToMegabytes(fileBytes), messages, options.characters);
+
+    std::vector<Character> domCharacters;
+    std::size_t domLiveBefore = GetAllocStats().liveBytes;
+    ResetAllocStats();
+    BenchTimer domTimer;
+    LoadCharactersDom(path, domCharacters);
+    double domSeconds = domTimer.Seconds();
+    Report("dom", domSeconds, fileBytes, domLiveBefore);
+
+    std::vector<Character> saxCharacters;
+    std::size_t saxLiveBefore = GetAllocStats().liveBytes;
+    ResetAllocStats();
+    BenchTimer saxTimer;
+    LoadResult loaded = LoadCharactersFromFile(path, saxCharacters);
+    double saxSeconds = saxTimer.Seconds();
+    Report("sax", saxSeconds, fileBytes, saxLiveBefore);
+
+    std::remove(path.c_str());
+
+    if (!loaded.ok) {
+        std::cout << "sax load failed: " << loaded.error << "\n";
+        return 1;
+    }
+    if (!SameCharacters(domCharacters, saxCharacters)) {
+        std::cout << "sax and dom loads differ\n";
+        return 1;
+    }
+    std::printf("speedup %.2fx\n", domSeconds / saxSeconds);
+    return 0;
+}
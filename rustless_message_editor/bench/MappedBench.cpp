@@ -0,0 +1,119 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "DialogueWriter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+struct MappedRun {
+    double seconds = 0.0;
+    std::size_t liveBytes = 0;
+    std::size_t peakBytes = 0;
+    std::size_t allocations = 0;
+};
+
+void Report(const char* name, const MappedRun& run, std::size_t fileBytes) {
+    std::printf("%-7s %8.3f s  %8.1f MB/s  resident %8.1f MB  peak heap %8.1f MB  allocations %10zu\n",
+        name, run.seconds, ToMegabytes(fileBytes) / run.seconds, ToMegabytes(run.liveBytes), ToMegabytes(run.peakBytes), run.allocations);
+}
+
+void CountTexts(const std::vector<Character>& characters, std::size_t& texts, std::size_t& borrowed) {
+    auto count = [&](const Text& text) {
+        texts++;
+        borrowed += text.Borrowed() ? 1 : 0;
+    };
+    for (auto& character : characters) {
+        for (auto& message : character.messages) {
+            count(message.content);
+            for (auto& response : message.responce) {
+                count(response.reply);
+                count(response.content);
+            }
+        }
+    }
+}
+
+}
+
+int RunMappedBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 256.0) * 1024 * 1024;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+    int edits = argc >= 3 ? std::atoi(argv[2]) : 10000;
+
+    const std::string path = "rustless_bench_mapped.json";
+    std::size_t messages = WriteSyntheticCorpus(path, options);
+    std::size_t fileBytes = static_cast<std::size_t>(std::filesystem::file_size(path));
+    std::printf("%.1f MB, %zu messages, %d characters\n", ToMegabytes(fileBytes), messages, options.characters);
+
+    //heap the characters hold on to after each load; the copying load's read buffer is freed by then
+    std::vector<Character> copied;
+    MappedRun copy;
+    std::size_t liveBefore = GetAllocStats().liveBytes;
+    ResetAllocStats();
+    BenchTimer copyTimer;
+    LoadResult copyLoad = LoadCharactersFromFile(path, copied);
+    copy.seconds = copyTimer.Seconds();
+    AllocStats stats = GetAllocStats();
+    copy.liveBytes = stats.liveBytes - liveBefore;
+    copy.peakBytes = stats.peakBytes - liveBefore;
+    copy.allocations = stats.allocations;
+    Report("copy", copy, fileBytes);
+
+    int failed = 0;
+    {
+        MappedFile source;
+        std::vector<Character> characters;
+        MappedRun mapped;
+        liveBefore = GetAllocStats().liveBytes;
+        ResetAllocStats();
+        BenchTimer mappedTimer;
+        LoadResult mappedLoad = LoadCharactersMapped(path, source, characters);
+        mapped.seconds = mappedTimer.Seconds();
+        stats = GetAllocStats();
+        mapped.liveBytes = stats.liveBytes - liveBefore;
+        mapped.peakBytes = stats.peakBytes - liveBefore;
+        mapped.allocations = stats.allocations;
+        Report("mapped", mapped, fileBytes);
+
+        std::size_t texts = 0;
+        std::size_t borrowed = 0;
+        CountTexts(characters, texts, borrowed);
+        std::printf("        %zu of %zu texts borrowed from the mapping, %.2fx less heap, %.2fx load time\n", borrowed, texts,
+            static_cast<double>(copy.liveBytes) / static_cast<double>(mapped.liveBytes), mapped.seconds / copy.seconds);
+
+        if (!copyLoad.ok || !mappedLoad.ok || !SameCharacters(copied, characters)) {
+            std::printf("MISMATCH: the mapped load differs from the copying one\n");
+            failed++;
+        }
+
+        //edits copy only the texts they touch, then the result is saved over the still mapped file
+        std::size_t edited = 0;
+        for (auto& character : characters) {
+            for (std::size_t m = 0; m < character.messages.size() && edited < static_cast<std::size_t>(edits); m += 97) {
+                character.messages[m].content += " (edited)";
+                copied[&character - characters.data()].messages[m].content += " (edited)";
+                edited++;
+            }
+        }
+        WriteOptions writeOptions;
+        BenchTimer saveTimer;
+        SaveResult saved = SaveCharactersToFile(path, characters, writeOptions);
+        double saveSeconds = saveTimer.Seconds();
+        std::printf("        %zu edits, saved over the mapped file in %.3f s\n", edited, saveSeconds);
+
+        std::vector<Character> reloaded;
+        LoadResult reload = LoadCharactersFromFile(path, reloaded);
+        if (!saved.ok || !reload.ok || !SameCharacters(copied, reloaded)) {
+            std::printf("MISMATCH: saving the mapped characters lost or changed text\n");
+            failed++;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,392 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "DialogueMerge.h"
+#include "DialogueWriter.h"
+#include "EditorUI.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int32_t kOursAdded = 1000000000;
+const int32_t kTheirsAdded = 1100000000;
+const int32_t kBothAdded = 1200000000;
+
+Message NewMessage(int32_t id, const char* content) {
+    Message message;
+    message.ID = id;
+    message.content = content;
+    return message;
+}
+
+// Every eighth character is left as it is, so those go by without being parsed.
+bool Untouched(int c) {
+    return c % 8 == 7;
+}
+
+// Ours and theirs are base with changes picked by each message's number (its ID / 100), and a few
+// new messages at the end of every character. The last base message of a character is left alone,
+// so what theirs adds always lands right after it.
+Character Derive(bool theirs, int c, const std::string& name, const std::vector<Message>& messages) {
+    Character character;
+    character.name = name;
+    if (Untouched(c)) {
+        character.messages = messages;
+        return character;
+    }
+    for (std::size_t j = 0; j < messages.size(); j++) {
+        Message message = messages[j];
+        int k = message.ID / 100;
+        bool last = j + 1 == messages.size();
+        if (!theirs) {
+            if (!last && (k % 70 == 2 || k % 700 == 6)) {
+                continue;
+            }
+            if (!last && k % 50 == 1) {
+                message.content = std::string(message.content.View()) + " (ours)";
+            }
+            if (!last && k % 500 == 5) {
+                message.content = "ours rewrote this";
+            }
+        }
+        else {
+            if (!last && k % 80 == 4) {
+                continue;
+            }
+            if (!last && k % 30 == 1) {
+                message.responce[0].health += 7;
+            }
+            if (!last && k % 500 == 5) {
+                message.content = "theirs rewrote this";
+            }
+            if (!last && k % 700 == 6) {
+                message.responce[0].reply = "theirs changed the reply";
+            }
+        }
+        character.messages.push_back(std::move(message));
+    }
+    character.messages.push_back(NewMessage((theirs ? kTheirsAdded : kOursAdded) + c * 10, theirs ? "theirs added this" : "ours added this"));
+    character.messages.push_back(NewMessage(kBothAdded + c, theirs ? "both added this, theirs" : "both added this, ours"));
+    return character;
+}
+
+bool SameField(const Message& a, const Message& b, MessageField field) {
+    FieldValue x = GetField(a, field);
+    FieldValue y = GetField(b, field);
+    return x.text == y.text && x.number == y.number;
+}
+
+bool SameMessage(const Message& a, const Message& b) {
+    for (int f = 0; f <= static_cast<int>(MessageField::Health2); f++) {
+        if (!SameField(a, b, static_cast<MessageField>(f))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The plain merge the real one has to agree with: messages found by ID in maps, base order, every
+// field compared.
+Character ReferenceMerge(const Character& base, const Character& ours, const Character& theirs, std::size_t& conflicts) {
+    std::unordered_map<int32_t, const Message*> inOurs;
+    std::unordered_map<int32_t, const Message*> inTheirs;
+    std::unordered_map<int32_t, const Message*> inBase;
+    for (auto& message : ours.messages) inOurs[message.ID] = &message;
+    for (auto& message : theirs.messages) inTheirs[message.ID] = &message;
+    for (auto& message : base.messages) inBase[message.ID] = &message;
+
+    auto combine = [&](const Message* b, const Message& o, const Message& t) {
+        Message merged = o;
+        for (int f = 0; f <= static_cast<int>(MessageField::Health2); f++) {
+            MessageField field = static_cast<MessageField>(f);
+            if (SameField(o, t, field)) {
+                continue;
+            }
+            if (b != nullptr && SameField(*b, o, field)) {
+                SetField(merged, field, GetField(t, field));
+            }
+            else if (b == nullptr || !SameField(*b, t, field)) {
+                conflicts++;
+            }
+        }
+        return merged;
+    };
+
+    Character merged;
+    merged.name = base.name;
+    for (auto& b : base.messages) {
+        auto o = inOurs.find(b.ID);
+        auto t = inTheirs.find(b.ID);
+        if (o != inOurs.end() && t != inTheirs.end()) {
+            merged.messages.push_back(combine(&b, *o->second, *t->second));
+        }
+        else if (o != inOurs.end() || t != inTheirs.end()) {
+            const Message& kept = o != inOurs.end() ? *o->second : *t->second;
+            if (!SameMessage(kept, b)) {
+                conflicts++;
+                merged.messages.push_back(kept);
+            }
+        }
+    }
+    for (auto& t : theirs.messages) {
+        if (inBase.count(t.ID) == 0 && inOurs.count(t.ID) == 0) {
+            merged.messages.push_back(t);
+        }
+    }
+    for (auto& o : ours.messages) {
+        if (inBase.count(o.ID) == 0) {
+            auto t = inTheirs.find(o.ID);
+            merged.messages.push_back(t != inTheirs.end() ? combine(nullptr, o, *t->second) : o);
+        }
+    }
+    return merged;
+}
+
+bool Derived(const std::string& path, bool theirs, const DialogueVersion& base) {
+    SaveResult saved = SaveCharacterStream(path, WriteOptions(), [&](CharacterWriter& writer, std::string& error) {
+        std::vector<Message> scratch;
+        for (std::size_t c = 0; c < base.Characters(); c++) {
+            const std::vector<Message>* messages = nullptr;
+            LoadResult result = base.Messages(c, scratch, messages);
+            if (!result.ok) {
+                error = result.error;
+                return false;
+            }
+            writer.Write(Derive(theirs, static_cast<int>(c), base.Name(c), *messages));
+        }
+        return true;
+    });
+    if (!saved.ok) {
+        std::printf("could not write %s: %s\n", path.c_str(), saved.error.c_str());
+    }
+    return saved.ok;
+}
+
+// Base, ours and theirs written as files, each a character at a time.
+bool WriteVersions(const std::string& prefix, const CorpusOptions& options) {
+    WriteSyntheticCorpus(prefix + "_base.json", options);
+    DialogueVersion base;
+    LoadResult opened = base.Open(prefix + "_base.json");
+    if (!opened.ok) {
+        std::printf("could not open the base: %s\n", opened.error.c_str());
+        return false;
+    }
+    return Derived(prefix + "_ours.json", false, base) && Derived(prefix + "_theirs.json", true, base);
+}
+
+void RemoveVersions(const std::string& prefix) {
+    std::error_code ec;
+    for (const char* suffix : { "_base.json", "_ours.json", "_theirs.json", "_merged.json" }) {
+        fs::remove(prefix + suffix, ec);
+    }
+}
+
+// Diff and merge of the files, timed and with their heap peak against the file sizes, then the
+// merge again with every character it emits checked against the reference.
+int RunFiles(const std::string& prefix, const CorpusOptions& options) {
+    if (!WriteVersions(prefix, options)) {
+        return 1;
+    }
+    int failed = 0;
+    DialogueVersion base;
+    DialogueVersion ours;
+    DialogueVersion theirs;
+    LoadResult opened = base.Open(prefix + "_base.json");
+    if (opened.ok) opened = ours.Open(prefix + "_ours.json");
+    if (opened.ok) opened = theirs.Open(prefix + "_theirs.json");
+    if (!opened.ok) {
+        std::printf("could not open: %s\n", opened.error.c_str());
+        return 1;
+    }
+    std::printf("base %.1f MB, ours %.1f MB, theirs %.1f MB, %zu characters\n", ToMegabytes(base.Bytes()), ToMegabytes(ours.Bytes()),
+        ToMegabytes(theirs.Bytes()), base.Characters());
+
+    ResetAllocStats();
+    std::size_t live = GetAllocStats().liveBytes;
+    BenchTimer diffTimer;
+    DiffStats diff;
+    std::size_t visited = 0;
+    LoadResult diffed = DiffDialogue(base, ours, [&](const MessageDiff&) { visited++; }, diff);
+    double diffSeconds = diffTimer.Seconds();
+    std::size_t diffPeak = GetAllocStats().peakBytes - live;
+    std::size_t expectAdded = 0;
+    for (std::size_t c = 0; c < base.Characters(); c++) {
+        expectAdded += Untouched(static_cast<int>(c)) ? 0 : 2;
+    }
+    bool diffChecked = diffed.ok && diff.added == expectAdded && diff.removed > 0 && diff.changed > 0
+        && visited == diff.added + diff.removed + diff.changed;
+    std::printf("diff base..ours: %.1f ms, %.0f MB/s, heap peak %.1f MB; %zu unchanged, %zu changed, %zu added, %zu removed  %s\n", diffSeconds * 1e3,
+        ToMegabytes(base.Bytes() + ours.Bytes()) / diffSeconds, ToMegabytes(diffPeak), diff.unchanged, diff.changed, diff.added, diff.removed,
+        diffChecked ? "ok" : "MISMATCH");
+    failed += diffChecked ? 0 : 1;
+
+    ResetAllocStats();
+    live = GetAllocStats().liveBytes;
+    BenchTimer mergeTimer;
+    std::vector<MergeConflict> conflicts;
+    MergeStats stats;
+    SaveResult saved = SaveCharacterStream(prefix + "_merged.json", WriteOptions(), [&](CharacterWriter& writer, std::string& error) {
+        LoadResult result = MergeDialogue(base, ours, theirs, [&](Character& character) { writer.Write(character); }, conflicts, stats);
+        error = result.error;
+        return result.ok;
+    });
+    double mergeSeconds = mergeTimer.Seconds();
+    std::size_t mergePeak = GetAllocStats().peakBytes - live;
+    std::printf("merge to file: %.1f ms, %.0f MB/s of input, heap peak %.1f MB (%.1f MB of conflicts), %.1f MB written; %zu unchanged, %zu from ours, "
+        "%zu from theirs, %zu from both, %zu added, %zu removed, %zu conflicts  %s\n", mergeSeconds * 1e3, ToMegabytes(base.Bytes() + ours.Bytes() + theirs.Bytes()) / mergeSeconds,
+        ToMegabytes(mergePeak), ToMegabytes(conflicts.capacity() * sizeof(MergeConflict)), ToMegabytes(saved.bytesWritten), stats.unchanged,
+        stats.fromOurs, stats.fromTheirs, stats.combined, stats.added, stats.removed, stats.conflicts, saved.ok ? "ok" : saved.error.c_str());
+    failed += saved.ok ? 0 : 1;
+
+    std::size_t expectConflicts = 0;
+    std::size_t checked = 0;
+    std::size_t wrong = 0;
+    std::vector<Message> scratch;
+    conflicts.clear();
+    stats = MergeStats();
+    LoadResult merged = MergeDialogue(base, ours, theirs, [&](Character& character) {
+        const std::vector<Message>* messages = nullptr;
+        std::size_t c = checked++;
+        if (!base.Messages(c, scratch, messages).ok) {
+            wrong++;
+            return;
+        }
+        Character original;
+        original.name = base.Name(c);
+        original.messages = *messages;
+        Character expected = ReferenceMerge(original, Derive(false, static_cast<int>(c), original.name, original.messages),
+            Derive(true, static_cast<int>(c), original.name, original.messages), expectConflicts);
+        bool same = character.name == expected.name && character.messages.size() == expected.messages.size();
+        for (std::size_t j = 0; same && j < expected.messages.size(); j++) {
+            same = SameMessage(character.messages[j], expected.messages[j]);
+        }
+        wrong += same ? 0 : 1;
+    }, conflicts, stats);
+    bool mergeChecked = merged.ok && checked == base.Characters() && wrong == 0 && conflicts.size() == expectConflicts && expectConflicts != 0;
+    std::printf("merge against the reference: %zu characters, %zu differ, %zu conflicts of %zu expected  %s\n", checked, wrong, conflicts.size(),
+        expectConflicts, mergeChecked ? "ok" : "MISMATCH");
+    failed += mergeChecked ? 0 : 1;
+
+    //the merged file reads back and has nothing left to merge from theirs
+    DialogueVersion output;
+    LoadResult reopened = output.Open(prefix + "_merged.json");
+    std::size_t left = 0;
+    if (reopened.ok) {
+        std::vector<MergeConflict> none;
+        MergeStats remerged;
+        reopened = MergeDialogue(theirs, output, theirs, [](Character&) {}, none, remerged);
+        left = none.size() + remerged.fromTheirs + remerged.combined;
+    }
+    std::printf("merged file merged with theirs again: %zu changes from theirs  %s\n", left, reopened.ok && left == 0 ? "ok" : "MISMATCH");
+    failed += reopened.ok && left == 0 ? 0 : 1;
+    return failed;
+}
+
+// Messages that only moved are matched through the hash map and aren't changes.
+int RunReordered(const CorpusOptions& options) {
+    CorpusOptions few = options;
+    few.messages = 20000;
+    few.characters = 8;
+    std::vector<Character> before = MakeSyntheticCharacters(few);
+    std::vector<Character> after = before;
+    std::reverse(after[3].messages.begin(), after[3].messages.end());
+    std::rotate(after[5].messages.begin(), after[5].messages.begin() + 7, after[5].messages.end());
+    std::reverse(after.begin(), after.end());
+    DialogueVersion a;
+    DialogueVersion b;
+    a.Use(before);
+    b.Use(after);
+    DiffStats stats;
+    std::size_t visited = 0;
+    BenchTimer timer;
+    LoadResult result = DiffDialogue(a, b, [&](const MessageDiff&) { visited++; }, stats);
+    double seconds = timer.Seconds();
+    bool checked = result.ok && visited == 0 && stats.unchanged == few.messages;
+    std::printf("reordered messages and characters, %zu messages: %.2f ms, %zu differ  %s\n", few.messages, seconds * 1e3, visited,
+        checked ? "ok" : "MISMATCH");
+    return checked ? 0 : 1;
+}
+
+// The editor merging theirs into its document: the conflicts it lists, settled one way or the
+// other, and applied; the document then matches the merge settled the same way, and its indexes
+// match fresh ones.
+int RunEditor(const std::string& prefix, const CorpusOptions& options) {
+    CorpusOptions small = options;
+    small.targetBytes = 2 << 20;
+    small.characters = 16;
+    if (!WriteVersions(prefix, small)) {
+        return 1;
+    }
+    EditorState state;
+    LoadResult loaded = LoadCharactersFromFile(prefix + "_ours.json", state.characters);
+    for (auto& character : state.characters) {
+        state.treeNames.push_back(character.name);
+    }
+    state.index.Rebuild(state.characters);
+    state.search.Rebuild(state.characters);
+    state.validator.ValidateAll(state.characters, state.index);
+    state.mergeBase = prefix + "_base.json";
+    state.mergeTheirs = prefix + "_theirs.json";
+
+    BenchTimer mergeTimer;
+    bool merged = loaded.ok && MergeIntoDocument(state);
+    double mergeSeconds = mergeTimer.Seconds();
+    int failed = 0;
+    if (!merged || state.mergeConflicts.empty()) {
+        std::printf("editor merge: MISMATCH %s\n", state.mergeError.c_str());
+        return 1;
+    }
+    for (std::size_t k = 0; k < state.mergeChoices.size(); k++) {
+        state.mergeChoices[k] = k % 3 == 0 ? MergeSide::Theirs : k % 3 == 1 ? MergeSide::Ours : MergeSide::Base;
+        if (state.mergeConflicts[k].kind == ConflictKind::BothAdded && state.mergeChoices[k] == MergeSide::Base) {
+            state.mergeChoices[k] = MergeSide::Theirs;
+        }
+    }
+    std::vector<Character> expected = state.merged;
+    ResolveConflicts(expected, state.mergeConflicts, state.mergeChoices);
+    std::size_t conflicts = state.mergeConflicts.size();
+
+    BenchTimer applyTimer;
+    ApplyMerge(state);
+    double applySeconds = applyTimer.Seconds();
+    DialogueIndex index;
+    index.Rebuild(state.characters);
+    SearchIndex search;
+    search.Rebuild(state.characters);
+    SearchOptions every;
+    every.maxHits = SIZE_MAX;
+    bool checked = SameCharacters(state.characters, expected) && !state.hasMerge;
+    for (const char* query : { "ours added", "theirs added", "rewrote", "theirs changed" }) {
+        checked &= state.search.Find(query, every).hits.size() == search.Find(query, every).hits.size();
+    }
+    for (auto& character : expected) {
+        checked &= state.index.FindCharacter(character.name) == index.FindCharacter(character.name);
+    }
+    std::printf("editor, %zu conflicts settled: merge %.1f ms, apply %.1f ms  %s\n", conflicts, mergeSeconds * 1e3, applySeconds * 1e3,
+        checked ? "ok" : "MISMATCH");
+    failed += checked ? 0 : 1;
+    return failed;
+}
+
+}
+
+int RunMergeBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>((argc >= 1 ? std::atof(argv[0]) : 64.0) * 1024 * 1024);
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+
+    const std::string prefix = "rustless_bench_merge";
+    int failed = RunFiles(prefix, options);
+    RemoveVersions(prefix);
+    failed += RunReordered(options);
+    failed += RunEditor(prefix, options);
+    RemoveVersions(prefix);
+    return failed == 0 ? 0 : 1;
+}
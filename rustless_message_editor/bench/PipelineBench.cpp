@@ -0,0 +1,619 @@
+#include "Bench.h"
+#include "DialogueIndex.h"
+#include "DialogueLoader.h"
+#include "DialogueWriter.h"
+
+#include <json.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<double> ParseScales(const char* text) {
+    std::vector<double> scales;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) {
+            scales.push_back(std::atof(item.c_str()));
+        }
+    }
+    return scales;
+}
+
+std::size_t PeakRss() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    //kilobytes on Linux
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Time, throughput and heap use of one step, measured from just before it.
+struct Measure {
+    std::size_t liveBefore = GetAllocStats().liveBytes;
+    BenchTimer timer;
+
+    Measure() { ResetAllocStats(); }
+
+    json Finish(std::size_t bytes) const {
+        double seconds = timer.Seconds();
+        AllocStats stats = GetAllocStats();
+        return json{ { "seconds", seconds }, { "bytes", bytes }, { "mbPerSecond", ToMegabytes(bytes) / seconds },
+            { "peakHeapBytes", stats.peakBytes - std::min(stats.peakBytes, liveBefore) }, { "allocations", stats.allocations } };
+    }
+};
+
+void PrintStep(const char* name, const json& step) {
+    std::printf("  %-13s %8.3f s  %8.1f MB/s  peak heap %8.1f MB  allocations %10zu\n", name, step["seconds"].get<double>(), step["mbPerSecond"].get<double>(),
+        ToMegabytes(step["peakHeapBytes"].get<std::size_t>()), step["allocations"].get<std::size_t>());
+}
+
+// Lookups by name and by ID through DialogueIndex, in a shuffled order so they aren't all cache hits.
+json MeasureLookups(const std::vector<Character>& characters) {
+    DialogueIndex index;
+    BenchTimer buildTimer;
+    index.Rebuild(characters);
+    double buildSeconds = buildTimer.Seconds();
+
+    std::mt19937 random(99);
+    std::vector<std::string> names;
+    std::vector<int32_t> ids;
+    for (auto& character : characters) {
+        names.push_back(character.name);
+        for (auto& message : character.messages) {
+            ids.push_back(message.ID);
+        }
+    }
+    const int lookups = 1000000;
+    std::vector<std::size_t> order(lookups);
+    for (auto& pick : order) {
+        pick = random();
+    }
+
+    long long found = 0;
+    BenchTimer nameTimer;
+    for (std::size_t pick : order) {
+        found += index.FindCharacter(names[pick % names.size()]);
+    }
+    double nameSeconds = nameTimer.Seconds();
+    BenchTimer idTimer;
+    for (std::size_t pick : order) {
+        found += index.FindMessage(ids[pick % ids.size()]).message;
+    }
+    double idSeconds = idTimer.Seconds();
+    //keeps the lookups from being optimized away
+    if (found == LLONG_MIN) {
+        std::printf("\n");
+    }
+    return json{ { "indexBuildSeconds", buildSeconds }, { "characterNs", nameSeconds * 1e9 / lookups }, { "messageNs", idSeconds * 1e9 / lookups } };
+}
+
+json RunScale(double megabytes, int& failed) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(megabytes * 1024 * 1024);
+    const std::string path = "rustless_bench_pipeline.json.in";
+    const std::string savePath = "rustless_bench_pipeline.json.out";
+    std::size_t messages = WriteSyntheticCorpus(path, options);
+    std::size_t fileBytes = static_cast<std::size_t>(fs::file_size(path));
+    std::printf("%.1f MB, %zu messages, %d characters\n", ToMegabytes(fileBytes), messages, options.characters);
+
+    json scale;
+    scale["megabytes"] = megabytes;
+    scale["fileBytes"] = fileBytes;
+    scale["messages"] = messages;
+    scale["characters"] = options.characters;
+
+    std::vector<Character> characters;
+    {
+        Measure measure;
+        LoadResult loaded = LoadCharactersFromFile(path, characters);
+        scale["load"] = measure.Finish(fileBytes);
+        if (!loaded.ok) {
+            std::printf("load failed: %s\n", loaded.error.c_str());
+            failed++;
+        }
+    }
+    PrintStep("load", scale["load"]);
+    {
+        MappedFile mapped;
+        std::vector<Character> borrowed;
+        Measure measure;
+        LoadCharactersMapped(path, mapped, borrowed);
+        scale["loadMapped"] = measure.Finish(fileBytes);
+    }
+    PrintStep("load mapped", scale["loadMapped"]);
+
+    const char* saves[] = { "savePretty", "saveCompact" };
+    for (int compact = 0; compact < 2; compact++) {
+        WriteOptions writeOptions;
+        writeOptions.compact = compact == 1;
+        Measure measure;
+        SaveResult saved = SaveCharactersToFile(savePath, characters, writeOptions);
+        scale[saves[compact]] = measure.Finish(saved.bytesWritten);
+        PrintStep(compact == 1 ? "save compact" : "save pretty", scale[saves[compact]]);
+        std::vector<Character> reloaded;
+        if (!saved.ok || !LoadCharactersFromFile(savePath, reloaded).ok || !SameCharacters(characters, reloaded)) {
+            std::printf("MISMATCH: the %s save doesn't load back the same\n", compact == 1 ? "compact" : "pretty");
+            failed++;
+        }
+    }
+
+    scale["lookup"] = MeasureLookups(characters);
+    std::printf("  lookups       %6.1f ns by name  %6.1f ns by ID  (index built in %.3f s)\n", scale["lookup"]["characterNs"].get<double>(),
+        scale["lookup"]["messageNs"].get<double>(), scale["lookup"]["indexBuildSeconds"].get<double>());
+
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove(savePath, ec);
+    return scale;
+}
+
+// Round-trip fuzzing: random documents written by hand, with everything the loader has to put up
+// with, checked against what they should load as.
+
+const char* kFragments[] = {
+    "Thou", "art", " ", " ", "a", "serf", "lol", "’", "‘", "“", "”", "—", "…", "é", "Ω", "日本語", "王", "😀", "🗡️",
+    "a\xcc\x90", "\"", "\\", "/", "\n", "\t", "\r", "\b", "\f", "\x01", "\x1f", "\x7f", "</script>", "{\"json\": [1]}", "null", "\\u0041"
+};
+const char* kNames[] = { "King", "Jester’s “Friend”", "王", "😀 Emoji", "", "Queen", "Serf\nwith a newline", "Knight \\ Squire" };
+const int kNumbers[] = { 0, 1, -1, 20, 25, 100, INT_MAX, INT_MIN, 1 << 20 };
+
+int Pick(std::mt19937& random, int count) {
+    return static_cast<int>(random() % static_cast<uint32_t>(count));
+}
+
+bool Chance(std::mt19937& random, int percent) {
+    return Pick(random, 100) < percent;
+}
+
+std::string RandomText(std::mt19937& random, std::size_t& longest) {
+    std::size_t fragments;
+    int roll = Pick(random, 1000);
+    if (roll < 100) {
+        fragments = 0;
+    }
+    else if (roll < 980) {
+        fragments = 1 + Pick(random, 24);
+    }
+    else if (roll < 998) {
+        fragments = 1000 + Pick(random, 20000);
+    }
+    else {
+        //about a megabyte
+        fragments = 300000;
+    }
+    std::string text;
+    for (std::size_t k = 0; k < fragments; k++) {
+        text += kFragments[Pick(random, sizeof(kFragments) / sizeof(kFragments[0]))];
+    }
+    longest = std::max(longest, text.size());
+    return text;
+}
+
+int RandomNumber(std::mt19937& random) {
+    return Chance(random, 50) ? kNumbers[Pick(random, sizeof(kNumbers) / sizeof(kNumbers[0]))] : static_cast<int>(random());
+}
+
+// Decodes one UTF-8 code point (the fragments are all valid UTF-8).
+uint32_t NextCodePoint(std::string_view text, std::size_t& at) {
+    unsigned char first = static_cast<unsigned char>(text[at]);
+    int length = first < 0x80 ? 1 : first < 0xe0 ? 2 : first < 0xf0 ? 3 : 4;
+    uint32_t point = length == 1 ? first : first & (0xff >> (length + 1));
+    for (int k = 1; k < length; k++) {
+        point = (point << 6) | (static_cast<unsigned char>(text[at + k]) & 0x3f);
+    }
+    at += length;
+    return point;
+}
+
+// unit is one UTF-16 code unit; surrogate pairs are written as two escapes
+void PutEscape(std::string& out, uint32_t unit) {
+    char escaped[8];
+    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(unit & 0xffff));
+    out += escaped;
+}
+
+// Writes text as a json string, escaping what has to be and, at random, plenty that doesn't.
+void PutString(std::string& out, std::string_view text, std::mt19937& random) {
+    out += '"';
+    std::size_t at = 0;
+    while (at < text.size()) {
+        std::size_t start = at;
+        uint32_t point = NextCodePoint(text, at);
+        const char* shortEscape = nullptr;
+        switch (point) {
+        case '"': shortEscape = "\\\""; break;
+        case '\\': shortEscape = "\\\\"; break;
+        case '\n': shortEscape = "\\n"; break;
+        case '\t': shortEscape = "\\t"; break;
+        case '\r': shortEscape = "\\r"; break;
+        case '\b': shortEscape = "\\b"; break;
+        case '\f': shortEscape = "\\f"; break;
+        case '/': shortEscape = Chance(random, 50) ? "\\/" : nullptr; break;
+        default: break;
+        }
+        if (shortEscape != nullptr && Chance(random, 80)) {
+            out += shortEscape;
+        }
+        else if (point < 0x20 || point == '"' || point == '\\' || Chance(random, point < 0x80 ? 3 : 25)) {
+            if (point >= 0x10000) {
+                PutEscape(out, 0xd800 + ((point - 0x10000) >> 10));
+                PutEscape(out, 0xdc00 + ((point - 0x10000) & 0x3ff));
+            }
+            else {
+                PutEscape(out, point);
+            }
+        }
+        else {
+            out.append(text.data() + start, at - start);
+        }
+    }
+    out += '"';
+}
+
+void PutSpace(std::string& out, std::mt19937& random) {
+    const char* spaces[] = { "", "", " ", "\n", "\n    ", "\t", "\r\n", "  \n\t " };
+    out += spaces[Pick(random, sizeof(spaces) / sizeof(spaces[0]))];
+}
+
+// A json value the loader should skip: any shape, sometimes with a "from" inside to trip up
+// anything that looks for speakers without following the structure.
+std::string RandomUnknown(std::mt19937& random, int depth) {
+    std::size_t unused = 0;
+    std::string out;
+    switch (Pick(random, depth > 2 ? 4 : 6)) {
+    case 0: PutString(out, RandomText(random, unused), random); break;
+    case 1: out = std::to_string(RandomNumber(random)); break;
+    case 2: out = Chance(random, 50) ? "true" : "null"; break;
+    case 3: out = "-1.5e3"; break;
+    case 4: {
+        out = "[";
+        int items = Pick(random, 4);
+        for (int k = 0; k < items; k++) {
+            out += (k == 0 ? "" : ",") + RandomUnknown(random, depth + 1);
+        }
+        out += "]";
+        break;
+    }
+    default: {
+        out = "{";
+        PutSpace(out, random);
+        out += Chance(random, 50) ? "\"from\": \"Impostor\", \"content\": \"not a message\"" : "\"messages\": [{\"from\": \"Nested\"}]";
+        out += ", \"deeper\": " + RandomUnknown(random, depth + 1) + "}";
+        break;
+    }
+    }
+    return out;
+}
+
+// Members of one json object in random order, each "key": value, with random spacing.
+std::string PutObject(std::vector<std::pair<std::string, std::string>> members, std::mt19937& random) {
+    std::shuffle(members.begin(), members.end(), random);
+    std::string out = "{";
+    for (std::size_t k = 0; k < members.size(); k++) {
+        PutSpace(out, random);
+        PutString(out, members[k].first, random);
+        PutSpace(out, random);
+        out += ":";
+        PutSpace(out, random);
+        out += members[k].second;
+        if (k + 1 < members.size()) {
+            out += ",";
+        }
+    }
+    PutSpace(out, random);
+    out += "}";
+    return out;
+}
+
+// Adds key with a random value, null or nothing at all; whatever the loader should end up with
+// goes in expected, which otherwise keeps its default.
+template <typename Value, typename Put>
+void AddMember(std::vector<std::pair<std::string, std::string>>& members, const char* key, std::mt19937& random, Value& expected, Value value, Put put) {
+    int roll = Pick(random, 100);
+    if (roll < 10) {
+        return;
+    }
+    if (roll < 20) {
+        members.emplace_back(key, "null");
+        return;
+    }
+    members.emplace_back(key, put(value));
+    expected = value;
+}
+
+std::string RandomResponse(std::mt19937& random, Response& expected, std::size_t& longest) {
+    if (Chance(random, 10)) {
+        return "null";
+    }
+    std::vector<std::pair<std::string, std::string>> members;
+    auto text = [&](const std::string& value) {
+        std::string out;
+        PutString(out, value, random);
+        return out;
+    };
+    auto number = [](int value) { return std::to_string(value); };
+    std::string reply;
+    std::string content;
+    AddMember(members, "reply", random, reply, RandomText(random, longest), text);
+    AddMember(members, "content", random, content, RandomText(random, longest), text);
+    AddMember(members, "health", random, expected.health, RandomNumber(random), number);
+    expected.reply = reply;
+    expected.content = content;
+    if (Chance(random, 15)) {
+        members.emplace_back("mood", RandomUnknown(random, 0));
+    }
+    return PutObject(std::move(members), random);
+}
+
+std::string RandomMessage(std::mt19937& random, Message& expected, std::string& from, std::size_t& longest) {
+    std::vector<std::pair<std::string, std::string>> members;
+    auto text = [&](const std::string& value) {
+        std::string out;
+        PutString(out, value, random);
+        return out;
+    };
+    auto number = [](int value) { return std::to_string(value); };
+    from = kNames[Pick(random, sizeof(kNames) / sizeof(kNames[0]))];
+    members.emplace_back("from", text(from));
+    std::string content;
+    AddMember(members, "content", random, content, RandomText(random, longest), text);
+    expected.content = content;
+    AddMember(members, "timeToRespond", random, expected.timeToRespond, RandomNumber(random), number);
+    int relationship = expected.relationship;
+    AddMember(members, "relationship", random, relationship, Pick(random, 3), number);
+    expected.relationship = static_cast<Relationship>(relationship);
+    int32_t id = expected.ID;
+    AddMember(members, "ID", random, id, RandomNumber(random), number);
+    expected.ID = id;
+
+    int roll = Pick(random, 100);
+    if (roll < 10) {
+        members.emplace_back("responses", "null");
+    }
+    else if (roll < 90) {
+        //past the second, responses are ignored
+        int count = Pick(random, 4);
+        std::string array = "[";
+        for (int k = 0; k < count; k++) {
+            Response ignored;
+            PutSpace(array, random);
+            array += (k == 0 ? "" : ",") + RandomResponse(random, k < 2 ? expected.responce[k] : ignored, longest);
+        }
+        array += "]";
+        members.emplace_back("responses", array);
+    }
+    if (Chance(random, 20)) {
+        members.emplace_back(Chance(random, 50) ? "note" : "responsesExtra", RandomUnknown(random, 0));
+    }
+    return PutObject(std::move(members), random);
+}
+
+// Adds a message the way LoadCharacters merges them: by speaker, in order of first appearance.
+void AddExpected(std::vector<Character>& characters, const std::string& from, Message message) {
+    for (auto& character : characters) {
+        if (character.name == from) {
+            character.messages.push_back(std::move(message));
+            return;
+        }
+    }
+    characters.emplace_back();
+    characters.back().name = from;
+    characters.back().messages.push_back(std::move(message));
+}
+
+std::string RandomDocument(std::mt19937& random, std::vector<Character>& expected, std::size_t& longest) {
+    int count = Pick(random, 100) < 5 ? 0 : 1 + Pick(random, 40);
+    std::string array = "[";
+    for (int k = 0; k < count; k++) {
+        Message message;
+        std::string from;
+        PutSpace(array, random);
+        array += (k == 0 ? "" : ",") + RandomMessage(random, message, from, longest);
+        AddExpected(expected, from, std::move(message));
+    }
+    PutSpace(array, random);
+    array += "]";
+
+    std::vector<std::pair<std::string, std::string>> members;
+    members.emplace_back("messages", array);
+    if (Chance(random, 30)) {
+        members.emplace_back("version", "3");
+    }
+    if (Chance(random, 30)) {
+        members.emplace_back("meta", RandomUnknown(random, 0));
+    }
+    std::string document;
+    PutSpace(document, random);
+    document += PutObject(std::move(members), random);
+    PutSpace(document, random);
+    return document;
+}
+
+// The saved json read back with nlohmann's own DOM, so the writer's escaping is checked by a
+// parser that shares nothing with ours.
+bool DomMatches(const std::string& saved, const std::vector<Character>& expected) {
+    json document = json::parse(saved, nullptr, false);
+    if (document.is_discarded() || !document["messages"].is_array()) {
+        return false;
+    }
+    std::size_t k = 0;
+    const json& messages = document["messages"];
+    for (auto& character : expected) {
+        for (auto& message : character.messages) {
+            if (k >= messages.size()) {
+                return false;
+            }
+            const json& out = messages[k++];
+            if (out["from"] != character.name || out["content"] != message.content.String() || out["timeToRespond"] != message.timeToRespond
+                || out["relationship"] != static_cast<int>(message.relationship) || out["ID"] != message.ID) {
+                return false;
+            }
+            for (int r = 0; r < 2; r++) {
+                const json& response = out["responses"][r];
+                if (response["reply"] != message.responce[r].reply.String() || response["content"] != message.responce[r].content.String()
+                    || response["health"] != message.responce[r].health) {
+                    return false;
+                }
+            }
+        }
+    }
+    return k == messages.size();
+}
+
+// Where one case went wrong, or empty when it didn't.
+std::string CheckCase(const std::string& document, const std::vector<Character>& expected, bool compact) {
+    const char* begin = document.data();
+    const char* end = begin + document.size();
+    std::vector<Character> loaded;
+    LoadResult result = LoadCharacters(begin, end, loaded);
+    if (!result.ok) {
+        return "load failed: " + result.error + " (line " + std::to_string(result.line) + ", column " + std::to_string(result.column) + ")";
+    }
+    if (!SameCharacters(loaded, expected)) {
+        return "load differs from the expected characters";
+    }
+    std::vector<Character> borrowed;
+    if (!LoadCharactersBorrowed(begin, end, borrowed).ok || !SameCharacters(borrowed, expected)) {
+        return "borrowing load differs";
+    }
+
+    std::vector<CharacterOutline> outline;
+    if (!OutlineCharacters(begin, end, outline).ok || outline.size() != expected.size()) {
+        return "outline differs";
+    }
+    std::vector<Character> lazy(outline.size());
+    for (std::size_t i = 0; i < outline.size(); i++) {
+        lazy[i].name = outline[i].name;
+        if (!LoadMessageRuns(begin, end, outline[i].runs, lazy[i].messages).ok) {
+            return "message runs of " + outline[i].name + " failed to load";
+        }
+    }
+    if (!SameCharacters(lazy, expected)) {
+        return "outline and message runs differ";
+    }
+
+    WriteOptions options;
+    options.compact = compact;
+    std::ostringstream first;
+    WriteCharacters(first, loaded, options);
+    std::string saved = first.str();
+    if (!DomMatches(saved, expected)) {
+        return "saved json doesn't parse back the same with a DOM parser";
+    }
+    std::vector<Character> reloaded;
+    if (!LoadCharacters(saved.data(), saved.data() + saved.size(), reloaded).ok || !SameCharacters(reloaded, expected)) {
+        return "load -> save -> load differs";
+    }
+    std::ostringstream second;
+    WriteCharacters(second, reloaded, options);
+    if (second.str() != saved) {
+        return "saving again gives different bytes";
+    }
+    return std::string();
+}
+
+json RunFuzz(int cases, int& failed) {
+    std::size_t bytes = 0;
+    std::size_t longest = 0;
+    int failures = 0;
+    BenchTimer timer;
+    for (int c = 0; c < cases; c++) {
+        uint32_t seed = 0x5eed0000u + static_cast<uint32_t>(c);
+        std::mt19937 random(seed);
+        std::vector<Character> expected;
+        std::string document = RandomDocument(random, expected, longest);
+        bytes += document.size();
+        std::string problem = CheckCase(document, expected, c % 2 == 1);
+        if (!problem.empty()) {
+            std::string path = "rustless_fuzz_failure_" + std::to_string(seed) + ".json";
+            std::ofstream(path, std::ios::binary) << document;
+            std::printf("MISMATCH: fuzz case %d (seed %u): %s, input kept in %s\n", c, seed, problem.c_str(), path.c_str());
+            failures++;
+        }
+    }
+    double seconds = timer.Seconds();
+    std::printf("fuzz: %d cases, %.1f MB of json, longest string %.1f MB, %d failed, %.2f s\n", cases, ToMegabytes(bytes), ToMegabytes(longest), failures, seconds);
+    failed += failures;
+    return json{ { "cases", cases }, { "bytes", bytes }, { "longestString", longest }, { "failures", failures }, { "seconds", seconds } };
+}
+
+// Prints how each throughput and lookup cost moved against an earlier results file.
+void CompareBaseline(const json& results, const std::string& path) {
+    std::ifstream file(path);
+    json baseline = json::parse(file, nullptr, false);
+    if (baseline.is_discarded()) {
+        std::printf("could not read baseline %s\n", path.c_str());
+        return;
+    }
+    std::printf("against %s:\n", path.c_str());
+    for (auto& scale : results["scales"]) {
+        for (auto& before : baseline["scales"]) {
+            if (before["megabytes"] != scale["megabytes"]) {
+                continue;
+            }
+            //throughputs regress when they fall, lookup times when they rise
+            const char* steps[] = { "load", "loadMapped", "savePretty", "saveCompact" };
+            for (const char* step : steps) {
+                double now = scale[step]["mbPerSecond"].get<double>();
+                double then = before[step]["mbPerSecond"].get<double>();
+                double change = (now / then - 1.0) * 100.0;
+                std::printf("  %5.1f MB %-12s %+7.1f%%%s\n", scale["megabytes"].get<double>(), step, change, change < -10.0 ? "  REGRESSION" : "");
+            }
+            const char* lookups[] = { "characterNs", "messageNs" };
+            for (const char* lookup : lookups) {
+                double now = scale["lookup"][lookup].get<double>();
+                double then = before["lookup"][lookup].get<double>();
+                double change = (now / then - 1.0) * 100.0;
+                std::printf("  %5.1f MB %-12s %+7.1f%%%s\n", scale["megabytes"].get<double>(), lookup, change, change > 10.0 ? "  REGRESSION" : "");
+            }
+        }
+    }
+}
+
+}
+
+int RunPipelineBench(int argc, char** argv) {
+    std::vector<double> scales = ParseScales(argc >= 1 ? argv[0] : "1,16,64");
+    int cases = argc >= 2 ? std::atoi(argv[1]) : 300;
+    std::string resultsPath = argc >= 3 ? argv[2] : "rustless_bench_pipeline.json";
+
+    int failed = 0;
+    json results;
+    results["suite"] = "pipeline";
+    results["version"] = 1;
+    results["scales"] = json::array();
+    for (double megabytes : scales) {
+        results["scales"].push_back(RunScale(megabytes, failed));
+    }
+    results["fuzz"] = RunFuzz(cases, failed);
+    results["peakRssBytes"] = PeakRss();
+    results["failures"] = failed;
+
+    std::ofstream out(resultsPath, std::ios::binary | std::ios::trunc);
+    out << std::setw(4) << results << "\n";
+    std::printf("results written to %s\n", resultsPath.c_str());
+    if (argc >= 4) {
+        CompareBaseline(results, argv[3]);
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "DialogueWriter.h"
+#include "Profiler.h"
+
+#include <json.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+double SpanNanoseconds(int spans) {
+    BenchTimer timer;
+    for (int i = 0; i < spans; i++) {
+        ProfileSpan span("bench/empty span");
+        span.AddBytes(1);
+    }
+    return timer.Seconds() * 1e9 / spans;
+}
+
+// Best of a few loads and saves of the corpus, so one slow run doesn't decide the overhead.
+double LoadSaveSeconds(const std::string& corpus, int runs) {
+    double best = 0.0;
+    for (int run = 0; run < runs; run++) {
+        std::vector<Character> characters;
+        std::ostringstream out;
+        BenchTimer timer;
+        LoadCharacters(corpus.data(), corpus.data() + corpus.size(), characters);
+        WriteCharacters(out, characters, WriteOptions());
+        double seconds = timer.Seconds();
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+}
+
+int RunProfileBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 64.0) * 1024 * 1024;
+    int spans = argc >= 2 ? std::atoi(argv[1]) : 1000000;
+    int runs = 3;
+
+#ifdef RUSTLESS_NO_PROFILING
+    std::printf("profiling compiled out (RUSTLESS_NO_PROFILING)\n");
+#endif
+    std::string corpus;
+    {
+        std::ostringstream out;
+        WriteSyntheticCorpus(out, options);
+        corpus = out.str();
+    }
+    std::printf("%.1f MB corpus, %d spans\n", ToMegabytes(corpus.size()), spans);
+
+    SetProfiling(false);
+    double offSpan = SpanNanoseconds(spans);
+    double offLoad = LoadSaveSeconds(corpus, runs);
+    SetProfiling(true);
+    ResetProfile();
+    double onSpan = SpanNanoseconds(spans);
+    ResetProfile();
+    double onLoad = LoadSaveSeconds(corpus, runs);
+    SetProfiling(false);
+
+    std::printf("span while off  %7.1f ns\n", offSpan);
+    std::printf("span while on   %7.1f ns\n", onSpan);
+    std::printf("load + save off %8.3f s\n", offLoad);
+    std::printf("load + save on  %8.3f s   %+.2f%%\n", onLoad, (onLoad / offLoad - 1.0) * 100.0);
+
+    ProfileSnapshot snapshot = TakeProfileSnapshot();
+    for (auto& span : snapshot.spans) {
+        std::printf("  %-20s %6llu calls %9.3f ms  %10llu bytes  %9llu allocations\n", span.name, static_cast<unsigned long long>(span.calls),
+            span.totalSeconds * 1000.0, static_cast<unsigned long long>(span.bytes), static_cast<unsigned long long>(span.allocations));
+    }
+    for (auto& counter : snapshot.counters) {
+        std::printf("  %s: %lld\n", counter.name, static_cast<long long>(counter.value));
+    }
+
+#ifndef RUSTLESS_NO_PROFILING
+    //the trace has to be json trace viewers accept, with one complete event per span call
+    const std::string path = "rustless_bench_profile.json";
+    std::string error;
+    if (!ExportProfileTrace(path, error)) {
+        std::printf("export failed: %s\n", error.c_str());
+        return 1;
+    }
+    std::size_t complete = 0;
+    try {
+        std::ifstream file(path);
+        nlohmann::json trace = nlohmann::json::parse(file);
+        for (auto& event : trace["traceEvents"]) {
+            complete += event["ph"] == "X" ? 1 : 0;
+        }
+    }
+    catch (const std::exception& e) {
+        std::printf("trace is not valid json: %s\n", e.what());
+        return 1;
+    }
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    std::size_t calls = 0;
+    for (auto& span : snapshot.spans) {
+        calls += span.calls;
+    }
+    std::printf("trace: %zu complete events for %zu span calls\n", complete, calls);
+    if (complete != calls) {
+        return 1;
+    }
+#endif
+    return 0;
+}
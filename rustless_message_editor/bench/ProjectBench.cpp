@@ -0,0 +1,109 @@
+#include "Bench.h"
+#include "ProjectFiles.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Splits targetBytes of dialogue over files chapter files, every one with all the speakers.
+std::size_t WriteChapters(const fs::path& directory, int files, const CorpusOptions& total) {
+    std::error_code ec;
+    fs::remove_all(directory, ec);
+    fs::create_directories(directory);
+    std::size_t messages = 0;
+    for (int f = 0; f < files; f++) {
+        CorpusOptions options = total;
+        options.targetBytes = total.targetBytes / static_cast<std::size_t>(files);
+        options.seed = total.seed + static_cast<uint32_t>(f);
+        char name[32];
+        std::snprintf(name, sizeof(name), "chapter%02d.json", f);
+        messages += WriteSyntheticCorpus((directory / name).string(), options);
+    }
+    return messages;
+}
+
+}
+
+int RunProjectBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 64.0) * 1024 * 1024;
+    int maxFiles = argc >= 2 ? std::atoi(argv[1]) : 64;
+    options.characters = argc >= 3 ? std::atoi(argv[2]) : 64;
+    options.interleave = true;
+    unsigned threads = argc >= 4 ? static_cast<unsigned>(std::atoi(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+
+    const fs::path directory = "rustless_bench_project";
+    std::printf("%.1f MB split over 1 to %d chapter files, %u threads\n", ToMegabytes(options.targetBytes), maxFiles, threads);
+    int failed = 0;
+    for (int files = 1; files <= maxFiles; files *= 2) {
+        std::size_t messages = WriteChapters(directory, files, options);
+
+        std::vector<Character> serial;
+        BenchTimer serialTimer;
+        LoadResult serialLoad = LoadChapterProject(directory.string(), serial, nullptr, 1);
+        double serialSeconds = serialTimer.Seconds();
+
+        std::vector<Character> parallel;
+        BenchTimer parallelTimer;
+        LoadResult parallelLoad = LoadChapterProject(directory.string(), parallel, nullptr, threads);
+        double parallelSeconds = parallelTimer.Seconds();
+
+        std::printf("%3d files, %8zu messages:  1 thread %7.3f s   %2u threads %7.3f s   %.2fx\n",
+            files, messages, serialSeconds, threads, parallelSeconds, serialSeconds / parallelSeconds);
+        if (!serialLoad.ok || !parallelLoad.ok || !SameCharacters(serial, parallel)) {
+            std::printf("MISMATCH: the parallel load differs from loading the files one by one\n");
+            failed++;
+        }
+    }
+
+    //a broken chapter is reported on its own and the others still load
+    {
+        std::ofstream broken(directory / "chapter99.json", std::ios::binary | std::ios::trunc);
+        broken << "{ \"messages\": [ { \"from\": ";
+    }
+    std::vector<Character> characters;
+    std::vector<FileLoadError> errors;
+    LoadResult partial = LoadChapterProject(directory.string(), characters, &errors, threads);
+    std::printf("with a broken file: %zu file error(s), \"%s\", %zu characters still loaded\n", errors.size(), partial.error.c_str(), characters.size());
+    if (partial.ok || errors.size() != 1 || characters.empty()) {
+        failed++;
+    }
+
+    //a sharded project's broken shard is kept as it is, even after its character is edited
+    const fs::path sharded = "rustless_bench_project_sharded";
+    std::error_code ec;
+    fs::remove_all(sharded, ec);
+    MarkAllDirty(characters);
+    SaveResult saved = SaveShardedProject(sharded.string(), PrepareShardedSave(characters), WriteOptions());
+    const std::string brokenText = "{ \"messages\": [ { \"from\": ";
+    {
+        std::ofstream broken(sharded / characters[0].shard, std::ios::binary | std::ios::trunc);
+        broken << brokenText;
+    }
+    std::vector<Character> reloaded;
+    LoadResult shardLoad = LoadShardedProject(sharded.string(), reloaded, nullptr, threads);
+    bool kept = saved.ok && !shardLoad.ok && !reloaded.empty() && !reloaded[0].loadError.empty();
+    if (kept) {
+        reloaded[0].messages.push_back(Message());
+        reloaded[0].dirty = true;
+        ShardedSaveJob job = PrepareShardedSave(reloaded);
+        kept = job.changed.empty() && SaveShardedProject(sharded.string(), job, WriteOptions()).ok;
+        std::ifstream shard(sharded / reloaded[0].shard, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(shard)), std::istreambuf_iterator<char>());
+        kept &= text == brokenText;
+    }
+    std::printf("sharded project with a broken shard: the shard is left alone after an edit  %s\n", kept ? "ok" : "MISMATCH");
+    failed += kept ? 0 : 1;
+
+    fs::remove_all(directory, ec);
+    fs::remove_all(sharded, ec);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "DialogueWriter.h"
+#include "LiveReload.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace {
+
+// Waits for the worker to hand over a batch; seconds until it did, or a negative value on timeout.
+double WaitForReload(ReloadWorker& worker, std::vector<ReloadChanges>& batches, double timeoutSeconds) {
+    BenchTimer timer;
+    while (timer.Seconds() < timeoutSeconds) {
+        if (worker.Take(batches)) {
+            return timer.Seconds();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return -1.0;
+}
+
+int RunWatcher(const char* label, const std::string& path, std::vector<Character> characters, std::unique_ptr<FileWatcher> watcher, int rounds, int edits) {
+    ReloadWorker worker;
+    worker.Start(path, characters, std::move(watcher));
+    std::mt19937 rng(5);
+    WriteOptions options;
+
+    for (int round = 0; round < rounds; round++) {
+        //some messages edited, one removed, one added, like a hand edit in another tool
+        for (int k = 0; k < edits; k++) {
+            Character& character = characters[rng() % characters.size()];
+            if (character.messages.empty()) {
+                continue;
+            }
+            Message& message = character.messages[rng() % character.messages.size()];
+            message.content += " (reloaded " + std::to_string(round) + ")";
+        }
+        Character& target = characters[rng() % characters.size()];
+        if (!target.messages.empty()) {
+            target.messages.erase(target.messages.begin());
+        }
+        Message added;
+        added.ID = 900000000 + round;
+        target.messages.push_back(added);
+
+        SaveResult saved = SaveCharactersToFile(path, characters, options);
+        if (!saved.ok) {
+            std::printf("could not write %s: %s\n", path.c_str(), saved.error.c_str());
+            return 1;
+        }
+        std::vector<ReloadChanges> batches;
+        double seconds = WaitForReload(worker, batches, 10.0);
+        if (seconds < 0.0) {
+            std::printf("%-8s round %d: no reload within 10 s\n", label, round);
+            return 1;
+        }
+        std::size_t changed = 0;
+        std::size_t removed = 0;
+        for (auto& batch : batches) {
+            changed += batch.changed.size();
+            removed += batch.removed.size();
+        }
+        std::printf("%-8s round %d: %7.1f ms after the write (%7.1f ms reading, parsing and diffing), %zu changed, %zu removed\n",
+            label, round, seconds * 1e3, worker.Status().seconds * 1e3, changed, removed);
+        //an erase shifts occurrences only among equal IDs, so with unique IDs it is exactly one removal
+        if (removed != 1 || changed < 1 || changed > static_cast<std::size_t>(edits) + 1) {
+            std::printf("unexpected diff\n");
+            return 1;
+        }
+    }
+
+    //same bytes again: woken, but skipped by the contents hash
+    ReloadStatus before = worker.Status();
+    SaveCharactersToFile(path, characters, options);
+    std::vector<ReloadChanges> batches;
+    if (WaitForReload(worker, batches, 1.0) >= 0.0) {
+        std::printf("%-8s rewriting the same contents produced a reload\n", label);
+        return 1;
+    }
+    ReloadStatus after = worker.Status();
+    std::printf("%-8s identical rewrite skipped (%zu skipped wake-ups)\n", label, after.skipped - before.skipped);
+    return 0;
+}
+
+}
+
+int RunReloadBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.messages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 200000;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+    options.minWords = 1;
+    options.maxWords = 12;
+    int edits = argc >= 3 ? std::atoi(argv[2]) : 100;
+    const int rounds = 3;
+
+    const std::string path = "rustless_bench_reload.json";
+    std::vector<Character> characters = MakeSyntheticCharacters(options);
+    SaveCharactersToFile(path, characters, WriteOptions());
+    std::vector<Character> loaded;
+    LoadResult result = LoadCharactersFromFile(path, loaded);
+    if (!result.ok) {
+        std::printf("load failed: %s\n", result.error.c_str());
+        return 1;
+    }
+    std::printf("%zu messages, %d characters, %d edits per round\n", options.messages, options.characters, edits);
+
+    int failed = RunWatcher("native", path, loaded, CreateFileWatcher(), rounds, edits);
+    SaveCharactersToFile(path, loaded, WriteOptions());
+    failed += RunWatcher("polling", path, loaded, std::make_unique<PollingFileWatcher>(), rounds, edits);
+    std::remove(path.c_str());
+    return failed == 0 ? 0 : 1;
+}
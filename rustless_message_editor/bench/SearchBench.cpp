@@ -0,0 +1,125 @@
+#include "Bench.h"
+#include "SearchIndex.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+// What SearchIndex::Find has to agree with: fold and search every field of every message.
+std::size_t NaiveCount(const std::vector<Character>& characters, const std::string& query, bool wholeWord) {
+    const SearchField fields[] = { SearchField::Content, SearchField::Reply1, SearchField::Content1, SearchField::Reply2, SearchField::Content2 };
+    std::string folded = FoldCase(query);
+    auto isWord = [](char c) {
+        unsigned char u = static_cast<unsigned char>(c);
+        return u >= 0x80 || u == '_' || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z');
+    };
+
+    std::size_t count = 0;
+    for (auto& character : characters) {
+        for (auto& message : character.messages) {
+            for (SearchField field : fields) {
+                std::string text = FoldCase(SearchFieldText(message, field));
+                for (std::size_t at = text.find(folded); at != std::string::npos; at = text.find(folded, at + 1)) {
+                    std::size_t after = at + folded.size();
+                    if (!wholeWord || ((at == 0 || !isWord(text[at - 1])) && (after == text.size() || !isWord(text[after])))) {
+                        count++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+struct Query {
+    const char* text;
+    bool wholeWord;
+};
+
+const Query kQueries[] = {
+    { "e", false },
+    { "zq", false },
+    { "Dragon", false },
+    { "dragon", true },
+    { "THINE", true },
+    { "fr", true },
+    { "quest sword", false },
+    { "castle knight", false },
+    { "\xE2\x80\x99s", false },
+    { "nothing like this", false },
+};
+
+}
+
+int RunSearchBench(int argc, char** argv) {
+    std::size_t messages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 1000000;
+    int characters = argc >= 2 ? std::atoi(argv[1]) : 100;
+    std::size_t edits = argc >= 3 ? static_cast<std::size_t>(std::atoll(argv[2])) : 20000;
+
+    CorpusOptions options;
+    options.messages = messages;
+    options.characters = characters;
+    options.minWords = 1;
+    options.maxWords = 12;
+    std::vector<Character> loaded = MakeSyntheticCharacters(options);
+
+    SearchIndex index;
+    BenchTimer buildTimer;
+    index.Rebuild(loaded);
+    std::printf("%zu messages, index built in %.1f ms\n\n", messages, buildTimer.Seconds() * 1e3);
+
+    //typing into random messages: append a word, then every so often delete and re-add one
+    std::mt19937 rng(5);
+    BenchTimer editTimer;
+    for (std::size_t k = 0; k < edits; k++) {
+        int c = static_cast<int>(rng() % loaded.size());
+        if (loaded[c].messages.empty()) {
+            continue;
+        }
+        int m = static_cast<int>(rng() % loaded[c].messages.size());
+        if (k % 50 == 49) {
+            loaded[c].messages.erase(loaded[c].messages.begin() + m);
+            index.OnMessageDeleted(c, m);
+            Message added;
+            added.content = "Freshly added dragon";
+            loaded[c].messages.insert(loaded[c].messages.begin() + m, added);
+            index.OnMessageAdded(loaded, c, m);
+        }
+        else {
+            loaded[c].messages[m].content += k % 2 == 0 ? " Zqx" : "s";
+            index.OnMessageChanged(loaded, c, m);
+        }
+    }
+    if (edits != 0) {
+        std::printf("%zu edits at %.2f us each\n\n", edits, editTimer.Seconds() * 1e6 / static_cast<double>(edits));
+    }
+
+    std::printf("%-22s %6s %12s %12s %10s\n", "query", "word", "first 1000", "all", "hits");
+    int failed = 0;
+    for (auto& query : kQueries) {
+        SearchOptions search;
+        search.wholeWord = query.wholeWord;
+
+        BenchTimer firstTimer;
+        SearchResults first = index.Find(query.text, search);
+        double firstSeconds = firstTimer.Seconds();
+
+        search.maxHits = static_cast<std::size_t>(-1);
+        BenchTimer allTimer;
+        SearchResults all = index.Find(query.text, search);
+        double allSeconds = allTimer.Seconds();
+
+        std::size_t expected = NaiveCount(loaded, query.text, query.wholeWord);
+        bool ok = all.hits.size() == expected && first.hits.size() == std::min<std::size_t>(expected, 1000);
+        std::printf("%-22s %6s %9.3f ms %9.3f ms %10zu%s\n", query.text, query.wholeWord ? "yes" : "no",
+            firstSeconds * 1e3, allSeconds * 1e3, all.hits.size(), ok ? "" : "  MISMATCH");
+        if (!ok) {
+            std::printf("    expected %zu hits\n", expected);
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
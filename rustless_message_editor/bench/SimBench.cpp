@@ -0,0 +1,180 @@
+#include "Bench.h"
+#include "DialogueSim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+bool SameResult(const SimResult& a, const SimResult& b) {
+    if (a.playthroughs != b.playthroughs || a.deaths != b.deaths || std::memcmp(a.finalHealth, b.finalHealth, sizeof(a.finalHealth)) != 0
+        || a.characters.size() != b.characters.size() || a.messages.size() != b.messages.size()) {
+        return false;
+    }
+    for (int r = 0; r < 3; r++) {
+        const SimRelationshipStats& x = a.relationships[r];
+        const SimRelationshipStats& y = b.relationships[r];
+        if (x.reached != y.reached || x.missed != y.missed || x.hurt != y.hurt || x.unchanged != y.unchanged || x.helped != y.helped || x.healthSum != y.healthSum) {
+            return false;
+        }
+    }
+    for (std::size_t c = 0; c < a.characters.size(); c++) {
+        const SimCharacterStats& x = a.characters[c];
+        const SimCharacterStats& y = b.characters[c];
+        if (x.playthroughs != y.playthroughs || x.deaths != y.deaths || x.finalHealthSum != y.finalHealthSum || x.finalHealthMin != y.finalHealthMin
+            || x.finalHealthMax != y.finalHealthMax || x.timeMsSum != y.timeMsSum || x.timeMsMax != y.timeMsMax) {
+            return false;
+        }
+    }
+    for (std::size_t m = 0; m < a.messages.size(); m++) {
+        const SimMessageStats& x = a.messages[m];
+        const SimMessageStats& y = b.messages[m];
+        if (x.reached != y.reached || x.missed != y.missed || x.picks[0] != y.picks[0] || x.picks[1] != y.picks[1] || x.deaths != y.deaths
+            || x.healthSum != y.healthSum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Totals that have to agree with each other whatever the corpus: every playthrough ends once, in
+// a death or past the last message, and every message reached was missed, answered or had no choice.
+bool Consistent(const SimModel& model, const SimResult& result) {
+    uint64_t histogram = 0;
+    for (uint64_t count : result.finalHealth) {
+        histogram += count;
+    }
+    uint64_t runs = 0;
+    uint64_t deaths = 0;
+    for (auto& character : result.characters) {
+        runs += character.playthroughs;
+        deaths += character.deaths;
+    }
+    uint64_t messageDeaths = 0;
+    uint64_t reached = 0;
+    for (std::size_t m = 0; m < result.messages.size(); m++) {
+        const SimMessageStats& stats = result.messages[m];
+        messageDeaths += stats.deaths;
+        reached += stats.reached;
+        uint64_t accounted = stats.missed + stats.picks[0] + stats.picks[1];
+        if (model.messages[m].choices != 0 ? accounted != stats.reached : accounted != 0) {
+            return false;
+        }
+    }
+    uint64_t relationshipReached = result.relationships[0].reached + result.relationships[1].reached + result.relationships[2].reached;
+    return histogram == result.playthroughs && runs == result.playthroughs && deaths == result.deaths && messageDeaths == result.deaths
+        && reached == relationshipReached;
+}
+
+double MeanFinalHealth(const SimResult& result) {
+    int64_t sum = 0;
+    for (auto& character : result.characters) {
+        sum += character.finalHealthSum;
+    }
+    return static_cast<double>(sum) / static_cast<double>(result.playthroughs);
+}
+
+}
+
+int RunSimBench(int argc, char** argv) {
+    CorpusOptions corpus;
+    corpus.messages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 1000;
+    corpus.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+    uint64_t playthroughs = argc >= 3 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+    std::vector<Character> characters = MakeSyntheticCharacters(corpus);
+    //a few messages with one response or none, and short timers, so every path gets taken
+    for (std::size_t k = 0; k < characters[0].messages.size(); k++) {
+        Message& message = characters[0].messages[k];
+        if (k % 7 == 0) {
+            message.responce[1].content = "";
+        }
+        if (k % 11 == 0) {
+            message.responce[0].content = "";
+            message.responce[1].content = "";
+        }
+        if (k % 5 == 0) {
+            message.timeToRespond = 3;
+        }
+    }
+
+    BenchTimer buildTimer;
+    SimModel model = BuildSimModel(characters);
+    double buildSeconds = buildTimer.Seconds();
+    std::printf("%zu messages, %d characters, model built in %.3f ms (%zu bytes of messages)\n", model.messages.size(), corpus.characters, buildSeconds * 1000.0,
+        model.messages.size() * sizeof(SimMessage));
+
+    int failed = 0;
+    SimOptions options;
+    options.playthroughs = playthroughs;
+    SimResult all = RunSimulation(model, options);
+    double steps = 0.0;
+    for (auto& stats : all.messages) {
+        steps += static_cast<double>(stats.reached);
+    }
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("random: %llu playthroughs on %u threads in %.3f s, %.1f million/s, %.0f million messages/s, %.1f%% died\n",
+        static_cast<unsigned long long>(all.playthroughs), cores, all.seconds, static_cast<double>(all.playthroughs) / all.seconds / 1e6,
+        steps / all.seconds / 1e6, 100.0 * static_cast<double>(all.deaths) / static_cast<double>(all.playthroughs));
+    if (!Consistent(model, all)) {
+        std::printf("MISMATCH: the totals don't add up\n");
+        failed++;
+    }
+
+    //the same seed gives the same totals however the batches were spread over threads
+    SimOptions smaller = options;
+    smaller.playthroughs = std::min<uint64_t>(playthroughs, 1000000);
+    smaller.threads = 1;
+    SimResult one = RunSimulation(model, smaller);
+    smaller.threads = 3;
+    SimResult three = RunSimulation(model, smaller);
+    std::printf("one thread %.3f s, three threads %.3f s, %s\n", one.seconds, three.seconds, SameResult(one, three) ? "same totals" : "DIFFERENT TOTALS");
+    if (!SameResult(one, three)) {
+        failed++;
+    }
+
+    const char* names[] = { "random", "kindest", "cruelest" };
+    double means[3];
+    for (int p = 0; p < 3; p++) {
+        smaller.policy = static_cast<SimPolicy>(p);
+        smaller.threads = 0;
+        SimResult result = RunSimulation(model, smaller);
+        means[p] = MeanFinalHealth(result);
+        std::printf("  %-9s mean final health %7.2f, %5.1f%% died\n", names[p], means[p], 100.0 * static_cast<double>(result.deaths) / static_cast<double>(result.playthroughs));
+        failed += Consistent(model, result) ? 0 : 1;
+    }
+    if (!(means[1] >= means[0] && means[0] >= means[2])) {
+        std::printf("MISMATCH: the kindest player should end healthier than a random one, and a random one than the cruelest\n");
+        failed++;
+    }
+
+    std::atomic<bool> cancel{ true };
+    SimResult cancelled = RunSimulation(model, smaller, nullptr, &cancel);
+    if (!cancelled.cancelled || cancelled.playthroughs != 0) {
+        std::printf("MISMATCH: a cancelled simulation kept running\n");
+        failed++;
+    }
+
+    //the worker drops a simulation that a newer one replaced
+    SimWorker worker;
+    SimOptions first = options;
+    first.seed = 7;
+    SimOptions second = smaller;
+    second.seed = 8;
+    worker.Start(model, first);
+    worker.Start(model, second);
+    SimModel takenModel;
+    SimResult taken;
+    BenchTimer waitTimer;
+    while (!worker.Take(takenModel, taken) && waitTimer.Seconds() < 60.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool newest = taken.options.seed == 8 && !taken.cancelled && taken.playthroughs == second.playthroughs;
+    std::printf("worker: newest simulation %s after %.3f s\n", newest ? "kept" : "NOT KEPT", waitTimer.Seconds());
+    if (!newest || takenModel.messages.size() != model.messages.size()) {
+        failed++;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#include "Bench.h"
+#include "DialogueLoader.h"
+#include "DialogueStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+struct StoreRun {
+    double seconds = 0.0;
+    std::size_t liveBytes = 0;
+    std::size_t peakBytes = 0;
+    std::size_t allocations = 0;
+};
+
+void Report(const char* name, const StoreRun& run, std::size_t fileBytes, std::size_t messages) {
+    std::printf("%-8s %8.3f s  %8.1f MB/s  resident %8.1f MB  %7.1f B/msg  peak %8.1f MB  allocations %10zu\n",
+        name, run.seconds, ToMegabytes(fileBytes) / run.seconds, ToMegabytes(run.liveBytes),
+        static_cast<double>(run.liveBytes) / static_cast<double>(messages), ToMegabytes(run.peakBytes), run.allocations);
+}
+
+int RunCorpus(const char* label, const CorpusOptions& options) {
+    std::string corpus;
+    std::size_t messages;
+    {
+        std::ostringstream out;
+        messages = WriteSyntheticCorpus(out, options);
+        corpus = out.str();
+    }
+    std::printf("%s: %.1f MB, %zu messages, %d characters\n", label, ToMegabytes(corpus.size()), messages, options.characters);
+
+    //what stays on the heap after each load, with the input buffer outside the measurement
+    std::vector<Character> characters;
+    StoreRun structs;
+    std::size_t liveBefore = GetAllocStats().liveBytes;
+    ResetAllocStats();
+    BenchTimer structTimer;
+    LoadResult structLoad = LoadCharacters(corpus.data(), corpus.data() + corpus.size(), characters);
+    structs.seconds = structTimer.Seconds();
+    AllocStats stats = GetAllocStats();
+    structs.liveBytes = stats.liveBytes - liveBefore;
+    structs.peakBytes = stats.peakBytes - liveBefore;
+    structs.allocations = stats.allocations;
+    Report("structs", structs, corpus.size(), messages);
+
+    DialogueStore store;
+    StoreRun columns;
+    liveBefore = GetAllocStats().liveBytes;
+    ResetAllocStats();
+    BenchTimer storeTimer;
+    LoadResult storeLoad = LoadDialogueStore(corpus.data(), corpus.data() + corpus.size(), store);
+    columns.seconds = storeTimer.Seconds();
+    stats = GetAllocStats();
+    columns.liveBytes = stats.liveBytes - liveBefore;
+    columns.peakBytes = stats.peakBytes - liveBefore;
+    columns.allocations = stats.allocations;
+    Report("store", columns, corpus.size(), messages);
+    std::printf("         %u distinct strings for %zu texts, store reports %.1f MB\n", store.Strings().Count(), messages * 5 + static_cast<std::size_t>(options.characters),
+        ToMegabytes(store.MemoryBytes()));
+    double memory = static_cast<double>(structs.liveBytes) / static_cast<double>(columns.liveBytes);
+    std::printf("         %.2fx %s memory, %.2fx load time, %.2fx peak\n\n", memory >= 1.0 ? memory : 1.0 / memory, memory >= 1.0 ? "less" : "more",
+        columns.seconds / structs.seconds, static_cast<double>(columns.peakBytes) / static_cast<double>(structs.peakBytes));
+
+    if (!structLoad.ok || !storeLoad.ok) {
+        std::printf("load failed: %s\n", structLoad.ok ? storeLoad.error.c_str() : structLoad.error.c_str());
+        return 1;
+    }
+    std::vector<Character> roundTrip;
+    store.ToCharacters(roundTrip);
+    if (!SameCharacters(characters, roundTrip)) {
+        std::printf("store and struct loads differ\n");
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int RunStoreBench(int argc, char** argv) {
+    CorpusOptions options;
+    options.targetBytes = static_cast<std::size_t>(argc >= 1 ? std::atof(argv[0]) : 256.0) * 1024 * 1024;
+    options.characters = argc >= 2 ? std::atoi(argv[1]) : 64;
+    options.minWords = 1;
+    options.maxWords = argc >= 3 ? std::atoi(argv[2]) : 12;
+
+    int failed = RunCorpus("grouped", options);
+    //speakers taking turns, so Finish has to regroup every message
+    options.interleave = true;
+    failed += RunCorpus("interleaved", options);
+    return failed == 0 ? 0 : 1;
+}
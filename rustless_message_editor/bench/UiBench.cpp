@@ -0,0 +1,221 @@
+#include "Bench.h"
+#include "EditorUI.h"
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+// Runs the real editor window (EditorUI.cpp) against ImGui with no platform or renderer backend:
+// input is scripted into ImGuiIO and the ImDrawData of each frame is only counted, never drawn.
+
+struct UiDataset {
+    const char* name;
+    int characters;
+    std::size_t messages;
+    int minWords;
+    int maxWords;
+};
+
+const UiDataset kDatasets[] = {
+    { "small", 10, 1000, 4, 40 },
+    { "wide", 100000, 100000, 1, 4 },
+    { "deep", 1, 1000000, 1, 8 },
+    { "long", 20, 2000, 1500, 3000 },
+};
+
+struct FrameSample {
+    double seconds = 0.0;
+    int vertices = 0;
+    int indices = 0;
+    std::size_t allocations = 0;
+};
+
+void* ImGuiAlloc(std::size_t size, void*) {
+    return ::operator new(size);
+}
+
+void ImGuiFree(void* ptr, void*) {
+    ::operator delete(ptr);
+}
+
+FrameSample RunFrame(EditorState& state) {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 800.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+
+    std::size_t allocationsBefore = GetAllocStats().allocations;
+    BenchTimer timer;
+    ImGui::NewFrame();
+    DrawEditor(state, io.DisplaySize);
+    ImGui::Render();
+
+    FrameSample sample;
+    sample.seconds = timer.Seconds();
+    sample.allocations = GetAllocStats().allocations - allocationsBefore;
+    ImDrawData* drawData = ImGui::GetDrawData();
+    sample.vertices = drawData->TotalVtxCount;
+    sample.indices = drawData->TotalIdxCount;
+    return sample;
+}
+
+// Rebuilds the ID the "Content" field of a message gets: window, character tree node,
+// PushID(character), "Messages" tree node, PushID(message), label.
+ImGuiID ContentFieldID(const EditorState& state, int character, int message) {
+    ImGuiID id = ImHashStr("Message Editor");
+    id = ImHashStr(state.treeNames[character].c_str(), 0, id);
+    id = ImHashData(&character, sizeof(character), id);
+    id = ImHashStr("Messages", 0, id);
+    id = ImHashData(&message, sizeof(message), id);
+    return ImHashStr("Content", 0, id);
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    std::size_t at = static_cast<std::size_t>(fraction * static_cast<double>(values.size() - 1) + 0.5);
+    return values[at];
+}
+
+void Report(const char* dataset, const char* phase, const std::vector<FrameSample>& samples) {
+    std::vector<double> milliseconds;
+    double vertices = 0.0;
+    double indices = 0.0;
+    double allocations = 0.0;
+    for (auto& sample : samples) {
+        milliseconds.push_back(sample.seconds * 1e3);
+        vertices += sample.vertices;
+        indices += sample.indices;
+        allocations += static_cast<double>(sample.allocations);
+    }
+    double count = static_cast<double>(samples.size());
+    std::printf("%-6s %-8s %9.3f %9.3f %9.3f %9.3f %10.0f %10.0f %10.1f\n", dataset, phase,
+        Percentile(milliseconds, 0.5), Percentile(milliseconds, 0.9), Percentile(milliseconds, 0.99),
+        *std::max_element(milliseconds.begin(), milliseconds.end()),
+        vertices / count, indices / count, allocations / count);
+}
+
+int RunDataset(const UiDataset& dataset, int frames) {
+    CorpusOptions options;
+    options.characters = dataset.characters;
+    options.messages = dataset.messages;
+    options.minWords = dataset.minWords;
+    options.maxWords = dataset.maxWords;
+
+    EditorState state;
+    state.characters = MakeSyntheticCharacters(options);
+    for (auto& character : state.characters) {
+        state.treeNames.push_back(character.name);
+    }
+    state.index.Rebuild(state.characters);
+    state.search.Rebuild(state.characters);
+    state.validator.ValidateAll(state.characters, state.index);
+
+    ImGui::SetAllocatorFunctions(ImGuiAlloc, ImGuiFree);
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    //settle the first-frame font and window setup before measuring anything
+    RunFrame(state);
+    RunFrame(state);
+
+    std::vector<FrameSample> samples;
+
+    //everything collapsed: the cost of the character list alone
+    for (int f = 0; f < frames; f++) {
+        samples.push_back(RunFrame(state));
+    }
+    Report(dataset.name, "idle", samples);
+
+    //Find ID on a message half way through the middle character opens its trees and scrolls there
+    int character = static_cast<int>(state.characters.size()) / 2;
+    int message = static_cast<int>(state.characters[character].messages.size()) / 2;
+    samples.clear();
+    for (int f = 0; f < frames; f++) {
+        if (f == 0) {
+            state.jumpTo = MessageLocation{ character, message };
+        }
+        samples.push_back(RunFrame(state));
+    }
+    Report(dataset.name, "expanded", samples);
+
+    //type into that message's content, one character per frame
+    std::size_t lengthBefore = state.characters[character].messages[message].content.size();
+    ImGui::ActivateItemByID(ContentFieldID(state, character, message));
+    RunFrame(state);
+    //activating selects everything; End puts the cursor after the text so typing appends
+    io.AddKeyEvent(ImGuiKey_End, true);
+    RunFrame(state);
+    io.AddKeyEvent(ImGuiKey_End, false);
+    RunFrame(state);
+    samples.clear();
+    for (int f = 0; f < frames; f++) {
+        io.AddInputCharacter('a' + f % 26);
+        samples.push_back(RunFrame(state));
+    }
+    Report(dataset.name, "typing", samples);
+    //the field stays active; scrolling it out of view below lets ImGui drop it
+    std::size_t typed = state.characters[character].messages[message].content.size() - lengthBefore;
+
+    //scroll down through the open list with the mouse wheel
+    io.AddMousePosEvent(640.0f, 400.0f);
+    samples.clear();
+    for (int f = 0; f < frames; f++) {
+        io.AddMouseWheelEvent(0.0f, -3.0f);
+        samples.push_back(RunFrame(state));
+    }
+    Report(dataset.name, "scroll", samples);
+
+    //the whole typing run is one undo step, and redo brings it back
+    std::size_t historyBytes = state.history.Bytes();
+    bool undone = UndoEdit(state) && state.characters[character].messages[message].content.size() == lengthBefore;
+    bool redone = RedoEdit(state) && state.characters[character].messages[message].content.size() == lengthBefore + typed;
+    RunFrame(state);
+
+    ImGui::DestroyContext();
+
+    if (typed != static_cast<std::size_t>(frames)) {
+        std::printf("typing check failed: %zu of %d characters reached the message\n", typed, frames);
+        return 1;
+    }
+    if (!undone || !redone || state.history.Steps() != 1) {
+        std::printf("undo check failed: %zu steps for one typing run, undo %s, redo %s\n", state.history.Steps(), undone ? "ok" : "failed", redone ? "ok" : "failed");
+        return 1;
+    }
+    std::printf("%-6s undo history after typing: 1 step, %zu bytes\n", dataset.name, historyBytes);
+    return 0;
+}
+
+}
+
+int RunUiBench(int argc, char** argv) {
+    const char* only = argc >= 1 ? argv[0] : "all";
+    int frames = argc >= 2 ? std::atoi(argv[1]) : 120;
+    if (frames < 1) {
+        frames = 1;
+    }
+
+    std::printf("%-6s %-8s %9s %9s %9s %9s %10s %10s %10s\n", "data", "phase", "p50 ms", "p90 ms", "p99 ms", "max ms", "vertices", "indices", "allocs");
+    int failed = 0;
+    bool ran = false;
+    for (auto& dataset : kDatasets) {
+        if (std::strcmp(only, "all") == 0 || std::strcmp(only, dataset.name) == 0) {
+            failed += RunDataset(dataset, frames);
+            ran = true;
+        }
+    }
+    if (!ran) {
+        std::printf("unknown dataset %s\n", only);
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
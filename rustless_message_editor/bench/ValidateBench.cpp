@@ -0,0 +1,148 @@
+#include "Bench.h"
+#include "DialogueIndex.h"
+#include "DialogueValidator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace {
+
+bool SameProblems(const std::vector<Problem>& a, const std::vector<Problem>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t k = 0; k < a.size(); k++) {
+        if (a[k].character != b[k].character || a[k].message != b[k].message || a[k].flags != b[k].flags) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int RunValidateBench(int argc, char** argv) {
+    std::size_t messages = argc >= 1 ? static_cast<std::size_t>(std::atoll(argv[0])) : 1000000;
+    int characters = argc >= 2 ? std::atoi(argv[1]) : 100;
+    std::size_t edits = argc >= 3 ? static_cast<std::size_t>(std::atoll(argv[2])) : 20000;
+
+    CorpusOptions options;
+    options.messages = messages;
+    options.characters = characters;
+    options.minWords = 1;
+    options.maxWords = 4;
+    std::vector<Character> loaded = MakeSyntheticCharacters(options);
+
+    DialogueIndex index;
+    index.Rebuild(loaded);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads : { 1u, cores }) {
+        DialogueValidator validator;
+        BenchTimer timer;
+        validator.ValidateAll(loaded, index, threads);
+        std::printf("full validation, %2u threads: %8.1f ms  (%zu problems)\n", threads, timer.Seconds() * 1e3, validator.ProblemCount());
+    }
+
+    //the edits the editor makes, each followed by its On* call; the synthetic corpus starts clean,
+    //so these are what create and clear the problems
+    DialogueValidator validator;
+    validator.ValidateAll(loaded, index);
+    std::mt19937 rng(11);
+    BenchTimer editTimer;
+    for (std::size_t k = 0; k < edits; k++) {
+        int c = static_cast<int>(rng() % loaded.size());
+        if (loaded[c].messages.empty()) {
+            continue;
+        }
+        int m = static_cast<int>(rng() % loaded[c].messages.size());
+        Message& message = loaded[c].messages[m];
+
+        switch (k % 8) {
+        case 0:
+        case 1: {
+            //copy another message's ID, or take a fresh or negative one
+            int32_t oldID = message.ID;
+            int32_t newID = k % 3 == 0 ? -static_cast<int32_t>(rng() % 100) : static_cast<int32_t>(rng() % messages) * 100;
+            index.OnMessageIDChanged(c, m, oldID, newID);
+            message.ID = newID;
+            validator.OnMessageIDChanged(loaded, index, c, m, oldID);
+            break;
+        }
+        case 2:
+            message.responce[rng() % 2].health = static_cast<int>(rng() % 400) - 200;
+            validator.OnMessageChanged(loaded, index, c, m);
+            break;
+        case 3:
+            message.responce[0].content.clear();
+            if (k % 2 == 0) {
+                message.responce[1].content.clear();
+            }
+            validator.OnMessageChanged(loaded, index, c, m);
+            break;
+        case 4:
+            message.relationship = static_cast<Relationship>(rng() % 4);
+            validator.OnMessageChanged(loaded, index, c, m);
+            break;
+        case 5: {
+            int32_t deletedID = message.ID;
+            loaded[c].messages.erase(loaded[c].messages.begin() + m);
+            index.OnMessageDeleted(loaded, c, m, deletedID);
+            validator.OnMessageDeleted(loaded, index, c, m, deletedID);
+            break;
+        }
+        case 6: {
+            Message added;
+            added.ID = static_cast<int32_t>(rng() % messages) * 100;
+            loaded[c].messages.insert(loaded[c].messages.begin() + m, added);
+            index.OnMessageAdded(loaded, c, m);
+            validator.OnMessageAdded(loaded, index, c, m);
+            break;
+        }
+        default:
+            if (k % 400 == 7) {
+                std::vector<int32_t> deletedIDs;
+                for (auto& gone : loaded[c].messages) {
+                    deletedIDs.push_back(gone.ID);
+                }
+                loaded.erase(loaded.begin() + c);
+                index.OnCharacterDeleted(loaded, c);
+                validator.OnCharacterDeleted(loaded, index, c, deletedIDs);
+
+                Character added;
+                added.messages.resize(3);
+                loaded.insert(loaded.begin() + c, added);
+                index.OnCharacterAdded(loaded, c);
+                validator.OnCharacterAdded(loaded, index, c);
+            }
+            else {
+                message.timeToRespond = static_cast<int>(rng() % 40) - 5;
+                validator.OnMessageChanged(loaded, index, c, m);
+            }
+            break;
+        }
+    }
+    if (edits != 0) {
+        std::printf("%zu edits at %.2f us each\n", edits, editTimer.Seconds() * 1e6 / static_cast<double>(edits));
+    }
+
+    DialogueValidator fresh;
+    fresh.ValidateAll(loaded, index);
+    std::printf("%zu problems after the edits\n", validator.ProblemCount());
+    for (int bit = 0; bit < kProblemKinds; bit++) {
+        ProblemFlag kind = static_cast<ProblemFlag>(1 << bit);
+        std::printf("    %-26s %zu\n", ProblemName(kind), validator.KindCount(kind));
+        if (validator.KindCount(kind) != fresh.KindCount(kind)) {
+            std::printf("MISMATCH: a full validation counts %zu\n", fresh.KindCount(kind));
+            return 1;
+        }
+    }
+    if (!SameProblems(validator.Collect(validator.ProblemCount()), fresh.Collect(fresh.ProblemCount()))) {
+        std::printf("MISMATCH: incremental problems differ from a full validation\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Dialogue.h"
+#include "DialogueBatch.h"
+#include "DialogueLoader.h"
+#include "DialogueMerge.h"
+#include "DialogueSim.h"
+#include "DialogueWriter.h"
+#include "ProjectFiles.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class OutputFormat {
+    Json,
+    Baked,
+    Sharded
+};
+
+struct CliOptions {
+    WriteOptions write;
+    // convert: what to write, and where; an empty outDir writes next to the input
+    OutputFormat to = OutputFormat::Json;
+    std::string outDir = "";
+    // stats: list every character, not just the totals
+    bool perCharacter = false;
+    unsigned jobs = 0;
+    // simulate: how many playthroughs and how the player answers; threads come from jobs
+    SimOptions simulate;
+    // batch: which messages, what to do to them in order, and whether to only show it
+    BatchFilter batchFilter;
+    std::vector<BatchTransform> batch;
+    bool dryRun = false;
+    // how many of the changes to list
+    std::size_t diffLines = 10;
+    // diff: the older version each input is compared with
+    std::string against = "";
+    // merge: what ours (the input) and theirs both started from, and theirs
+    std::string mergeBase = "";
+    std::string mergeTheirs = "";
+};
+
+// Relationship names as the options take them and the reports print them, indexed by Relationship.
+extern const char* const kRelationshipNames[3];
+
+struct CharacterStats {
+    std::string name = "";
+    std::size_t messages = 0;
+    std::size_t relationships[3] = { 0, 0, 0 };
+    std::size_t textBytes = 0;
+};
+
+struct DialogueStats {
+    std::size_t characters = 0;
+    std::size_t messages = 0;
+    std::size_t relationships[3] = { 0, 0, 0 };
+    // content, replies and response text, in UTF-8 bytes
+    std::size_t textBytes = 0;
+    std::vector<CharacterStats> perCharacter;
+
+    void Add(const DialogueStats& other);
+};
+
+// What one command did to one input. Filled on a worker thread, printed in input order afterwards.
+struct FileReport {
+    std::string path = "";
+    bool ok = true;
+    std::vector<std::string> problems;
+    std::vector<std::string> notes;
+    DialogueStats stats;
+    std::size_t bytesRead = 0;
+    std::size_t bytesWritten = 0;
+    double seconds = 0.0;
+};
+
+// Reads a messages json, a sharded project, a chapter directory or a baked .bin. Files of a
+// project that failed to load are listed in fileErrors.
+LoadResult LoadAnyDialogue(const std::string& path, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors = nullptr);
+
+// Where convert writes an input: same stem, new extension (none for a sharded directory).
+std::string ConvertOutputPath(const std::string& path, const CliOptions& options);
+
+void ValidateFile(const std::string& path, const CliOptions& options, FileReport& report);
+void ReformatFile(const std::string& path, const CliOptions& options, FileReport& report);
+void StatsFile(const std::string& path, const CliOptions& options, FileReport& report);
+void ConvertFile(const std::string& path, const CliOptions& options, FileReport& report);
+void SimulateFile(const std::string& path, const CliOptions& options, FileReport& report);
+void BatchFile(const std::string& path, const CliOptions& options, FileReport& report);
+void DiffFile(const std::string& path, const CliOptions& options, FileReport& report);
+void MergeFile(const std::string& path, const CliOptions& options, FileReport& report);
@@ -0,0 +1,426 @@
+#include "Cli.h"
+
+#include "BakedDialogue.h"
+#include "DialogueBake.h"
+#include "DialogueBatch.h"
+#include "DialogueIndex.h"
+#include "DialogueMerge.h"
+#include "DialogueSim.h"
+#include "DialogueValidator.h"
+#include "ProjectFiles.h"
+
+#include <cstdio>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+const char* const kRelationshipNames[3] = { "positive", "neuteral", "negative" };
+
+namespace {
+
+bool IsBakedPath(const fs::path& path) {
+    return path.extension() == ".bin";
+}
+
+// "Content/Data/messages/" and "Content/Data/messages" name the same project
+fs::path TrimmedPath(const std::string& path) {
+    fs::path trimmed(path);
+    if (!trimmed.has_filename() && trimmed.has_parent_path()) {
+        trimmed = trimmed.parent_path();
+    }
+    return trimmed;
+}
+
+bool Load(const std::string& path, std::vector<Character>& characters, FileReport& report) {
+    std::vector<FileLoadError> fileErrors;
+    LoadResult result = LoadAnyDialogue(path, characters, &fileErrors);
+    report.bytesRead = result.bytesRead;
+    if (!result.ok && fileErrors.empty()) {
+        std::string where = result.line != 0 ? ":" + std::to_string(result.line) + ":" + std::to_string(result.column) : "";
+        report.problems.push_back("load failed" + where + ": " + result.error);
+        report.ok = false;
+    }
+    for (auto& failed : fileErrors) {
+        std::string where = failed.result.line != 0 ? ":" + std::to_string(failed.result.line) + ":" + std::to_string(failed.result.column) : "";
+        report.problems.push_back("load failed: " + failed.file + where + ": " + failed.result.error);
+        report.ok = false;
+    }
+    return result.ok;
+}
+
+SaveResult Save(const fs::path& path, OutputFormat format, std::vector<Character>& characters, const WriteOptions& options) {
+    switch (format) {
+    case OutputFormat::Baked:
+        return SaveBakedFile(path.string(), characters);
+    case OutputFormat::Sharded:
+        MarkAllDirty(characters);
+        return SaveShardedProject(path.string(), PrepareShardedSave(characters), options);
+    default:
+        return SaveCharactersToFile(path.string(), characters, options);
+    }
+}
+
+OutputFormat FormatOf(const std::string& path) {
+    if (IsShardedProject(path)) {
+        return OutputFormat::Sharded;
+    }
+    return IsBakedPath(path) ? OutputFormat::Baked : OutputFormat::Json;
+}
+
+//the loader keeps whatever integer the file had
+bool IsKnownRelationship(Relationship relationship) {
+    int value = static_cast<int>(relationship);
+    return value >= POSITIVE && value <= NEGATIVE;
+}
+
+double Percent(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+// Lowest final health at least fraction of the playthroughs stayed under, to a bucket's width.
+int FinalHealthPercentile(const SimResult& result, double fraction) {
+    uint64_t seen = 0;
+    for (int k = 0; k < kSimHealthBuckets; k++) {
+        seen += result.finalHealth[k];
+        if (static_cast<double>(seen) >= fraction * static_cast<double>(result.playthroughs)) {
+            return (k + 1) * result.bucketWidth;
+        }
+    }
+    return kSimHealthBuckets * result.bucketWidth;
+}
+
+void AddSimulationNotes(const SimModel& model, const SimResult& result, bool perCharacter, FileReport& report) {
+    char line[512];
+    std::snprintf(line, sizeof(line), "%llu playthroughs in %.2f s (%.1f million/s), %.1f%% ran out of health",
+        static_cast<unsigned long long>(result.playthroughs), result.seconds, static_cast<double>(result.playthroughs) / std::max(result.seconds, 1e-9) / 1e6,
+        Percent(result.deaths, result.playthroughs));
+    report.notes.push_back(line);
+    std::snprintf(line, sizeof(line), "final health: 10%% under %d, half under %d, 90%% under %d", FinalHealthPercentile(result, 0.1),
+        FinalHealthPercentile(result, 0.5), FinalHealthPercentile(result, 0.9));
+    report.notes.push_back(line);
+    for (int r = 0; r < 3; r++) {
+        const SimRelationshipStats& stats = result.relationships[r];
+        uint64_t answered = stats.hurt + stats.unchanged + stats.helped;
+        std::snprintf(line, sizeof(line), "%s: %llu messages, %.1f%% missed, %.1f%% hurt, %.1f%% unchanged, %.1f%% helped, mean health change %+.2f",
+            kRelationshipNames[r], static_cast<unsigned long long>(stats.reached), Percent(stats.missed, stats.reached), Percent(stats.hurt, answered),
+            Percent(stats.unchanged, answered), Percent(stats.helped, answered), answered == 0 ? 0.0 : static_cast<double>(stats.healthSum) / static_cast<double>(answered));
+        report.notes.push_back(line);
+    }
+    if (perCharacter) {
+        for (std::size_t c = 0; c < model.characters.size(); c++) {
+            const SimCharacterStats& stats = result.characters[c];
+            if (stats.playthroughs == 0) {
+                continue;
+            }
+            double runs = static_cast<double>(stats.playthroughs);
+            std::snprintf(line, sizeof(line), "  %s: %.1f%% died, final health mean %.1f (%lld to %lld), time mean %.1f s, max %.1f s of a %.1f s budget",
+                model.names[c].c_str(), Percent(stats.deaths, stats.playthroughs), static_cast<double>(stats.finalHealthSum) / runs,
+                static_cast<long long>(stats.finalHealthMin), static_cast<long long>(stats.finalHealthMax), static_cast<double>(stats.timeMsSum) / runs / 1000.0,
+                static_cast<double>(stats.timeMsMax) / 1000.0, static_cast<double>(model.characters[c].budgetMs) / 1000.0);
+            report.notes.push_back(line);
+        }
+    }
+    std::vector<uint32_t> deadly = DeadliestMessages(result, 5);
+    for (uint32_t m : deadly) {
+        std::size_t c = 0;
+        while (model.characters[c].firstMessage + model.characters[c].messageCount <= m) {
+            c++;
+        }
+        const SimMessageStats& stats = result.messages[m];
+        std::snprintf(line, sizeof(line), "deadly: %s / ID %d: %.1f%% of the playthroughs reaching it die there", model.names[c].c_str(), model.ids[m],
+            Percent(stats.deaths, stats.reached));
+        report.notes.push_back(line);
+    }
+}
+
+// A messages json is mapped and read a character at a time; anything else is loaded whole.
+bool OpenVersion(const std::string& path, DialogueVersion& version, std::vector<Character>& characters, FileReport& report) {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec) || IsBakedPath(path)) {
+        if (!Load(path, characters, report)) {
+            return false;
+        }
+        version.Use(characters);
+        return true;
+    }
+    LoadResult result = version.Open(path);
+    if (!result.ok) {
+        std::string where = result.line != 0 ? ":" + std::to_string(result.line) + ":" + std::to_string(result.column) : "";
+        report.problems.push_back("load failed: " + path + where + ": " + result.error);
+        report.ok = false;
+    }
+    return result.ok;
+}
+
+void AddText(CharacterStats& stats, const Message& message) {
+    stats.textBytes += message.content.size();
+    for (auto& response : message.responce) {
+        stats.textBytes += response.reply.size() + response.content.size();
+    }
+}
+
+}
+
+void DialogueStats::Add(const DialogueStats& other) {
+    characters += other.characters;
+    messages += other.messages;
+    textBytes += other.textBytes;
+    for (int i = 0; i < 3; i++) {
+        relationships[i] += other.relationships[i];
+    }
+}
+
+LoadResult LoadAnyDialogue(const std::string& path, std::vector<Character>& characters, std::vector<FileLoadError>* fileErrors) {
+    if (!IsBakedPath(path)) {
+        return LoadProject(path, characters, fileErrors);
+    }
+
+    LoadResult result;
+    BakedDialogue baked;
+    if (!baked.Open(path, result.error)) {
+        result.ok = false;
+        return result;
+    }
+    std::error_code ec;
+    result.bytesRead = static_cast<std::size_t>(fs::file_size(path, ec));
+    UnbakeCharacters(baked, characters);
+    return result;
+}
+
+std::string ConvertOutputPath(const std::string& path, const CliOptions& options) {
+    fs::path input = TrimmedPath(path);
+    fs::path output = options.outDir.empty() ? input.parent_path() : fs::path(options.outDir);
+    output /= input.stem();
+    if (options.to == OutputFormat::Json) {
+        output += ".json";
+    }
+    else if (options.to == OutputFormat::Baked) {
+        output += ".bin";
+    }
+    return output.lexically_normal().string();
+}
+
+void ValidateFile(const std::string& path, const CliOptions&, FileReport& report) {
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    DialogueIndex index;
+    index.Rebuild(characters);
+    DialogueValidator validator;
+    validator.ValidateAll(characters, index);
+    for (auto& problem : validator.Collect(validator.ProblemCount())) {
+        report.problems.push_back(DescribeProblem(characters, problem));
+    }
+    report.ok = report.problems.empty();
+}
+
+void ReformatFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    if (IsChapterProject(path)) {
+        //merging the chapters would lose which file each message came from
+        report.problems.push_back("chapter directories can't be reformatted in place, reformat the files in it");
+        report.ok = false;
+        return;
+    }
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    SaveResult saved = Save(TrimmedPath(path), FormatOf(path), characters, options.write);
+    report.bytesWritten = saved.bytesWritten;
+    if (!saved.ok) {
+        report.problems.push_back(saved.error);
+        report.ok = false;
+    }
+}
+
+void StatsFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    DialogueStats& stats = report.stats;
+    for (auto& character : characters) {
+        CharacterStats entry;
+        entry.name = character.name;
+        entry.messages = character.messages.size();
+        for (auto& message : character.messages) {
+            if (IsKnownRelationship(message.relationship)) {
+                entry.relationships[message.relationship]++;
+            }
+            AddText(entry, message);
+        }
+
+        stats.characters++;
+        stats.messages += entry.messages;
+        stats.textBytes += entry.textBytes;
+        for (int i = 0; i < 3; i++) {
+            stats.relationships[i] += entry.relationships[i];
+        }
+        if (options.perCharacter) {
+            stats.perCharacter.push_back(entry);
+        }
+    }
+}
+
+void ConvertFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    fs::path output = ConvertOutputPath(path, options);
+    if (!options.outDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(options.outDir, ec);
+    }
+
+    SaveResult saved = Save(output, options.to, characters, options.write);
+    report.bytesWritten = saved.bytesWritten;
+    if (!saved.ok) {
+        report.problems.push_back(saved.error);
+        report.ok = false;
+        return;
+    }
+    report.notes.push_back("-> " + output.string());
+}
+
+void SimulateFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    SimModel model = BuildSimModel(characters);
+    if (model.characters.empty()) {
+        report.problems.push_back("no character has any messages to play through");
+        report.ok = false;
+        return;
+    }
+    SimOptions simulate = options.simulate;
+    simulate.threads = options.jobs;
+    SimResult result = RunSimulation(model, simulate);
+    AddSimulationNotes(model, result, options.perCharacter, report);
+}
+
+void BatchFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    if (IsChapterProject(path) && !options.dryRun) {
+        report.problems.push_back("chapter directories can't be batch edited in place, edit the files in it");
+        report.ok = false;
+        return;
+    }
+    std::vector<Character> characters;
+    if (!Load(path, characters, report)) {
+        return;
+    }
+
+    BatchPlan plan = PlanBatch(characters, options.batchFilter, options.batch, options.jobs);
+    if (!plan.ok) {
+        report.problems.push_back(plan.error);
+        report.ok = false;
+        return;
+    }
+    report.notes.push_back(std::to_string(plan.matched) + " messages matched, " + std::to_string(plan.changedMessages) + " changed, "
+        + std::to_string(plan.changes.size()) + " fields" + (options.dryRun ? " (dry run, nothing written)" : ""));
+    for (std::size_t k = 0; k < plan.changes.size() && k < options.diffLines; k++) {
+        report.notes.push_back(DescribeChange(characters, plan.changes[k]));
+    }
+    if (plan.changes.size() > options.diffLines) {
+        report.notes.push_back("... and " + std::to_string(plan.changes.size() - options.diffLines) + " more");
+    }
+    if (options.dryRun || plan.changes.empty()) {
+        return;
+    }
+
+    ApplyBatch(characters, plan.changes, false);
+    SaveResult saved = Save(TrimmedPath(path), FormatOf(path), characters, options.write);
+    report.bytesWritten = saved.bytesWritten;
+    if (!saved.ok) {
+        report.problems.push_back(saved.error);
+        report.ok = false;
+    }
+}
+
+void DiffFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    DialogueVersion before;
+    DialogueVersion after;
+    std::vector<Character> beforeCharacters;
+    std::vector<Character> afterCharacters;
+    if (!OpenVersion(options.against, before, beforeCharacters, report) || !OpenVersion(path, after, afterCharacters, report)) {
+        return;
+    }
+    DiffStats stats;
+    std::vector<std::string> lines;
+    LoadResult result = DiffDialogue(before, after, [&](const MessageDiff& diff) {
+        if (lines.size() < options.diffLines) {
+            lines.push_back(DescribeDiff(diff));
+        }
+    }, stats);
+    report.bytesRead = stats.bytesRead;
+    if (!result.ok) {
+        report.problems.push_back(result.error);
+        report.ok = false;
+        return;
+    }
+    report.notes.push_back("against " + options.against + ": " + std::to_string(stats.unchanged) + " messages unchanged, " + std::to_string(stats.changed)
+        + " changed, " + std::to_string(stats.added) + " added, " + std::to_string(stats.removed) + " removed");
+    for (auto& line : lines) {
+        report.notes.push_back(line);
+    }
+    std::size_t differ = stats.changed + stats.added + stats.removed;
+    if (differ > lines.size()) {
+        report.notes.push_back("... and " + std::to_string(differ - lines.size()) + " more");
+    }
+}
+
+void MergeFile(const std::string& path, const CliOptions& options, FileReport& report) {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec) || IsBakedPath(path)) {
+        report.problems.push_back("merge writes into a messages json, not a project or a baked file");
+        report.ok = false;
+        return;
+    }
+    DialogueVersion base;
+    DialogueVersion ours;
+    DialogueVersion theirs;
+    std::vector<Character> baseCharacters;
+    std::vector<Character> theirCharacters;
+    std::vector<Character> ourCharacters;
+    if (!OpenVersion(options.mergeBase, base, baseCharacters, report) || !OpenVersion(path, ours, ourCharacters, report)
+        || !OpenVersion(options.mergeTheirs, theirs, theirCharacters, report)) {
+        return;
+    }
+    //merged characters go straight out to the file, so only one of them is in memory at a time
+    std::vector<MergeConflict> conflicts;
+    MergeStats stats;
+    SaveResult saved = SaveCharacterStream(path, options.write, [&](CharacterWriter& writer, std::string& error) {
+        LoadResult result = MergeDialogue(base, ours, theirs, [&](Character& character) { writer.Write(character); }, conflicts, stats);
+        error = result.error;
+        return result.ok;
+    });
+    report.bytesRead = stats.bytesRead;
+    report.bytesWritten = saved.bytesWritten;
+    if (!saved.ok) {
+        report.problems.push_back(saved.error);
+        report.ok = false;
+        return;
+    }
+    report.notes.push_back(std::to_string(stats.messages) + " messages: " + std::to_string(stats.unchanged) + " unchanged, " + std::to_string(stats.fromOurs)
+        + " from ours, " + std::to_string(stats.fromTheirs) + " from theirs, " + std::to_string(stats.combined) + " from both, " + std::to_string(stats.added)
+        + " added, " + std::to_string(stats.removed) + " removed");
+    if (conflicts.empty()) {
+        return;
+    }
+    //like git, a conflicted merge is still written (keeping ours) but fails
+    report.ok = false;
+    report.problems.push_back(std::to_string(conflicts.size()) + " conflicts, ours kept for each");
+    for (std::size_t k = 0; k < conflicts.size() && k < options.diffLines; k++) {
+        report.problems.push_back(DescribeConflict(conflicts[k]));
+    }
+    if (conflicts.size() > options.diffLines) {
+        report.problems.push_back("... and " + std::to_string(conflicts.size() - options.diffLines) + " more");
+    }
+}
@@ -0,0 +1,359 @@
+// Headless dialogue tool for build machines: no window, no device, runs anywhere CMake does.
+//
+//   rustless_cli <command> [options] <file or project dir>...
+//
+// Every input is handled independently, so they are spread over a pool of worker threads
+// and the reports are printed in input order once all of them are done.
+
+#include "Cli.h"
+#include "ParallelFor.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+struct CliCommand {
+    const char* name;
+    const char* usage;
+    void (*run)(const std::string& path, const CliOptions& options, FileReport& report);
+};
+
+const CliCommand g_Commands[] = {
+    { "validate", "validate <inputs>...                    parse and check IDs, relationships, responses and names", ValidateFile },
+    { "reformat", "reformat [--compact] <inputs>...        rewrite in place in the canonical layout", ReformatFile },
+    { "stats", "stats [--characters] <inputs>...        counts per character and relationship, text bytes", StatsFile },
+    { "convert", "convert --to json|bin|sharded [--compact] [--out dir] <inputs>...", ConvertFile },
+    { "simulate", "simulate [--runs n] [--policy random|kindest|cruelest] [--health n] [--think seconds] [--seed n] [--characters] <inputs>...", SimulateFile },
+    { "batch", "batch [filters] <changes>... [--dry-run] [--diff n] [--compact] <inputs>...\n"
+        "      filters: --character name, --relationship positive|neuteral|negative, --ids low:high, --match text, --match-regex pattern\n"
+        "      changes, applied in order: --set field value, --add field n, --scale field x, --clamp field low high,\n"
+        "        --replace field from to, --regex field pattern replacement\n"
+        "      fields: content, time, relationship, id, content1, reply1, health1, content2, reply2, health2,\n"
+        "        or the groups health, reply, response and text", BatchFile },
+    { "diff", "diff --against old.json [--diff n] <inputs>...    messages added, removed and changed since old.json, by speaker and ID", DiffFile },
+    { "merge", "merge --base base.json --theirs theirs.json [--diff n] [--compact] <ours.json>\n"
+        "      three-way merge of theirs into ours, written over ours; fails on conflicts, keeping ours for them\n"
+        "      as a git merge driver: driver = rustless_cli merge --base %O --theirs %B %A", MergeFile },
+};
+
+int Usage() {
+    std::cout << "usage: rustless_cli <command> [-j threads] [--profile trace.json] [options] <inputs>...\n";
+    std::cout << "inputs are messages json files, sharded project or chapter directories, or baked .bin files\n";
+    for (auto& command : g_Commands) {
+        std::cout << "  " << command.usage << "\n";
+    }
+    return 2;
+}
+
+double Milliseconds(double seconds) {
+    return seconds * 1000.0;
+}
+
+void RunAll(const CliCommand& command, const CliOptions& options, std::vector<FileReport>& reports) {
+    ParallelFor(reports.size(), options.jobs, [&](std::size_t i) {
+        auto start = std::chrono::steady_clock::now();
+        command.run(reports[i].path, options, reports[i]);
+        reports[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+}
+
+void PrintStats(const DialogueStats& stats, const char* indent) {
+    std::cout << indent << stats.characters << " characters, " << stats.messages << " messages, " << stats.textBytes << " text bytes\n";
+    std::cout << indent;
+    for (int i = 0; i < 3; i++) {
+        std::cout << (i == 0 ? "" : ", ") << kRelationshipNames[i] << " " << stats.relationships[i];
+    }
+    std::cout << "\n";
+    for (auto& character : stats.perCharacter) {
+        std::cout << indent << "  " << character.name << ": " << character.messages << " messages, " << character.textBytes << " text bytes (";
+        for (int i = 0; i < 3; i++) {
+            std::cout << (i == 0 ? "" : ", ") << kRelationshipNames[i] << " " << character.relationships[i];
+        }
+        std::cout << ")\n";
+    }
+}
+
+// Per-span totals, after the trace was written.
+void PrintProfile(const ProfileSnapshot& snapshot) {
+    std::cout << "profile\n";
+    for (auto& span : snapshot.spans) {
+        std::cout << "       " << std::left << std::setw(22) << span.name << std::right << std::setw(8) << span.calls << " calls "
+            << std::setw(10) << Milliseconds(span.totalSeconds) << " ms";
+        if (span.bytes != 0 && span.totalSeconds > 0.0) {
+            std::cout << std::setw(10) << static_cast<double>(span.bytes) / (1024.0 * 1024.0) / span.totalSeconds << " MB/s";
+        }
+        std::cout << "  " << span.allocations << " allocations\n";
+    }
+    for (auto& counter : snapshot.counters) {
+        std::cout << "       " << counter.name << ": " << counter.value << "\n";
+    }
+}
+
+bool ParseFormat(const char* text, OutputFormat& format) {
+    if (std::strcmp(text, "json") == 0) format = OutputFormat::Json;
+    else if (std::strcmp(text, "bin") == 0) format = OutputFormat::Baked;
+    else if (std::strcmp(text, "sharded") == 0) format = OutputFormat::Sharded;
+    else return false;
+    return true;
+}
+
+bool ParsePolicy(const char* text, SimPolicy& policy) {
+    if (std::strcmp(text, "random") == 0) policy = SimPolicy::Random;
+    else if (std::strcmp(text, "kindest") == 0) policy = SimPolicy::Kindest;
+    else if (std::strcmp(text, "cruelest") == 0) policy = SimPolicy::Cruelest;
+    else return false;
+    return true;
+}
+
+bool ParseRelationship(const char* text, int& relationship) {
+    for (int i = 0; i < 3; i++) {
+        if (std::strcmp(text, kRelationshipNames[i]) == 0) {
+            relationship = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reads a batch change's field and the values after it, leaving i on the last one it used.
+bool ParseBatchChange(const std::string& arg, int argc, char** argv, int& i, BatchTransform& transform) {
+    struct Op {
+        const char* option;
+        BatchOp op;
+        int values;
+    };
+    const Op ops[] = {
+        { "--set", BatchOp::Set, 1 },
+        { "--add", BatchOp::Add, 1 },
+        { "--scale", BatchOp::Scale, 1 },
+        { "--clamp", BatchOp::Clamp, 2 },
+        { "--replace", BatchOp::Replace, 2 },
+        { "--regex", BatchOp::RegexReplace, 2 },
+    };
+    for (auto& op : ops) {
+        if (arg != op.option) {
+            continue;
+        }
+        if (i + 1 + op.values >= argc) {
+            std::cout << arg << " needs a field and " << op.values << (op.values == 1 ? " value\n" : " values\n");
+            return false;
+        }
+        if (!ParseBatchFields(argv[i + 1], transform.fields)) {
+            std::cout << "unknown field " << argv[i + 1] << "\n";
+            return false;
+        }
+        transform.op = op.op;
+        const char* first = argv[i + 2];
+        if (op.op == BatchOp::Clamp) {
+            transform.low = std::atoi(first);
+            transform.high = std::atoi(argv[i + 3]);
+        }
+        else if (op.values == 2) {
+            transform.pattern = first;
+            transform.text = argv[i + 3];
+        }
+        else {
+            //set takes text or a number, and relationships by name too
+            transform.text = first;
+            int relationship = 0;
+            transform.value = ParseRelationship(first, relationship) ? relationship : std::atof(first);
+        }
+        i += 1 + op.values;
+        return true;
+    }
+    return false;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const CliCommand* command = nullptr;
+    if (argc >= 2) {
+        for (auto& candidate : g_Commands) {
+            if (std::strcmp(argv[1], candidate.name) == 0) {
+                command = &candidate;
+            }
+        }
+    }
+    if (command == nullptr) {
+        return Usage();
+    }
+
+    CliOptions options;
+    bool formatGiven = false;
+    std::string profilePath;
+    std::vector<FileReport> reports;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--compact") {
+            options.write.compact = true;
+        }
+        else if (arg == "--characters") {
+            options.perCharacter = true;
+        }
+        else if (arg == "-j" && hasValue) {
+            options.jobs = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--profile" && hasValue) {
+            profilePath = argv[++i];
+        }
+        else if (arg == "--out" && hasValue) {
+            options.outDir = argv[++i];
+        }
+        else if (arg == "--runs" && hasValue) {
+            options.simulate.playthroughs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--policy" && hasValue) {
+            if (!ParsePolicy(argv[++i], options.simulate.policy)) {
+                std::cout << "unknown policy " << argv[i] << "\n";
+                return Usage();
+            }
+        }
+        else if (arg == "--health" && hasValue) {
+            options.simulate.startHealth = std::atoi(argv[++i]);
+        }
+        else if (arg == "--think" && hasValue) {
+            options.simulate.thinkMs = static_cast<int>(std::atof(argv[++i]) * 1000.0);
+        }
+        else if (arg == "--seed" && hasValue) {
+            options.simulate.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--character" && hasValue) {
+            options.batchFilter.character = argv[++i];
+        }
+        else if (arg == "--relationship" && hasValue) {
+            if (!ParseRelationship(argv[++i], options.batchFilter.relationship)) {
+                std::cout << "unknown relationship " << argv[i] << "\n";
+                return Usage();
+            }
+        }
+        else if (arg == "--ids" && hasValue) {
+            const char* range = argv[++i];
+            const char* colon = std::strchr(range, ':');
+            if (colon == nullptr) {
+                std::cout << "--ids takes low:high\n";
+                return Usage();
+            }
+            options.batchFilter.minID = std::atoi(range);
+            options.batchFilter.maxID = std::atoi(colon + 1);
+        }
+        else if ((arg == "--match" || arg == "--match-regex") && hasValue) {
+            options.batchFilter.text = argv[++i];
+            options.batchFilter.textRegex = arg == "--match-regex";
+        }
+        else if (arg == "--dry-run") {
+            options.dryRun = true;
+        }
+        else if (arg == "--diff" && hasValue) {
+            options.diffLines = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--against" && hasValue) {
+            options.against = argv[++i];
+        }
+        else if (arg == "--base" && hasValue) {
+            options.mergeBase = argv[++i];
+        }
+        else if (arg == "--theirs" && hasValue) {
+            options.mergeTheirs = argv[++i];
+        }
+        else if (arg == "--set" || arg == "--add" || arg == "--scale" || arg == "--clamp" || arg == "--replace" || arg == "--regex") {
+            BatchTransform transform;
+            if (!ParseBatchChange(arg, argc, argv, i, transform)) {
+                return Usage();
+            }
+            options.batch.push_back(transform);
+        }
+        else if (arg == "--to" && hasValue) {
+            if (!ParseFormat(argv[++i], options.to)) {
+                std::cout << "unknown format " << argv[i] << "\n";
+                return Usage();
+            }
+            formatGiven = true;
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            std::cout << "unknown option " << arg << "\n";
+            return Usage();
+        }
+        else {
+            FileReport report;
+            report.path = arg;
+            reports.push_back(report);
+        }
+    }
+    if (reports.empty() || (command->run == ConvertFile && !formatGiven) || (command->run == BatchFile && options.batch.empty())
+        || (command->run == DiffFile && options.against.empty()) || (command->run == MergeFile && (options.mergeBase.empty() || options.mergeTheirs.empty()))) {
+        return Usage();
+    }
+
+    //two inputs converting onto the same output would race on its temp file
+    if (command->run == ConvertFile) {
+        std::unordered_map<std::string, std::string> outputs;
+        for (auto& report : reports) {
+            auto output = outputs.emplace(ConvertOutputPath(report.path, options), report.path);
+            if (!output.second) {
+                std::cout << report.path << " and " << output.first->second << " would both convert to " << output.first->first << "\n";
+                return 2;
+            }
+        }
+    }
+
+    if (!profilePath.empty()) {
+        SetProfiling(true);
+    }
+    auto start = std::chrono::steady_clock::now();
+    RunAll(*command, options, reports);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    double busy = 0.0;
+    std::size_t bytesRead = 0;
+    DialogueStats total;
+    for (auto& report : reports) {
+        busy += report.seconds;
+        bytesRead += report.bytesRead;
+        total.Add(report.stats);
+        if (!report.ok) {
+            failed++;
+        }
+
+        std::cout << (report.ok ? "ok     " : "FAILED ") << report.path << "  " << std::fixed << std::setprecision(2) << Milliseconds(report.seconds) << " ms";
+        if (report.bytesWritten != 0) {
+            std::cout << ", " << report.bytesWritten << " bytes written";
+        }
+        std::cout << "\n";
+        for (auto& note : report.notes) {
+            std::cout << "       " << note << "\n";
+        }
+        for (auto& problem : report.problems) {
+            std::cout << "       " << problem << "\n";
+        }
+        if (report.ok && command->run == StatsFile) {
+            PrintStats(report.stats, "       ");
+        }
+    }
+
+    std::cout << reports.size() << " inputs, " << failed << " failed, " << bytesRead << " bytes read in " << std::fixed << std::setprecision(2) << Milliseconds(wall) << " ms (" << Milliseconds(busy) << " ms of work)\n";
+    if (command->run == StatsFile && reports.size() > 1) {
+        std::cout << "total\n";
+        PrintStats(total, "       ");
+    }
+    if (!profilePath.empty()) {
+        std::string error;
+        if (!ExportProfileTrace(profilePath, error)) {
+            std::cout << error << "\n";
+            return 1;
+        }
+        PrintProfile(TakeProfileSnapshot());
+        std::cout << "trace written to " << profilePath << "\n";
+    }
+    return failed == 0 ? 0 : 1;
+}